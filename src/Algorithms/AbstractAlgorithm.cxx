@@ -20,13 +20,20 @@
 
 #include "AbstractAlgorithm.h"
 
+#include "CaretProfiler.h"
+
 using namespace std;
 using namespace caret;
 
-AbstractAlgorithm::AbstractAlgorithm(ProgressObject* myProgressObject)
+AbstractAlgorithm::AbstractAlgorithm(ProgressObject* myProgressObject, const AString& profileName)
 {
     m_progObj = myProgressObject;
     m_finish = true;
+    m_profiled = CaretProfiler::isEnabled();
+    if (m_profiled)
+    {
+        CaretProfiler::beginSection(profileName);
+    }
     if (m_progObj == NULL)
     {
         m_finish = false;
@@ -56,6 +63,10 @@ float AbstractAlgorithm::getAlgorithmWeight()
 
 AbstractAlgorithm::~AbstractAlgorithm()
 {
+    if (m_profiled)
+    {
+        CaretProfiler::endSection();
+    }
     if ((m_progObj != NULL) && m_finish)
     {
         m_progObj->forceFinish();
@@ -34,13 +34,15 @@ namespace caret {
     {
         ProgressObject* m_progObj;//so that the destructor can make sure the bar finishes
         bool m_finish;
+        bool m_profiled;//so that the destructor ends the profiling section only if the constructor started one
         AbstractAlgorithm();//prevent default construction
     protected:
         ///override this with the weights of the algorithms this algorithm will call
         static float getSubAlgorithmWeight();//protected so that people don't try to use them to set algorithm weights in progress objects
         ///override this with the amount of work the algorithm does internally, outside of calls to other algorithms
         static float getAlgorithmInternalWeight();
-        AbstractAlgorithm(ProgressObject* myProgressObject);
+        ///profileName names the profiling section, derived algorithms pass their getCommandSwitch()
+        AbstractAlgorithm(ProgressObject* myProgressObject, const AString& profileName = "algorithm");
         virtual ~AbstractAlgorithm();
     public:
         ///use this to set the weight parameter of a ProgressObject
@@ -187,7 +187,7 @@ void AlgorithmCiftiCorrelation::useParameters(OperationParameters* myParams, Pro
 }
 
 AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, CiftiFile* myCiftiOut, const vector<float>* weights,
-                                                     const bool& fisherZ, const float& memLimitGB, const bool& noDemean, const bool& covariance) : AbstractAlgorithm(myProgObj)
+                                                     const bool& fisherZ, const float& memLimitGB, const bool& noDemean, const bool& covariance) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (covariance)
@@ -287,7 +287,7 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
 AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, CiftiFile* myCiftiOut,
                                                      const MetricFile* leftRoi, const MetricFile* rightRoi, const MetricFile* cerebRoi,
                                                      const VolumeFile* volRoi, const vector<float>* weights, const bool& fisherZ, const float& memLimitGB,
-                                                     const bool& noDemean, const bool& covariance) : AbstractAlgorithm(myProgObj)
+                                                     const bool& noDemean, const bool& covariance) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (covariance)
@@ -475,7 +475,7 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
 
 AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj, const CiftiFile* myCifti, CiftiFile* myCiftiOut, const CiftiFile* ciftiRoi,
                                                      const vector<float>* weights, const bool& fisherZ, const float& memLimitGB,
-                                                     const bool& noDemean, const bool& covariance): AbstractAlgorithm(NULL)//HACK: get around the sentinel by passing a null, because this implementation calls another
+                                                     const bool& noDemean, const bool& covariance): AbstractAlgorithm(NULL, getCommandSwitch())//HACK: get around the sentinel by passing a null, because this implementation calls another
 {
     const CiftiXML& roiXML = ciftiRoi->getCiftiXML();//roi is not optional in this variant
     if (roiXML.getMappingType(CiftiXML::ALONG_COLUMN) != CiftiMappingType::BRAIN_MODELS) throw AlgorithmException("cifti roi does not have brain models mapping along column");
@@ -20,7 +20,7 @@
 
 #include "AlgorithmCiftiCorrelationGradient.h"
 #include "AlgorithmException.h"
-#include "AlgorithmMetricGradient.h"
+#include "MetricGradientObject.h"
 #include "MetricSmoothingObject.h"
 #include "AlgorithmVolumeGradient.h"
 #include "CaretLogger.h"
@@ -188,7 +188,7 @@ AlgorithmCiftiCorrelationGradient::AlgorithmCiftiCorrelationGradient(ProgressObj
                                                                      const float& surfKern, const float& volKern, const bool& undoFisherInput, const bool& applyFisher,
                                                                      const float& surfaceExclude, const float& volumeExclude,
                                                                      const bool& covariance,
-                                                                     const float& memLimitGB) : AbstractAlgorithm(myProgObj)
+                                                                     const float& memLimitGB) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     init(myCifti, undoFisherInput, applyFisher, covariance);
@@ -307,27 +307,39 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         areaData = myAreas->getValuePointerForColumn(0);
     }
+    int numNodes = mySurf->getNumberOfNodes();
     MetricFile myRoi;
-    myRoi.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
+    myRoi.setNumberOfNodesAndColumns(numNodes, 1);
     myRoi.initializeColumn(0);
-    vector<int> rowsToCache;
+    vector<int> ciftiIndices(mapSize), rowsToCache;
     for (int i = 0; i < mapSize; ++i)
     {
         myRoi.setValue(myMap[i].m_surfaceNode, 0, 1.0f);
-        if (cacheFullInput)
-        {
-            rowsToCache.push_back(myMap[i].m_ciftiIndex);
-        }
+        ciftiIndices[i] = myMap[i].m_ciftiIndex;
     }
+    const float* roiColumn = myRoi.getValuePointerForColumn(0);
     if (cacheFullInput)
     {
-        cacheRows(rowsToCache);
+        cacheRows(ciftiIndices);
     }
     CaretPointer<MetricSmoothingObject> mySmooth;
     if (surfKern > 0.0f)
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData));//computes the smoothing weights only once per surface
     }
+    MetricGradientObject myGradient(mySurf, areaData);//ditto for the gradient geometry and operator
+    myGradient.buildOperator(roiColumn);
+    if (myGradient.getOperatorFallbackNode() != -1)
+    {
+        CaretLogFine("gradient calculation found a NaN/inf with regression method for at least vertex " + AString::number(myGradient.getOperatorFallbackNode()));
+    }
+    if (myGradient.getOperatorFailedNode() != -1)
+    {
+        CaretLogFine("Failed to compute gradient for at least vertex " + AString::number(myGradient.getOperatorFailedNode()) +
+                     " with standard and fallback methods, outputting ZERO, check your surface for disconnected vertices or other strangeness");
+    }
+    bool haveFailed = false;
+    vector<float> chunkCorr;
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -341,65 +353,48 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             }
             cacheRows(rowsToCache);
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-        MetricFile computeMetric;
-        computeMetric.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), endpos - startpos);
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < mapSize; ++i)
+        correlateChunk(ciftiIndices, startpos, endpos, chunkCorr);
+        int numMetricCols = endpos - startpos;
+#pragma omp CARET_PAR
         {
-            float movingRrs;
-            const float* movingRow;
-            int myrow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myMap[myrow].m_ciftiIndex, movingRrs);
-            }
-            for (int j = startpos; j < endpos; ++j)
-            {
-                if (myrow >= startpos && myrow < endpos)
+            vector<float> colScratch(numNodes, 0.0f), smoothScratch, gradScratch(numNodes);//vertices outside the map stay zero
+            if (surfKern > 0.0f) smoothScratch.resize(numNodes);
+            vector<double> myAccum(mapSize, 0.0);
+            bool myFailed = false;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int j = 0; j < numMetricCols; ++j)
+            {//smooth and take the gradient of each correlation map while it is still in cache, rather than one step at a time over the whole chunk
+                const float* chunkCol = chunkCorr.data() + (int64_t)j * mapSize;
+                for (int i = 0; i < mapSize; ++i)
                 {
-                    if (j >= myrow)
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                        float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                        computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
-                        computeMetric.setValue(myMap[j].m_surfaceNode, myrow - startpos, result);
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                    float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                    computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
+                    colScratch[myMap[i].m_surfaceNode] = chunkCol[i];
+                }
+                const float* toGradient = colScratch.data();
+                if (surfKern > 0.0f)
+                {
+                    mySmooth->smoothData(colScratch.data(), smoothScratch.data());
+                    toGradient = smoothScratch.data();
+                }
+                myGradient.applyOperator(toGradient, 1, 1, gradScratch.data(), NULL, &myFailed);
+                for (int i = 0; i < mapSize; ++i)
+                {
+                    myAccum[i] += gradScratch[myMap[i].m_surfaceNode];
                 }
             }
-        }
-        int numMetricCols = endpos - startpos;
-        MetricFile outputMetric, outputMetric2;
-        for (int j = 0; j < numMetricCols; ++j)
-        {
-            const float* myCol;
-            if (surfKern > 0.0f)
-            {
-                mySmooth->smoothColumn(&computeMetric, j, &outputMetric);
-                AlgorithmMetricGradient(NULL, mySurf, &outputMetric, &outputMetric2, NULL, -1.0f, &myRoi, false, -1, myAreas);
-                myCol = outputMetric2.getValuePointerForColumn(0);
-            } else {
-                AlgorithmMetricGradient(NULL, mySurf, &computeMetric, &outputMetric, NULL, -1.0f, &myRoi, false, j, myAreas);
-                myCol = outputMetric.getValuePointerForColumn(0);
-            }
-            for (int i = 0; i < mapSize; ++i)
+#pragma omp critical
             {
-                const float* roiColumn = myRoi.getValuePointerForColumn(0);
-                if (roiColumn[myMap[i].m_surfaceNode] > 0.0f)
+                for (int i = 0; i < mapSize; ++i)
                 {
-                    accum[i] += myCol[myMap[i].m_surfaceNode];
+                    accum[i] += myAccum[i];
                 }
+                if (myFailed) haveFailed = true;
             }
         }
     }
+    if (haveFailed)
+    {
+        CaretLogFine("gradient was not a number for at least one vertex, outputting ZERO, check the input for NaN values");
+    }
     for (int i = 0; i < mapSize; ++i)
     {
         m_outColumn[myMap[i].m_ciftiIndex] = accum[i] / mapSize;
@@ -437,30 +432,30 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
         areaData = myAreas->getValuePointerForColumn(0);
     }
     CaretPointer<GeodesicHelperBase> myGeoBase(new GeodesicHelperBase(mySurf, areaData));//can't really have SurfaceFile cache ones with corrected areas
+    int numNodes = mySurf->getNumberOfNodes();
     MetricFile myRoi;
-    myRoi.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
+    myRoi.setNumberOfNodesAndColumns(numNodes, 1);
     myRoi.initializeColumn(0);
-    vector<vector<bool> > roiLookup(numCacheRows);//this gets bit compressed
-    vector<bool> origRoi(mySurf->getNumberOfNodes());
     vector<vector<int32_t> > excludeNodes(numCacheRows);
-    vector<int> rowsToCache;
+    vector<int> ciftiIndices(mapSize), rowsToCache;
     for (int i = 0; i < mapSize; ++i)
     {
         myRoi.setValue(myMap[i].m_surfaceNode, 0, 1.0f);
-        if (cacheFullInput)
-        {
-            rowsToCache.push_back(myMap[i].m_ciftiIndex);
-        }
+        ciftiIndices[i] = myMap[i].m_ciftiIndex;
     }
+    const float* roiColumn = myRoi.getValuePointerForColumn(0);
     if (cacheFullInput)
     {
-        cacheRows(rowsToCache);
+        cacheRows(ciftiIndices);
     }
     CaretPointer<MetricSmoothingObject> mySmooth;
     if (surfKern > 0.0f)
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData));//computes the smoothing weights only once per surface
     }
+    MetricGradientObject myGradient(mySurf, areaData);//ditto for the gradient geometry
+    bool haveUsedFallback = false, haveFailed = false;
+    vector<float> chunkCorr;
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -474,102 +469,79 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             }
             cacheRows(rowsToCache);
         }
-        int numSurfNodes = mySurf->getNumberOfNodes();
 #pragma omp CARET_PAR
         {
             vector<float> distances;
             CaretPointer<GeodesicHelper> myGeoHelp(new GeodesicHelper(myGeoBase));
-#pragma omp CARET_FOR
+#pragma omp CARET_FOR schedule(dynamic)
             for (int i = startpos; i < endpos; ++i)
             {
-                vector<int32_t>& excludeRef = excludeNodes[i - startpos];
-                myGeoHelp->getNodesToGeoDist(myMap[i].m_surfaceNode, surfExclude, excludeRef, distances);
-                vector<bool>& lookupRef = roiLookup[i - startpos];
-                lookupRef.resize(numSurfNodes);
-                for (int j = 0; j < numSurfNodes; ++j)
+                myGeoHelp->getNodesToGeoDist(myMap[i].m_surfaceNode, surfExclude, excludeNodes[i - startpos], distances);
+            }
+        }
+        correlateChunk(ciftiIndices, startpos, endpos, chunkCorr);//the correlations with excluded vertices are computed too, but the roi makes everything ignore them
+        int numMetricCols = endpos - startpos;
+#pragma omp CARET_PAR
+        {
+            vector<float> colScratch(numNodes, 0.0f), smoothScratch, gradScratch(numNodes);//vertices outside the map stay zero
+            if (surfKern > 0.0f) smoothScratch.resize(numNodes);
+            vector<float> excludeRoi(roiColumn, roiColumn + numNodes);
+            vector<double> myAccum(mapSize, 0.0);
+            vector<int32_t> myAccumCount(mapSize, 0);
+            bool myUsedFallback = false, myFailed = false;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int j = 0; j < numMetricCols; ++j)
+            {//smooth and take the gradient of each correlation map while it is still in cache, rather than one step at a time over the whole chunk
+                const float* chunkCol = chunkCorr.data() + (int64_t)j * mapSize;
+                for (int i = 0; i < mapSize; ++i)
                 {
-                    lookupRef[j] = (myRoi.getValue(j, 0) > 0.0f);
+                    colScratch[myMap[i].m_surfaceNode] = chunkCol[i];
                 }
-                int numExclude = excludeRef.size();
-                for (int j = 0; j < numExclude; ++j)
+                int numExclude = (int)excludeNodes[j].size();
+                for (int k = 0; k < numExclude; ++k)
                 {
-                    lookupRef[excludeRef[j]] = false;
+                    excludeRoi[excludeNodes[j][k]] = 0.0f;//exclude the nodes near the seed node
                 }
-            }
-        }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-        MetricFile computeMetric;
-        computeMetric.setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), endpos - startpos);
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < mapSize; ++i)
-        {
-            float movingRrs;
-            const float* movingRow;
-            int myrow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myMap[myrow].m_ciftiIndex, movingRrs);
-            }
-            for (int j = startpos; j < endpos; ++j)
-            {
-                if (roiLookup[j - startpos][myMap[myrow].m_surfaceNode])
+                const float* toGradient = colScratch.data();
+                if (surfKern > 0.0f)
+                {
+                    mySmooth->smoothData(colScratch.data(), smoothScratch.data(), excludeRoi.data());
+                    toGradient = smoothScratch.data();
+                }
+                myGradient.computeGradient(toGradient, gradScratch.data(), NULL, excludeRoi.data(), &myUsedFallback, &myFailed);
+                for (int i = 0; i < mapSize; ++i)
                 {
-                    if (myrow >= startpos && myrow < endpos)
+                    if (excludeRoi[myMap[i].m_surfaceNode] > 0.0f)
                     {
-                        if (j >= myrow)
-                        {
-                            float cacheRrs;
-                            const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                            float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                            computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
-                            computeMetric.setValue(myMap[j].m_surfaceNode, myrow - startpos, result);
-                        }
-                    } else {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                        float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                        computeMetric.setValue(myMap[myrow].m_surfaceNode, j - startpos, result);
+                        myAccum[i] += gradScratch[myMap[i].m_surfaceNode];
+                        myAccumCount[i] += 1;
                     }
                 }
-            }
-        }
-        int numMetricCols = endpos - startpos;
-        MetricFile outputMetric, outputMetric2;
-        MetricFile excludeRoi = myRoi;
-        for (int j = 0; j < numMetricCols; ++j)
-        {
-            int numExclude = (int)excludeNodes[j].size();
-            const float* myCol;
-            for (int k = 0; k < numExclude; ++k)
-            {
-                excludeRoi.setValue(excludeNodes[j][k], 0, 0.0f);//exclude the nodes near the seed node
-            }
-            if (surfKern > 0.0f)
-            {
-                mySmooth->smoothColumn(&computeMetric, j, &outputMetric, &excludeRoi);
-                AlgorithmMetricGradient(NULL, mySurf, &outputMetric, &outputMetric2, NULL, -1.0f, &excludeRoi, false, -1, myAreas);
-                myCol = outputMetric2.getValuePointerForColumn(0);
-            } else {
-                AlgorithmMetricGradient(NULL, mySurf, &computeMetric, &outputMetric, NULL, -1.0f, &excludeRoi, false, j, myAreas);
-                myCol = outputMetric.getValuePointerForColumn(0);
-            }
-            for (int i = 0; i < mapSize; ++i)
-            {
-                const float* roiColumn = excludeRoi.getValuePointerForColumn(0);
-                if (roiColumn[myMap[i].m_surfaceNode] > 0.0f)
+                for (int k = 0; k < numExclude; ++k)
                 {
-                    accum[i] += myCol[myMap[i].m_surfaceNode];
-                    accumCount[i] += 1;//less dubious looking than ++accumCount[i]
+                    excludeRoi[excludeNodes[j][k]] = roiColumn[excludeNodes[j][k]];//and set them back to original roi afterwards, instead of a full reinitialize
                 }
             }
-            for (int k = 0; k < numExclude; ++k)
+#pragma omp critical
             {
-                excludeRoi.setValue(excludeNodes[j][k], 0, myRoi.getValue(excludeNodes[j][k], 0));//and set them back to original roi afterwards, instead of a full reinitialize
+                for (int i = 0; i < mapSize; ++i)
+                {
+                    accum[i] += myAccum[i];
+                    accumCount[i] += myAccumCount[i];
+                }
+                if (myUsedFallback) haveUsedFallback = true;
+                if (myFailed) haveFailed = true;
             }
         }
     }
+    if (haveUsedFallback)
+    {
+        CaretLogFine("gradient calculation found a NaN/inf with regression method for at least one vertex");
+    }
+    if (haveFailed)
+    {
+        CaretLogFine("Failed to compute gradient for at least one vertex with standard and fallback methods, outputting ZERO, check your surface for disconnected vertices or other strangeness");
+    }
     for (int i = 0; i < mapSize; ++i)
     {
         if (accumCount[i] != 0)
@@ -639,19 +611,17 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
     myXML.getVolumeDimsAndSForm(ciftiDims, ciftiSform);
     VolumeFile volRoi(newdims, ciftiSform);
     volRoi.setValueAllVoxels(0.0f);
-    vector<int> rowsToCache;
+    vector<int> ciftiIndices(mapSize), rowsToCache;
     for (int i = 0; i < mapSize; ++i)
     {
         volRoi.setValue(1.0f, myMap[i].m_ijk[0] - offset[0], myMap[i].m_ijk[1] - offset[1], myMap[i].m_ijk[2] - offset[2]);
-        if (cacheFullInput)
-        {
-            rowsToCache.push_back(myMap[i].m_ciftiIndex);
-        }
+        ciftiIndices[i] = myMap[i].m_ciftiIndex;
     }
     if (cacheFullInput)
     {
-        cacheRows(rowsToCache);
+        cacheRows(ciftiIndices);
     }
+    vector<float> chunkCorr;
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -665,40 +635,16 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
             }
             cacheRows(rowsToCache);
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
+        correlateChunk(ciftiIndices, startpos, endpos, chunkCorr);
         vector<int64_t> computeDims = newdims;
         computeDims.push_back(endpos - startpos);
         VolumeFile computeVol(computeDims, ciftiSform);
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < mapSize; ++i)
+        for (int j = startpos; j < endpos; ++j)
         {
-            float movingRrs;
-            const float* movingRow;
-            int myrow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myMap[myrow].m_ciftiIndex, movingRrs);
-            }
-            for (int j = startpos; j < endpos; ++j)
+            const float* chunkCol = chunkCorr.data() + (int64_t)(j - startpos) * mapSize;
+            for (int i = 0; i < mapSize; ++i)
             {
-                if (myrow >= startpos && myrow < endpos)
-                {
-                    if (j >= myrow)
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                        float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                        computeVol.setValue(result, myMap[myrow].m_ijk[0] - offset[0], myMap[myrow].m_ijk[1] - offset[1], myMap[myrow].m_ijk[2] - offset[2], j - startpos);
-                        computeVol.setValue(result, myMap[j].m_ijk[0] - offset[0], myMap[j].m_ijk[1] - offset[1], myMap[j].m_ijk[2] - offset[2], myrow - startpos);
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                    float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                    computeVol.setValue(result, myMap[myrow].m_ijk[0] - offset[0], myMap[myrow].m_ijk[1] - offset[1], myMap[myrow].m_ijk[2] - offset[2], j - startpos);
-                }
+                computeVol.setValue(chunkCol[i], myMap[i].m_ijk[0] - offset[0], myMap[i].m_ijk[1] - offset[1], myMap[i].m_ijk[2] - offset[2], j - startpos);
             }
         }
         VolumeFile outputVol;
@@ -777,19 +723,17 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
     myXML.getVolumeDimsAndSForm(ciftiDims, ciftiSform);
     VolumeFile volRoi(newdims, ciftiSform);
     volRoi.setValueAllVoxels(0.0f);
-    vector<int> rowsToCache;
+    vector<int> ciftiIndices(mapSize), rowsToCache;
     for (int i = 0; i < mapSize; ++i)
     {
         volRoi.setValue(1.0f, myMap[i].m_ijk[0] - offset[0], myMap[i].m_ijk[1] - offset[1], myMap[i].m_ijk[2] - offset[2]);
-        if (cacheFullInput)
-        {
-            rowsToCache.push_back(myMap[i].m_ciftiIndex);
-        }
+        ciftiIndices[i] = myMap[i].m_ciftiIndex;
     }
     if (cacheFullInput)
     {
-        cacheRows(rowsToCache);
+        cacheRows(ciftiIndices);
     }
+    vector<float> chunkCorr;
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -803,47 +747,16 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
             }
             cacheRows(rowsToCache);
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
+        correlateChunk(ciftiIndices, startpos, endpos, chunkCorr);
         vector<int64_t> computeDims = newdims;
         computeDims.push_back(endpos - startpos);
         VolumeFile computeVol(computeDims, ciftiSform);
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < mapSize; ++i)
+        for (int j = startpos; j < endpos; ++j)
         {
-            float movingRrs;
-            const float* movingRow;
-            int myrow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myMap[myrow].m_ciftiIndex, movingRrs);
-            }
-            Vector3D movingLoc;
-            volRoi.indexToSpace(myMap[myrow].m_ijk, movingLoc);//NOTE: this is outside the cropped volume, but matches the real location in the full volume, because we didn't fix the center
-            for (int j = startpos; j < endpos; ++j)
+            const float* chunkCol = chunkCorr.data() + (int64_t)(j - startpos) * mapSize;
+            for (int i = 0; i < mapSize; ++i)
             {
-                Vector3D seedLoc;
-                volRoi.indexToSpace(myMap[j].m_ijk, seedLoc);//ditto
-                if ((movingLoc - seedLoc).length() > volExclude)//don't correlate if closer than the exclude range
-                {
-                    if (myrow >= startpos && myrow < endpos)
-                    {
-                        if (j >= myrow)
-                        {
-                            float cacheRrs;
-                            const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                            float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                            computeVol.setValue(result, myMap[myrow].m_ijk[0] - offset[0], myMap[myrow].m_ijk[1] - offset[1], myMap[myrow].m_ijk[2] - offset[2], j - startpos);
-                            computeVol.setValue(result, myMap[j].m_ijk[0] - offset[0], myMap[j].m_ijk[1] - offset[1], myMap[j].m_ijk[2] - offset[2], myrow - startpos);
-                        }
-                    } else {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(myMap[j].m_ciftiIndex, cacheRrs, true);
-                        float result = correlate(movingRow, movingRrs, cacheRow, cacheRrs);
-                        computeVol.setValue(result, myMap[myrow].m_ijk[0] - offset[0], myMap[myrow].m_ijk[1] - offset[1], myMap[myrow].m_ijk[2] - offset[2], j - startpos);
-                    }
-                }
+                computeVol.setValue(chunkCol[i], myMap[i].m_ijk[0] - offset[0], myMap[i].m_ijk[1] - offset[1], myMap[i].m_ijk[2] - offset[2], j - startpos);
             }
         }
         VolumeFile outputVol, excludeRoi(newdims, ciftiSform);
@@ -887,38 +800,118 @@ void AlgorithmCiftiCorrelationGradient::processVolumeComponent(StructureEnum::En
     }
 }
 
-float AlgorithmCiftiCorrelationGradient::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2)
+void AlgorithmCiftiCorrelationGradient::correlateChunk(const vector<int>& ciftiIndices, const int& startpos, const int& endpos, vector<float>& chunkOut)
 {
-    double r;
-    if (row1 == row2 && !m_covariance)
+    int numIndices = (int)ciftiIndices.size();
+    chunkOut.resize((int64_t)(endpos - startpos) * numIndices);
+    int curRow = 0;//because we can't trust the order threads hit the critical section
+    int numBlocks = (numIndices + MOVING_BLOCK - 1) / MOVING_BLOCK;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int b = 0; b < numBlocks; ++b)
     {
-        r = 1.0;//short circuit for same row
-    } else {
-        double accum = 0.0;
+        int myRows[MOVING_BLOCK], numMoving = 0;
+        const float* movingRows[MOVING_BLOCK];
+        float movingRrs[MOVING_BLOCK];
+#pragma omp critical
+        {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
+            while (numMoving < MOVING_BLOCK && curRow < numIndices)
+            {//so, manually force it to read sequentially
+                myRows[numMoving] = curRow;
+                ++curRow;
+                movingRows[numMoving] = getRow(ciftiIndices[myRows[numMoving]], movingRrs[numMoving], false, numMoving);
+                ++numMoving;
+            }
+        }
+        for (int j = startpos; j < endpos; ++j)
+        {
+            int whichMoving[MOVING_BLOCK], numCompute = 0;
+            const float* computeRows[MOVING_BLOCK];
+            float computeRrs[MOVING_BLOCK], results[MOVING_BLOCK];
+            for (int m = 0; m < numMoving; ++m)
+            {
+                if (myRows[m] >= startpos && myRows[m] < endpos && j < myRows[m]) continue;//symmetric, written when the moving row was j
+                whichMoving[numCompute] = m;
+                computeRows[numCompute] = movingRows[m];
+                computeRrs[numCompute] = movingRrs[m];
+                ++numCompute;
+            }
+            if (numCompute == 0) continue;
+            float cacheRrs;
+            const float* cacheRow = getRow(ciftiIndices[j], cacheRrs, true);
+            correlateBlock(computeRows, computeRrs, numCompute, cacheRow, cacheRrs, results);
+            for (int c = 0; c < numCompute; ++c)
+            {
+                int myrow = myRows[whichMoving[c]];
+                chunkOut[(int64_t)(j - startpos) * numIndices + myrow] = results[c];
+                if (myrow >= startpos && myrow < endpos)
+                {
+                    chunkOut[(int64_t)(myrow - startpos) * numIndices + j] = results[c];
+                }
+            }
+        }
+    }
+}
+
+void AlgorithmCiftiCorrelationGradient::correlateBlock(const float* const* rows, const float* rrs, const int& numRows, const float* row2, const float& rrs2, float* resultsOut)
+{
+    CaretAssert(numRows > 0 && numRows <= MOVING_BLOCK);
+    double accum[MOVING_BLOCK];
+    if (numRows == MOVING_BLOCK)
+    {//each element of row2 is loaded once for all the moving rows
+        double accum0 = 0.0, accum1 = 0.0, accum2 = 0.0, accum3 = 0.0;
+        const float* rowA = rows[0], *rowB = rows[1], *rowC = rows[2], *rowD = rows[3];
         for (int i = 0; i < m_numCols; ++i)
         {
-            accum += row1[i] * row2[i];//these have already had the row means subtracted out
+            const float val = row2[i];
+            accum0 += rowA[i] * val;//these have already had the row means subtracted out
+            accum1 += rowB[i] * val;
+            accum2 += rowC[i] * val;
+            accum3 += rowD[i] * val;
         }
-        if (m_covariance)
+        accum[0] = accum0;
+        accum[1] = accum1;
+        accum[2] = accum2;
+        accum[3] = accum3;
+    } else {
+        for (int m = 0; m < numRows; ++m)
         {
-            r = accum / m_numCols;
-        } else {
-            r = accum / (rrs1 * rrs2);
+            double tempAccum = 0.0;
+            const float* row1 = rows[m];
+            for (int i = 0; i < m_numCols; ++i)
+            {
+                tempAccum += row1[i] * row2[i];
+            }
+            accum[m] = tempAccum;
         }
     }
-    if (!m_covariance)
+    for (int m = 0; m < numRows; ++m)
     {
-        if (m_applyFisher)
+        double r;
+        if (rows[m] == row2 && !m_covariance)
         {
-            if (r > 0.999999) r = 0.999999;//prevent inf
-            if (r < -0.999999) r = -0.999999;//prevent -inf
-            r = 0.5 * log((1 + r) / (1 - r));
+            r = 1.0;//short circuit for same row
         } else {
-            if (r > 1.0) r = 1.0;//don't output anything silly
-            if (r < -1.0) r = -1.0;
+            if (m_covariance)
+            {
+                r = accum[m] / m_numCols;
+            } else {
+                r = accum[m] / (rrs[m] * rrs2);
+            }
+        }
+        if (!m_covariance)
+        {
+            if (m_applyFisher)
+            {
+                if (r > 0.999999) r = 0.999999;//prevent inf
+                if (r < -0.999999) r = -0.999999;//prevent -inf
+                r = 0.5 * log((1 + r) / (1 - r));
+            } else {
+                if (r > 1.0) r = 1.0;//don't output anything silly
+                if (r < -1.0) r = -1.0;
+            }
         }
+        resultsOut[m] = r;
     }
-    return r;
 }
 
 void AlgorithmCiftiCorrelationGradient::init(const CiftiFile* input, const bool& undoFisherInput, const bool& applyFisher,
@@ -988,7 +981,7 @@ void AlgorithmCiftiCorrelationGradient::clearCache()
     m_cacheUsed = 0;
 }
 
-const float* AlgorithmCiftiCorrelationGradient::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached)
+const float* AlgorithmCiftiCorrelationGradient::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached, const int& tempSlot)
 {
     float* ret;
     CaretAssertVectorIndex(m_rowInfo, ciftiIndex);
@@ -1001,7 +994,7 @@ const float* AlgorithmCiftiCorrelationGradient::getRow(const int& ciftiIndex, fl
         {
             throw AlgorithmException("something very bad happened, notify the developers");
         }
-        ret = getTempRow();
+        ret = getTempRow(tempSlot);
         m_inputCifti->getRow(ret, ciftiIndex);
         adjustRow(ret, ciftiIndex);
     }
@@ -1049,28 +1042,25 @@ void AlgorithmCiftiCorrelationGradient::adjustRow(float* rowOut, const int& cift
     }
 }
 
-float* AlgorithmCiftiCorrelationGradient::getTempRow()
+float* AlgorithmCiftiCorrelationGradient::getTempRow(const int& tempSlot)
 {
+    CaretAssert(tempSlot >= 0 && tempSlot < MOVING_BLOCK);
 #ifdef CARET_OMP
     int oldsize = (int)m_tempRows.size();
-    int threadNum = omp_get_thread_num();
-    if (threadNum >= oldsize)
+    int index = omp_get_thread_num() * MOVING_BLOCK + tempSlot;
+#else
+    int oldsize = (int)m_tempRows.size();
+    int index = tempSlot;
+#endif
+    if (index >= oldsize)
     {
-        m_tempRows.resize(threadNum + 1);
-        for (int i = oldsize; i <= threadNum; ++i)
+        m_tempRows.resize(index + 1);
+        for (int i = oldsize; i <= index; ++i)
         {
             m_tempRows[i] = CaretArray<float>(m_numCols);
         }
     }
-    return m_tempRows[threadNum].getArray();
-#else
-    if (m_tempRows.size() == 0)
-    {
-        m_tempRows.resize(1);
-        m_tempRows[0] = CaretArray<float>(m_numCols);
-    }
-    return m_tempRows[0].getArray();
-#endif
+    return m_tempRows[index].getArray();
 }
 
 int AlgorithmCiftiCorrelationGradient::numRowsForMem(const float& memLimitGB, const int64_t& inrowBytes, const int64_t& outrowBytes, const int& numRows, bool& cacheFullInput)
@@ -1091,9 +1081,9 @@ int AlgorithmCiftiCorrelationGradient::numRowsForMem(const float& memLimitGB, co
         int64_t fullPasses = numRows / numRowsFull;
         int64_t fullCorrSkip = (fullPasses * numRowsFull * (numRowsFull - 1) + (numRows - fullPasses * numRowsFull) * (numRows - fullPasses * numRowsFull - 1)) / 2;
 #ifdef CARET_OMP
-        targetBytes -= inrowBytes * omp_get_max_threads();
+        targetBytes -= inrowBytes * omp_get_max_threads() * MOVING_BLOCK;
 #else
-        targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
+        targetBytes -= inrowBytes * MOVING_BLOCK;//moving rows in memory that aren't references to cache
 #endif
         int64_t numPassesPartial = ((outrowBytes + inrowBytes) * numRows + targetBytes - 1) / targetBytes;//break the partial cached passes up equally, to use less memory, and so we don't get an anemic pass at the end
         if (numPassesPartial < 1)
@@ -1120,9 +1110,9 @@ int AlgorithmCiftiCorrelationGradient::numRowsForMem(const float& memLimitGB, co
         cacheFullInput = false;
         int64_t div = max((int64_t)1, (outrowBytes + inrowBytes) * numRows);
 #ifdef CARET_OMP
-        targetBytes -= inrowBytes * omp_get_max_threads();
+        targetBytes -= inrowBytes * omp_get_max_threads() * MOVING_BLOCK;
 #else
-        targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
+        targetBytes -= inrowBytes * MOVING_BLOCK;//moving rows in memory that aren't references to cache
 #endif
         int64_t numPassesPartial = (targetBytes + div - 1) / targetBytes;
         int ret = (numRows + numPassesPartial - 1) / numPassesPartial;
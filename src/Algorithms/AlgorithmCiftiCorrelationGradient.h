@@ -46,6 +46,7 @@ namespace caret {
                 m_cacheIndex = -1;
             }
         };
+        enum { MOVING_BLOCK = 4 };//number of moving rows correlated against each cached row at once
         std::vector<CacheRow> m_rowCache;
         std::vector<RowInfo> m_rowInfo;
         std::vector<CaretArray<float> > m_tempRows;//reuse return values in getRow instead of reallocating
@@ -56,10 +57,11 @@ namespace caret {
         const CiftiFile* m_inputCifti;//so that accesses work through the cache functions
         void cacheRows(const std::vector<int>& ciftiIndices);//grabs the rows and does whatever it needs to, using as much IO bandwidth and CPU resources as available/needed
         void clearCache();
-        const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false);
+        const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false, const int& tempSlot = 0);
         void adjustRow(float* rowOut, const int& ciftiIndex);//does the reverse fisher transform, computes stuff, subtracts mean
-        float* getTempRow();
-        float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2);
+        float* getTempRow(const int& tempSlot);
+        void correlateBlock(const float* const* rows, const float* rrs, const int& numRows, const float* row2, const float& rrs2, float* resultsOut);
+        void correlateChunk(const std::vector<int>& ciftiIndices, const int& startpos, const int& endpos, std::vector<float>& chunkOut);//chunkOut[(j - startpos) * size + i] is the correlation of rows i and j
         void init(const CiftiFile* input, const bool& undoFisherInput, const bool& applyFisher, const bool& covariance);
         int numRowsForMem(const float& memLimitGB, const int64_t& inrowBytes, const int64_t& outrowBytes, const int& numRows, bool& cacheFullInput);
         //void processSurfaceComponentLocal(StructureEnum::Enum& myStructure, const float& surfKern, const float& memLimitGB, SurfaceFile* mySurf);
@@ -131,7 +131,7 @@ void AlgorithmCiftiCreateDenseScalar::useParameters(OperationParameters* myParam
 AlgorithmCiftiCreateDenseScalar::AlgorithmCiftiCreateDenseScalar(ProgressObject* myProgObj, CiftiFile* myCiftiOut, const VolumeFile* myVol,
                                                                  const VolumeFile* myVolLabel, const MetricFile* leftData, const MetricFile* leftRoi,
                                                                  const MetricFile* rightData, const MetricFile* rightRoi, const MetricFile* cerebData,
-                                                                 const MetricFile* cerebRoi) : AbstractAlgorithm(myProgObj)
+                                                                 const MetricFile* cerebRoi) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     CaretAssert(myCiftiOut != NULL);
     LevelProgress myProgress(myProgObj);
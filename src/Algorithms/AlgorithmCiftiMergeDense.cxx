@@ -23,14 +23,27 @@
 
 #include "AlgorithmCiftiReplaceStructure.h"
 #include "AlgorithmCiftiSeparate.h"
+#include "CaretAssert.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "LabelFile.h"
 #include "MetricFile.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    struct DenseCopy
+    {
+        int source;
+        vector<int64_t> inIndices, outIndices;
+    };
+}
+
 AString AlgorithmCiftiMergeDense::getCommandSwitch()
 {
     return "-cifti-merge-dense";
@@ -80,7 +93,7 @@ void AlgorithmCiftiMergeDense::useParameters(OperationParameters* myParams, Prog
     AlgorithmCiftiMergeDense(myProgObj, myDir, ciftiList, myCiftiOut);
 }
 
-AlgorithmCiftiMergeDense::AlgorithmCiftiMergeDense(ProgressObject* myProgObj, const int& myDir, const vector<const CiftiFile*>& ciftiList, CiftiFile* myCiftiOut) : AbstractAlgorithm(myProgObj)
+AlgorithmCiftiMergeDense::AlgorithmCiftiMergeDense(ProgressObject* myProgObj, const int& myDir, const vector<const CiftiFile*>& ciftiList, CiftiFile* myCiftiOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (ciftiList.size() == 0) throw AlgorithmException("no files specified");
@@ -169,87 +182,157 @@ AlgorithmCiftiMergeDense::AlgorithmCiftiMergeDense(ProgressObject* myProgObj, co
     }
     CaretAssert((int)sourceCifti.size() == outXML.getNumberOfBrainModels(myDir));
     myCiftiOut->setCiftiXML(outXML);
+    vector<DenseCopy> copyList;
+    vector<int> labelModels;
     for (int i = 0; i < (int)sourceCifti.size(); ++i)
     {
         CiftiBrainModelInfo myInfo = outXML.getBrainModelInfo(myDir, i);
+        const CiftiXMLOld& otherXML = ciftiList[sourceCifti[i]]->getCiftiXMLOld();
+        DenseCopy thisCopy;
+        thisCopy.source = sourceCifti[i];
         switch (myInfo.m_type)
         {
             case CIFTI_MODEL_TYPE_SURFACE:
             {
                 if (isLabel)
                 {
-                    LabelFile tempFile;
-                    AlgorithmCiftiSeparate(NULL, ciftiList[sourceCifti[i]], myDir, myInfo.m_structure, &tempFile);//using this because dealing with label tables is nasty, but doesn't happen on large files
-                    AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, myInfo.m_structure, &tempFile);
-                } else {//for everything else, just use rows directly, because making large metric files in-memory is problematic
-                    vector<CiftiSurfaceMap> inMap, outMap;
-                    const CiftiXMLOld& otherXML = ciftiList[sourceCifti[i]]->getCiftiXMLOld();
-                    outXML.getSurfaceMap(myDir, outMap, myInfo.m_structure);
-                    otherXML.getSurfaceMap(myDir, inMap, myInfo.m_structure);
-                    CaretAssert(inMap.size() == outMap.size());
-                    vector<float> rowscratch(outXML.getNumberOfColumns()), otherscratch(otherXML.getNumberOfColumns());
-                    if (myDir == CiftiXMLOld::ALONG_ROW)
-                    {
-                        for (int j = 0; j < outXML.getNumberOfRows(); ++j)
-                        {
-                            myCiftiOut->getRow(rowscratch.data(), j, true);
-                            ciftiList[sourceCifti[i]]->getRow(otherscratch.data(), j);
-                            for (int k = 0; k < (int)inMap.size(); ++k)
-                            {
-                                CaretAssert(inMap[k].m_surfaceNode == outMap[k].m_surfaceNode);
-                                rowscratch[outMap[k].m_ciftiIndex] = otherscratch[inMap[k].m_ciftiIndex];
-                            }
-                            myCiftiOut->setRow(rowscratch.data(), j);
-                        }
-                    } else {
-                        for (int k = 0; k < (int)inMap.size(); ++k)
-                        {
-                            CaretAssert(inMap[k].m_surfaceNode == outMap[k].m_surfaceNode);
-                            ciftiList[sourceCifti[i]]->getRow(otherscratch.data(), inMap[k].m_ciftiIndex);
-                            myCiftiOut->setRow(otherscratch.data(), outMap[k].m_ciftiIndex);
-                        }
-                    }
+                    labelModels.push_back(i);//using separate/replace because dealing with label tables is nasty, but doesn't happen on large files
+                    continue;
+                }//for everything else, just use rows directly, because making large metric files in-memory is problematic
+                vector<CiftiSurfaceMap> inMap, outMap;
+                outXML.getSurfaceMap(myDir, outMap, myInfo.m_structure);
+                otherXML.getSurfaceMap(myDir, inMap, myInfo.m_structure);
+                CaretAssert(inMap.size() == outMap.size());
+                for (int k = 0; k < (int)inMap.size(); ++k)
+                {
+                    CaretAssert(inMap[k].m_surfaceNode == outMap[k].m_surfaceNode);
+                    thisCopy.inIndices.push_back(inMap[k].m_ciftiIndex);
+                    thisCopy.outIndices.push_back(outMap[k].m_ciftiIndex);
                 }
                 break;
             }
             case CIFTI_MODEL_TYPE_VOXELS:
             {
                 vector<CiftiVolumeMap> inMap, outMap;
-                const CiftiXMLOld& otherXML = ciftiList[sourceCifti[i]]->getCiftiXMLOld();
                 outXML.getVolumeStructureMap(myDir, outMap, myInfo.m_structure);
                 otherXML.getVolumeStructureMap(myDir, inMap, myInfo.m_structure);
                 CaretAssert(inMap.size() == outMap.size());
-                vector<float> rowscratch(outXML.getNumberOfColumns()), otherscratch(otherXML.getNumberOfColumns());
-                if (myDir == CiftiXMLOld::ALONG_ROW)
+                for (int k = 0; k < (int)inMap.size(); ++k)
                 {
-                    for (int j = 0; j < outXML.getNumberOfRows(); ++j)
-                    {
-                        myCiftiOut->getRow(rowscratch.data(), j, true);
-                        ciftiList[sourceCifti[i]]->getRow(otherscratch.data(), j);
-                        for (int k = 0; k < (int)inMap.size(); ++k)
-                        {
-                            CaretAssert(inMap[k].m_ijk[0] == outMap[k].m_ijk[0]);
-                            CaretAssert(inMap[k].m_ijk[1] == outMap[k].m_ijk[1]);
-                            CaretAssert(inMap[k].m_ijk[2] == outMap[k].m_ijk[2]);
-                            rowscratch[outMap[k].m_ciftiIndex] = otherscratch[inMap[k].m_ciftiIndex];
-                        }
-                        myCiftiOut->setRow(rowscratch.data(), j);
-                    }
-                } else {
-                    for (int k = 0; k < (int)inMap.size(); ++k)
-                    {
-                        CaretAssert(inMap[k].m_ijk[0] == outMap[k].m_ijk[0]);
-                        CaretAssert(inMap[k].m_ijk[1] == outMap[k].m_ijk[1]);
-                        CaretAssert(inMap[k].m_ijk[2] == outMap[k].m_ijk[2]);
-                        ciftiList[sourceCifti[i]]->getRow(otherscratch.data(), inMap[k].m_ciftiIndex);
-                        myCiftiOut->setRow(otherscratch.data(), outMap[k].m_ciftiIndex);
-                    }
+                    CaretAssert(inMap[k].m_ijk[0] == outMap[k].m_ijk[0]);
+                    CaretAssert(inMap[k].m_ijk[1] == outMap[k].m_ijk[1]);
+                    CaretAssert(inMap[k].m_ijk[2] == outMap[k].m_ijk[2]);
+                    thisCopy.inIndices.push_back(inMap[k].m_ciftiIndex);
+                    thisCopy.outIndices.push_back(outMap[k].m_ciftiIndex);
                 }
                 break;
             }
             default:
                 throw AlgorithmException("encountered unknown model type in cifti merge dense");
         }
+        copyList.push_back(thisCopy);
+    }
+    const int64_t BLOCK_BYTES = ((int64_t)1) << 26;
+    int64_t outRowLength = outXML.getNumberOfColumns(), outNumRows = outXML.getNumberOfRows();
+    if (myDir == CiftiXMLOld::ALONG_ROW)
+    {//every input contributes to every output row, so stream blocks of rows from all inputs at once instead of a read-modify-write pass per structure
+        int numInputs = (int)ciftiList.size();
+        int64_t inputRowTotal = 0;
+        for (int i = 0; i < numInputs; ++i)
+        {
+            inputRowTotal += ciftiList[i]->getNumberOfColumns();
+        }
+        int64_t blockRows = max((int64_t)1, min(outNumRows, BLOCK_BYTES / (int64_t)sizeof(float) / (inputRowTotal + 2 * outRowLength)));
+        vector<vector<float> > inBlocks(numInputs);
+        for (int i = 0; i < numInputs; ++i)
+        {
+            inBlocks[i].resize(blockRows * ciftiList[i]->getNumberOfColumns());
+        }
+        vector<float> outBlocks[2];
+        outBlocks[0].resize(blockRows * outRowLength);
+        outBlocks[1].resize(blockRows * outRowLength);
+        int curBlock = 0;
+        int64_t pendingStart = 0, pendingRows = 0;
+        for (int64_t blockStart = 0; blockStart < outNumRows; blockStart += blockRows)
+        {
+            int64_t thisRows = min(blockRows, outNumRows - blockStart);
+            const vector<float>& pendingBlock = outBlocks[1 - curBlock];
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int t = 0; t <= numInputs; ++t)
+            {//each file is only touched by one thread, the extra iteration writes out the previous block
+                if (t < numInputs)
+                {
+                    ciftiList[t]->getRows(inBlocks[t].data(), blockStart, thisRows);
+                } else {
+                    if (pendingRows > 0) myCiftiOut->setRows(pendingBlock.data(), pendingStart, pendingRows);
+                }
+            }
+            float* outBlock = outBlocks[curBlock].data();
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+            for (int64_t r = 0; r < thisRows; ++r)
+            {
+                float* outRow = outBlock + r * outRowLength;
+                for (int64_t c = 0; c < outRowLength; ++c)
+                {
+                    outRow[c] = 0.0f;//label structures get filled in afterwards
+                }
+                for (int m = 0; m < (int)copyList.size(); ++m)
+                {
+                    const DenseCopy& thisCopy = copyList[m];
+                    const float* inRow = inBlocks[thisCopy.source].data() + r * ciftiList[thisCopy.source]->getNumberOfColumns();
+                    int64_t numIndices = (int64_t)thisCopy.inIndices.size();
+                    for (int64_t k = 0; k < numIndices; ++k)
+                    {
+                        outRow[thisCopy.outIndices[k]] = inRow[thisCopy.inIndices[k]];
+                    }
+                }
+            }
+            pendingStart = blockStart;
+            pendingRows = thisRows;
+            curBlock = 1 - curBlock;
+        }
+        if (pendingRows > 0) myCiftiOut->setRows(outBlocks[1 - curBlock].data(), pendingStart, pendingRows);
+    } else {//each structure is a set of whole rows, which are contiguous within a brain model, so copy them in blocks
+        for (int m = 0; m < (int)copyList.size(); ++m)
+        {
+            const DenseCopy& thisCopy = copyList[m];
+            const CiftiFile* thisCifti = ciftiList[thisCopy.source];
+            int64_t numIndices = (int64_t)thisCopy.inIndices.size();
+            bool contiguous = true;
+            for (int64_t k = 1; k < numIndices; ++k)
+            {
+                if (thisCopy.inIndices[k] != thisCopy.inIndices[0] + k || thisCopy.outIndices[k] != thisCopy.outIndices[0] + k)
+                {
+                    contiguous = false;
+                    break;
+                }
+            }
+            if (contiguous)
+            {
+                int64_t blockRows = max((int64_t)1, min(numIndices, BLOCK_BYTES / (int64_t)sizeof(float) / outRowLength));
+                vector<float> blockScratch(blockRows * outRowLength);
+                for (int64_t k = 0; k < numIndices; k += blockRows)
+                {
+                    int64_t thisRows = min(blockRows, numIndices - k);
+                    thisCifti->getRows(blockScratch.data(), thisCopy.inIndices[k], thisRows);
+                    myCiftiOut->setRows(blockScratch.data(), thisCopy.outIndices[k], thisRows);
+                }
+            } else {
+                vector<float> otherscratch(outRowLength);
+                for (int64_t k = 0; k < numIndices; ++k)
+                {
+                    thisCifti->getRow(otherscratch.data(), thisCopy.inIndices[k]);
+                    myCiftiOut->setRow(otherscratch.data(), thisCopy.outIndices[k]);
+                }
+            }
+        }
+    }
+    for (int i = 0; i < (int)labelModels.size(); ++i)
+    {
+        CiftiBrainModelInfo myInfo = outXML.getBrainModelInfo(myDir, labelModels[i]);
+        LabelFile tempFile;
+        AlgorithmCiftiSeparate(NULL, ciftiList[sourceCifti[labelModels[i]]], myDir, myInfo.m_structure, &tempFile);
+        AlgorithmCiftiReplaceStructure(NULL, myCiftiOut, myDir, myInfo.m_structure, &tempFile);
     }
 }
 
@@ -20,12 +20,14 @@
 
 #include "AlgorithmCiftiParcellate.h"
 #include "AlgorithmException.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "MultiDimIterator.h"
 #include "ReductionOperation.h"
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 
@@ -53,11 +55,16 @@ OperationParameters* AlgorithmCiftiParcellate::getParameters()
     
     ret->addCiftiOutputParameter(4, "cifti-out", "output cifti file");
     
+    OptionalParameter* methodOpt = ret->createOptionalParameter(5, "-method", "specify method of parcellation (default MEAN)");
+    methodOpt->addStringParameter(1, "method", "the method to use to assign parcel values from the values of member brainordinates");
+    
     ret->setHelpText(
         AString("Each label in the cifti label file will be treated as a parcel, and all rows or columns within the parcel are averaged together to form the output ") +
         "row or column.  " +
         "If ROW is specified, then the input mapping along rows must be brainordinates, and the output mapping along rows will be parcels, meaning columns will be averaged together.  " +
-        "For dtseries or dscalar, use COLUMN."
+        "For dtseries or dscalar, use COLUMN.  " +
+        "Label data is always parcellated with MODE, ignoring -method.  " +
+        "The parcellation methods are:\n\n" + ReductionOperation::getHelpInfo()
     );
     return ret;
 }
@@ -80,10 +87,19 @@ void AlgorithmCiftiParcellate::useParameters(OperationParameters* myParams, Prog
         }
     }
     CiftiFile* myCiftiOut = myParams->getOutputCifti(4);
-    AlgorithmCiftiParcellate(myProgObj, myCiftiIn, myCiftiLabel, direction, myCiftiOut);
+    ReductionEnum::Enum method = ReductionEnum::MEAN;
+    OptionalParameter* methodOpt = myParams->getOptionalParameter(5);
+    if (methodOpt->m_present)
+    {
+        bool ok = false;
+        method = ReductionEnum::fromName(methodOpt->getString(1), &ok);
+        if (!ok) throw AlgorithmException("unrecognized method string '" + methodOpt->getString(1) + "'");
+    }
+    AlgorithmCiftiParcellate(myProgObj, myCiftiIn, myCiftiLabel, direction, myCiftiOut, method);
 }
 
-AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut) : AbstractAlgorithm(myProgObj)
+AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
+                                                   const ReductionEnum::Enum& method) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
@@ -120,7 +136,6 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     myOutXML.setMap(direction, outParcelMap);
     myCiftiOut->setCiftiXML(myOutXML);
     int64_t numCols = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW);
-    vector<float> scratchRow(numCols);
     vector<int64_t> parcelCounts(numParcels, 0);
     for (int64_t j = 0; j < (int64_t)indexToParcel.size(); ++j)
     {
@@ -142,189 +157,184 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
             break;//there should never be more than one dimension with LABEL type, and if there is, just use the first one, i guess...
         }
     }
-    if (direction == CiftiXML::ALONG_ROW)
+    ReductionEnum::Enum useMethod = method;
+    if (isLabel) useMethod = ReductionEnum::MODE;//label keys can't be averaged
+    if (useMethod == ReductionEnum::INVALID) throw AlgorithmException("invalid reduction method specified");
+    if (useMethod == ReductionEnum::SAMPSTDEV)
+    {
+        for (int i = 0; i < numParcels; ++i)
+        {
+            if (parcelCounts[i] == 1) throw AlgorithmException("SAMPSTDEV requires at least 2 elements in every parcel, parcel '" + outParcelMap.getIndexName(i) + "' has 1");
+        }
+    }
+    //group the dense indices by parcel, so each parcel's members are contiguous when gathered
+    vector<int64_t> parcelStart(numParcels + 1, 0);
+    for (int i = 0; i < numParcels; ++i)
+    {
+        parcelStart[i + 1] = parcelStart[i] + parcelCounts[i];
+    }
+    const int64_t numMembers = parcelStart[numParcels];
+    vector<int64_t> sortedIndices(numMembers);
     {
-        vector<float> scratchOutRow(numParcels);
-        if (isLabel)
+        vector<int64_t> fillPos(parcelStart.begin(), parcelStart.end() - 1);
+        for (int64_t j = 0; j < (int64_t)indexToParcel.size(); ++j)
         {
-            vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation (when not considering vertex area, etc)
-            for (int j = 0; j < numParcels; ++j)
+            int parcel = indexToParcel[j];
+            if (parcel != -1)
             {
-                parcelData[j].reserve(parcelCounts[j]);
+                sortedIndices[fillPos[parcel]] = j;
+                ++fillPos[parcel];
             }
-            for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
+        }
+    }
+    if (direction == CiftiXML::ALONG_ROW)
+    {
+        MultiDimIterator<int64_t> rowIter(vector<int64_t>(dims.begin() + 1, dims.end()));
+#pragma omp CARET_PAR
+        {
+            vector<float> scratchRow(numCols), gathered(numMembers), scratchOutRow(numParcels);
+            vector<int64_t> indices;
+            while (true)
             {
-                for (int j = 0; j < numParcels; ++j)
-                {
-                    parcelData[j].clear();//doesn't change allocation
-                }
-                myCiftiIn->getRow(scratchRow.data(), *iter);
-                for (int64_t j = 0; j < numCols; ++j)
-                {
-                    int parcel = indexToParcel[j];
-                    if (parcel != -1)
+                bool haveRow = false;
+#pragma omp critical(ParcellateRead)
+                {//rows are read in order, one at a time, while other threads reduce the rows they already have
+                    if (!rowIter.atEnd())
                     {
-                        parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
+                        indices = *rowIter;
+                        ++rowIter;
+                        myCiftiIn->getRow(scratchRow.data(), indices);
+                        haveRow = true;
                     }
                 }
-                for (int j = 0; j < numParcels; ++j)
+                if (!haveRow) break;
+                for (int64_t k = 0; k < numMembers; ++k)
                 {
-                    CaretAssert(parcelCounts[j] == (int64_t)parcelData[j].size());
-                    if (parcelCounts[j] > 0)
-                    {
-                        scratchOutRow[j] = ReductionOperation::reduce(parcelData[j].data(), parcelData[j].size(), ReductionEnum::MODE);
-                    } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                        scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
-                    }
+                    gathered[k] = scratchRow[sortedIndices[k]];
                 }
-                myCiftiOut->setRow(scratchOutRow.data(), *iter);
-            }
-        } else {
-            for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
-            {
-                vector<double> scratchAccum(numParcels, 0.0);
-                myCiftiIn->getRow(scratchRow.data(), *iter);
-                for (int64_t j = 0; j < numCols; ++j)
+                float emptyValue = 0.0f;
+                if (isLabel)
                 {
-                    int parcel = indexToParcel[j];
-                    if (parcel != -1)
+                    for (int64_t k = 0; k < numMembers; ++k)
                     {
-                        scratchAccum[parcel] += scratchRow[j];
-                    }
+                        gathered[k] = floor(gathered[k] + 0.5f);//round to nearest integer to be safe
+                    }//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
+                    emptyValue = myOutXML.getLabelsMap(labelDir).getMapLabelTable(indices[labelDir - 1])->getUnassignedLabelKey();
                 }
                 for (int j = 0; j < numParcels; ++j)
                 {
                     if (parcelCounts[j] > 0)
                     {
-                        scratchOutRow[j] = scratchAccum[j] / parcelCounts[j];
+                        scratchOutRow[j] = ReductionOperation::reduce(gathered.data() + parcelStart[j], parcelCounts[j], useMethod);
                     } else {
-                        scratchOutRow[j] = 0.0f;
+                        scratchOutRow[j] = emptyValue;
                     }
                 }
-                myCiftiOut->setRow(scratchOutRow.data(), *iter);
+#pragma omp critical(ParcellateWrite)
+                myCiftiOut->setRow(scratchOutRow.data(), indices);
             }
         }
     } else {
-        vector<float> scratchOutRow(numCols);
+        const bool sumMethod = (useMethod == ReductionEnum::MEAN || useMethod == ReductionEnum::SUM);//these don't need all member rows at once
+        const int64_t COL_BLOCK = 64;//columns per transposed tile for the other methods
         vector<int64_t> otherDims = dims;
         otherDims.erase(otherDims.begin() + direction);//direction being parcellated
         otherDims.erase(otherDims.begin());//row
-        if (isLabel)
+        for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
         {
-            vector<vector<vector<float> > > parcelData(numParcels, vector<vector<float> >(numCols));//float so we can use ReductionOperation (when not considering vertex area, etc)
-            for (int i = 0; i < numParcels; ++i)
+            vector<int64_t> indices(dims.size() - 1);//we need to add the parcellated direction index back into the index list to use it in getRow/setRow
+            for (int i = 0; i < (int)otherDims.size(); ++i)
             {
-                for (int j = 0; j < numCols; ++j)
+                if (i < direction - 1)
                 {
-                    parcelData[i][j].reserve(parcelCounts[i]);
+                    indices[i] = (*iter)[i];
+                } else {
+                    indices[i + 1] = (*iter)[i];
                 }
-            }
-            for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
+            }//indices[direction - 1] is uninitialized, as it is the dimension to be parcellated
+#pragma omp CARET_PAR
             {
-                vector<int64_t> indices(dims.size() - 1);//we need to add the parcellated direction index back into the index list to use it in getRow/setRow
-                for (int i = 0; i < (int)otherDims.size(); ++i)
-                {
-                    if (i < direction - 1)
-                    {
-                        indices[i] = (*iter)[i];
-                    } else {
-                        indices[i + 1] = (*iter)[i];
-                    }
-                }//indices[direction - 1] is uninitialized, as it is the dimension to be parcellated
+                vector<int64_t> readIndices = indices, writeIndices = indices;
+                vector<float> scratchRow(numCols), scratchOutRow(numCols), parcelRows, columnBlock;
+                vector<double> accum;
+                if (sumMethod) accum.resize(numCols);
+#pragma omp CARET_FOR schedule(dynamic)
                 for (int i = 0; i < numParcels; ++i)
-                {
-                    for (int j = 0; j < numCols; ++j)
+                {//each thread reduces whole parcels, so its accumulators are only one row
+                    const int64_t count = parcelCounts[i];
+                    writeIndices[direction - 1] = i;
+                    if (count == 0)
                     {
-                        parcelData[i][j].clear();//doesn't change allocation
-                    }
-                }
-                for (int64_t i = 0; i < dims[direction]; ++i)
-                {
-                    int parcel = indexToParcel[i];
-                    if (parcel != -1)
-                    {
-                        indices[direction - 1] = i;
-                        myCiftiIn->getRow(scratchRow.data(), indices);
-                        vector<vector<float> >& parcelRef = parcelData[parcel];
-                        for (int j = 0; j < numCols; ++j)
+                        for (int64_t j = 0; j < numCols; ++j)
                         {
-                            parcelRef[j].push_back(floor(scratchRow[j] + 0.5f));
+                            if (isLabel)
+                            {
+                                if (labelDir == CiftiXML::ALONG_ROW)
+                                {
+                                    scratchOutRow[j] = myOutXML.getLabelsMap(CiftiXML::ALONG_ROW).getMapLabelTable(j)->getUnassignedLabelKey();
+                                } else {
+                                    scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable(indices[labelDir - 1])->getUnassignedLabelKey();
+                                }
+                            } else {
+                                scratchOutRow[j] = 0.0f;
+                            }
                         }
-                    }
-                }
-                for (int i = 0; i < numParcels; ++i)
-                {
-                    indices[direction - 1] = i;
-                    int64_t count = parcelCounts[i];
-                    vector<vector<float> >& parcelRef = parcelData[i];
-                    if (count > 0)
-                    {
-                        for (int j = 0; j < numCols; ++j)
+                    } else if (sumMethod) {
+                        accum.assign(numCols, 0.0);
+                        for (int64_t k = parcelStart[i]; k < parcelStart[i + 1]; ++k)
                         {
-                            CaretAssert((int64_t)parcelRef[j].size() == count);
-                            scratchOutRow[j] = ReductionOperation::reduce(parcelRef[j].data(), parcelRef[j].size(), ReductionEnum::MODE);
+                            readIndices[direction - 1] = sortedIndices[k];
+#pragma omp critical(ParcellateRead)
+                            myCiftiIn->getRow(scratchRow.data(), readIndices);
+                            for (int64_t j = 0; j < numCols; ++j)
+                            {
+                                accum[j] += scratchRow[j];
+                            }
                         }
-                    } else {
-                        for (int j = 0; j < numCols; ++j)
+                        for (int64_t j = 0; j < numCols; ++j)
                         {
-                            CaretAssert((int64_t)parcelRef[j].size() == count);
-                            if (labelDir == CiftiXML::ALONG_ROW)
+                            if (useMethod == ReductionEnum::MEAN)
                             {
-                                scratchOutRow[j] = myOutXML.getLabelsMap(CiftiXML::ALONG_ROW).getMapLabelTable(j)->getUnassignedLabelKey();
+                                scratchOutRow[j] = accum[j] / count;
                             } else {
-                                scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable(indices[labelDir - 1])->getUnassignedLabelKey();
+                                scratchOutRow[j] = accum[j];
                             }
                         }
-                    }
-                    myCiftiOut->setRow(scratchOutRow.data(), indices);
-                }
-            }
-        } else {
-            for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
-            {
-                vector<int64_t> indices(dims.size() - 1);//we need to add the parcellated direction index back into the index list to use it in getRow/setRow
-                for (int i = 0; i < (int)otherDims.size(); ++i)
-                {
-                    if (i < direction - 1)
-                    {
-                        indices[i] = (*iter)[i];
                     } else {
-                        indices[i + 1] = (*iter)[i];
-                    }
-                }//indices[direction - 1] is uninitialized, as it is the dimension to be parcellated
-                vector<vector<double> > accumRows(numParcels, vector<double>(numCols, 0.0f));
-                for (int64_t i = 0; i < dims[direction]; ++i)
-                {
-                    int parcel = indexToParcel[i];
-                    if (parcel != -1)
-                    {
-                        indices[direction - 1] = i;
-                        myCiftiIn->getRow(scratchRow.data(), indices);
-                        vector<double>& parcelRowRef = accumRows[parcel];
-                        for (int64_t j = 0; j < numCols; ++j)
+                        parcelRows.resize(count * numCols);
+                        for (int64_t m = 0; m < count; ++m)
                         {
-                            parcelRowRef[j] += scratchRow[j];
+                            readIndices[direction - 1] = sortedIndices[parcelStart[i] + m];
+#pragma omp critical(ParcellateRead)
+                            myCiftiIn->getRow(parcelRows.data() + m * numCols, readIndices);
                         }
-                    }
-                }
-                for (int i = 0; i < numParcels; ++i)
-                {
-                    indices[direction - 1] = i;
-                    int64_t count = parcelCounts[i];
-                    if (count > 0)
-                    {
-                        vector<double>& parcelRowRef = accumRows[i];
-                        for (int64_t j = 0; j < numCols; ++j)
+                        if (isLabel)
                         {
-                            scratchOutRow[j] = parcelRowRef[j] / count;
+                            for (int64_t k = 0; k < count * numCols; ++k)
+                            {
+                                parcelRows[k] = floor(parcelRows[k] + 0.5f);
+                            }
                         }
-                    } else {
-                        for (int64_t j = 0; j < numCols; ++j)
-                        {
-                            scratchOutRow[j] = 0.0f;
+                        columnBlock.resize(COL_BLOCK * count);
+                        for (int64_t blockStart = 0; blockStart < numCols; blockStart += COL_BLOCK)
+                        {//transpose a tile of columns so each column's values are contiguous for the reduction
+                            const int64_t blockEnd = min(blockStart + COL_BLOCK, numCols);
+                            for (int64_t m = 0; m < count; ++m)
+                            {
+                                const float* rowPtr = parcelRows.data() + m * numCols;
+                                for (int64_t j = blockStart; j < blockEnd; ++j)
+                                {
+                                    columnBlock[(j - blockStart) * count + m] = rowPtr[j];
+                                }
+                            }
+                            for (int64_t j = blockStart; j < blockEnd; ++j)
+                            {
+                                scratchOutRow[j] = ReductionOperation::reduce(columnBlock.data() + (j - blockStart) * count, count, useMethod);
+                            }
                         }
                     }
-                    myCiftiOut->setRow(scratchOutRow.data(), indices);
+#pragma omp critical(ParcellateWrite)
+                    myCiftiOut->setRow(scratchOutRow.data(), writeIndices);
                 }
             }
         }
@@ -24,6 +24,7 @@
 #include "AbstractAlgorithm.h"
 #include "CiftiBrainModelsMap.h"
 #include "CiftiParcelsMap.h"
+#include "ReductionEnum.h"
 #include <vector>
 
 namespace caret {
@@ -35,7 +36,8 @@ namespace caret {
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
-        AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut);
+        AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
+                                 const ReductionEnum::Enum& method = ReductionEnum::MEAN);
         static CiftiParcelsMap parcellateMapping(const CiftiFile* myCiftiLabel, const CiftiBrainModelsMap& toParcellate, std::vector<int>& indexToParcelOut);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
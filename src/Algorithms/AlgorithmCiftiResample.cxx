@@ -631,6 +631,84 @@ namespace
             }
         }
     }
+    
+    ///rows per block for ALONG_ROW resampling, keeps the row copies and per-structure surface scratch to about 64MB
+    int64_t getRowBlockSize(const map<StructureEnum::Enum, ResampleCache>& surfCache, const int64_t& inRowLength, const int64_t& outRowLength, const int64_t& numRows)
+    {
+        const int64_t BLOCK_BYTES = ((int64_t)1) << 26;
+        int64_t totalCurNodes = 0, totalNewNodes = 0;//each structure keeps its own scratch
+        for (map<StructureEnum::Enum, ResampleCache>::const_iterator iter = surfCache.begin(); iter != surfCache.end(); ++iter)
+        {
+            if (!iter->second.copyMode)
+            {
+                totalCurNodes += iter->second.curSphere->getNumberOfNodes();
+                totalNewNodes += iter->second.newSphere->getNumberOfNodes();
+            }
+        }//the dilation input and output metrics are also the size of the new sphere
+        return max((int64_t)1, min(numRows, BLOCK_BYTES / (int64_t)sizeof(float) / (inRowLength + outRowLength + totalCurNodes + 3 * totalNewNodes)));
+    }
+    
+    ///resample a block of rows for one surface structure, real-valued weighted resampling makes one pass through the weights for the whole block
+    void processBlockSurface(ResampleCache& myCache, const vector<vector<float> >& inRows, vector<vector<float> >& outRows, const int64_t& blockRows, const CiftiXML& myInputXML,
+                             const float& surfdilatemm, const bool& surfLargest, const vector<int>& unassignedLabelKey, const int64_t& blockStart)
+    {
+        bool labelMode = (myInputXML.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::LABELS);
+        if (myCache.copyMode || labelMode || surfLargest)
+        {
+            for (int64_t b = 0; b < blockRows; ++b)
+            {
+                processRowSurface(myCache, inRows[b], outRows[b], myInputXML, surfdilatemm, surfLargest, (labelMode ? unassignedLabelKey[blockStart + b] : 0), blockStart + b);
+            }
+            return;
+        }
+        int inMapSize = (int)myCache.inSurfMap.size(), outMapSize = (int)myCache.outSurfMap.size();
+        const int64_t curNodes = myCache.curSphere->getNumberOfNodes(), newNodes = myCache.newSphere->getNumberOfNodes();
+        if ((int64_t)myCache.floatScratch1.size() < curNodes * blockRows)
+        {
+            myCache.floatScratch1.resize(curNodes * blockRows, 0.0f);//vertices outside the input map stay zero, same as the per-row path
+        }
+        if ((int64_t)myCache.floatScratch2.size() < newNodes * blockRows)
+        {
+            myCache.floatScratch2.resize(newNodes * blockRows);
+        }
+        vector<const float*> inPointers(blockRows);
+        vector<float*> outPointers(blockRows);
+        for (int64_t b = 0; b < blockRows; ++b)
+        {
+            float* inScratch = myCache.floatScratch1.data() + b * curNodes;
+            for (int j = 0; j < inMapSize; ++j)
+            {
+                inScratch[myCache.inSurfMap[j].m_surfaceNode] = inRows[b][myCache.inSurfMap[j].m_ciftiIndex];
+            }
+            inPointers[b] = inScratch;
+            outPointers[b] = myCache.floatScratch2.data() + b * newNodes;
+        }
+        myCache.surfResamp.resampleNormalMulti(inPointers.data(), outPointers.data(), (int)blockRows);
+        if (surfdilatemm > 0.0f)
+        {//dilate all rows of the block in one call, so the dilation stencils are computed once per block
+            if (myCache.tempMetric1.getNumberOfColumns() != blockRows)
+            {
+                myCache.tempMetric1.setNumberOfNodesAndColumns(newNodes, blockRows);
+            }
+            for (int64_t b = 0; b < blockRows; ++b)
+            {
+                myCache.tempMetric1.setValuesForColumn(b, outPointers[b]);
+            }
+            AlgorithmMetricDilate(NULL, &(myCache.tempMetric1), myCache.newSphere, surfdilatemm, &(myCache.tempMetric2), &(myCache.surfDilateRoi), NULL, -1, true);
+            for (int64_t b = 0; b < blockRows; ++b)
+            {
+                outPointers[b] = (float*)myCache.tempMetric2.getValuePointerForColumn(b);
+            }
+        }
+        for (int64_t b = 0; b < blockRows; ++b)
+        {
+            const float* outData = outPointers[b];
+            for (int j = 0; j < outMapSize; ++j)
+            {
+                outRows[b][myCache.outSurfMap[j].m_ciftiIndex] = outData[myCache.outSurfMap[j].m_surfaceNode];
+            }
+        }
+    }
 }
 
 AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const int& direction, const CiftiFile* myTemplate, const int& templateDir,
@@ -639,7 +717,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                                                const VolumeFile* warpfield,
                                                const SurfaceFile* curLeftSphere, const SurfaceFile* newLeftSphere, const MetricFile* curLeftAreas, const MetricFile* newLeftAreas,
                                                const SurfaceFile* curRightSphere, const SurfaceFile* newRightSphere, const MetricFile* curRightAreas, const MetricFile* newRightAreas,
-                                               const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas) : AbstractAlgorithm(myProgObj)
+                                               const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     pair<bool, AString> myError = checkForErrors(myCiftiIn, direction, myTemplate, templateDir, mySurfMethod,
@@ -709,48 +787,60 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                            curRightSphere, newRightSphere, curRightAreas, newRightAreas,
                            curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
         int64_t numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-        vector<float> inRow(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW)), outRow(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
-        for (int64_t row = 0; row < numRows; ++row)
+        const int64_t inRowLength = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW), outRowLength = myOutXML.getDimensionLength(CiftiXML::ALONG_ROW);
+        const int64_t rowBlock = getRowBlockSize(surfCache, inRowLength, outRowLength, numRows);
+        vector<vector<float> > inRows(rowBlock, vector<float>(inRowLength)), outRows(rowBlock, vector<float>(outRowLength));
+        for (int64_t blockStart = 0; blockStart < numRows; blockStart += rowBlock)
         {
-            myCiftiIn->getRow(inRow.data(), row);
+            const int64_t blockRows = min(rowBlock, numRows - blockStart);
+            for (int64_t b = 0; b < blockRows; ++b)
+            {
+                myCiftiIn->getRow(inRows[b].data(), blockStart + b);
+            }
             for (int i = 0; i < numSurfStructs; ++i)
             {
                 map<StructureEnum::Enum, ResampleCache>::iterator iter = surfCache.find(surfList[i]);
                 CaretAssert(iter != surfCache.end());
-                processRowSurface(iter->second, inRow, outRow, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey[row], row);
+                processBlockSurface(iter->second, inRows, outRows, blockRows, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey, blockStart);
             }
-            for (int i = 0; i < numVolStructs; ++i)
+            for (int64_t b = 0; b < blockRows; ++b)
             {
-                map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
-                CaretAssert(iter != volCache.end());
-                ResampleCache& myCache = iter->second;
-                if (labelMode)//gets initialized to 0 when not using labels
-                {
-                    myCache.tempVol1->setValueAllVoxels(unassignedLabelKey[row]);
-                }
-                int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
-                for (int j = 0; j < inMapSize; ++j)
+                const int64_t row = blockStart + b;
+                const vector<float>& inRow = inRows[b];
+                vector<float>& outRow = outRows[b];
+                for (int i = 0; i < numVolStructs; ++i)
                 {
-                    myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
-                                               myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
-                                               myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
-                }
-                const VolumeFile* toResample = myCache.tempVol1;
-                if (voldilatemm > 0.0f)
-                {
-                    myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
-                    AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, AlgorithmVolumeDilate::NEAREST, myCache.tempVol3, myCache.volDilateRoi);
-                    toResample = myCache.tempVol3;
-                }
-                AlgorithmVolumeWarpfieldResample(NULL, toResample, warpfield, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
-                for (int j = 0; j < outMapSize; ++j)
-                {
-                    outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
-                                                                                           myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
-                                                                                           myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                    map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
+                    CaretAssert(iter != volCache.end());
+                    ResampleCache& myCache = iter->second;
+                    if (labelMode)//gets initialized to 0 when not using labels
+                    {
+                        myCache.tempVol1->setValueAllVoxels(unassignedLabelKey[row]);
+                    }
+                    int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
+                    for (int j = 0; j < inMapSize; ++j)
+                    {
+                        myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
+                                                   myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
+                                                   myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
+                    }
+                    const VolumeFile* toResample = myCache.tempVol1;
+                    if (voldilatemm > 0.0f)
+                    {
+                        myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
+                        AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, AlgorithmVolumeDilate::NEAREST, myCache.tempVol3, myCache.volDilateRoi);
+                        toResample = myCache.tempVol3;
+                    }
+                    AlgorithmVolumeWarpfieldResample(NULL, toResample, warpfield, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
+                    for (int j = 0; j < outMapSize; ++j)
+                    {
+                        outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
+                                                                                               myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
+                                                                                               myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                    }
                 }
+                myCiftiOut->setRow(outRow.data(), row);
             }
-            myCiftiOut->setRow(outRow.data(), row);
         }
     }
 }
@@ -761,7 +851,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                                                const FloatMatrix& affine,
                                                const SurfaceFile* curLeftSphere, const SurfaceFile* newLeftSphere, const MetricFile* curLeftAreas, const MetricFile* newLeftAreas,
                                                const SurfaceFile* curRightSphere, const SurfaceFile* newRightSphere, const MetricFile* curRightAreas, const MetricFile* newRightAreas,
-                                               const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas) : AbstractAlgorithm(myProgObj)
+                                               const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     pair<bool, AString> myError = checkForErrors(myCiftiIn, direction, myTemplate, templateDir, mySurfMethod,
@@ -830,44 +920,56 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                            curRightSphere, newRightSphere, curRightAreas, newRightAreas,
                            curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
         int64_t numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-        vector<float> inRow(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW)), outRow(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
-        for (int64_t row = 0; row < numRows; ++row)
+        const int64_t inRowLength = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW), outRowLength = myOutXML.getDimensionLength(CiftiXML::ALONG_ROW);
+        const int64_t rowBlock = getRowBlockSize(surfCache, inRowLength, outRowLength, numRows);
+        vector<vector<float> > inRows(rowBlock, vector<float>(inRowLength)), outRows(rowBlock, vector<float>(outRowLength));
+        for (int64_t blockStart = 0; blockStart < numRows; blockStart += rowBlock)
         {
-            myCiftiIn->getRow(inRow.data(), row);
+            const int64_t blockRows = min(rowBlock, numRows - blockStart);
+            for (int64_t b = 0; b < blockRows; ++b)
+            {
+                myCiftiIn->getRow(inRows[b].data(), blockStart + b);
+            }
             for (int i = 0; i < numSurfStructs; ++i)
             {
                 map<StructureEnum::Enum, ResampleCache>::iterator iter = surfCache.find(surfList[i]);
                 CaretAssert(iter != surfCache.end());
-                processRowSurface(iter->second, inRow, outRow, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey[row], row);
+                processBlockSurface(iter->second, inRows, outRows, blockRows, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey, blockStart);
             }
-            for (int i = 0; i < numVolStructs; ++i)
+            for (int64_t b = 0; b < blockRows; ++b)
             {
-                map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
-                CaretAssert(iter != volCache.end());
-                ResampleCache& myCache = iter->second;
-                int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
-                for (int j = 0; j < inMapSize; ++j)
-                {
-                    myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
-                                               myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
-                                               myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
-                }
-                const VolumeFile* toResample = myCache.tempVol1;
-                if (voldilatemm > 0.0f)
-                {
-                    myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
-                    AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, AlgorithmVolumeDilate::NEAREST, myCache.tempVol3, myCache.volDilateRoi);
-                    toResample = myCache.tempVol3;
-                }
-                AlgorithmVolumeAffineResample(NULL, toResample, affine, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
-                for (int j = 0; j < outMapSize; ++j)
+                const int64_t row = blockStart + b;
+                const vector<float>& inRow = inRows[b];
+                vector<float>& outRow = outRows[b];
+                for (int i = 0; i < numVolStructs; ++i)
                 {
-                    outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
-                                                                                           myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
-                                                                                           myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                    map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
+                    CaretAssert(iter != volCache.end());
+                    ResampleCache& myCache = iter->second;
+                    int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
+                    for (int j = 0; j < inMapSize; ++j)
+                    {
+                        myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
+                                                   myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
+                                                   myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
+                    }
+                    const VolumeFile* toResample = myCache.tempVol1;
+                    if (voldilatemm > 0.0f)
+                    {
+                        myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
+                        AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, AlgorithmVolumeDilate::NEAREST, myCache.tempVol3, myCache.volDilateRoi);
+                        toResample = myCache.tempVol3;
+                    }
+                    AlgorithmVolumeAffineResample(NULL, toResample, affine, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
+                    for (int j = 0; j < outMapSize; ++j)
+                    {
+                        outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
+                                                                                               myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
+                                                                                               myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                    }
                 }
+                myCiftiOut->setRow(outRow.data(), row);
             }
-            myCiftiOut->setRow(outRow.data(), row);
         }
     }
 }
@@ -22,9 +22,42 @@
 #include "AlgorithmException.h"
 #include "CiftiFile.h"
 
+#include "CaretOMP.h"
+
+#include <QDir>
+#include <QTemporaryFile>
+
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    ///transposes a numRows x numCols block into out, in square tiles so both sides stay in cache
+    void transposeTiles(const float* in, const int64_t& inStride, const int64_t& numRows, const int64_t& numCols, float* out, const int64_t& outStride)
+    {
+        const int64_t TILE = 32;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t colStart = 0; colStart < numCols; colStart += TILE)
+        {//each thread writes its own set of output rows
+            const int64_t colEnd = min(colStart + TILE, numCols);
+            for (int64_t rowStart = 0; rowStart < numRows; rowStart += TILE)
+            {
+                const int64_t rowEnd = min(rowStart + TILE, numRows);
+                for (int64_t c = colStart; c < colEnd; ++c)
+                {
+                    float* outRow = out + c * outStride;
+                    for (int64_t r = rowStart; r < rowEnd; ++r)
+                    {
+                        outRow[r] = in[r * inStride + c];
+                    }
+                }
+            }
+        }
+    }
+}
+
 AString AlgorithmCiftiTranspose::getCommandSwitch()
 {
     return "-cifti-transpose";
@@ -47,7 +80,9 @@ OperationParameters* AlgorithmCiftiTranspose::getParameters()
     
     ret->setHelpText(
         AString("The input must be a 2-dimensional cifti file.  ") +
-        "The output is a cifti file where every row in the input is a column in the output."
+        "The output is a cifti file where every row in the input is a column in the output.  " +
+        "If -mem-limit is smaller than the input, the input is still only read once, " +
+        "using a scratch file in the system temporary directory (TMPDIR) that is as large as the input."
     );
     return ret;
 }
@@ -69,7 +104,7 @@ void AlgorithmCiftiTranspose::useParameters(OperationParameters* myParams, Progr
     AlgorithmCiftiTranspose(myProgObj, ciftiIn, ciftiOut, memLimitGB);
 }
 
-AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const float& memLimitGB) : AbstractAlgorithm(myProgObj)
+AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const float& memLimitGB) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const CiftiXML& inXML = ciftiIn->getCiftiXML();
@@ -82,32 +117,87 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
     outXML.setMap(0, *(inXML.getMap(1)));
     outXML.setMap(1, *(inXML.getMap(0)));
     ciftiOut->setCiftiXML(outXML);
-    int rowSize = outXML.getDimensionLength(CiftiXML::ALONG_ROW), colSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    int64_t outRowBytes = rowSize * sizeof(float);
-    int numCacheRows = colSize;
-    if (memLimitGB >= 0.0f)
+    const int64_t inCols = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN), inRows = outXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    const int64_t totalBytes = inRows * inCols * sizeof(float);
+    if (memLimitGB < 0.0f || totalBytes <= memLimitGB * 1024 * 1024 * 1024)
     {
-        numCacheRows = memLimitGB * 1024 * 1024 * 1024 / outRowBytes;
-        if (numCacheRows < 1) numCacheRows = 1;
-        if (numCacheRows > colSize) numCacheRows = colSize;
+        vector<float> outData(inCols * inRows);
+        const int64_t BAND_ROWS = 256;
+        vector<float> bandData(min(BAND_ROWS, inRows) * inCols);
+        for (int64_t bandStart = 0; bandStart < inRows; bandStart += BAND_ROWS)
+        {
+            const int64_t bandEnd = min(bandStart + BAND_ROWS, inRows);
+            for (int64_t i = bandStart; i < bandEnd; ++i)
+            {
+                ciftiIn->getRow(bandData.data() + (i - bandStart) * inCols, i);
+            }
+            transposeTiles(bandData.data(), inCols, bandEnd - bandStart, inCols, outData.data() + bandStart, inRows);
+        }
+        for (int64_t k = 0; k < inCols; ++k)
+        {
+            ciftiOut->setRow(outData.data() + k * inRows, k);
+        }
+        return;
+    }
+    //out of core: read the input once, in bands of rows, and spill each transposed band to a scratch file
+    //the scratch file holds band after band, and within a band, the pieces of consecutive output rows are contiguous
+    const int64_t memBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
+    int64_t bandRows = memBytes / (2 * inCols * sizeof(float));//band buffer and its transpose
+    if (bandRows < 1) bandRows = 1;
+    if (bandRows > inRows) bandRows = inRows;
+    QTemporaryFile scratchFile;
+    if (!scratchFile.open())
+    {
+        throw AlgorithmException("failed to create scratch file for transpose in '" + QDir::tempPath() + "'");
+    }
+    {
+        vector<float> bandData(bandRows * inCols), transposed(bandRows * inCols);
+        for (int64_t bandStart = 0; bandStart < inRows; bandStart += bandRows)
+        {
+            const int64_t bandEnd = min(bandStart + bandRows, inRows), numBandRows = bandEnd - bandStart;
+            for (int64_t i = bandStart; i < bandEnd; ++i)
+            {
+                ciftiIn->getRow(bandData.data() + (i - bandStart) * inCols, i);
+            }
+            transposeTiles(bandData.data(), inCols, numBandRows, inCols, transposed.data(), numBandRows);
+            const int64_t numBytes = numBandRows * inCols * sizeof(float);
+            if (scratchFile.write((const char*)transposed.data(), numBytes) != numBytes)
+            {
+                throw AlgorithmException("failed to write to transpose scratch file '" + scratchFile.fileName() + "', is the disk full?");
+            }
+        }
     }
-    vector<vector<float> > cacheRows(numCacheRows, vector<float>(rowSize));
-    vector<float> scratchInRow(colSize);
-    for (int i = 0; i < colSize; i += numCacheRows)//loop through cache chunks
+    //assemble output rows a chunk at a time, reading one contiguous piece of each band
+    int64_t chunkRows = memBytes / (2 * inRows * sizeof(float));//output chunk and one band's piece of it
+    if (chunkRows < 1) chunkRows = 1;
+    if (chunkRows > inCols) chunkRows = inCols;
+    vector<float> outChunk(chunkRows * inRows), bandPiece(chunkRows * bandRows);
+    for (int64_t chunkStart = 0; chunkStart < inCols; chunkStart += chunkRows)
     {
-        int end = i + numCacheRows;
-        if (end > colSize) end = colSize;
-        for (int j = 0; j < rowSize; ++j)//loop through all input rows
+        const int64_t chunkEnd = min(chunkStart + chunkRows, inCols), numChunkRows = chunkEnd - chunkStart;
+        for (int64_t bandStart = 0; bandStart < inRows; bandStart += bandRows)
         {
-            ciftiIn->getRow(scratchInRow.data(), j);
-            for (int k = i; k < end; ++k)
+            const int64_t numBandRows = min(bandStart + bandRows, inRows) - bandStart;
+            const int64_t numBytes = numChunkRows * numBandRows * sizeof(float);
+            if (!scratchFile.seek((bandStart * inCols + chunkStart * numBandRows) * sizeof(float)) ||
+                scratchFile.read((char*)bandPiece.data(), numBytes) != numBytes)
+            {
+                throw AlgorithmException("failed to read from transpose scratch file '" + scratchFile.fileName() + "'");
+            }
+#pragma omp CARET_PARFOR schedule(static)
+            for (int64_t k = 0; k < numChunkRows; ++k)
             {
-                cacheRows[k - i][j] = scratchInRow[k];
+                const float* piece = bandPiece.data() + k * numBandRows;
+                float* outRow = outChunk.data() + k * inRows + bandStart;
+                for (int64_t i = 0; i < numBandRows; ++i)
+                {
+                    outRow[i] = piece[i];
+                }
             }
         }
-        for (int k = i; k < end; ++k)
+        for (int64_t k = chunkStart; k < chunkEnd; ++k)
         {
-            ciftiOut->setRow(cacheRows[k - i].data(), k);
+            ciftiOut->setRow(outChunk.data() + (k - chunkStart) * inRows, k);
         }
     }
 }
@@ -25,6 +25,7 @@
 #include "CaretHeap.h"
 #include "MathFunctions.h"
 #include "SurfaceFile.h"
+#include "VolumeDistanceTransform.h"
 
 #include <algorithm>
 #include <cmath>
@@ -70,13 +71,18 @@ OperationParameters* AlgorithmCreateSignedDistanceVolume::getParameters()
     OptionalParameter* windingMethodOpt = ret->createOptionalParameter(8, "-winding", "winding method for point inside surface test");
     windingMethodOpt->addStringParameter(1, "method", "name of the method (default EVEN_ODD)");
     
+    ret->createOptionalParameter(10, "-fast-unsigned", "output unsigned distance, using a distance transform instead of dijkstra outside the exact limit");
+    
     ret->setHelpText(
         AString("Computes the signed distance function of the surface.  Exact distance is calculated by finding the closest point on any surface triangle ") +
         "to the center of the voxel.  Approximate distance is calculated starting with these distances, using dijkstra's method with a neighborhood of voxels.  " +
         "Specifying too small of an exact distance may produce unexpected results.  Valid specifiers for winding methods are as follows:\n\n" +
         "EVEN_ODD (default)\nNEGATIVE\nNONZERO\nNORMALS\n\nThe NORMALS method uses the normals of triangles and edges, or the closest triangle hit by a ray from the point.  " +
         "This method may be slightly faster, but is only reliable for a closed surface that does not cross through itself.  All other methods count entry (positive) and " +
-        "exit (negative) crossings of a vertical ray from the point, then counts as inside if the total is odd, negative, or nonzero, respectively."
+        "exit (negative) crossings of a vertical ray from the point, then counts as inside if the total is odd, negative, or nonzero, respectively.\n\n" +
+        "The -fast-unsigned option drops the sign, and outside the exact limit uses the exact distance of the nearest exactly computed voxel plus the distance to it, " +
+        "found with a linear time euclidean distance transform.  -approx-neighborhood and -winding have no effect on the approximate region when it is used, " +
+        "unless the volume is skewed, in which case it takes the absolute value of the normal result."
     );
     return ret;
 }
@@ -144,11 +150,13 @@ void AlgorithmCreateSignedDistanceVolume::useParameters(OperationParameters* myP
     {
         myRoiOut = roiOutOpt->getOutputVolume(1);
     }
-    AlgorithmCreateSignedDistanceVolume(myProgObj, mySurf, myVolOut, myRoiOut, fillValue, exactLim, approxLim, approxNeighborhood, myWinding);
+    bool fastUnsigned = myParams->getOptionalParameter(10)->m_present;
+    AlgorithmCreateSignedDistanceVolume(myProgObj, mySurf, myVolOut, myRoiOut, fillValue, exactLim, approxLim, approxNeighborhood, myWinding, fastUnsigned);
 }
 
 AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(ProgressObject* myProgObj, const SurfaceFile* mySurf, VolumeFile* myVolOut, VolumeFile* myRoiOut, const float& fillValue,
-                                                                         const float& exactLim, const float& approxLim, const int& approxNeighborhood, const SignedDistanceHelper::WindingLogic& myWinding) : AbstractAlgorithm(myProgObj)
+                                                                         const float& exactLim, const float& approxLim, const int& approxNeighborhood, const SignedDistanceHelper::WindingLogic& myWinding,
+                                                                         const bool& fastUnsigned) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     if (exactLim <= 0.0f)
     {
@@ -285,8 +293,38 @@ AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(Progres
         }
     }
     myProgress.reportProgress(markweight + exactweight);
-    if (approxLim > exactLim)
+    const bool useTransform = fastUnsigned && VolumeDistanceTransform::isSeparable(myVolOut->getVolumeSpace());
+    if (useTransform)
     {
+        myProgress.setTask("computing distance transform from exact voxels");
+        vector<float> outFrame(myVolOut->getFrame(), myVolOut->getFrame() + frameSize);
+        vector<char> isSource(frameSize, 0);
+        int numExact = (int)exactVoxelList.size();
+        for (int i = 0; i < numExact; i += 3)
+        {
+            int64_t thisIndex = myVolOut->getIndex(exactVoxelList.data() + i);
+            outFrame[thisIndex] = abs(outFrame[thisIndex]);
+            isSource[thisIndex] = 1;
+        }
+        if (approxLim > exactLim)
+        {
+            vector<float> distSquared;
+            vector<int64_t> nearest;
+            VolumeDistanceTransform::compute(myVolOut->getVolumeSpace(), isSource, distSquared, nearest);
+#pragma omp CARET_PARFOR schedule(static)
+            for (int64_t v = 0; v < frameSize; ++v)
+            {
+                if (isSource[v] || nearest[v] == -1) continue;
+                float tempf = outFrame[nearest[v]] + sqrt(distSquared[v]);
+                if (tempf <= approxLim)
+                {
+                    outFrame[v] = tempf;
+                    volMarked[v] |= 6;//valid value, and frozen, for the roi
+                }
+            }
+        }
+        myVolOut->setFrame(outFrame.data());
+    } else if (approxLim > exactLim) {
         myProgress.setTask("approximating distances in extended region");
         int faceNeigh[] = { 1, 0, 0, 
                             -1, 0, 0,
@@ -503,6 +541,15 @@ AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(Progres
                 }
             }
         }
+    }
+    if (fastUnsigned && !useTransform)
+    {
+        vector<float> outFrame(myVolOut->getFrame(), myVolOut->getFrame() + frameSize);
+        for (int64_t v = 0; v < frameSize; ++v)
+        {
+            if ((volMarked[v] & 4) != 0) outFrame[v] = abs(outFrame[v]);
+        }
+        myVolOut->setFrame(outFrame.data());
     }//now make the roi volume
     if (myRoiOut != NULL)
     {
@@ -88,7 +88,7 @@ void AlgorithmLabelToBorder::useParameters(OperationParameters* myParams, Progre
 }
 
 AlgorithmLabelToBorder::AlgorithmLabelToBorder(ProgressObject* myProgObj, const SurfaceFile* mySurf, const LabelFile* myLabel, BorderFile* myBorderOut,
-                                               const float& placement, const int& columnNum) : AbstractAlgorithm(myProgObj)
+                                               const float& placement, const int& columnNum) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (mySurf->getNumberOfNodes() != myLabel->getNumberOfNodes()) throw AlgorithmException("label file does not match surface file number of vertices");
@@ -138,7 +138,7 @@ void AlgorithmMetricDilate::useParameters(OperationParameters* myParams, Progres
 
 AlgorithmMetricDilate::AlgorithmMetricDilate(ProgressObject* myProgObj, const MetricFile* myMetric, const SurfaceFile* mySurf, const float& distance, MetricFile* myMetricOut,
                                              const MetricFile* badNodeRoi, const MetricFile* dataRoi, const int& columnNum,
-                                             const bool& nearest, const bool& linear, const float& exponent, const MetricFile* corrAreas) : AbstractAlgorithm(myProgObj)
+                                             const bool& nearest, const bool& linear, const float& exponent, const MetricFile* corrAreas) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (nearest && linear) throw AlgorithmException("cannot dilate in nearest and linear modes together");
@@ -325,6 +325,18 @@ void AlgorithmMetricDilate::processColumn(float* colScratch, const float* myInpu
     {
         correctedBase.grabNew(new GeodesicHelperBase(mySurf, corrAreas->getValuePointerForColumn(0)));//NOTE: myAreas also points to this when applicable
     }
+    vector<int32_t> closestNodes;
+    vector<float> closestDists;
+    {
+        CaretPointer<GeodesicHelper> myGeoHelp;
+        if (corrAreas == NULL)
+        {
+            myGeoHelp = mySurf->getGeodesicHelper();
+        } else {
+            myGeoHelp.grabNew(new GeodesicHelper(correctedBase));
+        }
+        myGeoHelp->getClosestNodesInRoi(charRoi.data(), distance, closestNodes, closestDists);//one pass from all good vertices, instead of a search from every bad vertex
+    }
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
@@ -347,8 +359,8 @@ void AlgorithmMetricDilate::processColumn(float* colScratch, const float* myInpu
             }
             if ((dataRoiVals == NULL || dataRoiVals[i] > 0.0f) && badNode)
             {
-                float closestDist;
-                int closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
+                float closestDist = closestDists[i];
+                int closestNode = closestNodes[i];
                 if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
                 {
                     const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
@@ -540,11 +552,31 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
     }
     myStencils.resize(badCount);//initializes all stencils to have empty lists
     badCount = 0;
+    for (int i = 0; i < numNodes; ++i)//fill in the vertex list up front, so the parallel part can index it directly
+    {
+        if (badNodeData[i] > 0.0f && (dataRoiVals == NULL || dataRoiVals[i] > 0.0f))
+        {
+            myStencils[badCount].first = i;
+            ++badCount;
+        }
+    }
     CaretPointer<GeodesicHelperBase> correctedBase;
     if (corrAreas != NULL)
     {
         correctedBase.grabNew(new GeodesicHelperBase(mySurf, corrAreas->getValuePointerForColumn(0)));//NOTE: myAreas also points to this when applicable
     }
+    vector<int32_t> closestNodes;
+    vector<float> closestDists;
+    {
+        CaretPointer<GeodesicHelper> myGeoHelp;
+        if (corrAreas == NULL)
+        {
+            myGeoHelp = mySurf->getGeodesicHelper();
+        } else {
+            myGeoHelp.grabNew(new GeodesicHelper(correctedBase));
+        }
+        myGeoHelp->getClosestNodesInRoi(charRoi.data(), distance, closestNodes, closestDists);//one pass from all good vertices, instead of a search from every bad vertex
+    }
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
@@ -556,63 +588,54 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
             myGeoHelp.grabNew(new GeodesicHelper(correctedBase));
         }
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < numNodes; ++i)
+        for (int myIndex = 0; myIndex < badCount; ++myIndex)
         {
-            if (badNodeData[i] > 0.0f && (dataRoiVals == NULL || dataRoiVals[i] > 0.0f))
+            const int i = myStencils[myIndex].first;
+            StencilElem& myElem = myStencils[myIndex].second;
+            float closestDist = closestDists[i];
+            int closestNode = closestNodes[i];
+            if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
             {
-                int myIndex;
-#pragma omp critical
-                {
-                    myIndex = badCount;
-                    ++badCount;
-                }
-                myStencils[myIndex].first = i;
-                StencilElem& myElem = myStencils[myIndex].second;
-                float closestDist;
-                int closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
-                if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
+                const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
+                vector<float> distList;
+                myGeoHelp->getGeoToTheseNodes(i, nodeList, distList);//ok, its a little silly to do this
+                const int numInRange = (int)nodeList.size();
+                for (int j = 0; j < numInRange; ++j)
                 {
-                    const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
-                    vector<float> distList;
-                    myGeoHelp->getGeoToTheseNodes(i, nodeList, distList);//ok, its a little silly to do this
-                    const int numInRange = (int)nodeList.size();
-                    for (int j = 0; j < numInRange; ++j)
+                    if (charRoi[nodeList[j]] != 0 && (closestNode == -1 || distList[j] < closestDist))
                     {
-                        if (charRoi[nodeList[j]] != 0 && (closestNode == -1 || distList[j] < closestDist))
-                        {
-                            closestNode = nodeList[j];
-                            closestDist = distList[j];
-                        }
+                        closestNode = nodeList[j];
+                        closestDist = distList[j];
                     }
                 }
-                if (closestNode != -1)
+            }
+            if (closestNode != -1)
+            {
+                vector<int32_t> nodeList;
+                vector<float> distList;
+                myGeoHelp->getNodesToGeoDist(i, closestDist * cutoffRatio, nodeList, distList);
+                int numInRange = (int)nodeList.size();
+                myElem.m_weightsum = 0.0f;
+                for (int j = 0; j < numInRange; ++j)
                 {
-                    vector<int32_t> nodeList;
-                    vector<float> distList;
-                    myGeoHelp->getNodesToGeoDist(i, closestDist * cutoffRatio, nodeList, distList);
-                    int numInRange = (int)nodeList.size();
-                    myElem.m_weightsum = 0.0f;
-                    for (int j = 0; j < numInRange; ++j)
+                    if (charRoi[nodeList[j]] != 0)
                     {
-                        if (charRoi[nodeList[j]] != 0)
+                        float weight;
+                        const float tolerance = 0.9f;//distances should NEVER be less than closestDist, for obvious reasons
+                        float divdist = distList[j] / closestDist;
+                        if (divdist > tolerance)//tricky: if closestDist is zero, this filters between NaN and inf, resulting in a straight average between nodes with 0 distance
                         {
-                            float weight;
-                            const float tolerance = 0.9f;//distances should NEVER be less than closestDist, for obvious reasons
-                            float divdist = distList[j] / closestDist;
-                            if (divdist > tolerance)//tricky: if closestDist is zero, this filters between NaN and inf, resulting in a straight average between nodes with 0 distance
-                            {
-                                weight = myAreas[nodeList[j]] / pow(divdist, exponent);//NOTE: myAreas has already been pointed to the right data with -corrected-areas
-                            } else {
-                                weight = myAreas[nodeList[j]] / pow(tolerance, exponent);
-                            }
-                            myElem.m_weightsum += weight;
-                            myElem.m_weightlist.push_back(pair<int, float>(nodeList[j], weight));
+                            weight = myAreas[nodeList[j]] / pow(divdist, exponent);//NOTE: myAreas has already been pointed to the right data with -corrected-areas
+                        } else {
+                            weight = myAreas[nodeList[j]] / pow(tolerance, exponent);
                         }
+                        myElem.m_weightsum += weight;
+                        myElem.m_weightlist.push_back(pair<int, float>(nodeList[j], weight));
                     }
-                    if (myElem.m_weightsum == 0.0f)//set list to empty instead of making NaNs
-                    {
-                        myElem.m_weightlist.clear();
-                    }
+                }
+                if (myElem.m_weightsum == 0.0f)//set list to empty instead of making NaNs
+                {
+                    myElem.m_weightlist.clear();
                 }
             }
         }
@@ -663,11 +686,31 @@ void AlgorithmMetricDilate::precomputeNearest(vector<pair<int, int> >& myNearest
     }
     myNearest.resize(badCount);
     badCount = 0;
+    for (int i = 0; i < numNodes; ++i)//fill in the vertex list up front, so the parallel part can index it directly
+    {
+        if (badNodeData[i] > 0.0f && (dataRoiVals == NULL || dataRoiVals[i] > 0.0f))
+        {
+            myNearest[badCount].first = i;
+            ++badCount;
+        }
+    }
     CaretPointer<GeodesicHelperBase> correctedBase;
     if (corrAreas != NULL)
     {
         correctedBase.grabNew(new GeodesicHelperBase(mySurf, corrAreas->getValuePointerForColumn(0)));//NOTE: myAreas also points to this when applicable
     }
+    vector<int32_t> closestNodes;
+    vector<float> closestDists;
+    {
+        CaretPointer<GeodesicHelper> myGeoHelp;
+        if (corrAreas == NULL)
+        {
+            myGeoHelp = mySurf->getGeodesicHelper();
+        } else {
+            myGeoHelp.grabNew(new GeodesicHelper(correctedBase));
+        }
+        myGeoHelp->getClosestNodesInRoi(charRoi.data(), distance, closestNodes, closestDists);//one pass from all good vertices, instead of a search from every bad vertex
+    }
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
@@ -679,36 +722,27 @@ void AlgorithmMetricDilate::precomputeNearest(vector<pair<int, int> >& myNearest
             myGeoHelp.grabNew(new GeodesicHelper(correctedBase));
         }
 #pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < numNodes; ++i)
+        for (int myIndex = 0; myIndex < badCount; ++myIndex)
         {
-            if (badNodeData[i] > 0.0f && (dataRoiVals == NULL || dataRoiVals[i] > 0.0f))
+            const int i = myNearest[myIndex].first;
+            float closestDist = closestDists[i];
+            int closestNode = closestNodes[i];
+            if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
             {
-                int myIndex;
-#pragma omp critical
+                const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
+                vector<float> distList;
+                myGeoHelp->getGeoToTheseNodes(i, nodeList, distList);//ok, its a little silly to do this
+                const int numInRange = (int)nodeList.size();
+                for (int j = 0; j < numInRange; ++j)
                 {
-                    myIndex = badCount;
-                    ++badCount;
-                }
-                myNearest[myIndex].first = i;
-                float closestDist;
-                int closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
-                if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
-                {
-                    const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
-                    vector<float> distList;
-                    myGeoHelp->getGeoToTheseNodes(i, nodeList, distList);//ok, its a little silly to do this
-                    const int numInRange = (int)nodeList.size();
-                    for (int j = 0; j < numInRange; ++j)
+                    if (charRoi[nodeList[j]] != 0 && (closestNode == -1 || distList[j] < closestDist))
                     {
-                        if (charRoi[nodeList[j]] != 0 && (closestNode == -1 || distList[j] < closestDist))
-                        {
-                            closestNode = nodeList[j];
-                            closestDist = distList[j];
-                        }
+                        closestNode = nodeList[j];
+                        closestDist = distList[j];
                     }
                 }
-                myNearest[myIndex].second = closestNode;
             }
+            myNearest[myIndex].second = closestNode;
         }
     }
 }
@@ -25,13 +25,10 @@
 #include "AlgorithmException.h"
 #include "CaretOMP.h"
 #include "CaretLogger.h"
-#include "FloatMatrix.h"
-#include "MathFunctions.h"
 #include "MetricFile.h"
+#include "MetricGradientObject.h"
 #include "PaletteColorMapping.h"
 #include "SurfaceFile.h"
-#include "TopologyHelper.h"
-#include "Vector3D.h"
 
 #include <cmath>
 
@@ -150,7 +147,7 @@ AlgorithmMetricGradient::AlgorithmMetricGradient(ProgressObject* myProgObj,
                                                  const bool myAvgNormals,
                                                  const int32_t myColumn,
                                                  const MetricFile* corrAreaMetric,
-                                                 const bool matchRoiColumns) : AbstractAlgorithm(myProgObj)
+                                                 const bool matchRoiColumns) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     ProgressObject* smoothProgress = NULL;
     if (myProgObj != NULL && myPresmooth > 0.0f)
@@ -192,425 +189,153 @@ AlgorithmMetricGradient::AlgorithmMetricGradient(ProgressObject* myProgObj,
             useColumn = 0;
         }
     }
-    const float* myNormals = NULL;
-    vector<float> avgNormalStorage;
-    if (myAvgNormals)
+    const float* areaData = NULL;
+    if (corrAreaMetric != NULL)
     {
-        avgNormalStorage = mySurf->computeAverageNormals();
-        myNormals = avgNormalStorage.data();
-    } else {
-        mySurf->computeNormals();
-        myNormals = mySurf->getNormalData();
+        areaData = corrAreaMetric->getValuePointerForColumn(0);
     }
-    vector<float> sqrtCorrAreas;//same logic as GeodesicHelper
-    vector<float> sqrtVertAreas;
-    const float* vertAreas = NULL;
-    vector<float> areaData;
-    if (corrAreaMetric != NULL)
+    const int32_t numOutColumns = (myColumn == -1 ? numColumns : 1);
+    myMetricOut->setNumberOfNodesAndColumns(numNodes, numOutColumns);
+    myMetricOut->setStructure(mySurf->getStructure());
+    if (myVectorsOut != NULL)
     {
-        sqrtCorrAreas.resize(numNodes);
-        mySurf->computeNodeAreas(sqrtVertAreas);
-        const float* corrAreaData = corrAreaMetric->getValuePointerForColumn(0);
-        for (int i = 0; i < numNodes; ++i)
-        {
-            sqrtCorrAreas[i] = sqrt(corrAreaData[i]);
-            sqrtVertAreas[i] = sqrt(sqrtVertAreas[i]);
-        }
-        vertAreas = corrAreaData;
-    } else {
-        mySurf->computeNodeAreas(areaData);
-        vertAreas = areaData.data();
+        myVectorsOut->setNumberOfNodesAndColumns(numNodes, numOutColumns * 3);
+        myVectorsOut->setStructure(mySurf->getStructure());
     }
-    const float* myCoords = mySurf->getCoordinateData();
-    bool haveWarned = false, haveFailed = false;//print warning or failure messages only once
-    if (myColumn == -1)
+    for (int32_t outCol = 0; outCol < numOutColumns; ++outCol)
     {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, numColumns);
-        myMetricOut->setStructure(mySurf->getStructure());
-        float* myVecScratch = NULL;
+        const int32_t inCol = (myColumn == -1 ? outCol : useColumn);
+        myMetricOut->setColumnName(outCol, toProcess->getColumnName(inCol) + ", gradient");
+        *(myMetricOut->getPaletteColorMapping(outCol)) = *(toProcess->getPaletteColorMapping(inCol));//copy the palette settings
         if (myVectorsOut != NULL)
         {
-            myVectorsOut->setNumberOfNodesAndColumns(numNodes, numColumns * 3);
-            myVectorsOut->setStructure(mySurf->getStructure());
-            myVecScratch = new float[numNodes * 3];
+            myVectorsOut->setColumnName(outCol * 3, toProcess->getColumnName(inCol) + ", gradient vector X");
+            myVectorsOut->setColumnName(outCol * 3 + 1, toProcess->getColumnName(inCol) + ", gradient vector Y");
+            myVectorsOut->setColumnName(outCol * 3 + 2, toProcess->getColumnName(inCol) + ", gradient vector Z");
         }
-        float* myScratch = new float[numNodes];
-        for (int32_t col = 0; col < numColumns; ++col)
+    }
+    const bool perColumnRoi = (myRoi != NULL && matchRoiColumns && myColumn == -1);
+    const float* sharedRoi = NULL;
+    if (myRoi != NULL && !perColumnRoi)
+    {
+        sharedRoi = myRoi->getValuePointerForColumn(matchRoiColumns ? myColumn : 0);//use the ORIGINAL column number, not the one that has been modified due to a presmoothing step
+    }
+    MetricGradientObject myGradient(mySurf, areaData, myAvgNormals);//vertex geometry, computed once for all columns
+    if (!perColumnRoi)
+    {
+        myGradient.buildOperator(sharedRoi);//the regression is the same for all columns, so solve it once
+    }
+#ifdef CARET_OMP
+    const int32_t numThreads = omp_get_max_threads();
+#else
+    const int32_t numThreads = 1;
+#endif
+    if (perColumnRoi)
+    {//the roi changes the regression, so each column needs the per-vertex method, do a column per thread
+        const int32_t groupSize = min(numThreads, numOutColumns);
+        vector<float> magScratch((int64_t)numNodes * groupSize), vecScratch;
+        if (myVectorsOut != NULL) vecScratch.resize((int64_t)numNodes * groupSize * 3);
+        for (int32_t groupStart = 0; groupStart < numOutColumns; groupStart += groupSize)
         {
-            const float* myRoiColumn = NULL;
-            if (myRoi != NULL)
+            const int32_t groupEnd = min(groupStart + groupSize, numOutColumns);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int32_t col = groupStart; col < groupEnd; ++col)
             {
-                if (matchRoiColumns)
-                {
-                    myRoiColumn = myRoi->getValuePointerForColumn(col);
-                } else {
-                    myRoiColumn = myRoi->getValuePointerForColumn(0);
-                }
-            }
-            const float* myMetricColumn = toProcess->getValuePointerForColumn(col);
-            myMetricOut->setColumnName(col, toProcess->getColumnName(col) + ", gradient");
-            *(myMetricOut->getPaletteColorMapping(col)) = *(toProcess->getPaletteColorMapping(col));//copy the palette settings
-            if (myVectorsOut != NULL)
-            {
-                myVectorsOut->setColumnName(col * 3, toProcess->getColumnName(col) + ", gradient vector X");
-                myVectorsOut->setColumnName(col * 3 + 1, toProcess->getColumnName(col) + ", gradient vector Y");
-                myVectorsOut->setColumnName(col * 3 + 2, toProcess->getColumnName(col) + ", gradient vector Z");
+                const int64_t slot = col - groupStart;
+                myGradient.computeGradient(toProcess->getValuePointerForColumn(col), magScratch.data() + slot * numNodes,
+                                           (myVectorsOut == NULL ? NULL : vecScratch.data() + slot * numNodes * 3), myRoi->getValuePointerForColumn(col));
             }
-#pragma omp CARET_PAR
+            for (int32_t col = groupStart; col < groupEnd; ++col)
             {
-                Vector3D somevec, xhat, yhat;
-                float sanity = 0.0f;
-                CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//this stores and reuses helpers, so it isn't really a problem to call inside the loop
-#pragma omp CARET_FOR schedule(dynamic)
-                for (int32_t i = 0; i < numNodes; ++i)
+                const int64_t slot = col - groupStart;
+                myMetricOut->setValuesForColumn(col, magScratch.data() + slot * numNodes);
+                if (myVectorsOut != NULL)
                 {
-                    if (myRoiColumn != NULL && myRoiColumn[i] <= 0.0f)
-                    {
-                        myScratch[i] = 0.0f;
-                        if (myVecScratch != NULL)
-                        {
-                            myVecScratch[i] = 0.0f;
-                            myVecScratch[i + numNodes] = 0.0f;
-                            myVecScratch[i + numNodes * 2] = 0.0f;
-                        }
-                        continue;
-                    }
-                    int32_t numNeigh;
-                    int32_t i3 = i * 3;
-                    const int32_t* myNeighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);//one function call isn't that bad, most time spent is floating point math anyway
-                    Vector3D myNormal = Vector3D(myNormals + i3).normal();//should already be normalized, but just in case
-                    Vector3D myCoord = myCoords + i3;
-                    float nodeValue = myMetricColumn[i];
-                    somevec[2] = 0.0;
-                    if (abs(myNormal[0]) > abs(myNormal[1]))
-                    {//generate a vector not parallel to normal
-                        somevec[0] = 0.0;
-                        somevec[1] = 1.0;
-                    } else {
-                        somevec[0] = 1.0;
-                        somevec[1] = 0.0;
-                    }
-                    xhat = myNormal.cross(somevec).normal();
-                    yhat = myNormal.cross(xhat).normal();//xhat, yhat are orthogonal unit vectors describing a coord system with k = surface normal
-                    int neighCount = 0;//count within-roi neighbors, not simply surface neighbors
-                    if (numNeigh >= 2)
+                    for (int axis = 0; axis < 3; ++axis)
                     {
-                        FloatMatrix myRegress = FloatMatrix::zeros(3, 4);
-                        for (int32_t j = 0; j < numNeigh; ++j)
-                        {
-                            int32_t whichNode = myNeighbors[j];
-                            int32_t whichNode3 = whichNode * 3;
-                            if (myRoiColumn == NULL || myRoiColumn[whichNode] > 0.0f)
-                            {
-                                ++neighCount;
-                                float tempf = myMetricColumn[whichNode] - nodeValue;
-                                Vector3D neighCoord = myCoords + whichNode3;
-                                somevec = neighCoord - myCoord;
-                                float origMag = somevec.length();//save the original length
-                                float unrollMag = origMag;
-                                float opposite = somevec.dot(myNormal);//check for division by close to zero
-                                if (abs(opposite) > 0.035f * origMag)//do not do unrolling on very small angles - this is ~2 degrees
-                                {
-                                    unrollMag = origMag * asin(opposite / origMag) * origMag / opposite;
-                                }
-                                if (corrAreaMetric != NULL)
-                                {
-                                    unrollMag *= (sqrtCorrAreas[i] + sqrtCorrAreas[whichNode]) / (sqrtVertAreas[i] + sqrtVertAreas[whichNode]);
-                                }
-                                float xmag = xhat.dot(somevec);//dot product to get the direction in 2d
-                                float ymag = yhat.dot(somevec);
-                                float mag2d = sqrt(xmag * xmag + ymag * ymag);//get the new magnitude, to divide out
-                                xmag *= unrollMag / mag2d;//normalize the 2d vector and multiply by unrolled length
-                                ymag *= unrollMag / mag2d;
-                                myRegress[0][0] += xmag * xmag * vertAreas[whichNode];//gather A'A and A'b sums for regression, weighted by vertex area
-                                myRegress[0][1] += xmag * ymag * vertAreas[whichNode];
-                                myRegress[0][2] += xmag * vertAreas[whichNode];
-                                myRegress[1][1] += ymag * ymag * vertAreas[whichNode];
-                                myRegress[1][2] += ymag * vertAreas[whichNode];
-                                myRegress[2][2] += vertAreas[whichNode];
-                                myRegress[0][3] += xmag * tempf * vertAreas[whichNode];
-                                myRegress[1][3] += ymag * tempf * vertAreas[whichNode];
-                                myRegress[2][3] += tempf * vertAreas[whichNode];
-                            }
-                        }
-                        if (neighCount >= 2)
-                        {
-                            myRegress[1][0] = myRegress[0][1];//complete the symmetric elements
-                            myRegress[2][0] = myRegress[0][2];
-                            myRegress[2][1] = myRegress[1][2];
-                            myRegress[2][2] += vertAreas[i];//include center (metric and coord differences will be zero, so this is all that is needed)
-                            FloatMatrix myRref = myRegress.reducedRowEchelon();
-                            somevec = xhat * myRref[0][3] + yhat * myRref[1][3];//somevec is now our surface gradient
-                            sanity = somevec[0] + somevec[1] + somevec[2];
-                        }
+                        myVectorsOut->setValuesForColumn(col * 3 + axis, vecScratch.data() + (slot * 3 + axis) * numNodes);
                     }
-                    if (neighCount > 0 && (neighCount < 2 || sanity != sanity))
-                    {
-                        if (!haveWarned && myRoi == NULL)
-                        {//don't issue this warning with an ROI, because it is somewhat expected
-                            haveWarned = true;
-                            CaretLogWarning("WARNING: gradient calculation found a NaN/inf with regression method for at least vertex " + AString::number(i));
-                        }
-                        float xgrad = 0.0f, ygrad = 0.0f, totalWeight = 0.0f;
-                        for (int32_t j = 0; j < numNeigh; ++j)
-                        {
-                            int32_t whichNode = myNeighbors[j];
-                            int32_t whichNode3 = whichNode * 3;
-                            if (myRoiColumn == NULL || myRoiColumn[whichNode] > 0.0f)
-                            {
-                                float tempf = myMetricColumn[whichNode] - nodeValue;
-                                Vector3D neighCoord = myCoords + whichNode3;
-                                somevec = neighCoord - myCoord;
-                                float origMag = somevec.length();//save the original length
-                                float unrollMag = origMag;
-                                float opposite = somevec.dot(myNormal);//check for division by close to zero
-                                if (abs(opposite) > 0.035f * origMag)//do not do unrolling on very small angles - this is ~2 degrees
-                                {
-                                    unrollMag = origMag * asin(opposite / origMag) * origMag / opposite;
-                                }
-                                if (corrAreaMetric != NULL)
-                                {
-                                    unrollMag *= (sqrtCorrAreas[i] + sqrtCorrAreas[whichNode]) / (sqrtVertAreas[i] + sqrtVertAreas[whichNode]);
-                                }
-                                float xmag = xhat.dot(somevec);//dot product to get the direction in 2d
-                                float ymag = yhat.dot(somevec);
-                                float mag2d = sqrt(xmag * xmag + ymag * ymag);//get the new magnitude, to divide out
-                                tempf /= unrollMag * mag2d;//difference divided by distance gives point estimate of gradient magnitude, also divide by magnitude of 2d vector to normalize the next step at the same time
-                                xgrad += xmag * tempf * vertAreas[whichNode];//point estimate of gradient magnitude times normalized projected direction gives 2d estimate of gradient
-                                ygrad += ymag * tempf * vertAreas[whichNode];//average point estimates for each neighbor to estimate local gradient
-                                totalWeight += vertAreas[whichNode];
-                            }
-                        }
-                        xgrad /= totalWeight;//weighted average
-                        ygrad /= totalWeight;
-                        somevec = xhat * xgrad + yhat * ygrad;//unproject back into 3d
-                        sanity = somevec[0] + somevec[1] + somevec[2];
-                    }
-                    if (neighCount <= 0 || sanity != sanity)
-                    {
-                        if (!haveFailed && myRoiColumn == NULL)
-                        {//don't warn with an roi, they can be strange
-                            haveFailed = true;
-                            CaretLogWarning("Failed to compute gradient for at least vertex " + AString::number(i) +
-                            " with standard and fallback methods, outputting ZERO, check your surface for disconnected vertices or other strangeness");
-                        }
-                        somevec[0] = 0.0f;
-                        somevec[1] = 0.0f;
-                        somevec[2] = 0.0f;
-                    }
-                    if (myVecScratch != NULL)
-                    {
-                        myVecScratch[i] = somevec[0];//split them up far, so that they can be set to columns easily
-                        myVecScratch[numNodes + i] = somevec[1];
-                        myVecScratch[numNodes * 2 + i] = somevec[2];
-                    }
-                    myScratch[i] = MathFunctions::vectorLength(somevec);
                 }
             }
-            if (myVectorsOut != NULL)
-            {
-                myVectorsOut->setValuesForColumn(col * 3, myVecScratch);
-                myVectorsOut->setValuesForColumn(col * 3 + 1, myVecScratch + numNodes);
-                myVectorsOut->setValuesForColumn(col * 3 + 2, myVecScratch + (numNodes * 2));
-            }
-            myMetricOut->setValuesForColumn(col, myScratch);
-            myProgress.reportProgress(((float)col + 1) / numColumns);
+            myProgress.reportProgress(((float)groupEnd) / numOutColumns);
         }
-        delete[] myScratch;
-        if (myVecScratch != NULL)
+        return;//no warnings with an roi, they can be strange
+    }
+    if (myRoi == NULL)
+    {//don't warn with an ROI, because it is somewhat expected
+        if (myGradient.getOperatorFallbackNode() != -1)
         {
-            delete[] myVecScratch;
+            CaretLogWarning("WARNING: gradient calculation found a NaN/inf with regression method for at least vertex " + AString::number(myGradient.getOperatorFallbackNode()));
         }
-    } else {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
-        myMetricOut->setStructure(mySurf->getStructure());
-        float* myVecScratch = NULL;
-        if (myVectorsOut != NULL)
+        if (myGradient.getOperatorFailedNode() != -1)
         {
-            myVectorsOut->setNumberOfNodesAndColumns(numNodes, 3);
-            myVectorsOut->setStructure(mySurf->getStructure());
-            myVectorsOut->setColumnName(0, toProcess->getColumnName(useColumn) + ", gradient vector X");
-            myVectorsOut->setColumnName(1, toProcess->getColumnName(useColumn) + ", gradient vector Y");
-            myVectorsOut->setColumnName(2, toProcess->getColumnName(useColumn) + ", gradient vector Z");
-            myVecScratch = new float[numNodes * 3];
+            CaretLogWarning("Failed to compute gradient for at least vertex " + AString::number(myGradient.getOperatorFailedNode()) +
+                            " with standard and fallback methods, outputting ZERO, check your surface for disconnected vertices or other strangeness");
         }
-        float* myScratch = new float[numNodes];
-        const float* myRoiColumn = NULL;
-        if (myRoi != NULL)
+    }
+    const int32_t BLOCK_MAPS = 16;//maps per operator application, the neighbor rows of a block stay in cache
+    const int64_t BLOCK_BYTES = ((int64_t)1) << 26;//limit the interleaved scratch memory for large surfaces
+    const int64_t floatsPerMap = (int64_t)numNodes * (myVectorsOut == NULL ? 2 : 5);//input and magnitude, plus 3 vector components
+    const int32_t groupSize = (int32_t)max((int64_t)1, min((int64_t)min(BLOCK_MAPS * numThreads, numOutColumns), BLOCK_BYTES / (int64_t)sizeof(float) / floatsPerMap));
+    vector<float> inScratch((int64_t)numNodes * groupSize), magScratch((int64_t)numNodes * groupSize), vecScratch, colScratch(numNodes);
+    if (myVectorsOut != NULL) vecScratch.resize((int64_t)numNodes * groupSize * 3);
+    bool haveFailed = false;
+    for (int32_t groupStart = 0; groupStart < numOutColumns; groupStart += groupSize)
+    {
+        const int32_t groupEnd = min(groupStart + groupSize, numOutColumns), groupCols = groupEnd - groupStart;
+        vector<const float*> inCols(groupCols);
+        for (int32_t m = 0; m < groupCols; ++m)
         {
-            if (matchRoiColumns)
+            inCols[m] = toProcess->getValuePointerForColumn(myColumn == -1 ? groupStart + m : useColumn);
+        }
+#pragma omp CARET_PARFOR schedule(static)
+        for (int32_t i = 0; i < numNodes; ++i)
+        {//interleave the group's columns, so each vertex's values for the group are contiguous
+            float* inRow = inScratch.data() + (int64_t)i * groupCols;
+            for (int32_t m = 0; m < groupCols; ++m)
             {
-                myRoiColumn = myRoi->getValuePointerForColumn(myColumn);//use the ORIGINAL column number, not the one that has been modified due to a presmoothing step that generated a new single column metric
-            } else {
-                myRoiColumn = myRoi->getValuePointerForColumn(0);
+                inRow[m] = inCols[m][i];
             }
         }
-        const float* myMetricColumn = toProcess->getValuePointerForColumn(useColumn);
-        myMetricOut->setColumnName(0, toProcess->getColumnName(useColumn) + ", gradient");
-        *(myMetricOut->getPaletteColorMapping(0)) = *(toProcess->getPaletteColorMapping(useColumn));//copy the palette settings
-#pragma omp CARET_PAR
+        bool groupFailed = false;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int32_t blockStart = 0; blockStart < groupCols; blockStart += BLOCK_MAPS)
+        {
+            const int32_t blockMaps = min(BLOCK_MAPS, groupCols - blockStart);
+            bool blockFailed = false;
+            myGradient.applyOperator(inScratch.data() + blockStart, groupCols, blockMaps, magScratch.data() + blockStart,
+                                     (myVectorsOut == NULL ? NULL : vecScratch.data() + blockStart * 3), &blockFailed);
+            if (blockFailed)
+            {
+#pragma omp critical
+                groupFailed = true;
+            }
+        }
+        if (groupFailed) haveFailed = true;
+        for (int32_t m = 0; m < groupCols; ++m)
         {
-            Vector3D somevec, xhat, yhat;
-            float sanity = 0.0f;
-            CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
-#pragma omp CARET_FOR schedule(dynamic)
             for (int32_t i = 0; i < numNodes; ++i)
             {
-                if (myRoiColumn != NULL && myRoiColumn[i] <= 0.0f)
-                {
-                    myScratch[i] = 0.0f;
-                    if (myVecScratch != NULL)
-                    {
-                        myVecScratch[i] = 0.0f;
-                        myVecScratch[i + numNodes] = 0.0f;
-                        myVecScratch[i + numNodes * 2] = 0.0f;
-                    }
-                    continue;
-                }
-                int32_t numNeigh;
-                int32_t i3 = i * 3;
-                const int32_t* myNeighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
-                Vector3D myNormal = Vector3D(myNormals + i3).normal();//should already be normalized, but just in case
-                Vector3D myCoord = myCoords + i3;
-                float nodeValue = myMetricColumn[i];
-                somevec[2] = 0.0;
-                if (myNormal[0] > myNormal[1])
-                {//generate a vector not parallel to normal
-                    somevec[0] = 0.0;
-                    somevec[1] = 1.0;
-                } else {
-                    somevec[0] = 1.0;
-                    somevec[1] = 0.0;
-                }
-                xhat = myNormal.cross(somevec).normal();
-                yhat = myNormal.cross(xhat).normal();//xhat, yhat are orthogonal unit vectors describing a coord system with k = surface normal
-                int neighCount = 0;//count within-roi neighbors, not simply surface neighbors
-                if (numNeigh >= 2)
-                {
-                    FloatMatrix myRegress = FloatMatrix::zeros(3, 4);
-                    for (int32_t j = 0; j < numNeigh; ++j)
-                    {
-                        int32_t whichNode = myNeighbors[j];
-                        int32_t whichNode3 = whichNode * 3;
-                        if (myRoiColumn == NULL || myRoiColumn[whichNode] > 0.0f)
-                        {
-                            ++neighCount;
-                            float tempf = myMetricColumn[whichNode] - nodeValue;
-                            Vector3D neighCoord = myCoords + whichNode3;
-                            somevec = neighCoord - myCoord;
-                            float origMag = somevec.length();//save the original length
-                            float unrollMag = origMag;
-                            float opposite = somevec.dot(myNormal);//check for division by close to zero
-                            if (abs(opposite) > 0.035f * origMag)//do not do unrolling on very small angles - this is ~2 degrees
-                            {
-                                unrollMag = origMag * asin(opposite / origMag) * origMag / opposite;
-                            }
-                            if (corrAreaMetric != NULL)
-                            {
-                                unrollMag *= (sqrtCorrAreas[i] + sqrtCorrAreas[whichNode]) / (sqrtVertAreas[i] + sqrtVertAreas[whichNode]);
-                            }
-                            float xmag = xhat.dot(somevec);//dot product to get the direction in 2d
-                            float ymag = yhat.dot(somevec);
-                            float mag2d = sqrt(xmag * xmag + ymag * ymag);//get the new magnitude, to divide out
-                            xmag *= unrollMag / mag2d;//normalize the 2d vector and multiply by unrolled length
-                            ymag *= unrollMag / mag2d;
-                            myRegress[0][0] += xmag * xmag * vertAreas[whichNode];//gather A'A and A'b sums for regression, weighted by vertex area
-                            myRegress[0][1] += xmag * ymag * vertAreas[whichNode];
-                            myRegress[0][2] += xmag * vertAreas[whichNode];
-                            myRegress[1][1] += ymag * ymag * vertAreas[whichNode];
-                            myRegress[1][2] += ymag * vertAreas[whichNode];
-                            myRegress[2][2] += vertAreas[whichNode];
-                            myRegress[0][3] += xmag * tempf * vertAreas[whichNode];
-                            myRegress[1][3] += ymag * tempf * vertAreas[whichNode];
-                            myRegress[2][3] += tempf * vertAreas[whichNode];
-                        }
-                    }
-                    if (neighCount >= 2)
-                    {
-                        myRegress[1][0] = myRegress[0][1];//complete the symmetric elements
-                        myRegress[2][0] = myRegress[0][2];
-                        myRegress[2][1] = myRegress[1][2];
-                        myRegress[2][2] += vertAreas[i];//include center (metric and coord differences will be zero, so this is all that is needed)
-                        FloatMatrix myRref = myRegress.reducedRowEchelon();
-                        somevec = xhat * myRref[0][3] + yhat * myRref[1][3];//somevec is now our surface gradient
-                        sanity = somevec[0] + somevec[1] + somevec[2];
-                    }
-                }
-                if (neighCount > 0 && (neighCount < 2 || sanity != sanity))
+                colScratch[i] = magScratch[(int64_t)i * groupCols + m];
+            }
+            myMetricOut->setValuesForColumn(groupStart + m, colScratch.data());
+            if (myVectorsOut != NULL)
+            {
+                for (int axis = 0; axis < 3; ++axis)
                 {
-                    if (!haveWarned && myRoi == NULL)
-                    {//don't issue this warning with an ROI, because it is somewhat expected
-                        haveWarned = true;
-                        CaretLogWarning("WARNING: gradient calculation found a NaN/inf with regression method for at least vertex " + AString::number(i));
-                    }
-                    float xgrad = 0.0f, ygrad = 0.0f, totalWeight = 0.0f;
-                    for (int32_t j = 0; j < numNeigh; ++j)
+                    for (int32_t i = 0; i < numNodes; ++i)
                     {
-                        int32_t whichNode = myNeighbors[j];
-                        int32_t whichNode3 = whichNode * 3;
-                        if (myRoiColumn == NULL || myRoiColumn[whichNode] > 0.0f)
-                        {
-                            float tempf = myMetricColumn[whichNode] - nodeValue;
-                            Vector3D neighCoord = myCoords + whichNode3;
-                            somevec = neighCoord - myCoord;
-                            float origMag = somevec.length();//save the original length
-                            float unrollMag = origMag;
-                            float opposite = somevec.dot(myNormal);//check for division by close to zero
-                            if (abs(opposite) > 0.035f * origMag)//do not do unrolling on very small angles - this is ~2 degrees
-                            {
-                                unrollMag = origMag * asin(opposite / origMag) * origMag / opposite;
-                            }
-                            if (corrAreaMetric != NULL)
-                            {
-                                unrollMag *= (sqrtCorrAreas[i] + sqrtCorrAreas[whichNode]) / (sqrtVertAreas[i] + sqrtVertAreas[whichNode]);
-                            }
-                            float xmag = xhat.dot(somevec);//dot product to get the direction in 2d
-                            float ymag = yhat.dot(somevec);
-                            float mag2d = sqrt(xmag * xmag + ymag * ymag);//get the new magnitude, to divide out
-                            tempf /= unrollMag * mag2d;//difference divided by distance gives point estimate of gradient magnitude, also divide by magnitude of 2d vector to normalize the next step at the same time
-                            xgrad += xmag * tempf * vertAreas[whichNode];//point estimate of gradient magnitude times normalized projected direction gives 2d estimate of gradient
-                            ygrad += ymag * tempf * vertAreas[whichNode];//average point estimates for each neighbor to estimate local gradient
-                            totalWeight += vertAreas[whichNode];
-                        }
-                    }
-                    xgrad /= totalWeight;//weighted average
-                    ygrad /= totalWeight;
-                    somevec = xhat * xgrad + yhat * ygrad;//unproject back into 3d
-                    sanity = somevec[0] + somevec[1] + somevec[2];
-                }
-                if (neighCount <= 0 || sanity != sanity)
-                {
-                    if (!haveFailed && myRoiColumn == NULL)
-                    {//don't warn with an roi, they can be strange
-                        haveFailed = true;
-                        CaretLogWarning("Failed to compute gradient for at least vertex " + AString::number(i) +
-                            " with standard and fallback methods, outputting ZERO, check your surface for disconnected vertices or other strangeness");
+                        colScratch[i] = vecScratch[((int64_t)i * groupCols + m) * 3 + axis];
                     }
-                    somevec[0] = 0.0f;
-                    somevec[1] = 0.0f;
-                    somevec[2] = 0.0f;
-                }
-                if (myVecScratch != NULL)
-                {
-                    myVecScratch[i] = somevec[0];//split them up far, so that they can be set to columns easily
-                    myVecScratch[numNodes + i] = somevec[1];
-                    myVecScratch[numNodes * 2 + i] = somevec[2];
+                    myVectorsOut->setValuesForColumn((groupStart + m) * 3 + axis, colScratch.data());
                 }
-                myScratch[i] = MathFunctions::vectorLength(somevec);
             }
         }
-        if (myVectorsOut != NULL)
-        {
-            myVectorsOut->setValuesForColumn(0, myVecScratch);
-            myVectorsOut->setValuesForColumn(1, myVecScratch + numNodes);
-            myVectorsOut->setValuesForColumn(2, myVecScratch + (numNodes * 2));
-        }
-        myMetricOut->setValuesForColumn(0, myScratch);
-        delete[] myScratch;
-        if (myVecScratch != NULL)
-        {
-            delete[] myVecScratch;
-        }
+        myProgress.reportProgress(((float)groupEnd) / numOutColumns);
+    }
+    if (haveFailed && myRoi == NULL)
+    {
+        CaretLogWarning("gradient was not a number for at least one vertex, outputting ZERO, check the input for NaN values");
     }
 }
 
@@ -27,6 +27,8 @@
 #include "SurfaceFile.h"
 #include "SurfaceResamplingHelper.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
@@ -163,7 +165,7 @@ void AlgorithmMetricResample::useParameters(OperationParameters* myParams, Progr
 
 AlgorithmMetricResample::AlgorithmMetricResample(ProgressObject* myProgObj, const MetricFile* metricIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere,
                                                  const SurfaceResamplingMethodEnum::Enum& myMethod, MetricFile* metricOut, const MetricFile* curAreas, const MetricFile* newAreas,
-                                                 const MetricFile* currentRoi, MetricFile* validRoiOut, const bool& largest) : AbstractAlgorithm(myProgObj)
+                                                 const MetricFile* currentRoi, MetricFile* validRoiOut, const bool& largest) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (metricIn->getNumberOfNodes() != curSphere->getNumberOfNodes()) throw AlgorithmException("input metric has different number of nodes than input sphere");
@@ -202,10 +204,33 @@ AlgorithmMetricResample::AlgorithmMetricResample(ProgressObject* myProgObj, cons
         if (largest)
         {
             myHelp.resampleLargest(metricIn->getValuePointerForColumn(i), colScratch.data());
-        } else {
-            myHelp.resampleNormal(metricIn->getValuePointerForColumn(i), colScratch.data());
+            metricOut->setValuesForColumn(i, colScratch.data());
+        }
+    }
+    if (!largest)
+    {//resample blocks of columns together, so the weights are traversed once per block rather than once per column
+        const int BLOCK_COLUMNS = 64;
+        int blockSize = min(BLOCK_COLUMNS, numColumns);
+        vector<float> blockScratch((int64_t)blockSize * numNewNodes);
+        vector<const float*> inPointers(blockSize);
+        vector<float*> outPointers(blockSize);
+        for (int c = 0; c < blockSize; ++c)
+        {
+            outPointers[c] = blockScratch.data() + (int64_t)c * numNewNodes;
+        }
+        for (int blockStart = 0; blockStart < numColumns; blockStart += blockSize)
+        {
+            int blockCols = min(blockSize, numColumns - blockStart);
+            for (int c = 0; c < blockCols; ++c)
+            {
+                inPointers[c] = metricIn->getValuePointerForColumn(blockStart + c);
+            }
+            myHelp.resampleNormalMulti(inPointers.data(), outPointers.data(), blockCols);
+            for (int c = 0; c < blockCols; ++c)
+            {
+                metricOut->setValuesForColumn(blockStart + c, outPointers[c]);
+            }
         }
-        metricOut->setValuesForColumn(i, colScratch.data());
     }
 }
 
@@ -65,12 +65,14 @@ OperationParameters* AlgorithmMetricToVolumeMapping::getParameters()
     ribbonOpt->addSurfaceParameter(2, "outer-surf", "the outer surface of the ribbon");
     OptionalParameter* ribbonSubdivOpt = ribbonOpt->createOptionalParameter(3, "-voxel-subdiv", "voxel divisions while estimating voxel weights");
     ribbonSubdivOpt->addIntegerParameter(1, "subdiv-num", "number of subdivisions, default 3");
+    ribbonOpt->createOptionalParameter(4, "-exact-overlap", "compute the exact volume of overlap instead of subdividing voxels");
     
     ret->setHelpText(
         AString("Maps values from a metric file into a volume file.  ") +
         "You must specify exactly one mapping method option.  " +
         "The -nearest-vertex method uses the value from the vertex closest to the voxel center (useful for integer values).  " +
-        "The -ribbon-constrained method uses the same method as in -volume-to-surface-mapping, then uses the weights in reverse.  "
+        "The -ribbon-constrained method uses the same method as in -volume-to-surface-mapping, then uses the weights in reverse.  " +
+        "Its -exact-overlap option computes the exact polyhedron/voxel overlap rather than approximating it with subdivisions.  "
     );
     return ret;
 }
@@ -123,6 +125,14 @@ void AlgorithmMetricToVolumeMapping::useParameters(OperationParameters* myParams
                 throw AlgorithmException("invalid number of subdivisions specified");
             }
         }
+        if (ribbonOpt->getOptionalParameter(4)->m_present)
+        {
+            if (ribbonSubdivOpt->m_present)
+            {
+                throw AlgorithmException("-voxel-subdiv and -exact-overlap cannot be used together");
+            }
+            subDivs = 0;//RibbonMappingHelper computes exact overlap for 0 subdivisions
+        }
     }
     if (!haveMethod)
     {
@@ -143,7 +153,7 @@ void AlgorithmMetricToVolumeMapping::useParameters(OperationParameters* myParams
 }
 
 AlgorithmMetricToVolumeMapping::AlgorithmMetricToVolumeMapping(ProgressObject* myProgObj, const MetricFile* myMetric, const SurfaceFile* mySurf, const VolumeSpace& myVolSpace,
-                                                                 VolumeFile* myVolOut, const float& nearDist) : AbstractAlgorithm(myProgObj)
+                                                                 VolumeFile* myVolOut, const float& nearDist) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (myMetric->getNumberOfNodes() != mySurf->getNumberOfNodes())
@@ -191,7 +201,7 @@ AlgorithmMetricToVolumeMapping::AlgorithmMetricToVolumeMapping(ProgressObject* m
 }
 
 AlgorithmMetricToVolumeMapping::AlgorithmMetricToVolumeMapping(ProgressObject* myProgObj, const MetricFile* myMetric, const SurfaceFile* mySurf, const VolumeSpace& myVolSpace,
-                                                                 VolumeFile* myVolOut, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int& subDivs) : AbstractAlgorithm(myProgObj)
+                                                                 VolumeFile* myVolOut, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int& subDivs) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     int numNodes = mySurf->getNumberOfNodes();
     if (myMetric->getNumberOfNodes() != numNodes)
@@ -223,7 +223,7 @@ AlgorithmNodesInsideBorder::AlgorithmNodesInsideBorder(ProgressObject* myProgObj
                                                        const int32_t assignToMetricMapIndex,
                                                        const float assignMetricValue,
                                                        MetricFile* metricFileInOut)
-: AbstractAlgorithm(myProgObj)
+: AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     CaretAssert(surfaceFile);
     CaretAssert(border);
@@ -268,7 +268,7 @@ AlgorithmNodesInsideBorder::AlgorithmNodesInsideBorder(ProgressObject* myProgObj
                                                        const int32_t assignToLabelMapIndex,
                                                        const int32_t assignLabelKey,
                                                        LabelFile* labelFileInOut)
-: AbstractAlgorithm(myProgObj)
+: AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     CaretAssert(surfaceFile);
     CaretAssert(border);
@@ -313,7 +313,7 @@ AlgorithmNodesInsideBorder::AlgorithmNodesInsideBorder(ProgressObject* myProgObj
                            const int32_t assignToCiftiScalarMapIndex,
                            const float assignScalarValue,
                            CiftiBrainordinateScalarFile* ciftiScalarFileInOut)
-: AbstractAlgorithm(myProgObj)
+: AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     CaretAssert(surfaceFile);
     CaretAssert(border);
@@ -361,7 +361,7 @@ AlgorithmNodesInsideBorder::AlgorithmNodesInsideBorder(ProgressObject* myProgObj
                                                        const int32_t assignToCiftiLabelMapIndex,
                                                        const int32_t assignLabelKey,
                                                        CiftiBrainordinateLabelFile* ciftiLabelFileInOut)
-: AbstractAlgorithm(myProgObj)
+: AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     CaretAssert(surfaceFile);
     CaretAssert(border);
@@ -409,7 +409,7 @@ AlgorithmNodesInsideBorder::AlgorithmNodesInsideBorder(ProgressObject* myProgObj
                                                        const Border* border,
                                                        const bool isInverseSelection,
                                                        std::vector<int32_t>& nodesInsideBorderOut)
-: AbstractAlgorithm(myProgObj)
+: AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     CaretAssert(surfaceFile);
     CaretAssert(border);
@@ -70,7 +70,7 @@ void AlgorithmSurfaceApplyWarpfield::useParameters(OperationParameters* myParams
     AlgorithmSurfaceApplyWarpfield(myProgObj, mySurf, myWarp.getWarpfield(), mySurfOut);
 }
 
-AlgorithmSurfaceApplyWarpfield::AlgorithmSurfaceApplyWarpfield(ProgressObject* myProgObj, const SurfaceFile* mySurf, const VolumeFile* warpfield, SurfaceFile* mySurfOut) : AbstractAlgorithm(myProgObj)
+AlgorithmSurfaceApplyWarpfield::AlgorithmSurfaceApplyWarpfield(ProgressObject* myProgObj, const SurfaceFile* mySurf, const VolumeFile* warpfield, SurfaceFile* mySurfOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> warpDims;
@@ -79,21 +79,20 @@ AlgorithmSurfaceApplyWarpfield::AlgorithmSurfaceApplyWarpfield(ProgressObject* m
     *mySurfOut = *mySurf;//copy rather than initialize, don't currently have much in the way of modification functions
     int numNodes = mySurf->getNumberOfNodes();
     const float* coordData = mySurf->getCoordinateData();
-    vector<float> coordsOut(numNodes * 3);
+    vector<float> coordsOut(coordData, coordData + numNodes * 3), displacement(numNodes);
+    CaretArray<bool> valid(numNodes);
+    warpfield->interpolateValues(coordData, numNodes, displacement.data(), VolumeFile::TRILINEAR, valid.getArray(), 0);
     for (int i = 0; i < numNodes; ++i)
     {
-        int base = i * 3;
-        Vector3D sample = coordData + base;
-        Vector3D displacement;
-        bool valid = false;
-        displacement[0] = warpfield->interpolateValue(sample, VolumeFile::TRILINEAR, &valid, 0);
-        if (!valid) throw AlgorithmException("surface exceeds the bounding box of the warpfield");
-        displacement[1] = warpfield->interpolateValue(sample, VolumeFile::TRILINEAR, NULL, 1);
-        displacement[2] = warpfield->interpolateValue(sample, VolumeFile::TRILINEAR, NULL, 2);
-        Vector3D newCoord = sample + displacement;
-        coordsOut[base] = newCoord[0];
-        coordsOut[base + 1] = newCoord[1];
-        coordsOut[base + 2] = newCoord[2];
+        if (!valid[i]) throw AlgorithmException("surface exceeds the bounding box of the warpfield");
+    }
+    for (int d = 0; d < 3; ++d)
+    {
+        if (d != 0) warpfield->interpolateValues(coordData, numNodes, displacement.data(), VolumeFile::TRILINEAR, NULL, d);
+        for (int i = 0; i < numNodes; ++i)
+        {
+            coordsOut[i * 3 + d] += displacement[i];
+        }
     }
     mySurfOut->setCoordinates(coordsOut.data());
 }
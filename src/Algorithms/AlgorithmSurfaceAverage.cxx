@@ -108,7 +108,7 @@ void AlgorithmSurfaceAverage::useParameters(OperationParameters* myParams, Progr
 }
 
 AlgorithmSurfaceAverage::AlgorithmSurfaceAverage(ProgressObject* myProgObj, SurfaceFile* myAvgOut, const vector<const SurfaceFile*>& inputSurfs,
-                                                 MetricFile* stdevOut, MetricFile* uncertOut, const vector<float>* surfWeightPtr) : AbstractAlgorithm(myProgObj)
+                                                 MetricFile* stdevOut, MetricFile* uncertOut, const vector<float>* surfWeightPtr) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     int numSurfs = (int)inputSurfs.size();
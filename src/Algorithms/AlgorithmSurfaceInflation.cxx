@@ -22,12 +22,13 @@
 #include <cmath>
 
 #include "AlgorithmSurfaceInflation.h"
-#include "AlgorithmSurfaceSmoothing.h"
 #include "AlgorithmException.h"
 #include "BoundingBox.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "SurfaceFile.h"
+#include "SurfaceSmoothingObject.h"
 
 using namespace caret;
 
@@ -136,22 +137,24 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
                                                      const float strength,
                                                      const int32_t iterations,
                                                      const float inflationFactorIn)
-   : AbstractAlgorithm(myProgObj)
+   : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
-    std::vector<ProgressObject*> subAlgProgress;
-    if (myProgObj != NULL) {
-        subAlgProgress.resize(cycles);
-        for (int32_t i = 0; i < cycles; ++i)
-        {
-            subAlgProgress[i] = myProgObj->addAlgorithm(AlgorithmSurfaceSmoothing::getAlgorithmWeight());
-        }
+    if ((strength < 0.0)
+        || (strength > 1.0)) {
+        throw AlgorithmException("Invalid smoothing strength outside [0.0, 1.0]: "
+                                 + QString::number(strength, 'f', 5));
+    }
+    
+    if (iterations <= 0) {
+        throw AlgorithmException("Invalid iterations value [1, infinity]: "
+                                 + QString::number(iterations));
     }
     
     /*
      * Sets the algorithm up to use the progress object, and will
      * finish the progress object automatically when the algorithm terminates
      */
-    LevelProgress myProgress(myProgObj, 1.0f, 0.1f);//lower the internal weight
+    LevelProgress myProgress(myProgObj);
     
     const float inflationFactor = inflationFactorIn - 1.0;
     
@@ -165,48 +168,41 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
     
     const int32_t numberOfNodes = outputSurfaceFile->getNumberOfNodes();
     
+    /*
+     * Set up the smoothing once, and keep the coordinates as separate x, y, z arrays through all cycles
+     */
+    SurfaceSmoothingObject mySmoothing(outputSurfaceFile);
+    std::vector<float> xCoords, yCoords, zCoords;
+    SurfaceSmoothingObject::getCoordinates(outputSurfaceFile, xCoords, yCoords, zCoords);
+    
     for (int iCycle = 0; iCycle < cycles; iCycle++) {
         /*
          * Smooth
          */
-        ProgressObject* subProgress = NULL;
-        if (myProgObj != NULL)
-        {
-            subProgress = subAlgProgress[iCycle];
-        }
-        AlgorithmSurfaceSmoothing(subProgress,
-                                  outputSurfaceFile,
-                                  outputSurfaceFile,
-                                  strength,
-                                  iterations);
+        mySmoothing.smooth(xCoords, yCoords, zCoords, strength, iterations);
         
         /*
          * Inflate
          */
-        float xyz[3];
+#pragma omp CARET_PARFOR schedule(static)
         for (int32_t iNode = 0; iNode < numberOfNodes; iNode++) {
-            outputSurfaceFile->getCoordinate(iNode,
-                                             xyz);
-            
-            const float x = xyz[0] / anatomicalRangeX;
-            const float y = xyz[1] / anatomicalRangeY;
-            const float z = xyz[2] / anatomicalRangeZ;
+            const float x = xCoords[iNode] / anatomicalRangeX;
+            const float y = yCoords[iNode] / anatomicalRangeY;
+            const float z = zCoords[iNode] / anatomicalRangeZ;
             
             const float radius = std::sqrt(x*x + y*y + z*z);
             const float scale  = 1.0 + inflationFactor * (1.0 - radius);
             
-            xyz[0] *= scale;
-            xyz[1] *= scale;
-            xyz[2] *= scale;
-            
-            outputSurfaceFile->setCoordinate(iNode,
-                                             xyz);
+            xCoords[iNode] *= scale;
+            yCoords[iNode] *= scale;
+            zCoords[iNode] *= scale;
         }
         
         myProgress.reportProgress(static_cast<float>(iCycle +1)
                                   / static_cast<float>(cycles));
     }
     
+    SurfaceSmoothingObject::setCoordinates(outputSurfaceFile, xCoords, yCoords, zCoords);
     outputSurfaceFile->computeNormals();
 }
 
@@ -219,7 +215,7 @@ AlgorithmSurfaceInflation::getAlgorithmInternalWeight()
     /*
      * override this if needed, if the progress bar isn't smooth
      */
-    return 0.1f;//all this does internally is rescale the coordinates, lower the internal weight
+    return 1.0f;//smoothing is done internally now
 }
 
 /**
@@ -231,6 +227,6 @@ AlgorithmSurfaceInflation::getSubAlgorithmWeight()
     /*
      * If you use a subalgorithm
      */
-    return AlgorithmSurfaceSmoothing::getAlgorithmWeight();
+    return 0.0f;
 }
 
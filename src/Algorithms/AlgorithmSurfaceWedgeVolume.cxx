@@ -63,7 +63,7 @@ void AlgorithmSurfaceWedgeVolume::useParameters(OperationParameters* myParams, P
     AlgorithmSurfaceWedgeVolume(myProgObj, innerSurf, outerSurf, myMetricOut);
 }
 
-AlgorithmSurfaceWedgeVolume::AlgorithmSurfaceWedgeVolume(ProgressObject* myProgObj, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, MetricFile* myMetricOut) : AbstractAlgorithm(myProgObj)
+AlgorithmSurfaceWedgeVolume::AlgorithmSurfaceWedgeVolume(ProgressObject* myProgObj, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, MetricFile* myMetricOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     int numNodes = innerSurf->getNumberOfNodes();
@@ -98,7 +98,7 @@ void AlgorithmVolumeAffineResample::useParameters(OperationParameters* myParams,
 }
 
 AlgorithmVolumeAffineResample::AlgorithmVolumeAffineResample(ProgressObject* myProgObj, const VolumeFile* inVol, const FloatMatrix& myAffine,
-                                                             const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod, VolumeFile* outVol) : AbstractAlgorithm(myProgObj)
+                                                             const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod, VolumeFile* outVol) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     int64_t affRows, affColumns;
@@ -134,6 +134,8 @@ AlgorithmVolumeAffineResample::AlgorithmVolumeAffineResample(ProgressObject* myP
             *(outVol->getMapLabelTable(i)) = *(inVol->getMapLabelTable(i));
         }
     }
+    const int64_t sliceSize = outDims[0] * outDims[1];
+    vector<float> outFrame(sliceSize * outDims[2]);
     for (int64_t c = 0; c < numComponents; ++c)
     {
         for (int64_t b = 0; b < numMaps; ++b)
@@ -142,21 +144,29 @@ AlgorithmVolumeAffineResample::AlgorithmVolumeAffineResample(ProgressObject* myP
             {
                 inVol->validateSpline(b, c);//because deconvolve is parallel, but won't execute parallel if we are already in a parallel section
             }
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t k = 0; k < outDims[2]; ++k)
+#pragma omp CARET_PAR
             {
-                for (int64_t j = 0; j < outDims[1]; ++j)
+                vector<float> sliceCoords(sliceSize * 3);
+#pragma omp CARET_FOR schedule(dynamic)
+                for (int64_t k = 0; k < outDims[2]; ++k)
                 {
-                    for (int64_t i = 0; i < outDims[0]; ++i)
+                    for (int64_t j = 0; j < outDims[1]; ++j)
                     {
-                        Vector3D outCoord, inCoord;
-                        outVol->indexToSpace(i, j, k, outCoord);
-                        inCoord = xvec * outCoord[0] + yvec * outCoord[1] + zvec * outCoord[2] + offset;
-                        float interpVal = inVol->interpolateValue(inCoord, myMethod, NULL, b, c);
-                        outVol->setValue(interpVal, i, j, k, b, c);
+                        for (int64_t i = 0; i < outDims[0]; ++i)
+                        {
+                            Vector3D outCoord, inCoord;
+                            outVol->indexToSpace(i, j, k, outCoord);
+                            inCoord = xvec * outCoord[0] + yvec * outCoord[1] + zvec * outCoord[2] + offset;
+                            float* thisCoord = sliceCoords.data() + (i + j * outDims[0]) * 3;
+                            thisCoord[0] = inCoord[0];
+                            thisCoord[1] = inCoord[1];
+                            thisCoord[2] = inCoord[2];
+                        }
                     }
+                    inVol->interpolateValues(sliceCoords.data(), sliceSize, outFrame.data() + k * sliceSize, myMethod, NULL, b, c);//a slice at a time keeps the coordinate scratch small
                 }
             }
+            outVol->setFrame(outFrame.data(), b, c);
             if (myMethod == VolumeFile::CUBIC)
             {
                 inVol->freeSpline(b, c);//release memory we no longer need, if we allocated it
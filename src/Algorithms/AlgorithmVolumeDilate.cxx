@@ -26,6 +26,7 @@
 #include "CaretOMP.h"
 #include "FloatMatrix.h"
 #include "Vector3D.h"
+#include "VolumeDistanceTransform.h"
 #include "VolumeFile.h"
 #include "VoxelIJK.h"
 
@@ -34,6 +35,16 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    bool isGoodVoxel(const VolumeFile* volIn, const int64_t ijk[3], const int& insubvol, const int& component, const VolumeFile* badRoi, const VolumeFile* dataRoi)
+    {
+        if (dataRoi != NULL && !(dataRoi->getValue(ijk) > 0.0f)) return false;
+        if (badRoi == NULL) return volIn->getValue(ijk, insubvol, component) != 0.0f;
+        return !(badRoi->getValue(ijk) > 0.0f);
+    }
+}
+
 AString AlgorithmVolumeDilate::getCommandSwitch()
 {
     return "-volume-dilate";
@@ -115,7 +126,7 @@ void AlgorithmVolumeDilate::useParameters(OperationParameters* myParams, Progres
 }
 
 AlgorithmVolumeDilate::AlgorithmVolumeDilate(ProgressObject* myProgObj, const VolumeFile* volIn, const float& distance, const Method& myMethod,
-                                             VolumeFile* volOut, const VolumeFile* badRoi, const VolumeFile* dataRoi, const int& subvol) : AbstractAlgorithm(myProgObj)
+                                             VolumeFile* volOut, const VolumeFile* badRoi, const VolumeFile* dataRoi, const int& subvol) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myDims;
@@ -231,29 +242,57 @@ AlgorithmVolumeDilate::AlgorithmVolumeDilate(ProgressObject* myProgObj, const Vo
         }
         volOut->setMapName(0, volIn->getMapName(subvol) + " dilate " + AString::number(distance));
     }
+    const bool useTransform = VolumeDistanceTransform::isSeparable(volIn->getVolumeSpace());//skewed volumes fall back to searching the whole stencil
     if (subvol == -1)
     {
         for (int s = 0; s < myDims[3]; ++s)
         {
             for (int c = 0; c < myDims[4]; ++c)
             {
-                dilateFrame(volIn, s, c, volOut, s, badRoi, dataRoi, myMethod, stencil, stenWeights);
+                dilateFrame(volIn, s, c, volOut, s, badRoi, dataRoi, myMethod, stencil, stenWeights, distance, useTransform);
             }
         }
     } else {
         for (int c = 0; c < myDims[4]; ++c)
         {
-            dilateFrame(volIn, subvol, c, volOut, 0, badRoi, dataRoi, myMethod, stencil, stenWeights);
+            dilateFrame(volIn, subvol, c, volOut, 0, badRoi, dataRoi, myMethod, stencil, stenWeights, distance, useTransform);
         }
     }
 }
 
 void AlgorithmVolumeDilate::dilateFrame(const VolumeFile* volIn, const int& insubvol, const int& component, VolumeFile* volOut, const int& outsubvol,
-                                        const VolumeFile* badRoi, const VolumeFile* dataRoi, const Method& myMethod, const vector<int>& stencil, const vector<float>& stenWeights)
+                                        const VolumeFile* badRoi, const VolumeFile* dataRoi, const Method& myMethod, const vector<int>& stencil, const vector<float>& stenWeights,
+                                        const float& distance, const bool& useTransform)
 {
     vector<int64_t> myDims;
     volIn->getDimensions(myDims);
     int stensize = (int)stenWeights.size();
+    vector<int> faceStencil;//the face neighbors are always used, even when they are farther than the distance
+    for (int stenind = 0; stenind < stensize; ++stenind)
+    {
+        if (abs(stencil[stenind * 3]) + abs(stencil[stenind * 3 + 1]) + abs(stencil[stenind * 3 + 2]) == 1) faceStencil.push_back(stenind);
+    }
+    vector<float> distSquared;
+    vector<int64_t> nearest;
+    if (useTransform)
+    {//find the nearest good voxel for every voxel in linear time, instead of searching the stencil
+        vector<char> isSource(myDims[0] * myDims[1] * myDims[2], 0);
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int k = 0; k < myDims[2]; ++k)
+        {
+            for (int j = 0; j < myDims[1]; ++j)
+            {
+                for (int i = 0; i < myDims[0]; ++i)
+                {
+                    int64_t ijk[3] = { i, j, k };
+                    isSource[volIn->getIndex(ijk)] = isGoodVoxel(volIn, ijk, insubvol, component, badRoi, dataRoi);
+                }
+            }
+        }
+        VolumeDistanceTransform::compute(volIn->getVolumeSpace(), isSource, distSquared, nearest);
+    }
+    const float* inFrame = volIn->getFrame(insubvol, component);
+    const double distance2 = (double)distance * distance;
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int k = 0; k < myDims[2]; ++k)
     {
@@ -278,6 +317,28 @@ void AlgorithmVolumeDilate::dilateFrame(const VolumeFile* volIn, const int& insu
                     {
                         case NEAREST:
                         {
+                            if (useTransform)
+                            {
+                                const int64_t voxIndex = volIn->getIndex(i, j, k);
+                                int64_t source = -1;
+                                if (nearest[voxIndex] != -1 && distSquared[voxIndex] <= distance2)
+                                {
+                                    source = nearest[voxIndex];
+                                } else {//nothing within the distance, so only the face neighbors can be used
+                                    for (int f = 0; f < (int)faceStencil.size(); ++f)
+                                    {
+                                        int base = faceStencil[f] * 3;
+                                        int64_t tempindex[3] = { stencil[base] + i, stencil[base + 1] + j, stencil[base + 2] + k };
+                                        if (volIn->indexValid(tempindex) && isGoodVoxel(volIn, tempindex, insubvol, component, badRoi, dataRoi))
+                                        {
+                                            source = volIn->getIndex(tempindex);
+                                            break;
+                                        }
+                                    }
+                                }
+                                volOut->setValue((source == -1 ? 0.0f : inFrame[source]), i, j, k, outsubvol, component);
+                                break;
+                            }
                             int best = -1;
                             if (badRoi == NULL)
                             {
@@ -330,6 +391,29 @@ void AlgorithmVolumeDilate::dilateFrame(const VolumeFile* volIn, const int& insu
                         }
                         case WEIGHTED:
                         {
+                            if (useTransform)
+                            {//skip the stencil search when no good voxel is in range
+                                const int64_t voxIndex = volIn->getIndex(i, j, k);
+                                if (nearest[voxIndex] == -1 || distSquared[voxIndex] > distance2)
+                                {
+                                    bool haveFace = false;
+                                    for (int f = 0; f < (int)faceStencil.size(); ++f)
+                                    {
+                                        int base = faceStencil[f] * 3;
+                                        int64_t tempindex[3] = { stencil[base] + i, stencil[base + 1] + j, stencil[base + 2] + k };
+                                        if (volIn->indexValid(tempindex) && isGoodVoxel(volIn, tempindex, insubvol, component, badRoi, dataRoi))
+                                        {
+                                            haveFace = true;
+                                            break;
+                                        }
+                                    }
+                                    if (!haveFace)
+                                    {
+                                        volOut->setValue(0.0f, i, j, k, outsubvol, component);
+                                        break;
+                                    }
+                                }
+                            }
                             double sum = 0.0, weightsum = 0.0;
                             if (badRoi == NULL)
                             {
@@ -45,7 +45,8 @@ namespace caret {
         static AString getShortDescription();
     private:
         void dilateFrame(const VolumeFile* volIn, const int& insubvol, const int& component, VolumeFile* volOut, const int& outsubvol, const VolumeFile* badRoi,
-                         const VolumeFile* dataRoi, const Method& myMethod, const std::vector<int>& stencil, const std::vector<float>& stenWeights);
+                         const VolumeFile* dataRoi, const Method& myMethod, const std::vector<int>& stencil, const std::vector<float>& stenWeights,
+                         const float& distance, const bool& useTransform);
     };
 
     typedef TemplateAutoOperation<AlgorithmVolumeDilate> AutoAlgorithmVolumeDilate;
@@ -289,7 +289,7 @@ namespace
 
 AlgorithmVolumeFindClusters::AlgorithmVolumeFindClusters(ProgressObject* myProgObj, const VolumeFile* volIn, const float& threshValue, const float& minVolume, VolumeFile* volOut,
                                                          const bool& lessThan, const VolumeFile* myRoi, const int& subvolNum, const int& startVal, int* endVal,
-                                                         const float& sizeRatio, const float& distanceCutoff) : AbstractAlgorithm(myProgObj)
+                                                         const float& sizeRatio, const float& distanceCutoff) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (startVal == 0)
@@ -21,14 +21,8 @@
 #include "AlgorithmException.h"
 #include "AlgorithmVolumeGradient.h"
 #include "AlgorithmVolumeSmoothing.h"
-#include "CaretOMP.h"
-#include "FloatMatrix.h"
-#include "MathFunctions.h"
-#include "Vector3D.h"
 #include "VolumeFile.h"
-
-#include <algorithm>
-#include <cmath>
+#include "VolumeGradientObject.h"
 
 using namespace caret;
 using namespace std;
@@ -106,7 +100,7 @@ void AlgorithmVolumeGradient::useParameters(OperationParameters* myParams, Progr
 }
 
 AlgorithmVolumeGradient::AlgorithmVolumeGradient(ProgressObject* myProgObj, const VolumeFile* volIn, VolumeFile* volOut, const float& presmooth,
-                                                       const VolumeFile* myRoi, VolumeFile* vectorsOut, const int& subvolNum) : AbstractAlgorithm(myProgObj)
+                                                       const VolumeFile* myRoi, VolumeFile* vectorsOut, const int& subvolNum) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     ProgressObject* smoothProgress = NULL;
     if (myProgObj != NULL && presmooth > 0.0f)
@@ -136,22 +130,20 @@ AlgorithmVolumeGradient::AlgorithmVolumeGradient(ProgressObject* myProgObj, cons
     }
     vector<int64_t> origDims = volIn->getOriginalDimensions(), myDims;
     volIn->getDimensions(myDims);
-    int stencil[] = { 0, 0, 1,
-                    0, 0, -1,
-                    0, 1, 0,
-                    0, -1, 0,
-                    1, 0, 0,
-                    -1, 0, 0 };
-    vector<vector<float> > volSpace = volIn->getSform();
-    Vector3D ivec, jvec, kvec, origin;
-    ivec[0] = volSpace[0][0]; jvec[0] = volSpace[0][1]; kvec[0] = volSpace[0][2]; origin[0] = volSpace[0][3];
-    ivec[1] = volSpace[1][0]; jvec[1] = volSpace[1][1]; kvec[1] = volSpace[1][2]; origin[1] = volSpace[1][3];
-    ivec[2] = volSpace[2][0]; jvec[2] = volSpace[2][1]; kvec[2] = volSpace[2][2]; origin[2] = volSpace[2][3];//TODO: special case orthogonal volumes (central difference)?
     const float* roiFrame = NULL;
     if (myRoi != NULL)
     {
         roiFrame = myRoi->getFrame();
     }
+    VolumeGradientObject myGradient(volIn->getVolumeSpace(), roiFrame);//neighbor weights only depend on the volume space and roi, so build them once for all frames
+    const int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+    vector<float> magScratch(frameSize), vecScratch;
+    float* vecPointer = NULL;
+    if (vectorsOut != NULL)
+    {
+        vecScratch.resize(frameSize * 3);
+        vecPointer = vecScratch.data();
+    }
     if (subvolNum == -1)
     {
         volOut->reinitialize(origDims, volIn->getSform(), myDims[4], volIn->getType());
@@ -168,237 +160,14 @@ AlgorithmVolumeGradient::AlgorithmVolumeGradient(ProgressObject* myProgObj, cons
         {
             for (int s = 0; s < myDims[3]; ++s)
             {
-                const float* inFrame = processVol->getFrame(s, c);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int k = 0; k < myDims[2]; ++k)
+                myGradient.computeGradient(processVol->getFrame(s, c), magScratch.data(), vecPointer);
+                volOut->setFrame(magScratch.data(), s, c);
+                if (vectorsOut != NULL)
                 {
-                    for (int j = 0; j < myDims[1]; ++j)
+                    int subvolbase = s * 3;
+                    for (int axis = 0; axis < 3; ++axis)
                     {
-                        for (int i = 0; i < myDims[0]; ++i)
-                        {
-                            float magnitude;
-                            Vector3D gradient;
-                            if (myRoi == NULL || myRoi->getValue(i, j, k) > 0.0f)
-                            {
-                                float curval = processVol->getValue(i, j, k, s, c);
-                                FloatMatrix regress = FloatMatrix::zeros(4, 5);
-                                regress[3][3] = 1;//count the center voxel in case neighbors are missing (displacement and valdiff are zero, cancelling all other terms)
-                                int dircheck = 0;
-                                for (int neighbase = 0; neighbase < 18; neighbase += 3)
-                                {
-                                    int ikern = i + stencil[neighbase];
-                                    int jkern = j + stencil[neighbase + 1];
-                                    int kkern = k + stencil[neighbase + 2];
-                                    if (volIn->indexValid(ikern, jkern, kkern))
-                                    {
-                                        int64_t kernIndex = volIn->getIndex(ikern, jkern, kkern);
-                                        if (roiFrame == NULL || roiFrame[kernIndex] > 0.0f)
-                                        {
-                                            dircheck |= 1<<(neighbase / 6);//uses the ordering of the neighbors to map neighbor to direction
-                                            float valdiff = inFrame[kernIndex] - curval;
-                                            Vector3D displacement = ivec * stencil[neighbase] + jvec * stencil[neighbase + 1] + kvec * stencil[neighbase + 2];
-                                            regress[0][0] += displacement[0] * displacement[0];//note: this is the generic code, built to handle strange volumes, to get more speed, test
-                                            regress[0][1] += displacement[0] * displacement[1];// for orthogonal volume, and use central differences (if no ROI, could special case for even more speed)
-                                            regress[0][2] += displacement[0] * displacement[2];//but, seems reasonably fast anyway
-                                            regress[0][3] += displacement[0];
-                                            regress[0][4] += displacement[0] * valdiff;
-                                            regress[1][1] += displacement[1] * displacement[1];
-                                            regress[1][2] += displacement[1] * displacement[2];
-                                            regress[1][3] += displacement[1];
-                                            regress[1][4] += displacement[1] * valdiff;
-                                            regress[2][2] += displacement[2] * displacement[2];
-                                            regress[2][3] += displacement[2];
-                                            regress[2][4] += displacement[2] * valdiff;
-                                            regress[3][3] += 1;
-                                            regress[3][4] += valdiff;
-                                        }
-                                    }
-                                }
-                                if (dircheck == 7)//have at least one neighbor in every index axis, continue
-                                {
-                                    regress[1][0] = regress[0][1];//finish the symmetric part of the matrix
-                                    regress[2][0] = regress[0][2];
-                                    regress[2][1] = regress[1][2];
-                                    regress[3][0] = regress[0][3];
-                                    regress[3][1] = regress[1][3];
-                                    regress[3][2] = regress[2][3];
-                                    FloatMatrix result = regress.reducedRowEchelon();
-                                    gradient[0] = result[0][4];
-                                    gradient[1] = result[1][4];
-                                    gradient[2] = result[2][4];//[3][4] is the constant part of the regression
-                                    magnitude = gradient.length();
-                                    if (!MathFunctions::isNumeric(magnitude))
-                                    {
-                                        magnitude = 0.0f;
-                                        gradient[0] = 0.0f;
-                                        gradient[1] = 0.0f;
-                                        gradient[2] = 0.0f;
-                                    }
-                                } else {//fallback 1: regression with 26-neighbors
-                                    Vector3D directions[3];//track the displacements in index space for simplicity
-                                    int dirUsed = 0;
-                                    if (dircheck & 1)
-                                    {
-                                        directions[dirUsed][0] = 1;
-                                        ++dirUsed;
-                                    }
-                                    if (dircheck & 2)
-                                    {
-                                        directions[dirUsed][1] = 1;
-                                        ++dirUsed;
-                                    }
-                                    if (dircheck & 4)
-                                    {
-                                        directions[dirUsed][2] = 1;
-                                        ++dirUsed;
-                                    }
-                                    int imin = max(i - 1, 0), jmin = max(j - 1, 0), kmin = max(k - 1, 0);
-                                    int imax = min(i + 2, (int)myDims[0]), jmax = min(j + 2, (int)myDims[1]), kmax = min(k + 2, (int)myDims[2]);
-                                    Vector3D voxelDir;
-                                    for (int kkern = kmin; kkern < kmax; ++kkern)
-                                    {
-                                        voxelDir[2] = kkern - k;
-                                        int kabs = abs(kkern - k);
-                                        int64_t kindpart = kkern * myDims[1];
-                                        for (int jkern = jmin; jkern < jmax; ++jkern)
-                                        {
-                                            int jabs = abs(jkern - j) + kabs;
-                                            if (jabs > 0)//skip inner loop if it won't get any new neighbors
-                                            {
-                                                int64_t jindpart = (kindpart + jkern) * myDims[0];
-                                                voxelDir[1] = jkern - j;
-                                                for (int ikern = imin; ikern < imax; ++ikern)
-                                                {
-                                                    int64_t kernIndex = jindpart + ikern;
-                                                    if (jabs + abs(ikern - i) > 1 && (roiFrame == NULL || roiFrame[kernIndex] > 0.0f))//only add non-face neighbors
-                                                    {
-                                                        if (dirUsed < 3)//check for singularity via base vectors being dependent
-                                                        {
-                                                            bool newDir = true;
-                                                            switch (dirUsed)
-                                                            {
-                                                                case 0:
-                                                                default:
-                                                                    break;
-                                                                case 1:
-                                                                    if (voxelDir.cross(directions[0]).length() < 0.01f) newDir = false;
-                                                                    break;
-                                                                case 2:
-                                                                    if (voxelDir.cross(directions[0]).cross(voxelDir.cross(directions[1])).length() < 0.01f)
-                                                                        newDir = false;
-                                                                    break;
-                                                            }
-                                                            if (newDir)
-                                                            {
-                                                                directions[dirUsed] = voxelDir;
-                                                                ++dirUsed;
-                                                            }
-                                                        }
-                                                        voxelDir[0] = ikern - i;
-                                                        Vector3D displacement = ivec * voxelDir[0] + jvec * voxelDir[1] + kvec * voxelDir[2];
-                                                        float valdiff = inFrame[kernIndex] - curval;
-                                                        regress[0][0] += displacement[0] * displacement[0];
-                                                        regress[0][1] += displacement[0] * displacement[1];
-                                                        regress[0][2] += displacement[0] * displacement[2];
-                                                        regress[0][3] += displacement[0];
-                                                        regress[0][4] += displacement[0] * valdiff;
-                                                        regress[1][1] += displacement[1] * displacement[1];
-                                                        regress[1][2] += displacement[1] * displacement[2];
-                                                        regress[1][3] += displacement[1];
-                                                        regress[1][4] += displacement[1] * valdiff;
-                                                        regress[2][2] += displacement[2] * displacement[2];
-                                                        regress[2][3] += displacement[2];
-                                                        regress[2][4] += displacement[2] * valdiff;
-                                                        regress[3][3] += 1;
-                                                        regress[3][4] += valdiff;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                    }
-                                    if (dirUsed == 3)
-                                    {
-                                        regress[1][0] = regress[0][1];//finish the symmetric part of the matrix
-                                        regress[2][0] = regress[0][2];
-                                        regress[2][1] = regress[1][2];
-                                        regress[3][0] = regress[0][3];
-                                        regress[3][1] = regress[1][3];
-                                        regress[3][2] = regress[2][3];
-                                        FloatMatrix result = regress.reducedRowEchelon();
-                                        gradient[0] = result[0][4];
-                                        gradient[1] = result[1][4];
-                                        gradient[2] = result[2][4];//[3][4] is the constant part of the regression
-                                        magnitude = gradient.length();
-                                        if (!MathFunctions::isNumeric(magnitude))
-                                        {
-                                            magnitude = 0.0f;
-                                            gradient[0] = 0.0f;
-                                            gradient[1] = 0.0f;
-                                            gradient[2] = 0.0f;
-                                        }
-                                    } else {//fallback 2: average forward differences in 26-neighborhood
-                                        Vector3D accum;
-                                        int accumCount = 0;
-                                        for (int kkern = kmin; kkern < kmax; ++kkern)
-                                        {
-                                            voxelDir[2] = kkern - k;
-                                            int64_t kindpart = kkern * myDims[1];
-                                            for (int jkern = jmin; jkern < jmax; ++jkern)
-                                            {
-                                                int64_t jindpart = (kindpart + jkern) * myDims[0];
-                                                voxelDir[1] = jkern - j;
-                                                for (int ikern = imin; ikern < imax; ++ikern)
-                                                {
-                                                    int64_t kernIndex = jindpart + ikern;
-                                                    if (roiFrame == NULL || roiFrame[kernIndex] > 0.0f)
-                                                    {
-                                                        float valdiff = inFrame[kernIndex] - curval;
-                                                        voxelDir[0] = ikern - i;
-                                                        Vector3D displacement = ivec * voxelDir[0] + jvec * voxelDir[1] + kvec * voxelDir[2];
-                                                        float length = displacement.length();
-                                                        if (length > 0.0f)
-                                                        {
-                                                            accum += displacement * (valdiff / (length * length));//once to normalize vector, and once to find gradient magnitude
-                                                            ++accumCount;
-                                                        }
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        if (accumCount > 0)
-                                        {
-                                            gradient = accum / accumCount;
-                                            magnitude = gradient.length();
-                                            if (!MathFunctions::isNumeric(magnitude))
-                                            {
-                                                magnitude = 0.0f;
-                                                gradient[0] = 0.0f;
-                                                gradient[1] = 0.0f;
-                                                gradient[2] = 0.0f;
-                                            }
-                                        } else {
-                                            magnitude = 0.0f;
-                                            gradient[0] = 0.0f;
-                                            gradient[1] = 0.0f;
-                                            gradient[2] = 0.0f;
-                                        }
-                                    }
-                                }
-                            } else {
-                                magnitude = 0.0f;
-                                gradient[0] = 0.0f;
-                                gradient[1] = 0.0f;
-                                gradient[2] = 0.0f;
-                            }
-                            volOut->setValue(magnitude, i, j, k, s, c);
-                            if (vectorsOut != NULL)
-                            {
-                                int subvolbase = s * 3;
-                                vectorsOut->setValue(gradient[0], i, j, k, subvolbase, c);
-                                vectorsOut->setValue(gradient[1], i, j, k, subvolbase + 1, c);
-                                vectorsOut->setValue(gradient[2], i, j, k, subvolbase + 2, c);
-                            }
-                        }
+                        vectorsOut->setFrame(vecPointer + axis * frameSize, subvolbase + axis, c);
                     }
                 }
             }
@@ -413,236 +182,13 @@ AlgorithmVolumeGradient::AlgorithmVolumeGradient(ProgressObject* myProgObj, cons
         }
         for (int c = 0; c < myDims[4]; ++c)
         {
-            const float* inFrame = processVol->getFrame(useSubvol, c);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int k = 0; k < myDims[2]; ++k)
+            myGradient.computeGradient(processVol->getFrame(useSubvol, c), magScratch.data(), vecPointer);
+            volOut->setFrame(magScratch.data(), 0, c);
+            if (vectorsOut != NULL)
             {
-                for (int j = 0; j < myDims[1]; ++j)
+                for (int axis = 0; axis < 3; ++axis)
                 {
-                    for (int i = 0; i < myDims[0]; ++i)
-                    {
-                        float magnitude;
-                        Vector3D gradient;
-                        if (myRoi == NULL || myRoi->getValue(i, j, k) > 0.0f)
-                        {
-                            float curval = processVol->getValue(i, j, k, useSubvol, c);
-                            FloatMatrix regress = FloatMatrix::zeros(4, 5);
-                            regress[3][3] = 1;//count the center voxel in case neighbors are missing (displacement and valdiff are zero, cancelling all other terms)
-                            int dircheck = 0;
-                            for (int neighbase = 0; neighbase < 18; neighbase += 3)
-                            {
-                                int ikern = i + stencil[neighbase];
-                                int jkern = j + stencil[neighbase + 1];
-                                int kkern = k + stencil[neighbase + 2];
-                                if (volIn->indexValid(ikern, jkern, kkern))
-                                {
-                                    int64_t kernIndex = volIn->getIndex(ikern, jkern, kkern);
-                                    if (roiFrame == NULL || roiFrame[kernIndex] > 0.0f)
-                                    {
-                                        dircheck |= 1<<(neighbase / 6);//uses the ordering of the neighbors to map neighbor to direction
-                                        float valdiff = inFrame[kernIndex] - curval;
-                                        Vector3D displacement = ivec * stencil[neighbase] + jvec * stencil[neighbase + 1] + kvec * stencil[neighbase + 2];
-                                        regress[0][0] += displacement[0] * displacement[0];//note: this is the generic code, built to handle strange volumes, to get more speed, test
-                                        regress[0][1] += displacement[0] * displacement[1];// for orthogonal volume, and use central differences (if no ROI, could special case for even more speed)
-                                        regress[0][2] += displacement[0] * displacement[2];
-                                        regress[0][3] += displacement[0];
-                                        regress[0][4] += displacement[0] * valdiff;
-                                        regress[1][1] += displacement[1] * displacement[1];
-                                        regress[1][2] += displacement[1] * displacement[2];
-                                        regress[1][3] += displacement[1];
-                                        regress[1][4] += displacement[1] * valdiff;
-                                        regress[2][2] += displacement[2] * displacement[2];
-                                        regress[2][3] += displacement[2];
-                                        regress[2][4] += displacement[2] * valdiff;
-                                        regress[3][3] += 1;
-                                        regress[3][4] += valdiff;
-                                    }
-                                }
-                            }
-                            if (dircheck == 7)//have at least one neighbor in every index axis, continue
-                            {
-                                regress[1][0] = regress[0][1];//finish the symmetric part of the matrix
-                                regress[2][0] = regress[0][2];
-                                regress[2][1] = regress[1][2];
-                                regress[3][0] = regress[0][3];
-                                regress[3][1] = regress[1][3];
-                                regress[3][2] = regress[2][3];
-                                FloatMatrix result = regress.reducedRowEchelon();
-                                gradient[0] = result[0][4];
-                                gradient[1] = result[1][4];
-                                gradient[2] = result[2][4];//[3][4] is the constant part of the regression
-                                magnitude = gradient.length();
-                                if (!MathFunctions::isNumeric(magnitude))
-                                {
-                                    magnitude = 0.0f;
-                                    gradient[0] = 0.0f;
-                                    gradient[1] = 0.0f;
-                                    gradient[2] = 0.0f;
-                                }
-                            } else {//fallback 1: regression with 26-neighbors
-                                Vector3D directions[3];//track the displacements in index space for simplicity
-                                int dirUsed = 0;
-                                if (dircheck & 1)
-                                {
-                                    directions[dirUsed][0] = 1;
-                                    ++dirUsed;
-                                }
-                                if (dircheck & 2)
-                                {
-                                    directions[dirUsed][1] = 1;
-                                    ++dirUsed;
-                                }
-                                if (dircheck & 4)
-                                {
-                                    directions[dirUsed][2] = 1;
-                                    ++dirUsed;
-                                }
-                                int imin = max(i - 1, 0), jmin = max(j - 1, 0), kmin = max(k - 1, 0);
-                                int imax = min(i + 2, (int)myDims[0]), jmax = min(j + 2, (int)myDims[1]), kmax = min(k + 2, (int)myDims[2]);
-                                Vector3D voxelDir;
-                                for (int kkern = kmin; kkern < kmax; ++kkern)
-                                {
-                                    voxelDir[2] = kkern - k;
-                                    int kabs = abs(kkern - k);
-                                    int64_t kindpart = kkern * myDims[1];
-                                    for (int jkern = jmin; jkern < jmax; ++jkern)
-                                    {
-                                        int jabs = abs(jkern - j) + kabs;
-                                        if (jabs > 0)//skip inner loop if it won't get any new neighbors
-                                        {
-                                            int64_t jindpart = (kindpart + jkern) * myDims[0];
-                                            voxelDir[1] = jkern - j;
-                                            for (int ikern = imin; ikern < imax; ++ikern)
-                                            {
-                                                int64_t kernIndex = jindpart + ikern;
-                                                if (jabs + abs(ikern - i) > 1 && (roiFrame == NULL || roiFrame[kernIndex] > 0.0f))//only add non-face neighbors
-                                                {
-                                                    if (dirUsed < 3)//check for singularity via base vectors being dependent
-                                                    {
-                                                        bool newDir = true;
-                                                        switch (dirUsed)
-                                                        {
-                                                            case 0:
-                                                            default:
-                                                                break;
-                                                            case 1:
-                                                                if (voxelDir.cross(directions[0]).length() < 0.01f) newDir = false;
-                                                                break;
-                                                            case 2:
-                                                                if (voxelDir.cross(directions[0]).cross(voxelDir.cross(directions[1])).length() < 0.01f)
-                                                                    newDir = false;
-                                                                break;
-                                                        }
-                                                        if (newDir)
-                                                        {
-                                                            directions[dirUsed] = voxelDir;
-                                                            ++dirUsed;
-                                                        }
-                                                    }
-                                                    voxelDir[0] = ikern - i;
-                                                    Vector3D displacement = ivec * voxelDir[0] + jvec * voxelDir[1] + kvec * voxelDir[2];
-                                                    float valdiff = inFrame[kernIndex] - curval;
-                                                    regress[0][0] += displacement[0] * displacement[0];
-                                                    regress[0][1] += displacement[0] * displacement[1];
-                                                    regress[0][2] += displacement[0] * displacement[2];
-                                                    regress[0][3] += displacement[0];
-                                                    regress[0][4] += displacement[0] * valdiff;
-                                                    regress[1][1] += displacement[1] * displacement[1];
-                                                    regress[1][2] += displacement[1] * displacement[2];
-                                                    regress[1][3] += displacement[1];
-                                                    regress[1][4] += displacement[1] * valdiff;
-                                                    regress[2][2] += displacement[2] * displacement[2];
-                                                    regress[2][3] += displacement[2];
-                                                    regress[2][4] += displacement[2] * valdiff;
-                                                    regress[3][3] += 1;
-                                                    regress[3][4] += valdiff;
-                                                }
-                                            }
-                                        }
-                                    }
-                                }
-                                if (dirUsed == 3)
-                                {
-                                    regress[1][0] = regress[0][1];//finish the symmetric part of the matrix
-                                    regress[2][0] = regress[0][2];
-                                    regress[2][1] = regress[1][2];
-                                    regress[3][0] = regress[0][3];
-                                    regress[3][1] = regress[1][3];
-                                    regress[3][2] = regress[2][3];
-                                    FloatMatrix result = regress.reducedRowEchelon();
-                                    gradient[0] = result[0][4];
-                                    gradient[1] = result[1][4];
-                                    gradient[2] = result[2][4];//[3][4] is the constant part of the regression
-                                    magnitude = gradient.length();
-                                    if (!MathFunctions::isNumeric(magnitude))
-                                    {
-                                        magnitude = 0.0f;
-                                        gradient[0] = 0.0f;
-                                        gradient[1] = 0.0f;
-                                        gradient[2] = 0.0f;
-                                    }
-                                } else {//fallback 2: average forward differences in 26-neighborhood
-                                    Vector3D accum;
-                                    int accumCount = 0;
-                                    for (int kkern = kmin; kkern < kmax; ++kkern)
-                                    {
-                                        voxelDir[2] = kkern - k;
-                                        int64_t kindpart = kkern * myDims[1];
-                                        for (int jkern = jmin; jkern < jmax; ++jkern)
-                                        {
-                                            int64_t jindpart = (kindpart + jkern) * myDims[0];
-                                            voxelDir[1] = jkern - j;
-                                            for (int ikern = imin; ikern < imax; ++ikern)
-                                            {
-                                                int64_t kernIndex = jindpart + ikern;
-                                                if (roiFrame == NULL || roiFrame[kernIndex] > 0.0f)
-                                                {
-                                                    float valdiff = inFrame[kernIndex] - curval;
-                                                    voxelDir[0] = ikern - i;
-                                                    Vector3D displacement = ivec * voxelDir[0] + jvec * voxelDir[1] + kvec * voxelDir[2];
-                                                    float length = displacement.length();
-                                                    if (length > 0.0f)
-                                                    {
-                                                        accum += displacement * (valdiff / (length * length));//once to normalize vector, and once to find gradient magnitude
-                                                        ++accumCount;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                    }
-                                    if (accumCount > 0)
-                                    {
-                                        gradient = accum / accumCount;
-                                        magnitude = gradient.length();
-                                        if (!MathFunctions::isNumeric(magnitude))
-                                        {
-                                            magnitude = 0.0f;
-                                            gradient[0] = 0.0f;
-                                            gradient[1] = 0.0f;
-                                            gradient[2] = 0.0f;
-                                        }
-                                    } else {
-                                        magnitude = 0.0f;
-                                        gradient[0] = 0.0f;
-                                        gradient[1] = 0.0f;
-                                        gradient[2] = 0.0f;
-                                    }
-                                }
-                            }
-                        } else {
-                            magnitude = 0.0f;
-                            gradient[0] = 0.0f;
-                            gradient[1] = 0.0f;
-                            gradient[2] = 0.0f;
-                        }
-                        volOut->setValue(magnitude, i, j, k, 0, c);
-                        if (vectorsOut != NULL)
-                        {
-                            vectorsOut->setValue(gradient[0], i, j, k, 0, c);
-                            vectorsOut->setValue(gradient[1], i, j, k, 1, c);
-                            vectorsOut->setValue(gradient[2], i, j, k, 2, c);
-                        }
-                    }
+                    vectorsOut->setFrame(vecPointer + axis * frameSize, axis, c);
                 }
             }
         }
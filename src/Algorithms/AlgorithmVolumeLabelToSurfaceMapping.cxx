@@ -78,7 +78,7 @@ void AlgorithmVolumeLabelToSurfaceMapping::useParameters(OperationParameters* my
 }
 
 AlgorithmVolumeLabelToSurfaceMapping::AlgorithmVolumeLabelToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface,
-                                                                           LabelFile* myLabelOut, const int& mySubVol) : AbstractAlgorithm(myProgObj)
+                                                                           LabelFile* myLabelOut, const int& mySubVol) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (myVolume->getType() != SubvolumeAttributes::LABEL)
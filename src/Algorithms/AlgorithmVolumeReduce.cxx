@@ -21,10 +21,14 @@
 #include "AlgorithmVolumeReduce.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "GiftiLabelTable.h"
 #include "ReductionOperation.h"
 #include "VolumeFile.h"
+#include "VolumeFrameReader.h"
+#include "VolumeFrameWriter.h"
 
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -43,11 +47,11 @@ AString AlgorithmVolumeReduce::getShortDescription()
 OperationParameters* AlgorithmVolumeReduce::getParameters()
 {
     OperationParameters* ret = new OperationParameters();
-    ret->addVolumeParameter(1, "volume-in", "the volume file to reduce");
+    ret->addOnDiskVolumeParameter(1, "volume-in", "the volume file to reduce");
     
     ret->addStringParameter(2, "operation", "the reduction operator to use");
     
-    ret->addVolumeOutputParameter(3, "volume-out", "the output volume");
+    ret->addOnDiskVolumeOutputParameter(3, "volume-out", "the output volume");
     
     OptionalParameter* excludeOpt = ret->createOptionalParameter(4, "-exclude-outliers", "exclude non-numeric values and outliers by standard deviation");
     excludeOpt->addDoubleParameter(1, "sigma-below", "number of standard deviations below the mean to include");
@@ -64,9 +68,9 @@ OperationParameters* AlgorithmVolumeReduce::getParameters()
 
 void AlgorithmVolumeReduce::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
 {
-    VolumeFile* volumeIn = myParams->getVolume(1);
+    VolumeFrameReader* volumeIn = myParams->getOnDiskVolume(1);
     AString opString = myParams->getString(2);
-    VolumeFile* volumeOut = myParams->getOutputVolume(3);
+    VolumeFrameWriter* volumeOut = myParams->getOnDiskOutputVolume(3);
     OptionalParameter* excludeOpt = myParams->getOptionalParameter(4);
     bool onlyNumeric = myParams->getOptionalParameter(5)->m_present;
     bool ok = false;
@@ -81,7 +85,7 @@ void AlgorithmVolumeReduce::useParameters(OperationParameters* myParams, Progres
     }
 }
 
-AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, const VolumeFile* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFile* volumeOut, const bool& onlyNumeric) : AbstractAlgorithm(myProgObj)
+AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, const VolumeFile* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFile* volumeOut, const bool& onlyNumeric) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myDims, newDims = volumeIn->getOriginalDimensions();
@@ -115,7 +119,7 @@ AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, const Vo
     }
 }
 
-AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, const VolumeFile* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFile* volumeOut, const float& sigmaBelow, const float& sigmaAbove) : AbstractAlgorithm(myProgObj)
+AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, const VolumeFile* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFile* volumeOut, const float& sigmaBelow, const float& sigmaAbove) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myDims, newDims = volumeIn->getOriginalDimensions();
@@ -144,6 +148,81 @@ AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, const Vo
     }
 }
 
+AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, VolumeFrameReader* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFrameWriter* volumeOut, const bool& onlyNumeric) : AbstractAlgorithm(myProgObj, getCommandSwitch())
+{
+    LevelProgress myProgress(myProgObj);
+    reduceOnDisk(volumeIn, myReduce, volumeOut, onlyNumeric, false, 0.0f, 0.0f);
+}
+
+AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, VolumeFrameReader* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFrameWriter* volumeOut, const float& sigmaBelow, const float& sigmaAbove) : AbstractAlgorithm(myProgObj, getCommandSwitch())
+{
+    LevelProgress myProgress(myProgObj);
+    reduceOnDisk(volumeIn, myReduce, volumeOut, false, true, sigmaBelow, sigmaAbove);
+}
+
+void AlgorithmVolumeReduce::reduceOnDisk(VolumeFrameReader* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFrameWriter* volumeOut, const bool& onlyNumeric,
+                                         const bool& excludeOutliers, const float& sigmaBelow, const float& sigmaAbove)
+{
+    if (volumeIn->getNumberOfComponents() != 1)
+    {
+        throw AlgorithmException("multi-component volumes are not supported in streaming reduction");
+    }
+    vector<int64_t> newDims = volumeIn->getOriginalDimensions();
+    newDims.resize(3, 1);//have only one subvolume
+    const int64_t numBricks = volumeIn->getNumberOfMaps();
+    CaretVolumeExtension outExt;
+    outExt.m_attributes.resize(1);
+    outExt.m_attributes[0].grabNew(new SubvolumeAttributes());
+    outExt.m_attributes[0]->m_type = volumeIn->getType();
+    if (volumeIn->getType() == SubvolumeAttributes::LABEL)
+    {
+        CaretLogWarning("reduction operation performed on label volume");
+        outExt.m_attributes[0]->m_labelTable.grabNew(new GiftiLabelTable(*(volumeIn->getCaretExtension().m_attributes[0]->m_labelTable)));
+    }
+    volumeOut->writeHeader(newDims, volumeIn->getVolumeSpace().getSform(), outExt);
+    const int64_t sliceSize = newDims[0] * newDims[1], frameSize = sliceSize * newDims[2];
+    const int64_t slabBudget = ((int64_t)256) * 1024 * 1024 / sizeof(float);//limit on floats of input to hold at once
+    int64_t slabSlices = slabBudget / max(sliceSize * numBricks, (int64_t)1);
+    if (slabSlices < 1) slabSlices = 1;
+    if (slabSlices > newDims[2]) slabSlices = newDims[2];
+    vector<float> slabData(slabSlices * sliceSize * numBricks), outFrame(frameSize);
+    if (slabSlices < newDims[2])
+    {//each slab reads part of every brick, which would restart decompression of a .nii.gz for every slab
+        volumeIn->decompressForSliceReads();
+    }
+    for (int64_t firstSlice = 0; firstSlice < newDims[2]; firstSlice += slabSlices)
+    {
+        const int64_t numSlices = min(slabSlices, newDims[2] - firstSlice);
+        const int64_t slabSize = numSlices * sliceSize;
+        for (int64_t b = 0; b < numBricks; ++b)
+        {//each brick's part of the slab is contiguous in the file
+            volumeIn->readSlices(slabData.data() + b * slabSize, firstSlice, numSlices, b);
+        }
+        const int64_t outOffset = firstSlice * sliceSize;
+#pragma omp CARET_PAR
+        {
+            vector<float> scratchArray(numBricks);
+#pragma omp CARET_FOR schedule(static)
+            for (int64_t i = 0; i < slabSize; ++i)
+            {
+                for (int64_t b = 0; b < numBricks; ++b)
+                {
+                    scratchArray[b] = slabData[b * slabSize + i];
+                }
+                if (excludeOutliers)
+                {
+                    outFrame[outOffset + i] = ReductionOperation::reduceExcludeDev(scratchArray.data(), numBricks, myReduce, sigmaBelow, sigmaAbove);
+                } else if (onlyNumeric) {
+                    outFrame[outOffset + i] = ReductionOperation::reduceOnlyNumeric(scratchArray.data(), numBricks, myReduce);
+                } else {
+                    outFrame[outOffset + i] = ReductionOperation::reduce(scratchArray.data(), numBricks, myReduce);
+                }
+            }
+        }
+    }
+    volumeOut->writeFrame(outFrame.data(), 0);
+}
+
 float AlgorithmVolumeReduce::getAlgorithmInternalWeight()
 {
     return 1.0f;//override this if needed, if the progress bar isn't smooth
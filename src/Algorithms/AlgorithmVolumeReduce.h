@@ -26,15 +26,23 @@
 
 namespace caret {
     
+    class VolumeFrameReader;
+    class VolumeFrameWriter;
+    
     class AlgorithmVolumeReduce : public AbstractAlgorithm
     {
         AlgorithmVolumeReduce();
+        void reduceOnDisk(VolumeFrameReader* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFrameWriter* volumeOut, const bool& onlyNumeric,
+                          const bool& excludeOutliers, const float& sigmaBelow, const float& sigmaAbove);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
         AlgorithmVolumeReduce(ProgressObject* myProgObj, const VolumeFile* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFile* volumeOut, const bool& onlyNumeric = false);
         AlgorithmVolumeReduce(ProgressObject* myProgObj, const VolumeFile* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFile* volumeOut, const float& sigmaBelow, const float& sigmaAbove);
+        ///streaming versions, read slabs of slices across all subvolumes so memory use doesn't scale with the number of subvolumes
+        AlgorithmVolumeReduce(ProgressObject* myProgObj, VolumeFrameReader* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFrameWriter* volumeOut, const bool& onlyNumeric = false);
+        AlgorithmVolumeReduce(ProgressObject* myProgObj, VolumeFrameReader* volumeIn, const ReductionEnum::Enum& myReduce, VolumeFrameWriter* volumeOut, const float& sigmaBelow, const float& sigmaAbove);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
@@ -21,6 +21,8 @@
 #include "AlgorithmVolumeSmoothing.h"
 #include "AlgorithmException.h"
 #include "VolumeFile.h"
+#include "VolumeFrameReader.h"
+#include "VolumeFrameWriter.h"
 #include "Vector3D.h"
 #include "CaretLogger.h"
 #include "CaretOMP.h"
@@ -46,11 +48,11 @@ AString AlgorithmVolumeSmoothing::getShortDescription()
 OperationParameters* AlgorithmVolumeSmoothing::getParameters()
 {
     OperationParameters* ret = new OperationParameters();
-    ret->addVolumeParameter(1, "volume-in", "the volume to smooth");
+    ret->addOnDiskVolumeParameter(1, "volume-in", "the volume to smooth");
     
     ret->addDoubleParameter(2, "kernel", "the gaussian smoothing kernel sigma, in mm");
     
-    ret->addVolumeOutputParameter(3, "volume-out", "the output volume");
+    ret->addOnDiskVolumeOutputParameter(3, "volume-out", "the output volume");
     
     OptionalParameter* roiVolOpt = ret->createOptionalParameter(4, "-roi", "smooth only from data within an ROI");
     roiVolOpt->addVolumeParameter(1, "roivol", "the volume to use as an ROI");
@@ -73,9 +75,9 @@ OperationParameters* AlgorithmVolumeSmoothing::getParameters()
 
 void AlgorithmVolumeSmoothing::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
 {
-    VolumeFile* myVol = myParams->getVolume(1);
+    VolumeFrameReader* myVol = myParams->getOnDiskVolume(1);
     float myKernel = (float)myParams->getDouble(2);
-    VolumeFile* myOutVol = myParams->getOutputVolume(3);
+    VolumeFrameWriter* myOutVol = myParams->getOnDiskOutputVolume(3);
     OptionalParameter* roiVolOpt = myParams->getOptionalParameter(4);
     VolumeFile* roiVol = NULL;
     if (roiVolOpt->m_present)
@@ -94,10 +96,54 @@ void AlgorithmVolumeSmoothing::useParameters(OperationParameters* myParams, Prog
             throw AlgorithmException("invalid subvolume specified");
         }
     }
-    AlgorithmVolumeSmoothing(myProgObj, myVol, myKernel, myOutVol, roiVol, fixZeros, subvolNum);
+    if (roiVol != NULL && !myVol->matchesVolumeSpace(roiVol->getVolumeSpace()))
+    {
+        throw AlgorithmException("volume roi space does not match input volume");
+    }
+    if (myVol->getNumberOfComponents() != 1)
+    {//frames only hold one component, so smooth each component of the whole volume in memory
+        VolumeFile wholeIn, wholeOut;
+        wholeIn.readFile(myVol->getFileName());
+        AlgorithmVolumeSmoothing(myProgObj, &wholeIn, myKernel, &wholeOut, roiVol, fixZeros, subvolNum);
+        myOutVol->writeVolumeFile(wholeOut);
+        return;
+    }
+    LevelProgress myProgress(myProgObj);
+    //stream one subvolume at a time through the in-memory algorithm, so memory use doesn't depend on the number of subvolumes
+    vector<int64_t> outDims = myVol->getOriginalDimensions();
+    vector<int64_t> inFrames;
+    if (subvolNum == -1)
+    {
+        for (int64_t b = 0; b < myVol->getNumberOfMaps(); ++b)
+        {
+            inFrames.push_back(b);
+        }
+    } else {
+        outDims.resize(3);
+        inFrames.push_back(subvolNum);
+    }
+    CaretVolumeExtension outExt;
+    outExt.m_attributes.resize(inFrames.size());
+    for (int64_t i = 0; i < (int64_t)inFrames.size(); ++i)
+    {
+        outExt.m_attributes[i].grabNew(new SubvolumeAttributes());
+        outExt.m_attributes[i]->m_guiLabel = myVol->getMapName(inFrames[i]) + ", smooth " + AString::number(myKernel);
+    }
+    myOutVol->writeHeader(outDims, myVol->getVolumeSpace().getSform(), outExt);
+    VolumeFile frameIn, frameOut;
+    frameIn.reinitialize(myVol->getVolumeSpace(), 1);
+    vector<float> scratchFrame(myVol->getFrameSize());
+    for (int64_t i = 0; i < (int64_t)inFrames.size(); ++i)
+    {
+        myVol->readFrame(scratchFrame.data(), inFrames[i]);
+        frameIn.setFrame(scratchFrame.data());
+        AlgorithmVolumeSmoothing(NULL, &frameIn, myKernel, &frameOut, roiVol, fixZeros, 0);
+        myOutVol->writeFrame(frameOut.getFrame(), i);
+        myProgress.reportProgress(((float)i + 1) / inFrames.size());
+    }
 }
 
-AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, const VolumeFile* inVol, const float& kernel, VolumeFile* outVol, const VolumeFile* roiVol, const bool& fixZeros, const int& subvol) : AbstractAlgorithm(myProgObj)
+AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, const VolumeFile* inVol, const float& kernel, VolumeFile* outVol, const VolumeFile* roiVol, const bool& fixZeros, const int& subvol) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     CaretAssert(inVol != NULL);
     CaretAssert(outVol != NULL);
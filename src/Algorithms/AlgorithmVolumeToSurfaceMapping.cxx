@@ -21,6 +21,7 @@
 #include "AlgorithmVolumeToSurfaceMapping.h"
 #include "AlgorithmException.h"
 
+#include "CaretAssert.h"
 #include "CaretOMP.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
@@ -30,6 +31,7 @@
 #include "Vector3D.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -70,6 +72,7 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
     OptionalParameter* ribbonWeights = ribbonOpt->createOptionalParameter(5, "-output-weights", "write the voxel weights for a vertex to a volume file");
     ribbonWeights->addIntegerParameter(1, "vertex", "the vertex number to get the voxel weights for, 0-based");
     ribbonWeights->addVolumeOutputParameter(2, "weights-out", "volume to write the weights to");
+    ribbonOpt->createOptionalParameter(6, "-exact-overlap", "compute the exact volume of overlap instead of subdividing voxels");
     
     OptionalParameter* myelinStyleOpt = ret->createOptionalParameter(9, "-myelin-style", "use the method from myelin mapping");
     myelinStyleOpt->addVolumeParameter(1, "ribbon-roi", "an roi volume of the cortical ribbon for this hemisphere");
@@ -87,7 +90,8 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
         "The volume ROI is useful to exclude partial volume effects of voxels the surfaces pass through, and will cause the mapping to ignore " +
         "voxels that don't have a positive value in the mask.  The subdivision number specifies how it approximates the amount of the volume the polyhedron " +
         "intersects, by splitting each voxel into NxNxN pieces, and checking whether the center of each piece is inside the polyhedron.  If you have very large " +
-        "voxels, consider increasing this if you get zeros in your output.\n\n" +
+        "voxels, consider increasing this if you get zeros in your output.  Alternatively, -exact-overlap computes the overlap volume of the polyhedron and each voxel " +
+        "directly, which gives the result that increasing the subdivisions converges to, and is usually faster than a high subdivision number.\n\n" +
         "The myelin style method uses part of the caret5 myelin mapping command to do the mapping: for each surface vertex, take all voxels closer than the thickness at the vertex " +
         "that are within the ribbon ROI, and less than half the thickness value away from the vertex along the direction of the surface normal, and apply a gaussian kernel " +
         "with the specified sigma to them to get the weights to use."
@@ -193,6 +197,14 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
                     throw AlgorithmException("invalid number of subdivisions specified");
                 }
             }
+            if (ribbonOpt->getOptionalParameter(6)->m_present)
+            {
+                if (ribbonSubdiv->m_present)
+                {
+                    throw AlgorithmException("-voxel-subdiv and -exact-overlap cannot be used together");
+                }
+                subdivisions = 0;//RibbonMappingHelper computes exact overlap for 0 subdivisions
+            }
             int weightsOutVertex = -1;
             VolumeFile* weightsOut = NULL;
             OptionalParameter* ribbonWeights = ribbonOpt->getOptionalParameter(5);
@@ -219,7 +231,7 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
 
 //interpolation mapping
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
-                                                                 const VolumeFile::InterpType& myMethod, const int64_t& mySubVol) : AbstractAlgorithm(myProgObj)
+                                                                 const VolumeFile::InterpType& myMethod, const int64_t& mySubVol) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -270,11 +282,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
                 metricLabel += methodName;
                 int64_t thisCol = i * myVolDims[4] + j;
                 myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myArray[node] = myVolume->interpolateValue(mySurface->getCoordinate(node), myMethod, NULL, i, j);
-                }
+                myVolume->interpolateValues(mySurface->getCoordinateData(), numNodes, myArray.data(), myMethod, NULL, i, j);
                 if (myMethod == VolumeFile::CUBIC)
                 {
                     myVolume->freeSpline(i, j);//release memory we no longer need, if we allocated it
@@ -297,11 +305,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
             metricLabel += methodName;
             int64_t thisCol = j;
             myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                myArray[node] = myVolume->interpolateValue(mySurface->getCoordinate(node), myMethod, NULL, mySubVol, j);
-            }
+            myVolume->interpolateValues(mySurface->getCoordinateData(), numNodes, myArray.data(), myMethod, NULL, mySubVol, j);
             if (myMethod == VolumeFile::CUBIC)
             {
                 myVolume->freeSpline(mySubVol, j);//release memory we no longer need, if we allocated it
@@ -314,7 +318,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
 //ribbon mapping
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                                                  const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile* roiVol,
-                                                                 const int32_t& subdivisions, const int64_t& mySubVol, const int& weightsOutVertex, VolumeFile* weightsOut) : AbstractAlgorithm(myProgObj)
+                                                                 const int32_t& subdivisions, const int64_t& mySubVol, const int& weightsOutVertex, VolumeFile* weightsOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -362,82 +366,14 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
             weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
         }
     }
-    CaretArray<float> myScratchArray(numNodes);
-    float* myScratch = myScratchArray.getArray();
-    if (mySubVol == -1)
-    {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch);
-            }
-        }
-    } else {
-        for (int64_t j = 0; j < myVolDims[4]; ++j)
-        {
-            AString metricLabel = myVolume->getMapName(mySubVol);
-            if (myVolDims[4] != 1)
-            {
-                metricLabel += " component " + AString::number(j);
-            }
-            metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch);
-        }
-    }
+    vector<int64_t> frameBricks, frameComponents;
+    setMappedColumnNames(myVolume, mySubVol, myMetricOut, frameBricks, frameComponents);
+    applyWeightsFrameBlocked(myWeights, true, myVolume, frameBricks, frameComponents, myMetricOut);
 }
 
 //myelin style mapping
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
-                                                                 const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol): AbstractAlgorithm(myProgObj)
+                                                                 const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol): AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -462,58 +398,150 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     myMetricOut->setStructure(mySurface->getStructure());
     vector<vector<VoxelWeight> > myWeights;
     precomputeWeightsMyelin(myWeights, mySurface, roiVol, thickness, sigma);
-    vector<float> myScratch(numNodes);
-    if (mySubVol == -1)
+    vector<int64_t> frameBricks, frameComponents;
+    setMappedColumnNames(myVolume, mySubVol, myMetricOut, frameBricks, frameComponents);
+    applyWeightsFrameBlocked(myWeights, false, myVolume, frameBricks, frameComponents, myMetricOut);//weights have already been normalized in precompute, for this method
+}
+
+void AlgorithmVolumeToSurfaceMapping::setMappedColumnNames(const VolumeFile* myVolume, const int64_t& mySubVol, MetricFile* myMetricOut,
+                                                           vector<int64_t>& frameBricksOut, vector<int64_t>& frameComponentsOut)
+{
+    vector<int64_t> myVolDims;
+    myVolume->getDimensions(myVolDims);
+    frameBricksOut.clear();
+    frameComponentsOut.clear();
+    int64_t startBrick = 0, endBrick = myVolDims[3];
+    if (mySubVol != -1)
+    {
+        startBrick = mySubVol;
+        endBrick = mySubVol + 1;
+    }
+    for (int64_t i = startBrick; i < endBrick; ++i)
     {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    double accum = 0.0;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);//weights have already been normalized in precompute, for this method
-                    }
-                    myScratch[node] = accum;
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch.data());
-            }
-        }
-    } else {
         for (int64_t j = 0; j < myVolDims[4]; ++j)
         {
-            AString metricLabel = myVolume->getMapName(mySubVol);
+            AString metricLabel = myVolume->getMapName(i);
             if (myVolDims[4] != 1)
             {
                 metricLabel += " component " + AString::number(j);
             }
             metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
+            myMetricOut->setColumnName((int32_t)frameBricksOut.size(), metricLabel);
+            frameBricksOut.push_back(i);
+            frameComponentsOut.push_back(j);
+        }
+    }
+}
+
+void AlgorithmVolumeToSurfaceMapping::applyWeightsFrameBlocked(const vector<vector<VoxelWeight> >& myWeights, const bool& normalizeWeights, const VolumeFile* myVolume,
+                                                               const vector<int64_t>& frameBricks, const vector<int64_t>& frameComponents, MetricFile* myMetricOut)
+{
+    CaretAssert(frameBricks.size() == frameComponents.size());
+    int64_t numNodes = (int64_t)myWeights.size();
+    int64_t numFrames = (int64_t)frameBricks.size();
+    //compact the voxels used by any vertex into a sorted list, so the per-frame gather walks each frame in memory order
+    vector<int64_t> usedVoxels;
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        int numVoxels = (int)myWeights[node].size();
+        for (int voxel = 0; voxel < numVoxels; ++voxel)
+        {
+            usedVoxels.push_back(myVolume->getIndex(myWeights[node][voxel].ijk));
+        }
+    }
+    sort(usedVoxels.begin(), usedVoxels.end());
+    usedVoxels.erase(unique(usedVoxels.begin(), usedVoxels.end()), usedVoxels.end());
+    int64_t numUsed = (int64_t)usedVoxels.size();
+    //convert the weights to compressed rows of compact voxel indices, with normalization folded in
+    vector<int64_t> rowStart(numNodes + 1, 0);
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        rowStart[node + 1] = rowStart[node] + (int64_t)myWeights[node].size();
+    }
+    vector<int64_t> compactIndex(rowStart[numNodes]);
+    vector<float> compactWeight(rowStart[numNodes]);
 #pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        int numVoxels = (int)myWeights[node].size();
+        double totalWeight = 0.0;
+        for (int voxel = 0; voxel < numVoxels; ++voxel)
+        {
+            totalWeight += myWeights[node][voxel].weight;
+        }
+        for (int voxel = 0; voxel < numVoxels; ++voxel)
+        {
+            int64_t thisIndex = rowStart[node] + voxel;
+            compactIndex[thisIndex] = lower_bound(usedVoxels.begin(), usedVoxels.end(), myVolume->getIndex(myWeights[node][voxel].ijk)) - usedVoxels.begin();
+            if (!normalizeWeights)
+            {
+                compactWeight[thisIndex] = myWeights[node][voxel].weight;
+            } else if (totalWeight != 0.0) {
+                compactWeight[thisIndex] = myWeights[node][voxel].weight / totalWeight;
+            } else {
+                compactWeight[thisIndex] = 0.0f;
+            }
+        }
+    }
+    //transpose blocks of frames into voxel-major time courses, so each vertex's weights apply to a contiguous run of frames
+    const int64_t MAX_BLOCK_FRAMES = 64, MAX_BLOCK_BYTES = 256 * 1024 * 1024;
+    int64_t blockFrames = MAX_BLOCK_FRAMES;
+    if (numUsed > 0 && numUsed * blockFrames * (int64_t)sizeof(float) > MAX_BLOCK_BYTES)
+    {
+        blockFrames = max((int64_t)1, MAX_BLOCK_BYTES / (numUsed * (int64_t)sizeof(float)));
+    }
+    if (blockFrames > numFrames) blockFrames = numFrames;
+    vector<float> timeCourses(numUsed * blockFrames), outBlock(numNodes * blockFrames);
+    vector<const float*> framePointers(blockFrames);
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += blockFrames)
+    {
+        int64_t thisBlockFrames = min(blockFrames, numFrames - blockStart);
+        for (int64_t f = 0; f < thisBlockFrames; ++f)
+        {
+            framePointers[f] = myVolume->getFrame(frameBricks[blockStart + f], frameComponents[blockStart + f]);
+        }
+        const int64_t VOXEL_CHUNK = 4096;
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t chunkStart = 0; chunkStart < numUsed; chunkStart += VOXEL_CHUNK)
+        {
+            int64_t chunkEnd = min(chunkStart + VOXEL_CHUNK, numUsed);
+            for (int64_t f = 0; f < thisBlockFrames; ++f)
+            {
+                const float* thisFrame = framePointers[f];
+                for (int64_t v = chunkStart; v < chunkEnd; ++v)
+                {
+                    timeCourses[v * blockFrames + f] = thisFrame[usedVoxels[v]];
+                }
+            }
+        }
+#pragma omp CARET_PAR
+        {
+            vector<double> accum(thisBlockFrames);
+#pragma omp CARET_FOR schedule(dynamic, 256)
             for (int64_t node = 0; node < numNodes; ++node)
             {
-                double accum = 0.0;
-                int numVoxels = (int)myWeights[node].size();
-                for (int voxel = 0; voxel < numVoxels; ++voxel)
+                for (int64_t f = 0; f < thisBlockFrames; ++f)
                 {
-                    accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);//weights have already been normalized in precompute, for this method
+                    accum[f] = 0.0;
+                }
+                for (int64_t w = rowStart[node]; w < rowStart[node + 1]; ++w)
+                {
+                    const float thisWeight = compactWeight[w];
+                    const float* thisTimeCourse = timeCourses.data() + compactIndex[w] * blockFrames;
+                    for (int64_t f = 0; f < thisBlockFrames; ++f)
+                    {
+                        accum[f] += thisWeight * thisTimeCourse[f];
+                    }
+                }
+                for (int64_t f = 0; f < thisBlockFrames; ++f)
+                {
+                    outBlock[f * numNodes + node] = accum[f];
                 }
-                myScratch[node] = accum;
             }
-            myMetricOut->setValuesForColumn(thisCol, myScratch.data());
+        }
+        for (int64_t f = 0; f < thisBlockFrames; ++f)
+        {
+            myMetricOut->setValuesForColumn(blockStart + f, outBlock.data() + f * numNodes);
         }
     }
 }
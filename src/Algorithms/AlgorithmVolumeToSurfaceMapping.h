@@ -35,6 +35,11 @@ namespace caret {
     {
         AlgorithmVolumeToSurfaceMapping();
         void precomputeWeightsMyelin(std::vector<std::vector<VoxelWeight> >& myWeights, const SurfaceFile* mySurface, const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma);
+        void setMappedColumnNames(const VolumeFile* myVolume, const int64_t& mySubVol, MetricFile* myMetricOut,
+                                  std::vector<int64_t>& frameBricksOut, std::vector<int64_t>& frameComponentsOut);
+        ///apply precomputed weights to blocks of frames at once, gathering only the voxels used by some vertex
+        void applyWeightsFrameBlocked(const std::vector<std::vector<VoxelWeight> >& myWeights, const bool& normalizeWeights, const VolumeFile* myVolume,
+                                      const std::vector<int64_t>& frameBricks, const std::vector<int64_t>& frameComponents, MetricFile* myMetricOut);
         enum Method
         {
             TRILINEAR,
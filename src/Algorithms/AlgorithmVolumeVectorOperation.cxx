@@ -88,7 +88,7 @@ void AlgorithmVolumeVectorOperation::useParameters(OperationParameters* myParams
 
 AlgorithmVolumeVectorOperation::AlgorithmVolumeVectorOperation(ProgressObject* myProgObj, const VolumeFile* volumeA, const VolumeFile* volumeB,
                                                                const VectorOperation::Operation& myOper, VolumeFile* myVolumeOut,
-                                                               const bool& normA, const bool& normB, const bool& normOut, const bool& magOut) : AbstractAlgorithm(myProgObj)
+                                                               const bool& normA, const bool& normB, const bool& normOut, const bool& magOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const VolumeSpace& checkSpace = volumeA->getVolumeSpace();
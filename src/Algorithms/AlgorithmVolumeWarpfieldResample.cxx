@@ -96,7 +96,7 @@ void AlgorithmVolumeWarpfieldResample::useParameters(OperationParameters* myPara
 }
 
 AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObject* myProgObj, const VolumeFile* inVol, const VolumeFile* warpfield,
-                                                                   const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod, VolumeFile* outVol) : AbstractAlgorithm(myProgObj)
+                                                                   const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod, VolumeFile* outVol) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> warpDims;
@@ -120,6 +120,8 @@ AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObjec
             *(outVol->getMapLabelTable(i)) = *(inVol->getMapLabelTable(i));
         }
     }
+    const int64_t sliceSize = outDims[0] * outDims[1];
+    vector<float> outFrame(sliceSize * outDims[2]);
     for (int64_t c = 0; c < numComponents; ++c)
     {
         for (int64_t b = 0; b < numMaps; ++b)
@@ -128,30 +130,46 @@ AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObjec
             {
                 inVol->validateSpline(b, c);//because deconvolve is parallel, but won't execute parallel if we are already in a parallel section
             }
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t k = 0; k < outDims[2]; ++k)
+#pragma omp CARET_PAR
             {
-                for (int64_t j = 0; j < outDims[1]; ++j)
+                vector<float> sliceCoords(sliceSize * 3), displacement(sliceSize * 3);
+                CaretArray<bool> validDisplacement(sliceSize);
+#pragma omp CARET_FOR schedule(dynamic)
+                for (int64_t k = 0; k < outDims[2]; ++k)
                 {
-                    for (int64_t i = 0; i < outDims[0]; ++i)
+                    for (int64_t j = 0; j < outDims[1]; ++j)
                     {
-                        Vector3D outCoord, inCoord, displacement;
-                        outVol->indexToSpace(i, j, k, outCoord);
-                        bool validDisplacement = false;
-                        displacement[0] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, &validDisplacement, 0);
-                        if (validDisplacement)
+                        for (int64_t i = 0; i < outDims[0]; ++i)
                         {
-                            displacement[1] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, NULL, 1);
-                            displacement[2] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, NULL, 2);
-                            inCoord = outCoord + displacement;
-                            float interpVal = inVol->interpolateValue(inCoord, myMethod, NULL, b, c);
-                            outVol->setValue(interpVal, i, j, k, b, c);
-                        } else {
-                            outVol->setValue(VolumeFile::INVALID_INTERP_VALUE, i, j, k, b, c);
+                            outVol->indexToSpace(i, j, k, sliceCoords.data() + (i + j * outDims[0]) * 3);
                         }
                     }
+                    float* sliceOut = outFrame.data() + k * sliceSize;
+                    warpfield->interpolateValues(sliceCoords.data(), sliceSize, sliceOut, VolumeFile::TRILINEAR, validDisplacement.getArray(), 0);
+                    for (int64_t v = 0; v < sliceSize; ++v)
+                    {
+                        displacement[v * 3] = sliceOut[v];
+                    }
+                    for (int d = 1; d < 3; ++d)
+                    {
+                        warpfield->interpolateValues(sliceCoords.data(), sliceSize, sliceOut, VolumeFile::TRILINEAR, NULL, d);
+                        for (int64_t v = 0; v < sliceSize; ++v)
+                        {
+                            displacement[v * 3 + d] = sliceOut[v];
+                        }
+                    }
+                    for (int64_t v = 0; v < sliceSize * 3; ++v)
+                    {
+                        sliceCoords[v] += displacement[v];
+                    }
+                    inVol->interpolateValues(sliceCoords.data(), sliceSize, sliceOut, myMethod, NULL, b, c);
+                    for (int64_t v = 0; v < sliceSize; ++v)
+                    {
+                        if (!validDisplacement[v]) sliceOut[v] = VolumeFile::INVALID_INTERP_VALUE;
+                    }
                 }
             }
+            outVol->setFrame(outFrame.data(), b, c);
             if (myMethod == VolumeFile::CUBIC)
             {
                 inVol->freeSpline(b, c);//release memory we no longer need, if we allocated it
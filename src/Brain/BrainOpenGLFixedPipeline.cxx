@@ -129,6 +129,7 @@
 #include "SurfaceMontageViewport.h"
 #include "SurfaceNodeColoring.h"
 #include "SurfaceProjectedItem.h"
+#include "SurfaceProjectedItemArrays.h"
 #include "SurfaceProjectionBarycentric.h"
 #include "SurfaceProjectionVanEssen.h"
 #include "SurfaceSelectionModel.h"
@@ -2295,18 +2296,36 @@ BrainOpenGLFixedPipeline::drawBorder(const BorderDrawInfo& borderDrawInfo)
     const std::vector<int32_t>& nodesBoundaryEdgeCount = th->getNumberOfBoundaryEdgesForAllNodes();
     CaretAssert(static_cast<int32_t>(nodesBoundaryEdgeCount.size()) == borderDrawInfo.surface->getNumberOfNodes());
     
+    /*
+     * Unproject all points in one pass, const access keeps the border's point arrays valid
+     */
+    const Border* constBorder = borderDrawInfo.border;
+    const SurfaceProjectedItemArrays* pointArrays = constBorder->getPointArrays();
+    std::vector<float> allXYZ;
+    std::vector<char> allXYZValid;
+    pointArrays->getProjectedPositionsAboveSurface(*borderDrawInfo.surface,
+                                                   allXYZ,
+                                                   allXYZValid,
+                                                   drawAtDistanceAboveSurface);
+    std::vector<float> allAnatomicalXYZ;
+    std::vector<char> allAnatomicalXYZValid;
+    if (flatSurfaceDrawUnstretchedLinesFlag) {
+        pointArrays->getProjectedPositionsAboveSurface(*borderDrawInfo.anatomicalSurface,
+                                                       allAnatomicalXYZ,
+                                                       allAnatomicalXYZValid,
+                                                       drawAtDistanceAboveSurface);
+    }
+    
     /*
      * Find points valid for this surface
      */
     for (int32_t i = 0; i < numBorderPoints; i++) {
-        const SurfaceProjectedItem* p = borderDrawInfo.border->getPoint(i);
-        
         /*
          * If surface structure does not match the point's structure,
          * check to see if contralateral display is enabled and 
          * compare contralateral surface structure to point's structure.
          */
-        const StructureEnum::Enum pointStructure = p->getStructure();
+        const StructureEnum::Enum pointStructure = pointArrays->getStructure(i);
         bool structureMatches = true;
         if (surfaceStructure != pointStructure) {
             structureMatches = false;
@@ -2320,10 +2339,8 @@ BrainOpenGLFixedPipeline::drawBorder(const BorderDrawInfo& borderDrawInfo)
             continue;
         }
         
-        float xyz[3];
-        bool isXyzValid = p->getProjectedPositionAboveSurface(*borderDrawInfo.surface, 
-                                                                    xyz,
-                                                                    drawAtDistanceAboveSurface);
+        const float* xyz = &allXYZ[i * 3];
+        bool isXyzValid = (allXYZValid[i] != 0);
         
         if (isXyzValid) {
             /*
@@ -2332,16 +2349,14 @@ BrainOpenGLFixedPipeline::drawBorder(const BorderDrawInfo& borderDrawInfo)
              * (near cuts and medial wall)
              */
             if (flatSurfaceDrawUnstretchedLinesFlag){
-                if (p->getBarycentricProjection()->isValid()) {
-                    const int32_t* baryNodes = p->getBarycentricProjection()->getTriangleNodes();
-                    if (baryNodes != NULL) {
-                        int32_t edgeNodeCount = 0;
-                        if (nodesBoundaryEdgeCount[baryNodes[0]] > 0) edgeNodeCount++;
-                        if (nodesBoundaryEdgeCount[baryNodes[1]] > 0) edgeNodeCount++;
-                        if (nodesBoundaryEdgeCount[baryNodes[2]] > 0) edgeNodeCount++;
-                        if (edgeNodeCount >= 3) {
-                            isXyzValid = false;
-                        }
+                const int32_t* baryNodes = pointArrays->getBarycentricTriangleNodes(i);
+                if (baryNodes != NULL) {
+                    int32_t edgeNodeCount = 0;
+                    if (nodesBoundaryEdgeCount[baryNodes[0]] > 0) edgeNodeCount++;
+                    if (nodesBoundaryEdgeCount[baryNodes[1]] > 0) edgeNodeCount++;
+                    if (nodesBoundaryEdgeCount[baryNodes[2]] > 0) edgeNodeCount++;
+                    if (edgeNodeCount >= 3) {
+                        isXyzValid = false;
                     }
                 }
             }
@@ -2349,11 +2364,8 @@ BrainOpenGLFixedPipeline::drawBorder(const BorderDrawInfo& borderDrawInfo)
         
         if (isXyzValid) {
             if (flatSurfaceDrawUnstretchedLinesFlag) {
-                float anatXYZ[3];
-                const bool isAnatXyzValid = p->getProjectedPositionAboveSurface(*borderDrawInfo.anatomicalSurface,
-                                                                                anatXYZ,
-                                                                                drawAtDistanceAboveSurface);
-                if (isAnatXyzValid) {
+                if (allAnatomicalXYZValid[i]) {
+                    const float* anatXYZ = &allAnatomicalXYZ[i * 3];
                     pointXYZ.push_back(xyz[0]);
                     pointXYZ.push_back(xyz[1]);
                     pointXYZ.push_back(xyz[2]);
@@ -2754,8 +2766,21 @@ BrainOpenGLFixedPipeline::drawSurfaceFoci(Surface* surface)
         
         const int32_t numFoci = fociFile->getNumberOfFoci();
         
+        /*
+         * Unproject all foci in one pass
+         */
+        const FociFile* constFociFile = fociFile;//non-const getFocus() discards the file's projection arrays
+        std::vector<int32_t> focusProjectionOffsets;
+        CaretPointer<const SurfaceProjectedItemArrays> projectionArrays = constFociFile->getProjectionArrays(focusProjectionOffsets);
+        std::vector<float> projectionXYZ;
+        std::vector<char> projectionValid;
+        projectionArrays->getProjectedPositions(*surface,
+                                                projectionXYZ,
+                                                projectionValid,
+                                                isPasteOntoSurface);
+        
         for (int32_t j = 0; j < numFoci; j++) {
-            Focus* focus = fociFile->getFocus(j);
+            const Focus* focus = constFociFile->getFocus(j);
             float rgba[4] = { 0.0, 0.0, 0.0, 1.0 };
             
             const GroupAndNameHierarchyItem* nameItem = focus->getGroupNameSelectionItem();
@@ -2772,11 +2797,8 @@ BrainOpenGLFixedPipeline::drawSurfaceFoci(Surface* surface)
                         const GiftiLabel* colorLabel = classColorTable->getLabelBestMatching(focus->getClassName());
                         if (colorLabel != NULL) {
                             colorLabel->getColor(rgba);
-                            focus->setClassRgba(rgba);
-                        }
-                        else {
-                            focus->setClassRgba(rgba);
                         }
+                        fociFile->getFocus(j)->setClassRgba(rgba);
                     }
                     focus->getClassRgba(rgba);
                     break;
@@ -2791,11 +2813,8 @@ BrainOpenGLFixedPipeline::drawSurfaceFoci(Surface* surface)
                         const GiftiLabel* colorLabel = nameColorTable->getLabelBestMatching(focus->getName());
                         if (colorLabel != NULL) {
                             colorLabel->getColor(rgba);
-                            focus->setNameRgba(rgba);
-                        }
-                        else {
-                            focus->setNameRgba(rgba);
                         }
+                        fociFile->getFocus(j)->setNameRgba(rgba);
                     }
                     focus->getNameRgba(rgba);
                     break;
@@ -2806,12 +2825,10 @@ BrainOpenGLFixedPipeline::drawSurfaceFoci(Surface* surface)
             
             const int32_t numProjections = focus->getNumberOfProjections();
             for (int32_t k = 0; k < numProjections; k++) {
-                const SurfaceProjectedItem* spi = focus->getProjection(k);
-                float xyz[3];
-                if (spi->getProjectedPosition(*surface,
-                                              xyz,
-                                              isPasteOntoSurface)) {
-                    const StructureEnum::Enum focusStructure = spi->getStructure();
+                const int32_t projectionIndex = focusProjectionOffsets[j] + k;
+                if (projectionValid[projectionIndex]) {
+                    const float* xyz = &projectionXYZ[projectionIndex * 3];
+                    const StructureEnum::Enum focusStructure = projectionArrays->getStructure(projectionIndex);
                     bool drawIt = false;
                     if (focusStructure == surfaceStructure) {
                         drawIt = true;
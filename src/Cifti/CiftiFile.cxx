@@ -24,6 +24,7 @@
 #include "CaretAssert.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "MultiDimArray.h"
@@ -42,13 +43,16 @@ namespace caret
         CiftiXML m_xml;//because we need to parse it to set up the dimensions anyway
     public:
         CiftiOnDiskImpl(const QString& filename);//read-only
-        CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version);//make new empty file with read/write
+        CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const int16_t& dataType = NIFTI_TYPE_FLOAT32,
+                        const double& mult = 1.0, const double& offset = 0.0);//make new empty file, with read/write unless compressed
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize) const;
+        void setRows(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize);
     };
     
     class CiftiMemoryImpl : public CiftiFile::WriteImplInterface
@@ -61,6 +65,8 @@ namespace caret
         bool isInMemory() const { return true; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize) const;
+        void setRows(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize);
     };
     
     class CiftiXnatImpl : public CiftiFile::ReadImplInterface
@@ -87,11 +93,73 @@ CiftiFile::WriteImplInterface::~WriteImplInterface()
 {
 }
 
+void CiftiFile::ReadImplInterface::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize) const
+{
+    vector<int64_t> tempvec(1);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        tempvec[0] = firstRow + i;
+        getRow(dataOut + i * rowSize, tempvec, false);
+    }
+}
+
+void CiftiFile::WriteImplInterface::setRows(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize)
+{
+    vector<int64_t> tempvec(1);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        tempvec[0] = firstRow + i;
+        setRow(dataIn + i * rowSize, tempvec);
+    }
+}
+
+int16_t CiftiFile::s_defaultWritingDataType = NIFTI_TYPE_FLOAT32;
+
+namespace
+{
+    bool isIntegerType(const int16_t& type)
+    {//only valid for types that pass NiftiHeader::isSupportedOutputType
+        return type != NIFTI_TYPE_FLOAT32 && type != NIFTI_TYPE_FLOAT64;
+    }
+}
+
 CiftiFile::CiftiFile(const QString& fileName)
 {
+    m_writingDataType = s_defaultWritingDataType;
     openFile(fileName);
 }
 
+void CiftiFile::setDefaultWritingDataType(const int16_t& type)
+{
+    if (!NiftiHeader::isSupportedOutputType(type)) throw DataFileException("unsupported datatype for cifti output: " + QString::number(type));
+    s_defaultWritingDataType = type;
+}
+
+void CiftiFile::setWritingDataType(const int16_t& type)
+{
+    if (!NiftiHeader::isSupportedOutputType(type)) throw DataFileException("unsupported datatype for cifti output: " + QString::number(type));
+    if (type != m_writingDataType && m_writingImpl != NULL && !isInMemory())
+    {
+        convertToInMemory();//data already written with the old type, keep it and write it out in writeFile
+    }
+    m_writingDataType = type;
+}
+
+bool CiftiFile::mustDeferWriting() const
+{//compressed files can only be written sequentially, and integer types need the range of all the data before the header is written
+    return m_writingFile.endsWith(".gz") || isIntegerType(getOutputDataType());
+}
+
+int16_t CiftiFile::getOutputDataType() const
+{
+    if (!isIntegerType(m_writingDataType)) return m_writingDataType;
+    for (int i = 0; i < m_xml.getNumberOfDimensions(); ++i)
+    {
+        if (m_xml.getMappingType(i) == CiftiMappingType::LABELS) return NIFTI_TYPE_FLOAT32;
+    }
+    return m_writingDataType;
+}
+
 void CiftiFile::openFile(const QString& fileName)
 {
     m_writingImpl.grabNew(NULL);
@@ -153,15 +221,37 @@ void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVe
         m_readingImpl = tempMemory;//we are about to make the old reading impl very unhappy, replace it so that if we get an error while writing, we hang onto the memory version
         m_writingImpl.grabNew(NULL);//and make it re-magic the writing implementation again if data is set
     }
-    CaretPointer<WriteImplInterface> tempWrite(new CiftiOnDiskImpl(myInfo.getAbsoluteFilePath(), m_xml, writingVersion));
+    double mult = 1.0, offset = 0.0;
+    const int16_t outType = getOutputDataType();
+    if (isIntegerType(outType))
+    {//find the range of the data to see whether it needs scaling
+        double minVal = numeric_limits<double>::infinity(), maxVal = -numeric_limits<double>::infinity();
+        bool allIntegers = true;
+        vector<int64_t> iterateDims(m_dims.begin() + 1, m_dims.end());
+        vector<float> scratchRow(m_dims[0]);
+        for (MultiDimIterator<int64_t> iter(iterateDims); !iter.atEnd(); ++iter)
+        {
+            m_readingImpl->getRow(scratchRow.data(), *iter, false);
+            NiftiHeader::accumulateDataRange(scratchRow.data(), m_dims[0], minVal, maxVal, allIntegers);
+        }
+        NiftiHeader::computeDataScaling(outType, minVal, maxVal, allIntegers, mult, offset);
+    }
+    CaretPointer<WriteImplInterface> tempWrite(new CiftiOnDiskImpl(myInfo.getAbsoluteFilePath(), m_xml, writingVersion, outType, mult, offset));
     copyImplData(m_readingImpl, tempWrite, m_dims);
     if (collision)//if we rewrote the file, we need the handle to the new file, and to dump the temporary in-memory version
     {
         m_onDiskVersion = writingVersion;//also record the current version number
-        m_readingImpl = tempWrite;//replace the temporary memory version
-        if (hadWriter)//if it was in read-write mode
-        {
-            m_writingImpl = tempWrite;//set the writer too
+        if (fileName.endsWith(".gz"))
+        {//compressed files are opened write-only, so reopen for reading
+            tempWrite.grabNew(NULL);
+            m_readingImpl.grabNew(new CiftiOnDiskImpl(myInfo.getAbsoluteFilePath()));
+            m_writingImpl.grabNew(NULL);
+        } else {
+            m_readingImpl = tempWrite;//replace the temporary memory version
+            if (hadWriter)//if it was in read-write mode
+            {
+                m_writingImpl = tempWrite;//set the writer too
+            }
         }
     }
 }
@@ -303,12 +393,30 @@ void CiftiFile::setRow(const float* dataIn, const int64_t& index)
 }
 //*///end old compatibility functions
 
+void CiftiFile::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows) const
+{
+    if (m_dims.empty()) throw DataFileException("getRows called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRows called on non-2D CiftiFile");
+    CaretAssert(firstRow >= 0 && numRows >= 0 && firstRow + numRows <= m_dims[1]);
+    if (m_readingImpl == NULL || numRows == 0) return;//see getRow
+    m_readingImpl->getRows(dataOut, firstRow, numRows, m_dims[0]);
+}
+
+void CiftiFile::setRows(const float* dataIn, const int64_t& firstRow, const int64_t& numRows)
+{
+    verifyWriteImpl();
+    if (m_dims.size() != 2) throw DataFileException("setRows called on non-2D CiftiFile");
+    CaretAssert(firstRow >= 0 && numRows >= 0 && firstRow + numRows <= m_dims[1]);
+    if (numRows == 0) return;
+    m_writingImpl->setRows(dataIn, firstRow, numRows, m_dims[0]);
+}
+
 void CiftiFile::verifyWriteImpl()
 {//this is where the magic happens - we want to emulate being a simple in-memory file, but actually be reading/writing on-disk when possible
     if (m_writingImpl != NULL) return;
     CaretAssert(!m_dims.empty());//if the xml hasn't been set, then we can't do anything meaningful
     if (m_dims.empty()) throw DataFileException("setRow or setColumn attempted on uninitialized CiftiFile");
-    if (m_writingFile == "")
+    if (m_writingFile == "" || mustDeferWriting())//when deferred, writeFile does the actual writing
     {
         if (m_readingImpl != NULL)
         {
@@ -329,7 +437,7 @@ void CiftiFile::verifyWriteImpl()
                 }
             }
         }
-        m_writingImpl.grabNew(new CiftiOnDiskImpl(m_writingFile, m_xml, m_onDiskVersion));//this constructor makes new file for writing
+        m_writingImpl.grabNew(new CiftiOnDiskImpl(m_writingFile, m_xml, m_onDiskVersion, getOutputDataType()));//this constructor makes new file for writing
         if (m_readingImpl != NULL)
         {
             copyImplData(m_readingImpl, m_writingImpl, m_dims);
@@ -388,6 +496,28 @@ void CiftiMemoryImpl::setRow(const float* dataIn, const vector<int64_t>& indexSe
     }
 }
 
+void CiftiMemoryImpl::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize) const
+{
+    CaretAssert(m_array.getDimensions().size() == 2 && rowSize == m_array.getDimensions()[0]);
+    const float* ref = m_array.get(2, vector<int64_t>()) + firstRow * rowSize;//rows are contiguous in memory
+    int64_t numElems = numRows * rowSize;
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        dataOut[i] = ref[i];
+    }
+}
+
+void CiftiMemoryImpl::setRows(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize)
+{
+    CaretAssert(m_array.getDimensions().size() == 2 && rowSize == m_array.getDimensions()[0]);
+    float* ref = m_array.get(2, vector<int64_t>()) + firstRow * rowSize;
+    int64_t numElems = numRows * rowSize;
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        ref[i] = dataIn[i];
+    }
+}
+
 void CiftiMemoryImpl::setColumn(const float* dataIn, const int64_t& index)
 {
     CaretAssert(m_array.getDimensions().size() == 2);//otherwise, CiftiFile shouldn't have called this
@@ -416,7 +546,10 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
         }
     }
     if (whichExt == -1) throw DataFileException("no cifti extension found in file '" + filename + "'");
-    m_xml.readXML(QByteArray(myHeader.m_extensions[whichExt]->m_bytes.data(), myHeader.m_extensions[whichExt]->m_bytes.size()));//CiftiXML should be under 2GB
+    {
+        CaretProfiler::IOTimer myTimer(CaretProfiler::PARSE, filename);
+        m_xml.readXML(QByteArray(myHeader.m_extensions[whichExt]->m_bytes.data(), myHeader.m_extensions[whichExt]->m_bytes.size()));//CiftiXML should be under 2GB
+    }
     vector<int64_t> dimCheck = m_nifti.getDimensions();
     if (dimCheck.size() < 5)
     {
@@ -459,10 +592,11 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
     }
 }
 
-CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version)
+CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const int16_t& dataType, const double& mult, const double& offset)
 {//starts writing new file
     NiftiHeader outHeader;
-    outHeader.setDataType(NIFTI_TYPE_FLOAT32);//actually redundant currently, default is float32
+    outHeader.setDataType(dataType);
+    outHeader.setDataScaling(mult, offset);
     char intentName[16];
     int32_t intentCode = xml.getIntentInfo(version, intentName);
     outHeader.setIntent(intentCode, intentName);
@@ -487,11 +621,11 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, c
         headerDims[4] = headerDims[5];
         headerDims[5] = temp;
         outHeader.setDimensions(headerDims);//give the header the reversed dimensions
-        m_nifti.writeNew(filename, outHeader, 2, true);
+        m_nifti.writeNew(filename, outHeader, 2, !filename.endsWith(".gz"));//compressed files can't be read while writing
         m_nifti.overrideDimensions(niftiDims);//and then tell the nifti reader to use the correct dimensions
     } else {
         outHeader.setDimensions(niftiDims);
-        m_nifti.writeNew(filename, outHeader, 2, true);
+        m_nifti.writeNew(filename, outHeader, 2, !filename.endsWith(".gz"));
     }
     m_xml = xml;
 }
@@ -521,6 +655,18 @@ void CiftiOnDiskImpl::setRow(const float* dataIn, const vector<int64_t>& indexSe
     m_nifti.writeData(dataIn, 5, indexSelect);
 }
 
+void CiftiOnDiskImpl::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t&) const
+{
+    vector<int64_t> indexSelect(1, firstRow);
+    m_nifti.readData(dataOut, 5, indexSelect, false, numRows);//rows of a 2D matrix are contiguous on disk, so this is a single read
+}
+
+void CiftiOnDiskImpl::setRows(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t&)
+{
+    vector<int64_t> indexSelect(1, firstRow);
+    m_nifti.writeData(dataIn, 5, indexSelect, numRows);
+}
+
 void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
 {
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
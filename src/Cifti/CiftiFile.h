@@ -36,12 +36,16 @@ namespace caret
     class CiftiFile : public CiftiInterface
     {
     public:
-        CiftiFile() { }
+        CiftiFile() { m_writingDataType = s_defaultWritingDataType; }
         explicit CiftiFile(const QString &fileName);//calls openFile
         void openFile(const QString& fileName);//starts on-disk reading
         void openURL(const QString& url, const QString& user, const QString& pass);//open from XNAT
         void openURL(const QString& url);//same, without user/pass (or curently, reusing existing auth if the server matches
         void setWritingFile(const QString& fileName, const CiftiVersion& writingVersion = CiftiVersion());//starts on-disk writing
+        void setWritingDataType(const int16_t& type);//nifti datatype used for output, integer types get scaling computed from the data, and so are written when writeFile is called
+        int16_t getWritingDataType() const { return m_writingDataType; }
+        static void setDefaultWritingDataType(const int16_t& type);//for new CiftiFile objects, set by wb_command's -output-datatype option
+        static int16_t getDefaultWritingDataType() { return s_defaultWritingDataType; }
         void writeFile(const QString& fileName, const CiftiVersion& writingVersion = CiftiVersion());//leaves current state as-is, rewrites if already writing to that filename and version mismatch
         void convertToInMemory();
         QString getFileName() const { return m_fileName; }
@@ -63,11 +67,15 @@ namespace caret
         
         void setRow(const float* dataIn, const int64_t& index);//backwards compatibility for old CiftiFile
         
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows) const;//for 2D only, consecutive rows in one read, dataOut must hold numRows full rows
+        void setRows(const float* dataIn, const int64_t& firstRow, const int64_t& numRows);//for 2D only
+        
         class ReadImplInterface
         {
         public:
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
+            virtual void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize) const;//default loops over getRow
             virtual bool isInMemory() const { return false; }
             virtual ~ReadImplInterface();
         };
@@ -77,6 +85,7 @@ namespace caret
         public:
             virtual void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect) = 0;
             virtual void setColumn(const float* dataIn, const int64_t& index) = 0;
+            virtual void setRows(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowSize);//default loops over setRow
             virtual ~WriteImplInterface();
         };
     private:
@@ -86,6 +95,11 @@ namespace caret
         QString m_writingFile, m_fileName;
         //CiftiXML m_xml;//uncomment when we drop CiftiInterface
         CiftiVersion m_onDiskVersion;
+        int16_t m_writingDataType;
+        static int16_t s_defaultWritingDataType;
+        bool mustDeferWriting() const;
+        ///label keys must stay exact, so files with a label mapping ignore an integer writing type
+        int16_t getOutputDataType() const;
         void verifyWriteImpl();
         static void copyImplData(const ReadImplInterface* from, WriteImplInterface* to, const std::vector<int64_t>& dims);
     };
@@ -0,0 +1,210 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CommandBatchFileStore.h"
+
+#include "BorderFile.h"
+#include "CiftiFile.h"
+#include "CaretAssert.h"
+#include "CommandException.h"
+#include "FileInformation.h"
+#include "FociFile.h"
+#include "LabelFile.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <QDir>
+
+using namespace caret;
+using namespace std;
+
+CommandBatchFileStore::CommandBatchFileStore()
+{
+    m_currentCommand = 0;
+}
+
+CommandBatchFileStore::~CommandBatchFileStore()
+{
+}
+
+bool CommandBatchFileStore::isMemoryOnlyName(const AString& name)
+{
+    return name.startsWith("mem:");
+}
+
+AString CommandBatchFileStore::getKey(const AString& name)
+{
+    if (isMemoryOnlyName(name)) return name;
+    FileInformation myInfo(name);
+    return QDir::cleanPath(myInfo.getAbsoluteFilePath());//output files may not exist yet, so we can't use the canonical path
+}
+
+void CommandBatchFileStore::addNameUse(const AString& name, const int& command)
+{
+    const AString key = getKey(name);
+    map<AString, int>::iterator iter = m_lastUse.find(key);
+    if (iter == m_lastUse.end())
+    {
+        m_lastUse[key] = command;
+    } else {
+        if (command > iter->second) iter->second = command;
+    }
+}
+
+void CommandBatchFileStore::setCurrentCommand(const int& command)
+{
+    m_currentCommand = command;
+}
+
+bool CommandBatchFileStore::isNeededLater(const AString& name) const
+{
+    map<AString, int>::const_iterator iter = m_lastUse.find(getKey(name));
+    if (iter == m_lastUse.end()) return false;
+    return iter->second > m_currentCommand;
+}
+
+void CommandBatchFileStore::releaseUnneeded()
+{
+    vector<AString> toRemove;
+    for (map<AString, OperationParametersEnum::Enum>::const_iterator iter = m_types.begin(); iter != m_types.end(); ++iter)
+    {
+        if (!isNeededLater(iter->first)) toRemove.push_back(iter->first);
+    }
+    for (int i = 0; i < (int)toRemove.size(); ++i)
+    {
+        removeFile(toRemove[i]);
+    }
+}
+
+void CommandBatchFileStore::removeFile(const AString& name)
+{
+    const AString key = getKey(name);
+    m_types.erase(key);
+    m_borders.erase(key);
+    m_cifti.erase(key);
+    m_foci.erase(key);
+    m_labels.erase(key);
+    m_metrics.erase(key);
+    m_surfaces.erase(key);
+    m_volumes.erase(key);
+}
+
+template<typename T>
+bool CommandBatchFileStore::getFromMap(const map<AString, CaretPointer<T> >& fileMap, const OperationParametersEnum::Enum& type, const AString& name, CaretPointer<T>& fileOut) const
+{
+    const AString key = getKey(name);
+    map<AString, OperationParametersEnum::Enum>::const_iterator typeIter = m_types.find(key);
+    if (typeIter == m_types.end())
+    {
+        if (isMemoryOnlyName(name))
+        {
+            throw CommandException("in-memory file '" + name + "' is used before any command creates it");
+        }
+        return false;
+    }
+    if (typeIter->second != type)
+    {
+        throw CommandException("in-memory file '" + name + "' is a " + OperationParametersEnum::toName(typeIter->second) +
+                               " file, but is used as a " + OperationParametersEnum::toName(type) + " file");
+    }
+    typename map<AString, CaretPointer<T> >::const_iterator iter = fileMap.find(key);
+    CaretAssert(iter != fileMap.end());
+    fileOut = iter->second;
+    return true;
+}
+
+template<typename T>
+void CommandBatchFileStore::putInMap(map<AString, CaretPointer<T> >& fileMap, const OperationParametersEnum::Enum& type, const AString& name, const CaretPointer<T>& file)
+{
+    removeFile(name);//an output may replace a stored file of a different type
+    const AString key = getKey(name);
+    m_types[key] = type;
+    fileMap[key] = file;
+}
+
+bool CommandBatchFileStore::getFile(const AString& name, CaretPointer<BorderFile>& fileOut) const
+{
+    return getFromMap(m_borders, OperationParametersEnum::BORDER, name, fileOut);
+}
+
+bool CommandBatchFileStore::getFile(const AString& name, CaretPointer<CiftiFile>& fileOut) const
+{
+    return getFromMap(m_cifti, OperationParametersEnum::CIFTI, name, fileOut);
+}
+
+bool CommandBatchFileStore::getFile(const AString& name, CaretPointer<FociFile>& fileOut) const
+{
+    return getFromMap(m_foci, OperationParametersEnum::FOCI, name, fileOut);
+}
+
+bool CommandBatchFileStore::getFile(const AString& name, CaretPointer<LabelFile>& fileOut) const
+{
+    return getFromMap(m_labels, OperationParametersEnum::LABEL, name, fileOut);
+}
+
+bool CommandBatchFileStore::getFile(const AString& name, CaretPointer<MetricFile>& fileOut) const
+{
+    return getFromMap(m_metrics, OperationParametersEnum::METRIC, name, fileOut);
+}
+
+bool CommandBatchFileStore::getFile(const AString& name, CaretPointer<SurfaceFile>& fileOut) const
+{
+    return getFromMap(m_surfaces, OperationParametersEnum::SURFACE, name, fileOut);
+}
+
+bool CommandBatchFileStore::getFile(const AString& name, CaretPointer<VolumeFile>& fileOut) const
+{
+    return getFromMap(m_volumes, OperationParametersEnum::VOLUME, name, fileOut);
+}
+
+void CommandBatchFileStore::putFile(const AString& name, const CaretPointer<BorderFile>& file)
+{
+    putInMap(m_borders, OperationParametersEnum::BORDER, name, file);
+}
+
+void CommandBatchFileStore::putFile(const AString& name, const CaretPointer<CiftiFile>& file)
+{
+    putInMap(m_cifti, OperationParametersEnum::CIFTI, name, file);
+}
+
+void CommandBatchFileStore::putFile(const AString& name, const CaretPointer<FociFile>& file)
+{
+    putInMap(m_foci, OperationParametersEnum::FOCI, name, file);
+}
+
+void CommandBatchFileStore::putFile(const AString& name, const CaretPointer<LabelFile>& file)
+{
+    putInMap(m_labels, OperationParametersEnum::LABEL, name, file);
+}
+
+void CommandBatchFileStore::putFile(const AString& name, const CaretPointer<MetricFile>& file)
+{
+    putInMap(m_metrics, OperationParametersEnum::METRIC, name, file);
+}
+
+void CommandBatchFileStore::putFile(const AString& name, const CaretPointer<SurfaceFile>& file)
+{
+    putInMap(m_surfaces, OperationParametersEnum::SURFACE, name, file);
+}
+
+void CommandBatchFileStore::putFile(const AString& name, const CaretPointer<VolumeFile>& file)
+{
+    putInMap(m_volumes, OperationParametersEnum::VOLUME, name, file);
+}
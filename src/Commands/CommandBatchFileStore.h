@@ -0,0 +1,94 @@
+#ifndef __COMMAND_BATCH_FILE_STORE_H__
+#define __COMMAND_BATCH_FILE_STORE_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AString.h"
+#include "CaretPointer.h"
+#include "OperationParametersEnum.h"
+
+#include <map>
+
+namespace caret {
+    
+    class BorderFile;
+    class CiftiFile;
+    class FociFile;
+    class LabelFile;
+    class MetricFile;
+    class SurfaceFile;
+    class VolumeFile;
+    
+    /// keeps the outputs of one -batch command in memory for the commands after it
+    class CommandBatchFileStore
+    {
+        //all maps are keyed by getKey(), so different spellings of the same path find the same file
+        std::map<AString, OperationParametersEnum::Enum> m_types;
+        std::map<AString, CaretPointer<BorderFile> > m_borders;
+        std::map<AString, CaretPointer<CiftiFile> > m_cifti;
+        std::map<AString, CaretPointer<FociFile> > m_foci;
+        std::map<AString, CaretPointer<LabelFile> > m_labels;
+        std::map<AString, CaretPointer<MetricFile> > m_metrics;
+        std::map<AString, CaretPointer<SurfaceFile> > m_surfaces;
+        std::map<AString, CaretPointer<VolumeFile> > m_volumes;
+        std::map<AString, int> m_lastUse;//last script command that mentions each name
+        int m_currentCommand;
+        
+        static AString getKey(const AString& name);
+        template<typename T>
+        bool getFromMap(const std::map<AString, CaretPointer<T> >& fileMap, const OperationParametersEnum::Enum& type, const AString& name, CaretPointer<T>& fileOut) const;
+        template<typename T>
+        void putInMap(std::map<AString, CaretPointer<T> >& fileMap, const OperationParametersEnum::Enum& type, const AString& name, const CaretPointer<T>& file);
+    public:
+        CommandBatchFileStore();
+        ~CommandBatchFileStore();//defined where the file types are complete
+        
+        ///names with this prefix are never written to disk
+        static bool isMemoryOnlyName(const AString& name);
+        
+        void addNameUse(const AString& name, const int& command);
+        void setCurrentCommand(const int& command);
+        ///whether a command after the current one mentions this name
+        bool isNeededLater(const AString& name) const;
+        ///drop stored files that no later command mentions
+        void releaseUnneeded();
+        void removeFile(const AString& name);
+        
+        bool getFile(const AString& name, CaretPointer<BorderFile>& fileOut) const;
+        bool getFile(const AString& name, CaretPointer<CiftiFile>& fileOut) const;
+        bool getFile(const AString& name, CaretPointer<FociFile>& fileOut) const;
+        bool getFile(const AString& name, CaretPointer<LabelFile>& fileOut) const;
+        bool getFile(const AString& name, CaretPointer<MetricFile>& fileOut) const;
+        bool getFile(const AString& name, CaretPointer<SurfaceFile>& fileOut) const;
+        bool getFile(const AString& name, CaretPointer<VolumeFile>& fileOut) const;
+        
+        void putFile(const AString& name, const CaretPointer<BorderFile>& file);
+        void putFile(const AString& name, const CaretPointer<CiftiFile>& file);
+        void putFile(const AString& name, const CaretPointer<FociFile>& file);
+        void putFile(const AString& name, const CaretPointer<LabelFile>& file);
+        void putFile(const AString& name, const CaretPointer<MetricFile>& file);
+        void putFile(const AString& name, const CaretPointer<SurfaceFile>& file);
+        void putFile(const AString& name, const CaretPointer<VolumeFile>& file);
+    };
+    
+}
+
+#endif //__COMMAND_BATCH_FILE_STORE_H__
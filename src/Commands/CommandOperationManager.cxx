@@ -129,6 +129,7 @@
 #include "OperationAddToSpecFile.h"
 #include "OperationBackendAverageDenseROI.h"
 #include "OperationBackendAverageROICorrelation.h"
+#include "OperationBackendServer.h"
 #include "OperationBorderExportColorTable.h"
 #include "OperationBorderFileExportToCaret5.h"
 #include "OperationBorderLength.h"
@@ -211,6 +212,7 @@
 
 #include "AlgorithmException.h"
 #include "ApplicationInformation.h"
+#include "CommandBatchFileStore.h"
 #include "CommandParser.h"
 #include "OperationException.h"
 
@@ -224,7 +226,14 @@
 #include "CommandUnitTest.h"
 #include "ProgramParameters.h"
 
+#include "CaretCommandLine.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
+#include "CiftiFile.h"
+#include "VolumeFile.h"
+
+#include <QFile>
+#include <QTextStream>
 
 #include <iostream>
 
@@ -370,6 +379,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoOperationAddToSpecFile()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationBackendAverageDenseROI()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationBackendAverageROICorrelation()));
+    this->commandOperations.push_back(new CommandParser(new AutoOperationBackendServer()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationBorderExportColorTable()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationBorderFileExportToCaret5()));
     this->commandOperations.push_back(new CommandParser(new AutoOperationBorderLength()));
@@ -483,6 +493,14 @@ CommandOperationManager::~CommandOperationManager()
     this->deprecatedOperations.clear();
 }
 
+namespace
+{
+    //names accepted by -output-datatype, in the order shown in the help
+    const char* const OUTPUT_TYPE_NAMES[] = { "FLOAT32", "FLOAT64", "INT8", "UINT8", "INT16", "UINT16", "INT32", "UINT32" };
+    const int16_t OUTPUT_TYPE_CODES[] = { NIFTI_TYPE_FLOAT32, NIFTI_TYPE_FLOAT64, NIFTI_TYPE_INT8, NIFTI_TYPE_UINT8, NIFTI_TYPE_INT16, NIFTI_TYPE_UINT16, NIFTI_TYPE_INT32, NIFTI_TYPE_UINT32 };
+    const int NUM_OUTPUT_TYPES = sizeof(OUTPUT_TYPE_CODES) / sizeof(OUTPUT_TYPE_CODES[0]);
+}
+
 /**
  * Run a command.
  * 
@@ -503,6 +521,22 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
         if (!valid) throw CommandException("unrecognized logging level: '" + globalOptionArgs[0] + "'");
         CaretLogger::getLogger()->setLevel(level);
     }
+    AString profileFileName;
+    if (getGlobalOption(parameters, "-profile", 1, globalOptionArgs))
+    {
+        profileFileName = globalOptionArgs[0];
+    }
+    if (getGlobalOption(parameters, "-output-datatype", 1, globalOptionArgs))
+    {
+        int i;
+        for (i = 0; i < NUM_OUTPUT_TYPES; ++i)
+        {
+            if (globalOptionArgs[0].toUpper() == OUTPUT_TYPE_NAMES[i]) break;
+        }
+        if (i == NUM_OUTPUT_TYPES) throw CommandException("unrecognized output datatype: '" + globalOptionArgs[0] + "'");
+        CiftiFile::setDefaultWritingDataType(OUTPUT_TYPE_CODES[i]);
+        VolumeFile::setDefaultWritingDataType(OUTPUT_TYPE_CODES[i]);
+    }
 
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
@@ -529,45 +563,207 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
     } else if (commandSwitch == "-all-commands-help") {
         printAllCommandsHelpInfo("wb_command");
     } else {
-        
         CommandOperation* operation = NULL;
-        
-        for (uint64_t i = 0; i < numberOfCommands; i++)
+        AString batchScript;
+        if (commandSwitch == "-batch")
         {
-            if (this->commandOperations[i]->getCommandLineSwitch() == commandSwitch)
+            batchScript = parameters.nextString("batch script");
+            parameters.verifyAllParametersProcessed();
+        } else {
+            operation = findOperation(commandSwitch);
+            if (operation == NULL) {
+                if (!parameters.hasNext())
+                {
+                    printAllCommandsMatching(commandSwitch);
+                } else {
+                    throw CommandException("Command \"" + commandSwitch + "\" not found.");
+                }
+                return;
+            }
+            if (!parameters.hasNext() && operation->takesParameters())
             {
-                operation = this->commandOperations[i];
-                break;
+                cout << operation->getHelpInformation("wb_command") << endl;
+                return;
             }
         }
-        if (operation == NULL)
+        const AString fullCommandLine = caret_global_commandLine;//-batch replaces it for each script command
+        if (!profileFileName.isEmpty()) CaretProfiler::enable();
+        try
         {
-            for (uint64_t i = 0; i < numberOfDeprecated; i++)
+            if (operation == NULL)
             {
-                if (this->deprecatedOperations[i]->getCommandLineSwitch() == commandSwitch)
+                runBatch(batchScript, parameters.getProgramName(), preventProvenance);
+            } else {
+                operation->execute(parameters, preventProvenance);
+            }
+        } catch (...) {
+            if (!profileFileName.isEmpty())
+            {
+                CaretProfiler::writeReport(profileFileName, fullCommandLine);//still useful to see where the time went before an error
+            }
+            throw;
+        }
+        if (!profileFileName.isEmpty())
+        {
+            CaretProfiler::writeReport(profileFileName, fullCommandLine);
+        }
+    }
+}
+
+CommandOperation* CommandOperationManager::findOperation(const AString& commandSwitch)
+{
+    for (size_t i = 0; i < commandOperations.size(); ++i)
+    {
+        if (commandOperations[i]->getCommandLineSwitch() == commandSwitch)
+        {
+            return commandOperations[i];
+        }
+    }
+    for (size_t i = 0; i < deprecatedOperations.size(); ++i)
+    {
+        if (deprecatedOperations[i]->getCommandLineSwitch() == commandSwitch)
+        {
+            return deprecatedOperations[i];
+        }
+    }
+    return NULL;
+}
+
+namespace
+{
+    //splits a script line into arguments, with shell-like quoting: '' is literal, "" and bare words allow \ escapes, # outside quotes starts a comment
+    vector<AString> tokenizeBatchLine(const AString& line, const AString& location)
+    {
+        vector<AString> ret;
+        AString current;
+        bool inToken = false;
+        const int length = line.size();
+        for (int i = 0; i < length; ++i)
+        {
+            const QChar c = line[i];
+            if (c == '\'')
+            {
+                int end = line.indexOf('\'', i + 1);
+                if (end == -1) throw CommandException(location + ": unterminated single quote");
+                current += line.mid(i + 1, end - i - 1);
+                inToken = true;
+                i = end;
+            } else if (c == '"') {
+                ++i;
+                while (i < length && line[i] != '"')
+                {
+                    if (line[i] == '\\' && i + 1 < length && (line[i + 1] == '"' || line[i + 1] == '\\')) ++i;
+                    current += line[i];
+                    ++i;
+                }
+                if (i >= length) throw CommandException(location + ": unterminated double quote");
+                inToken = true;
+            } else if (c == '\\' && i + 1 < length) {
+                ++i;
+                current += line[i];
+                inToken = true;
+            } else if (c.isSpace()) {
+                if (inToken)
                 {
-                    operation = this->deprecatedOperations[i];
-                    break;
+                    ret.push_back(current);
+                    current = "";
+                    inToken = false;
                 }
+            } else if (c == '#' && !inToken) {
+                break;
+            } else {
+                current += c;
+                inToken = true;
             }
         }
-        
-        if (operation == NULL) {
-            if (!parameters.hasNext())
+        if (inToken) ret.push_back(current);
+        return ret;
+    }
+}
+
+void CommandOperationManager::runBatch(const AString& scriptName, const AString& programName, const bool& preventProvenance)
+{
+    QFile scriptFile(scriptName);
+    if (!scriptFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        throw CommandException("failed to open batch script '" + scriptName + "': " + scriptFile.errorString());
+    }
+    vector<vector<AString> > commands;
+    vector<int> commandLineNumbers;
+    QTextStream scriptStream(&scriptFile);
+    AString joined;
+    int lineNumber = 0, startLine = 0;
+    while (!scriptStream.atEnd())
+    {
+        AString line = scriptStream.readLine();
+        ++lineNumber;
+        if (joined.isEmpty()) startLine = lineNumber;
+        if (line.endsWith('\\'))//line continuation
+        {
+            joined += line.left(line.size() - 1) + " ";
+            continue;
+        }
+        joined += line;
+        vector<AString> tokens = tokenizeBatchLine(joined, scriptName + " line " + AString::number(startLine));
+        joined = "";
+        if (!tokens.empty() && tokens[0] == "wb_command") tokens.erase(tokens.begin());//allow pasting commands from a shell script
+        if (tokens.empty()) continue;
+        commands.push_back(tokens);
+        commandLineNumbers.push_back(startLine);
+    }
+    if (!joined.isEmpty())
+    {
+        throw CommandException(scriptName + " line " + AString::number(startLine) + ": line continuation at end of file");
+    }
+    vector<CommandOperation*> operations(commands.size());
+    CommandBatchFileStore myStore;
+    for (int i = 0; i < (int)commands.size(); ++i)
+    {//check all commands before running anything, so a typo on the last line doesn't waste the earlier work
+        const AString location = scriptName + " line " + AString::number(commandLineNumbers[i]);
+        if (commands[i][0] == "-batch") throw CommandException(location + ": -batch can't be used inside a batch script");
+        operations[i] = findOperation(commands[i][0]);
+        if (operations[i] == NULL) throw CommandException(location + ": command \"" + commands[i][0] + "\" not found");
+        if (commands[i].size() < 2 && operations[i]->takesParameters()) throw CommandException(location + ": command \"" + commands[i][0] + "\" has no arguments");
+        for (int j = 1; j < (int)commands[i].size(); ++j)
+        {
+            myStore.addNameUse(commands[i][j], i);
+        }
+    }
+    const QByteArray programNameBytes = programName.toLocal8Bit();
+    const char* programNameChars = programNameBytes.constData();
+    CommandParser::setBatchFileStore(&myStore);
+    try
+    {
+        for (int i = 0; i < (int)commands.size(); ++i)
+        {
+            ProgramParameters myParams(1, &programNameChars);
+            for (int j = 0; j < (int)commands[i].size(); ++j)
             {
-                printAllCommandsMatching(commandSwitch);
-            } else {
-                throw CommandException("Command \"" + commandSwitch + "\" not found.");
+                myParams.addParameter(commands[i][j]);
             }
-        } else {
-            if (!parameters.hasNext() && operation->takesParameters())
+            caret_global_commandLine_init(myParams);//provenance records the script command, not the -batch invocation
+            myParams.nextString("Command Name");
+            myStore.setCurrentCommand(i);
+            if (dynamic_cast<CommandParser*>(operations[i]) == NULL)
+            {//commands with their own argument handling don't know about the store, so don't keep copies of anything they might rewrite
+                for (int j = 1; j < (int)commands[i].size(); ++j)
+                {
+                    myStore.removeFile(commands[i][j]);
+                }
+            }
+            try
             {
-                cout << operation->getHelpInformation("wb_command") << endl;
-            } else {
-                operation->execute(parameters, preventProvenance);
+                operations[i]->execute(myParams, preventProvenance);
+            } catch (CaretException& e) {
+                throw CommandException(scriptName + " line " + AString::number(commandLineNumbers[i]) + " (" + commands[i][0] + "): " + e.whatString());
             }
+            myStore.releaseUnneeded();
         }
+    } catch (...) {
+        CommandParser::setBatchFileStore(NULL);
+        throw;
     }
+    CommandParser::setBatchFileStore(NULL);
 }
 
 bool CommandOperationManager::getGlobalOption(ProgramParameters& parameters, const AString& optionString, const int& numArgs, vector<AString>& arguments)
@@ -751,6 +947,13 @@ void CommandOperationManager::printHelpInfo()
     cout << "   -list-deprecated-commands   list deprecated subcommands" << endl;
     cout << "   -all-commands-help          show all processing subcommands and their help" << endl;
     cout << "                                  info - VERY LONG" << endl;
+    cout << endl << "Batch processing:" << endl;
+    cout << "   -batch <script-file>        run the processing commands in a text file, one" << endl;
+    cout << "                                  per line, without the 'wb_command'.  Outputs" << endl;
+    cout << "                                  that later lines use are kept in memory" << endl;
+    cout << "                                  instead of being read back from disk, and" << endl;
+    cout << "                                  file names starting with 'mem:' are only" << endl;
+    cout << "                                  kept in memory, and never written" << endl;
     cout << endl << "Global options (can be added to any command):" << endl;
     cout << "   -disable-provenance         don't generate provenance info in output files" << endl;
     cout << "   -logging <level>            set the logging level, valid values are:" << endl;
@@ -761,6 +964,19 @@ void CommandOperationManager::printHelpInfo()
          iter++) {
         cout << "            " << LogLevelEnum::toName(*iter) << endl;
     }
+    cout << "   -profile <json-file>        write the time spent in file access and" << endl;
+    cout << "                                  algorithms, bytes moved, and peak memory" << endl;
+    cout << "                                  to a json file" << endl;
+    cout << "   -output-datatype <type>     datatype for cifti and volume outputs, default" << endl;
+    cout << "                                  FLOAT32.  Integer types are scaled to fit" << endl;
+    cout << "                                  the data unless it is integer-valued and in" << endl;
+    cout << "                                  range, and those outputs are computed in" << endl;
+    cout << "                                  memory before writing.  Valid values are:" << endl;
+    for (int i = 0; i < NUM_OUTPUT_TYPES; ++i)
+    {
+        cout << "            " << OUTPUT_TYPE_NAMES[i] << endl;
+    }
+    cout << "   cifti and volume outputs ending in .gz are written compressed" << endl;
     cout << endl;
     cout << "To get the help information on a processing subcommand, run it without any" << endl;
     cout << "   additional arguments." << endl;
@@ -69,6 +69,10 @@ namespace caret {
         
         bool getGlobalOption(ProgramParameters& parameters, const AString& optionString, const int& numArgs, std::vector<AString>& arguments);
         
+        CommandOperation* findOperation(const AString& commandSwitch);
+        
+        void runBatch(const AString& scriptName, const AString& programName, const bool& preventProvenance);
+        
     private:
         std::vector<CommandOperation*> commandOperations, deprecatedOperations;
         
@@ -27,7 +27,9 @@
 #include "CaretCommandLine.h"
 #include "CaretDataFileHelper.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "CiftiFile.h"
+#include "CommandBatchFileStore.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "FociFile.h"
@@ -37,6 +39,8 @@
 #include "OperationException.h"
 #include "SurfaceFile.h"
 #include "VolumeFile.h"
+#include "VolumeFrameReader.h"
+#include "VolumeFrameWriter.h"
 
 #include <QDir>
 
@@ -49,6 +53,7 @@ const AString CommandParser::PROVENANCE_NAME = "Provenance";
 const AString CommandParser::PARENT_PROVENANCE_NAME = "ParentProvenance";
 const AString CommandParser::PROGRAM_PROVENANCE_NAME = "ProgramProvenance";
 const AString CommandParser::CWD_PROVENANCE_NAME = "WorkingDirectory";
+CommandBatchFileStore* CommandParser::s_batchStore = NULL;
 
 CommandParser::CommandParser(AutoOperationInterface* myAutoOper) :
     CommandOperation(myAutoOper->getCommandSwitch(), myAutoOper->getShortDescription()),
@@ -63,6 +68,31 @@ void CommandParser::disableProvenance()
 }
 
 
+void CommandParser::setBatchFileStore(CommandBatchFileStore* store)
+{
+    s_batchStore = store;
+}
+
+template<typename T>
+bool CommandParser::getBatchFile(const AString& name, CaretPointer<T>& fileOut)
+{
+    if (s_batchStore == NULL) return false;
+    return s_batchStore->getFile(name, fileOut);
+}
+
+template<typename T>
+bool CommandParser::storeBatchFile(const AString& name, const CaretPointer<T>& file)
+{//returns whether the file still needs to be written to disk
+    if (s_batchStore == NULL) return true;
+    if (s_batchStore->isNeededLater(name) || CommandBatchFileStore::isMemoryOnlyName(name))
+    {
+        s_batchStore->putFile(name, file);
+    } else {
+        s_batchStore->removeFile(name);//don't let a later reader see a stale copy
+    }
+    return !CommandBatchFileStore::isMemoryOnlyName(name);
+}
+
 void CommandParser::executeOperation(ProgramParameters& parameters)
 {
     CaretPointer<OperationParameters> myAlgParams(m_autoOper->getParameters());//could be an autopointer, but this is safer
@@ -72,13 +102,21 @@ void CommandParser::executeOperation(ProgramParameters& parameters)
     //the parent provenance should never be generated manually
     m_parentProvenance = "";//in case someone tries to use the same instance more than once
     m_workingDir = QDir::currentPath();//get the current path, in case some stupid command changes the working directory
+    m_inputCiftiNames.clear();//-batch reuses the same instance for many commands
+    m_inputVolumeNames.clear();
     //these get set on output files during writeOutput (and for on-disk in provenanceBeforeOperation)
-    parseComponent(myAlgParams.getPointer(), parameters, myOutAssoc);//parsing block
-    parameters.verifyAllParametersProcessed();
-    makeOnDiskOutputs(myOutAssoc);//check for input on-disk files used as output on-disk files
+    {
+        CaretProfiler::Section mySection("read inputs");
+        parseComponent(myAlgParams.getPointer(), parameters, myOutAssoc);//parsing block
+        parameters.verifyAllParametersProcessed();
+        makeOnDiskOutputs(myOutAssoc);//check for input on-disk files used as output on-disk files
+    }
     //code to show what arguments map to what parameters should go here
     if (m_doProvenance) provenanceBeforeOperation(myOutAssoc);
-    m_autoOper->useParameters(myAlgParams.getPointer(), NULL);//TODO: progress status for caret_command? would probably get messed up by any command info output
+    {
+        CaretProfiler::Section mySection(m_autoOper->getCommandSwitch());
+        m_autoOper->useParameters(myAlgParams.getPointer(), NULL);//TODO: progress status for caret_command? would probably get messed up by any command info output
+    }
     vector<AString> uncheckedWarnings = myAlgParams->findUncheckedParams("the command");
     for (size_t i = 0; i < uncheckedWarnings.size(); ++i)
     {
@@ -86,6 +124,7 @@ void CommandParser::executeOperation(ProgramParameters& parameters)
     }
     if (m_doProvenance) provenanceAfterOperation(myOutAssoc);
     //TODO: deallocate input files - give abstract parameter a virtual deallocate method? use CaretPointer and rely on reference counting?
+    CaretProfiler::Section mySection("write outputs");
     writeOutput(myOutAssoc);
 }
 
@@ -142,8 +181,12 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::BORDER:
                 {
-                    CaretPointer<BorderFile> myFile(new BorderFile());
-                    myFile->readFile(nextArg);
+                    CaretPointer<BorderFile> myFile;
+                    if (!getBatchFile(nextArg, myFile))
+                    {
+                        myFile.grabNew(new BorderFile());
+                        myFile->readFile(nextArg);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -166,10 +209,17 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::CIFTI:
                 {
-                    FileInformation myInfo(nextArg);
-                    CaretPointer<CiftiFile> myFile(new CiftiFile());
-                    myFile->openFile(nextArg);
-                    m_inputCiftiNames[myInfo.getCanonicalFilePath()] = myFile;//track input cifti, so we can check their size
+                    CaretPointer<CiftiFile> myFile;
+                    if (!getBatchFile(nextArg, myFile))
+                    {
+                        myFile.grabNew(new CiftiFile());
+                        myFile->openFile(nextArg);
+                    }
+                    if (!CommandBatchFileStore::isMemoryOnlyName(nextArg))
+                    {
+                        FileInformation myInfo(nextArg);
+                        m_inputCiftiNames[myInfo.getCanonicalFilePath()] = myFile;//track input cifti, so we can check their size
+                    }
                     if (m_doProvenance)//just an optimization, if we aren't going to write provenance, don't generate it, either
                     {
                         const GiftiMetaData* md = myFile->getCiftiXML().getFileMetaData();
@@ -206,8 +256,12 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::FOCI:
                 {
-                    CaretPointer<FociFile> myFile(new FociFile());
-                    myFile->readFile(nextArg);
+                    CaretPointer<FociFile> myFile;
+                    if (!getBatchFile(nextArg, myFile))
+                    {
+                        myFile.grabNew(new FociFile());
+                        myFile->readFile(nextArg);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -241,8 +295,12 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::LABEL:
                 {
-                    CaretPointer<LabelFile> myFile(new LabelFile());
-                    myFile->readFile(nextArg);
+                    CaretPointer<LabelFile> myFile;
+                    if (!getBatchFile(nextArg, myFile))
+                    {
+                        myFile.grabNew(new LabelFile());
+                        myFile->readFile(nextArg);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -265,8 +323,12 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::METRIC:
                 {
-                    CaretPointer<MetricFile> myFile(new MetricFile());
-                    myFile->readFile(nextArg);
+                    CaretPointer<MetricFile> myFile;
+                    if (!getBatchFile(nextArg, myFile))
+                    {
+                        myFile.grabNew(new MetricFile());
+                        myFile->readFile(nextArg);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -289,6 +351,10 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::STRING:
                 {
+                    if (s_batchStore != NULL && !CommandBatchFileStore::isMemoryOnlyName(nextArg))
+                    {//commands that modify a file in place take its name as a string, so a stored copy would be stale
+                        s_batchStore->removeFile(nextArg);
+                    }
                     ((StringParameter*)myComponent->m_paramList[i])->m_parameter = nextArg;
                     if (debug)
                     {
@@ -299,8 +365,12 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::SURFACE:
                 {
-                    CaretPointer<SurfaceFile> myFile(new SurfaceFile());
-                    myFile->readFile(nextArg);
+                    CaretPointer<SurfaceFile> myFile;
+                    if (!getBatchFile(nextArg, myFile))
+                    {
+                        myFile.grabNew(new SurfaceFile());
+                        myFile->readFile(nextArg);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -323,8 +393,31 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::VOLUME:
                 {
-                    CaretPointer<VolumeFile> myFile(new VolumeFile());
-                    myFile->readFile(nextArg);
+                    VolumeParameter* myVolParam = (VolumeParameter*)myComponent->m_paramList[i];
+                    if (myVolParam->m_onDisk)
+                    {//volume files have no file metadata, so no provenance to collect
+                        if (CommandBatchFileStore::isMemoryOnlyName(nextArg))
+                        {
+                            throw CommandException("volume parameter <" + myComponent->m_paramList[i]->m_shortName + "> is read frame by frame from disk, it can't use in-memory file '" + nextArg + "'");
+                        }
+                        if (s_batchStore != NULL) s_batchStore->removeFile(nextArg);//a stored copy may be modified by this command while the disk file is not
+                        FileInformation myInfo(nextArg);
+                        myVolParam->m_reader.grabNew(new VolumeFrameReader());
+                        myVolParam->m_reader->openFile(nextArg);
+                        m_inputVolumeNames.insert(myInfo.getCanonicalFilePath());//track on-disk input volumes, so outputs don't overwrite them while reading
+                        if (debug)
+                        {
+                            cout << "Parameter <" << myComponent->m_paramList[i]->m_shortName << "> opened on-disk file with name ";
+                            cout << nextArg << endl;
+                        }
+                        break;
+                    }
+                    CaretPointer<VolumeFile> myFile;
+                    if (!getBatchFile(nextArg, myFile))
+                    {
+                        myFile.grabNew(new VolumeFile());
+                        myFile->readFile(nextArg);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -337,7 +430,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                             }
                         }
                     }
-                    ((VolumeParameter*)myComponent->m_paramList[i])->m_parameter = myFile;
+                    myVolParam->m_parameter = myFile;
                     if (debug)
                     {
                         cout << "Parameter <" << myComponent->m_paramList[i]->m_shortName << "> opened file with name ";
@@ -429,8 +522,9 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
             }
             case OperationParametersEnum::VOLUME:
             {
-                CaretPointer<VolumeFile>& myFile = ((VolumeParameter*)(myComponent->m_outputList[i]))->m_parameter;
-                myFile.grabNew(new VolumeFile());
+                VolumeParameter* myVolParam = (VolumeParameter*)(myComponent->m_outputList[i]);
+                if (myVolParam->m_onDisk) break;//created in makeOnDiskOutputs(), like cifti
+                myVolParam->m_parameter.grabNew(new VolumeFile());
                 break;
             }
             case OperationParametersEnum::DOUBLE://ignore these output types
@@ -606,7 +700,7 @@ void CommandParser::provenanceAfterOperation(const vector<OutputAssoc>& outAssoc
             case OperationParametersEnum::VOLUME:
             {
                 VolumeFile* myFile = ((VolumeParameter*)myParam)->m_parameter;
-                md = myFile->getFileMetaData();
+                if (myFile != NULL) md = myFile->getFileMetaData();//on-disk volumes don't have a VolumeFile
                 break;
             }
             default:
@@ -635,6 +729,11 @@ void CommandParser::makeOnDiskOutputs(const vector<OutputAssoc>& outAssociation)
             case OperationParametersEnum::CIFTI:
             {
                 CiftiParameter* myCiftiParam = (CiftiParameter*)myParam;
+                if (CommandBatchFileStore::isMemoryOnlyName(outAssociation[i].m_fileName))
+                {
+                    myCiftiParam->m_parameter.grabNew(new CiftiFile());//never touches disk
+                    break;
+                }
                 FileInformation myInfo(outAssociation[i].m_fileName);
                 map<AString, const CiftiFile*>::iterator iter = m_inputCiftiNames.find(myInfo.getCanonicalFilePath());
                 if (iter != m_inputCiftiNames.end())
@@ -656,6 +755,21 @@ void CommandParser::makeOnDiskOutputs(const vector<OutputAssoc>& outAssociation)
                 }
                 break;
             }
+            case OperationParametersEnum::VOLUME:
+            {
+                VolumeParameter* myVolParam = (VolumeParameter*)myParam;
+                if (!myVolParam->m_onDisk) break;
+                if (CommandBatchFileStore::isMemoryOnlyName(outAssociation[i].m_fileName))
+                {
+                    throw CommandException("volume output <" + myParam->m_shortName + "> is written frame by frame to disk, it can't use in-memory file '" + outAssociation[i].m_fileName + "'");
+                }
+                if (s_batchStore != NULL) s_batchStore->removeFile(outAssociation[i].m_fileName);
+                FileInformation myInfo(outAssociation[i].m_fileName);
+                bool collision = (m_inputVolumeNames.find(myInfo.getCanonicalFilePath()) != m_inputVolumeNames.end());
+                myVolParam->m_writer.grabNew(new VolumeFrameWriter());
+                myVolParam->m_writer->setWritingFile(outAssociation[i].m_fileName, collision);//on collision, write to a temporary file and rename it after the inputs are done
+                break;
+            }
             default:
                 break;
         }
@@ -674,14 +788,17 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
                 break;
             case OperationParametersEnum::BORDER:
             {
-                BorderFile* myFile = ((BorderParameter*)myParam)->m_parameter;
-                myFile->writeFile(outAssociation[i].m_fileName);
+                const CaretPointer<BorderFile>& myFile = ((BorderParameter*)myParam)->m_parameter;
+                if (storeBatchFile(outAssociation[i].m_fileName, myFile)) myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::CIFTI:
             {
-                CiftiFile* myFile = ((CiftiParameter*)myParam)->m_parameter;//we can't set metadata here because the XML is already on disk, see provenanceForOnDiskOutputs
-                myFile->writeFile(outAssociation[i].m_fileName);//this is basically a noop unless outputs and inputs collide, we opened ON_DISK and set cache file to this name back in makeOnDiskOutputs
+                const CaretPointer<CiftiFile>& myFile = ((CiftiParameter*)myParam)->m_parameter;//we can't set metadata here because the XML is already on disk, see provenanceForOnDiskOutputs
+                if (storeBatchFile(outAssociation[i].m_fileName, myFile))
+                {
+                    myFile->writeFile(outAssociation[i].m_fileName);//this is basically a noop unless outputs and inputs collide, we opened ON_DISK and set cache file to this name back in makeOnDiskOutputs
+                }
                 break;
             }
             case OperationParametersEnum::DOUBLE:
@@ -692,20 +809,20 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
                 break;
             case OperationParametersEnum::FOCI:
             {
-                FociFile* myFile = ((FociParameter*)myParam)->m_parameter;
-                myFile->writeFile(outAssociation[i].m_fileName);
+                const CaretPointer<FociFile>& myFile = ((FociParameter*)myParam)->m_parameter;
+                if (storeBatchFile(outAssociation[i].m_fileName, myFile)) myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::LABEL:
             {
-                LabelFile* myFile = ((LabelParameter*)myParam)->m_parameter;
-                myFile->writeFile(outAssociation[i].m_fileName);
+                const CaretPointer<LabelFile>& myFile = ((LabelParameter*)myParam)->m_parameter;
+                if (storeBatchFile(outAssociation[i].m_fileName, myFile)) myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::METRIC:
             {
-                MetricFile* myFile = ((MetricParameter*)myParam)->m_parameter;
-                myFile->writeFile(outAssociation[i].m_fileName);
+                const CaretPointer<MetricFile>& myFile = ((MetricParameter*)myParam)->m_parameter;
+                if (storeBatchFile(outAssociation[i].m_fileName, myFile)) myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::STRING:
@@ -713,14 +830,19 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
                 break;
             case OperationParametersEnum::SURFACE:
             {
-                SurfaceFile* myFile = ((SurfaceParameter*)myParam)->m_parameter;
-                myFile->writeFile(outAssociation[i].m_fileName);
+                const CaretPointer<SurfaceFile>& myFile = ((SurfaceParameter*)myParam)->m_parameter;
+                if (storeBatchFile(outAssociation[i].m_fileName, myFile)) myFile->writeFile(outAssociation[i].m_fileName);
                 break;
             }
             case OperationParametersEnum::VOLUME:
             {
-                VolumeFile* myFile = ((VolumeParameter*)myParam)->m_parameter;
-                myFile->writeFile(outAssociation[i].m_fileName);
+                VolumeParameter* myVolParam = (VolumeParameter*)myParam;
+                if (myVolParam->m_onDisk)
+                {
+                    myVolParam->m_writer->finish();//frames are already written, this closes the file and renames it if needed
+                } else {
+                    if (storeBatchFile(outAssociation[i].m_fileName, myVolParam->m_parameter)) myVolParam->m_parameter->writeFile(outAssociation[i].m_fileName);
+                }
                 break;
             }
             default:
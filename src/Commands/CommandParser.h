@@ -32,6 +32,8 @@
 
 namespace caret {
 
+    class CommandBatchFileStore;
+    
     class CommandParser : public CommandOperation, OperationParserInterface
     {
         int m_minIndent, m_maxIndent, m_indentIncrement, m_maxWidth;
@@ -39,6 +41,12 @@ namespace caret {
         bool m_doProvenance;
         const static AString PROVENANCE_NAME, PARENT_PROVENANCE_NAME, PROGRAM_PROVENANCE_NAME, CWD_PROVENANCE_NAME;//TODO: put this elsewhere?
         std::map<AString, const CiftiFile*> m_inputCiftiNames;
+        std::set<AString> m_inputVolumeNames;//only on-disk volume inputs
+        static CommandBatchFileStore* s_batchStore;//set while running a -batch script, NULL otherwise
+        template<typename T>
+        static bool getBatchFile(const AString& name, CaretPointer<T>& fileOut);
+        template<typename T>
+        static bool storeBatchFile(const AString& name, const CaretPointer<T>& file);
         struct OutputAssoc
         {//how the output is stored is up to the parser, in the GUI it should load into memory without writing to disk
             AString m_fileName;
@@ -65,6 +73,8 @@ namespace caret {
         void showParsedOperation(ProgramParameters& parameters);
         AString getHelpInformation(const AString& programName);
         bool takesParameters();
+        ///files named in the store are read from and written to memory instead of disk, pass NULL to stop
+        static void setBatchFileStore(CommandBatchFileStore* store);
     };
 
 };
@@ -0,0 +1,112 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ColumnStatistics.h"
+
+#include "CaretAssert.h"
+
+#include "ByteRangeCache.h"
+
+#include "CaretAssert.h"
+#include "DataFileException.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+ByteRangeCache::ByteRangeCache(const int64_t& blockSize, const int64_t& maxBlocks)
+{
+    CaretAssert(blockSize > 0 && maxBlocks > 0);
+    m_blockSize = blockSize;
+    m_maxBlocks = maxBlocks;
+    m_fileSize = 0;
+    m_useCounter = 0;
+}
+
+ByteRangeCache::~ByteRangeCache()
+{
+}
+
+void ByteRangeCache::addToCache(const int64_t& block, const char* data, const int64_t& size)
+{
+    if (m_cache.find(block) == m_cache.end() && (int64_t)m_cache.size() >= m_maxBlocks)
+    {
+        map<int64_t, CacheBlock>::iterator oldest = m_cache.begin();
+        for (map<int64_t, CacheBlock>::iterator iter = m_cache.begin(); iter != m_cache.end(); ++iter)
+        {
+            if (iter->second.m_lastUsed < oldest->second.m_lastUsed) oldest = iter;
+        }
+        m_cache.erase(oldest);
+    }
+    CacheBlock& newBlock = m_cache[block];
+    newBlock.m_data.assign(data, data + size);
+    newBlock.m_lastUsed = m_useCounter++;
+}
+
+int64_t ByteRangeCache::readRange(char* dataOut, const int64_t& position, const int64_t& count)
+{
+    const int64_t toRead = max(min(count, m_fileSize - position), (int64_t)0);
+    int64_t done = 0;
+    vector<char> fetched;
+    while (done < toRead)
+    {
+        const int64_t curPos = position + done;
+        const int64_t block = curPos / m_blockSize;
+        const int64_t offset = curPos - block * m_blockSize;
+        map<int64_t, CacheBlock>::iterator iter = m_cache.find(block);
+        if (iter != m_cache.end())
+        {
+            if ((int64_t)iter->second.m_data.size() <= offset)
+            {
+                throw DataFileException("cached block is shorter than expected in '" + getRangeSourceName() + "'");
+            }
+            const int64_t copySize = min((int64_t)iter->second.m_data.size() - offset, toRead - done);
+            memcpy(dataOut + done, iter->second.m_data.data() + offset, copySize);
+            iter->second.m_lastUsed = m_useCounter++;
+            done += copySize;
+            continue;
+        }
+        const int64_t lastBlock = (position + toRead - 1) / m_blockSize;
+        int64_t numMissing = 1;//coalesce all consecutive uncached blocks of this read into one request
+        while (block + numMissing <= lastBlock && m_cache.find(block + numMissing) == m_cache.end()) ++numMissing;
+        const int64_t start = block * m_blockSize;
+        const int64_t end = min(start + numMissing * m_blockSize, m_fileSize) - 1;//inclusive
+        fetchRange(start, end, fetched);
+        if ((int64_t)fetched.size() != end - start + 1)
+        {
+            throw DataFileException("wrong number of bytes received from '" + getRangeSourceName() + "'");
+        }
+        const int64_t copySize = min((int64_t)fetched.size() - offset, toRead - done);
+        memcpy(dataOut + done, fetched.data() + offset, copySize);
+        done += copySize;
+        for (int64_t i = 0; i < numMissing; ++i)
+        {
+            const int64_t blockStart = i * m_blockSize;
+            addToCache(block + i, fetched.data() + blockStart, min(m_blockSize, (int64_t)fetched.size() - blockStart));
+        }
+    }
+    return toRead;
+}
+
+void ByteRangeCache::clearCache()
+{
+    m_cache.clear();
+}
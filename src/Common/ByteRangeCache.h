@@ -0,0 +1,71 @@
+#ifndef __BYTE_RANGE_CACHE_H__
+#define __BYTE_RANGE_CACHE_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AString.h"
+
+#include "stdint.h"
+#include <map>
+#include <vector>
+
+namespace caret {
+    
+    ///reads byte ranges of a remote file through a block cache, fetching all missing consecutive blocks of a read in one request
+    ///the transport is up to the subclass, so the offset and coalescing logic can be tested without a server
+    class ByteRangeCache
+    {
+        struct CacheBlock
+        {
+            std::vector<char> m_data;
+            int64_t m_lastUsed;
+        };
+        std::map<int64_t, CacheBlock> m_cache;//keyed by block number
+        int64_t m_blockSize, m_maxBlocks, m_fileSize, m_useCounter;
+        ByteRangeCache(const ByteRangeCache&);
+        ByteRangeCache& operator=(const ByteRangeCache&);
+    protected:
+        ///must return exactly the bytes from start through end, inclusive (like the http range header), or throw
+        virtual void fetchRange(const int64_t& start, const int64_t& end, std::vector<char>& dataOut) = 0;
+        
+        ///name for error messages
+        virtual AString getRangeSourceName() const = 0;
+    public:
+        ByteRangeCache(const int64_t& blockSize = (1<<20), const int64_t& maxBlocks = 128);//1MB, large enough to amortize request latency, small enough that a dconn row doesn't drag in much else
+        virtual ~ByteRangeCache();
+        
+        void setFileSize(const int64_t& fileSize) { m_fileSize = fileSize; }
+        int64_t getFileSize() const { return m_fileSize; }
+        int64_t getBlockSize() const { return m_blockSize; }
+        int64_t getNumberOfCachedBlocks() const { return (int64_t)m_cache.size(); }
+        
+        ///for data that arrived some other way, like the response to the request that found the file size, data must start at the beginning of the block
+        void addToCache(const int64_t& block, const char* data, const int64_t& size);
+        
+        ///copies up to count bytes starting at position, returns the number copied, which is less than count only at the end of the file
+        int64_t readRange(char* dataOut, const int64_t& position, const int64_t& count);
+        
+        void clearCache();
+    };
+    
+}
+
+#endif //__BYTE_RANGE_CACHE_H__
@@ -25,13 +25,21 @@
 #define _FILE_OFFSET_BITS 64
 #endif
 
+#include "ByteRangeCache.h"
 #include "CaretBinaryFile.h"
+#include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
+#include "DataFile.h"
 #include "DataFileException.h"
 
 #include <QFile>
 #include "zlib.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 using namespace caret;
 using namespace std;
 
@@ -65,6 +73,34 @@ namespace caret
         void read(void* dataOut, const int64_t& count, int64_t* numRead);
         void write(const void* dataIn, const int64_t& count);
     };
+    
+    //fetches byte ranges with http range requests, the block and offset logic is in ByteRangeCache
+    class HttpByteRangeCache : public ByteRangeCache
+    {
+        QString m_url;
+    protected:
+        void fetchRange(const int64_t& start, const int64_t& end, std::vector<char>& dataOut);
+        AString getRangeSourceName() const { return m_url; }
+    public:
+        void setUrl(const QString& url) { m_url = url; }
+    };
+    
+    //read-only access to a file on a web server, using byte range requests so that only the parts that are used get downloaded
+    class HttpRangeImpl : public CaretBinaryFile::ImplInterface
+    {
+        HttpByteRangeCache m_cache;
+        std::vector<char> m_wholeFile;//if the server ignores the range header, we get the entire file, so just keep it
+        bool m_haveWholeFile;
+        int64_t m_pos;
+    public:
+        HttpRangeImpl() { m_haveWholeFile = false; m_pos = 0; }
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos();
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+    };
 }
 
 CaretBinaryFile::ImplInterface::~ImplInterface()
@@ -104,8 +140,11 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
 {
     close();
     if (opmode == NONE) throw DataFileException("can't open file with NONE mode");
-    if (filename.endsWith(".gz"))
+    if (DataFile::isFileOnNetwork(filename))
     {
+        if (filename.endsWith(".gz")) throw DataFileException("can't read compressed file '" + filename + "' over the network without downloading it");
+        m_impl.grabNew(new HttpRangeImpl());
+    } else if (filename.endsWith(".gz")) {
 #ifdef ZLIB_VERSION
         m_impl.grabNew(new ZFileImpl());
 #else //ZLIB_VERSION
@@ -114,6 +153,7 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
     } else {
         m_impl.grabNew(new QFileImpl());
     }
+    CaretProfiler::IOTimer myTimer(CaretProfiler::OPEN, filename);
     m_impl->open(filename, opmode);
     m_curMode = opmode;
 }
@@ -121,7 +161,9 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
 void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead)
 {
     if (!getOpenForRead()) throw DataFileException("file is not open for reading");
+    CaretProfiler::IOTimer myTimer(CaretProfiler::READ, m_impl->getFilename(), count);
     m_impl->read(dataOut, count, numRead);
+    if (numRead != NULL) myTimer.setBytes(*numRead);
 }
 
 void CaretBinaryFile::seek(const int64_t& position)
@@ -139,6 +181,7 @@ int64_t CaretBinaryFile::pos()
 void CaretBinaryFile::write(const void* dataIn, const int64_t& count)
 {
     if (!getOpenForWrite()) throw DataFileException("file is not open for writing");
+    CaretProfiler::IOTimer myTimer(CaretProfiler::WRITE, m_impl->getFilename(), count);
     m_impl->write(dataIn, count);
 }
 
@@ -320,3 +363,100 @@ void QFileImpl::write(const void* dataIn, const int64_t& count)
     if (writeret != count) throw DataFileException(msg);
     //if (writeret != count) throw DataFileException("failed to write to file '" + m_fileName + "'");
 }
+
+void HttpByteRangeCache::fetchRange(const int64_t& start, const int64_t& end, vector<char>& dataOut)
+{
+    CaretHttpRequest myRequest;
+    myRequest.m_method = CaretHttpManager::GET;
+    myRequest.m_url = m_url;
+    myRequest.m_headers.push_back(make_pair(AString("Range"), "bytes=" + AString::number(start) + "-" + AString::number(end)));
+    CaretHttpResponse myResponse;
+    CaretHttpManager::httpRequest(myRequest, myResponse);
+    if (myResponse.m_responseCode != 206)
+    {
+        throw DataFileException("error reading from URL '" + m_url + "', response code: " + AString::number(myResponse.m_responseCode));
+    }
+    dataOut.swap(myResponse.m_body);
+}
+
+void HttpRangeImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    if (opmode != CaretBinaryFile::READ) throw DataFileException("files on the network can only be opened for reading: '" + filename + "'");
+    m_cache.setUrl(filename);
+    CaretHttpRequest myRequest;
+    myRequest.m_method = CaretHttpManager::GET;
+    myRequest.m_url = filename;
+    myRequest.m_headers.push_back(std::make_pair(AString("Range"), "bytes=0-" + AString::number(m_cache.getBlockSize() - 1)));
+    CaretHttpResponse myResponse;
+    CaretHttpManager::httpRequest(myRequest, myResponse);
+    if (!myResponse.m_ok)
+    {
+        throw DataFileException("error opening URL '" + filename + "', response code: " + AString::number(myResponse.m_responseCode));
+    }
+    if (myResponse.m_responseCode == 200)
+    {
+        CaretLogFine("server ignored range request, using entire contents of '" + filename + "'");
+        m_wholeFile.swap(myResponse.m_body);
+        m_haveWholeFile = true;
+        return;
+    }
+    int64_t fileSize = -1;
+    for (int i = 0; i < (int)myResponse.m_headers.size(); ++i)
+    {
+        if (myResponse.m_headers[i].first.toLower() == "content-range")//"bytes 0-1048575/123456789"
+        {
+            const AString& value = myResponse.m_headers[i].second;
+            bool ok = false;
+            fileSize = value.mid(value.lastIndexOf('/') + 1).toLongLong(&ok);
+            if (!ok) fileSize = -1;
+        }
+    }
+    if (fileSize < 0) throw DataFileException("server did not report the size of '" + filename + "'");
+    m_cache.setFileSize(fileSize);
+    m_cache.addToCache(0, myResponse.m_body.data(), (int64_t)myResponse.m_body.size());
+}
+
+void HttpRangeImpl::close()
+{
+    m_cache.clearCache();
+    m_cache.setFileSize(0);
+    m_wholeFile.clear();
+    m_haveWholeFile = false;
+    m_pos = 0;
+}
+
+void HttpRangeImpl::seek(const int64_t& position)
+{
+    if (position < 0) throw DataFileException("seek failed in URL '" + m_fileName + "'");
+    m_pos = position;
+}
+
+int64_t HttpRangeImpl::pos()
+{
+    return m_pos;
+}
+
+void HttpRangeImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    int64_t toRead = 0;
+    if (m_haveWholeFile)
+    {
+        toRead = max(min(count, (int64_t)m_wholeFile.size() - m_pos), (int64_t)0);
+        if (toRead > 0) memcpy(dataOut, m_wholeFile.data() + m_pos, toRead);
+    } else {
+        toRead = m_cache.readRange((char*)dataOut, m_pos, count);
+    }
+    m_pos += toRead;
+    if (numRead == NULL)
+    {
+        if (toRead != count) throw DataFileException("premature end of file in '" + m_fileName + "'");
+    } else {
+        *numRead = toRead;
+    }
+}
+void HttpRangeImpl::write(const void*, const int64_t&)
+{
+    throw DataFileException("files on the network can't be written to: '" + m_fileName + "'");
+}
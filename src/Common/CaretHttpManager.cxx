@@ -192,6 +192,10 @@ void CaretHttpManager::httpRequestPrivate(const CaretHttpRequest &request, Caret
     {
         CaretLogInfo("NO AUTH FOUND for URL " + request.m_url);
     }
+    for (int i = 0; i < (int)request.m_headers.size(); ++i)
+    {
+        myRequest.setRawHeader(request.m_headers[i].first.toLatin1(), request.m_headers[i].second.toLatin1());
+    }
     QNetworkReply* myReply = NULL;
     QUrl myUrl = QUrl::fromUserInput(request.m_url);
     for (int32_t i = 0; i < (int32_t)request.m_queries.size(); ++i)
@@ -261,7 +265,7 @@ void CaretHttpManager::httpRequestPrivate(const CaretHttpRequest &request, Caret
         response.m_responseCode = myReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
         response.m_responseCodeValid = true;
     }
-    if (response.m_responseCode == 200)
+    if (response.m_responseCode == 200 || response.m_responseCode == 206)//206 is the reply to a range request
     {
         response.m_ok = true;
     }
@@ -285,6 +289,11 @@ void CaretHttpManager::httpRequestPrivate(const CaretHttpRequest &request, Caret
                             response);
     }
     
+    QList<QByteArray> replyHeaderList = myReply->rawHeaderList();
+    for (QList<QByteArray>::const_iterator iter = replyHeaderList.begin(); iter != replyHeaderList.end(); ++iter)
+    {
+        response.m_headers.push_back(std::make_pair(AString(*iter), AString(myReply->rawHeader(*iter))));
+    }
     QByteArray myBody = myReply->readAll();
     int64_t mySize = myBody.size();
     response.m_body.reserve(mySize + 1);//make room for the null terminator that will sometimes be added to the end
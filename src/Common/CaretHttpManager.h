@@ -72,6 +72,7 @@ namespace caret {
         bool m_responseCodeValid;
         QUrl m_redirectionUrl;
         bool m_redirectionUrlValid;
+        std::vector<std::pair<AString, AString> > m_headers;//raw reply headers, for things like Content-Range
     };
 
     struct CaretHttpRequest
@@ -79,6 +80,7 @@ namespace caret {
         CaretHttpManager::Method m_method;
         AString m_url;
         std::vector<std::pair<AString, AString> > m_arguments, m_queries;//arguments go to post data if method is post, queries stay as queries
+        std::vector<std::pair<AString, AString> > m_headers;//extra raw request headers, like Range
     };
 
 }
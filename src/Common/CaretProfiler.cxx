@@ -0,0 +1,243 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "CaretProfiler.h"
+
+#include "CaretAssert.h"
+#include "CaretMutex.h"
+#include "CaretPointer.h"
+#include "DataFileException.h"
+#include "ElapsedTimer.h"
+
+#ifndef CARET_OS_WINDOWS
+#include <sys/resource.h>
+#endif
+
+#include <fstream>
+#include <map>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+bool CaretProfiler::s_enabled = false;
+ElapsedTimer* CaretProfiler::s_timer = NULL;
+
+namespace
+{
+    struct IOStats
+    {
+        int64_t m_calls, m_bytes;
+        double m_seconds;
+        IOStats() { m_calls = 0; m_bytes = 0; m_seconds = 0.0; }
+    };
+    
+    struct SectionNode
+    {
+        AString m_name;
+        double m_start, m_seconds, m_ioSeconds;
+        int64_t m_bytesRead, m_bytesWritten;
+        vector<CaretPointer<SectionNode> > m_children;
+        SectionNode(const AString& name, const double& start) : m_name(name)
+        {
+            m_start = start;
+            m_seconds = 0.0;
+            m_ioSeconds = 0.0;
+            m_bytesRead = 0;
+            m_bytesWritten = 0;
+        }
+    };
+    
+    CaretMutex g_profileMutex;//file reads can happen inside parallel sections
+    map<pair<int, AString>, IOStats> g_ioStats;
+    vector<CaretPointer<SectionNode> > g_topSections;
+    vector<SectionNode*> g_sectionStack;
+    
+    AString jsonString(const AString& in)
+    {
+        AString ret = "\"";
+        for (int i = 0; i < in.size(); ++i)
+        {
+            QChar c = in[i];
+            if (c == '"' || c == '\\')
+            {
+                ret += '\\';
+                ret += c;
+            } else if (c.unicode() < 0x20) {
+                ret += "\\u" + AString::number(c.unicode(), 16).rightJustified(4, '0');
+            } else {
+                ret += c;
+            }
+        }
+        return ret + "\"";
+    }
+    
+    const char* ioTypeName(const int& type)
+    {
+        switch (type)
+        {
+            case CaretProfiler::OPEN:
+                return "open";
+            case CaretProfiler::PARSE:
+                return "parse";
+            case CaretProfiler::READ:
+                return "read";
+            case CaretProfiler::WRITE:
+                return "write";
+        }
+        CaretAssert(0);
+        return "";
+    }
+    
+    void writeSection(ofstream& outFile, const SectionNode& node, const AString& indent)
+    {
+        outFile << indent << "{" << "\"name\": " << jsonString(node.m_name)
+                << ", \"seconds\": " << node.m_seconds
+                << ", \"io_seconds\": " << node.m_ioSeconds
+                << ", \"bytes_read\": " << node.m_bytesRead
+                << ", \"bytes_written\": " << node.m_bytesWritten
+                << ", \"children\": [";
+        for (int i = 0; i < (int)node.m_children.size(); ++i)
+        {
+            outFile << (i == 0 ? "\n" : ",\n");
+            writeSection(outFile, *(node.m_children[i]), indent + "  ");
+        }
+        if (!node.m_children.empty()) outFile << "\n" << indent;
+        outFile << "]}";
+    }
+}
+
+void CaretProfiler::enable()
+{
+    CaretAssert(!s_enabled);
+    s_timer = new ElapsedTimer();
+    s_timer->start();
+    s_enabled = true;
+}
+
+double CaretProfiler::getTime()
+{
+    if (s_timer == NULL) return 0.0;
+    return s_timer->getElapsedTimeSeconds();
+}
+
+void CaretProfiler::recordIO(const IOType& type, const AString& fileName, const double& seconds, const int64_t& bytes)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locked(&g_profileMutex);
+    IOStats& stats = g_ioStats[make_pair((int)type, fileName)];
+    ++stats.m_calls;
+    stats.m_bytes += bytes;
+    stats.m_seconds += seconds;
+    if (!g_sectionStack.empty())
+    {
+        SectionNode* current = g_sectionStack.back();
+        if (type != PARSE) current->m_ioSeconds += seconds;//parse time is mostly cpu, and any reads it does are already recorded separately
+        if (type == READ) current->m_bytesRead += bytes;
+        if (type == WRITE) current->m_bytesWritten += bytes;
+    }
+}
+
+void CaretProfiler::beginSection(const AString& name)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locked(&g_profileMutex);
+    CaretPointer<SectionNode> newNode(new SectionNode(name, getTime()));
+    if (g_sectionStack.empty())
+    {
+        g_topSections.push_back(newNode);
+    } else {
+        g_sectionStack.back()->m_children.push_back(newNode);
+    }
+    g_sectionStack.push_back(newNode);
+}
+
+void CaretProfiler::endSection()
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locked(&g_profileMutex);
+    CaretAssert(!g_sectionStack.empty());
+    if (g_sectionStack.empty()) return;
+    SectionNode* current = g_sectionStack.back();
+    current->m_seconds = getTime() - current->m_start;
+    g_sectionStack.pop_back();
+    if (!g_sectionStack.empty())//file access in a child section also counts for its parents
+    {
+        SectionNode* parent = g_sectionStack.back();
+        parent->m_ioSeconds += current->m_ioSeconds;
+        parent->m_bytesRead += current->m_bytesRead;
+        parent->m_bytesWritten += current->m_bytesWritten;
+    }
+}
+
+int64_t CaretProfiler::getPeakMemoryBytes()
+{
+#ifdef CARET_OS_WINDOWS
+    return -1;
+#else
+    struct rusage myUsage;
+    if (getrusage(RUSAGE_SELF, &myUsage) != 0) return -1;
+#ifdef CARET_OS_MACOSX
+    return myUsage.ru_maxrss;//bytes on mac
+#else
+    return ((int64_t)myUsage.ru_maxrss) * 1024;//kilobytes on linux
+#endif
+#endif
+}
+
+void CaretProfiler::writeReport(const AString& fileName, const AString& commandLine)
+{
+    if (!s_enabled) return;
+    double totalSeconds = getTime();
+    while (!g_sectionStack.empty()) endSection();//in case the command threw
+    ofstream outFile(fileName.toLocal8Bit().constData());
+    if (!outFile) throw DataFileException("failed to open profile output file '" + fileName + "'");
+    outFile.precision(6);
+    outFile << fixed;
+    outFile << "{\n";
+    outFile << "  \"command\": " << jsonString(commandLine) << ",\n";
+    outFile << "  \"wall_seconds\": " << totalSeconds << ",\n";
+    outFile << "  \"peak_memory_bytes\": " << getPeakMemoryBytes() << ",\n";
+    outFile << "  \"io\": [";
+    bool first = true;
+    for (map<pair<int, AString>, IOStats>::iterator iter = g_ioStats.begin(); iter != g_ioStats.end(); ++iter)
+    {
+        outFile << (first ? "\n" : ",\n");
+        first = false;
+        outFile << "    {\"type\": \"" << ioTypeName(iter->first.first) << "\""
+                << ", \"file\": " << jsonString(iter->first.second)
+                << ", \"calls\": " << iter->second.m_calls
+                << ", \"seconds\": " << iter->second.m_seconds
+                << ", \"bytes\": " << iter->second.m_bytes << "}";
+    }
+    outFile << "\n  ],\n";
+    outFile << "  \"sections\": [";
+    for (int i = 0; i < (int)g_topSections.size(); ++i)
+    {
+        outFile << (i == 0 ? "\n" : ",\n");
+        writeSection(outFile, *(g_topSections[i]), "    ");
+    }
+    outFile << "\n  ]\n}\n";
+    if (!outFile) throw DataFileException("error writing profile output file '" + fileName + "'");
+    s_enabled = false;
+    g_ioStats.clear();
+    g_topSections.clear();
+    delete s_timer;
+    s_timer = NULL;
+}
@@ -0,0 +1,97 @@
+#ifndef __CARET_PROFILER_H__
+#define __CARET_PROFILER_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AString.h"
+
+#include <stdint.h>
+
+namespace caret {
+    
+    class ElapsedTimer;
+    
+    ///records wall time of file access and algorithms for wb_command -profile, does nothing unless enabled
+    class CaretProfiler
+    {
+        static bool s_enabled;
+        static ElapsedTimer* s_timer;
+        CaretProfiler();
+    public:
+        enum IOType
+        {
+            OPEN,
+            PARSE,//header and xml parsing, reported per file but not added to section io time, because the reads it does are timed as READ
+            READ,
+            WRITE
+        };
+        ///starts the wall clock, only call once, before any work is done
+        static void enable();
+        static bool isEnabled() { return s_enabled; }
+        ///seconds since enable() was called
+        static double getTime();
+        static void recordIO(const IOType& type, const AString& fileName, const double& seconds, const int64_t& bytes);
+        ///sections nest, time spent in file access is also attributed to the innermost open section
+        static void beginSection(const AString& name);
+        static void endSection();
+        ///-1 if not available on this platform
+        static int64_t getPeakMemoryBytes();
+        ///write everything recorded so far as json, and stop profiling
+        static void writeReport(const AString& fileName, const AString& commandLine);
+        
+        ///times a file access, and records it on destruction if profiling is enabled
+        class IOTimer
+        {
+            IOType m_type;
+            QString m_fileName;//QString copies are reference counted, so this is cheap
+            double m_start;
+            int64_t m_bytes;
+            IOTimer();
+            IOTimer(const IOTimer&);
+            IOTimer& operator=(const IOTimer&);
+        public:
+            IOTimer(const IOType& type, const QString& fileName, const int64_t& bytes = 0) : m_type(type), m_fileName(fileName), m_bytes(bytes)
+            {
+                if (s_enabled) m_start = getTime();
+            }
+            void setBytes(const int64_t& bytes) { m_bytes = bytes; }
+            ~IOTimer()
+            {
+                if (s_enabled) recordIO(m_type, m_fileName, getTime() - m_start, m_bytes);
+            }
+        };
+        
+        ///begins a section on construction and ends it on destruction, so exceptions don't leave sections open
+        class Section
+        {
+            bool m_active;
+            Section();
+            Section(const Section&);
+            Section& operator=(const Section&);
+        public:
+            Section(const AString& name) : m_active(s_enabled) { if (m_active) beginSection(name); }
+            ~Section() { if (m_active) endSection(); }
+        };
+    };
+    
+}
+
+#endif //__CARET_PROFILER_H__
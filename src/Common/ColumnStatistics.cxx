@@ -0,0 +1,245 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ColumnStatistics.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "ReductionOperation.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t BLOCK_ROWS = 64;
+    
+    void checkCount(const int64_t& count, const vector<ReductionEnum::Enum>& reductions)
+    {
+        if (count == 0) throw CaretException("roi column is empty");
+        for (int i = 0; i < (int)reductions.size(); ++i)
+        {
+            if (reductions[i] == ReductionEnum::SAMPSTDEV && count < 2) throw CaretException("SAMPSTDEV reduction would require dividing by zero");
+        }
+    }
+}
+
+ColumnStatistics::ColumnStatistics(const int64_t& numColumns, const vector<ReductionEnum::Enum>& reductions, const vector<float>& percentiles)
+{
+    m_numColumns = numColumns;
+    m_blockRows = 0;
+    m_reductions = reductions;
+    m_percentiles = percentiles;
+    m_haveRoi = false;
+    m_needValues = !percentiles.empty();
+    for (int i = 0; i < (int)reductions.size(); ++i)
+    {
+        if (reductions[i] == ReductionEnum::INVALID) throw CaretException("reduction requested with INVALID operator");
+        if (reductions[i] == ReductionEnum::MEDIAN || reductions[i] == ReductionEnum::MODE) m_needValues = true;
+    }
+    m_block.resize(BLOCK_ROWS * numColumns);
+    if (m_needValues) m_values.resize(numColumns);
+    m_count.resize(numColumns, 0);
+    m_countNonzero.resize(numColumns, 0);
+    m_indexMax.resize(numColumns, 0);
+    m_indexMin.resize(numColumns, 0);
+    m_sum.resize(numColumns, 0.0);
+    m_mean.resize(numColumns, 0.0);
+    m_sumSquaredResid.resize(numColumns, 0.0);
+    m_product.resize(numColumns, 1.0);
+    m_max.resize(numColumns, 0.0f);
+    m_min.resize(numColumns, 0.0f);
+}
+
+void ColumnStatistics::addRow(const float* row, const float* roiRow)
+{
+    if (roiRow != NULL && !m_haveRoi)
+    {//rows that were added without an roi are all included
+        m_roiBlock.resize(BLOCK_ROWS * m_numColumns, 1.0f);
+        m_haveRoi = true;
+    }
+    float* blockRow = m_block.data() + m_blockRows * m_numColumns;
+    for (int64_t c = 0; c < m_numColumns; ++c) blockRow[c] = row[c];
+    if (m_haveRoi)
+    {
+        float* roiBlockRow = m_roiBlock.data() + m_blockRows * m_numColumns;
+        for (int64_t c = 0; c < m_numColumns; ++c) roiBlockRow[c] = (roiRow == NULL ? 1.0f : roiRow[c]);
+    }
+    ++m_blockRows;
+    if (m_blockRows == BLOCK_ROWS) flushBlock();
+}
+
+void ColumnStatistics::flushBlock()
+{
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t c = 0; c < m_numColumns; ++c)
+    {
+        for (int64_t r = 0; r < m_blockRows; ++r)
+        {
+            if (m_haveRoi && !(m_roiBlock[r * m_numColumns + c] > 0.0f)) continue;
+            const float value = m_block[r * m_numColumns + c];
+            const int64_t count = ++m_count[c];
+            m_sum[c] += value;
+            const double delta = value - m_mean[c];//Welford, so variance doesn't need a second pass
+            m_mean[c] += delta / count;
+            m_sumSquaredResid[c] += delta * (value - m_mean[c]);
+            m_product[c] *= value;
+            if (count == 1 || value > m_max[c])
+            {
+                m_max[c] = value;
+                m_indexMax[c] = count;//1-based, to match ReductionOperation
+            }
+            if (count == 1 || value < m_min[c])
+            {
+                m_min[c] = value;
+                m_indexMin[c] = count;
+            }
+            if (value != 0.0f) ++m_countNonzero[c];
+            if (m_needValues) m_values[c].push_back(value);
+        }
+    }
+    m_blockRows = 0;
+}
+
+void ColumnStatistics::getResults(vector<vector<float> >& resultsOut)
+{
+    flushBlock();
+    for (int64_t c = 0; c < m_numColumns; ++c)
+    {
+        checkCount(m_count[c], m_reductions);//throw before the parallel section
+    }
+    const int numReduce = (int)m_reductions.size(), numPercent = (int)m_percentiles.size();
+    resultsOut.resize(m_numColumns);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t c = 0; c < m_numColumns; ++c)
+    {
+        vector<float>& results = resultsOut[c];
+        results.resize(numReduce + numPercent);
+        const int64_t count = m_count[c];
+        for (int i = 0; i < numReduce; ++i)
+        {
+            switch (m_reductions[i])
+            {
+                case ReductionEnum::INVALID:
+                    CaretAssert(false);
+                    break;
+                case ReductionEnum::SUM:
+                    results[i] = m_sum[c];
+                    break;
+                case ReductionEnum::MEAN:
+                    results[i] = m_sum[c] / count;
+                    break;
+                case ReductionEnum::STDEV:
+                    results[i] = sqrt(m_sumSquaredResid[c] / count);
+                    break;
+                case ReductionEnum::SAMPSTDEV:
+                    results[i] = sqrt(m_sumSquaredResid[c] / (count - 1));
+                    break;
+                case ReductionEnum::VARIANCE:
+                    results[i] = m_sumSquaredResid[c] / count;
+                    break;
+                case ReductionEnum::PRODUCT:
+                    results[i] = m_product[c];
+                    break;
+                case ReductionEnum::MAX:
+                    results[i] = m_max[c];
+                    break;
+                case ReductionEnum::MIN:
+                    results[i] = m_min[c];
+                    break;
+                case ReductionEnum::INDEXMAX:
+                    results[i] = m_indexMax[c];
+                    break;
+                case ReductionEnum::INDEXMIN:
+                    results[i] = m_indexMin[c];
+                    break;
+                case ReductionEnum::COUNT_NONZERO:
+                    results[i] = m_countNonzero[c];
+                    break;
+                case ReductionEnum::MEDIAN:
+                    results[i] = percentile(m_values[c].data(), count, 50.0f);
+                    break;
+                case ReductionEnum::MODE:
+                    results[i] = ReductionOperation::reduce(m_values[c].data(), count, ReductionEnum::MODE);
+                    break;
+            }
+        }
+        for (int i = 0; i < numPercent; ++i)
+        {
+            results[numReduce + i] = percentile(m_values[c].data(), count, m_percentiles[i]);
+        }
+    }
+}
+
+void ColumnStatistics::computeColumn(const float* data, const int64_t& numElems, const float* roiData, const vector<ReductionEnum::Enum>& reductions,
+                                     const vector<float>& percentiles, vector<float>& resultsOut)
+{
+    vector<float> toUse;
+    if (roiData == NULL)
+    {
+        toUse.assign(data, data + numElems);
+    } else {
+        toUse.reserve(numElems);
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            if (roiData[i] > 0.0f) toUse.push_back(data[i]);
+        }
+    }
+    checkCount(toUse.size(), reductions);
+    const int numReduce = (int)reductions.size(), numPercent = (int)percentiles.size();
+    resultsOut.resize(numReduce + numPercent);
+    for (int i = 0; i < numReduce; ++i)
+    {//percentile() reorders the data, which breaks INDEXMAX and INDEXMIN, so do everything else first
+        if (reductions[i] != ReductionEnum::MEDIAN)
+        {
+            resultsOut[i] = ReductionOperation::reduce(toUse.data(), toUse.size(), reductions[i]);
+        }
+    }
+    for (int i = 0; i < numReduce; ++i)
+    {
+        if (reductions[i] == ReductionEnum::MEDIAN)
+        {
+            resultsOut[i] = percentile(toUse.data(), toUse.size(), 50.0f);
+        }
+    }
+    for (int i = 0; i < numPercent; ++i)
+    {
+        resultsOut[numReduce + i] = percentile(toUse.data(), toUse.size(), percentiles[i]);
+    }
+}
+
+float ColumnStatistics::percentile(float* data, const int64_t& numElems, const float& percent)
+{
+    CaretAssert(numElems > 0);
+    CaretAssert(percent >= 0.0f && percent <= 100.0f);
+    const float index = percent / 100.0f * (numElems - 1);
+    if (index <= 0) return *min_element(data, data + numElems);
+    if (index >= numElems - 1) return *max_element(data, data + numElems);
+    float ipart, fpart;
+    fpart = modf(index, &ipart);
+    const int64_t lower = (int64_t)ipart;
+    nth_element(data, data + lower, data + numElems);//everything after lower is now at least as large
+    const float lowVal = data[lower];
+    const float highVal = *min_element(data + lower + 1, data + numElems);
+    return (1.0f - fpart) * lowVal + fpart * highVal;
+}
@@ -0,0 +1,63 @@
+#ifndef __COLUMN_STATISTICS_H__
+#define __COLUMN_STATISTICS_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ReductionEnum.h"
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+    
+    ///computes several reductions and percentiles down every column of a matrix that arrives one row at a time, without storing it unless an order statistic needs it
+    class ColumnStatistics
+    {
+        int64_t m_numColumns, m_blockRows;
+        std::vector<ReductionEnum::Enum> m_reductions;
+        std::vector<float> m_percentiles;
+        bool m_needValues, m_haveRoi;
+        std::vector<float> m_block, m_roiBlock;//rows are buffered so each column's updates touch a small, cached block
+        std::vector<std::vector<float> > m_values;//only for MEDIAN, MODE and percentiles
+        std::vector<int64_t> m_count, m_countNonzero, m_indexMax, m_indexMin;
+        std::vector<double> m_sum, m_mean, m_sumSquaredResid, m_product;
+        std::vector<float> m_max, m_min;
+        void flushBlock();
+    public:
+        ColumnStatistics(const int64_t& numColumns, const std::vector<ReductionEnum::Enum>& reductions, const std::vector<float>& percentiles);
+        
+        ///roiRow is optional, elements where it is not positive are excluded
+        void addRow(const float* row, const float* roiRow = NULL);
+        
+        ///for each column, the reductions in the order given, followed by the percentiles
+        void getResults(std::vector<std::vector<float> >& resultsOut);
+        
+        ///same output order, for one column that is already in memory
+        static void computeColumn(const float* data, const int64_t& numElems, const float* roiData, const std::vector<ReductionEnum::Enum>& reductions,
+                                  const std::vector<float>& percentiles, std::vector<float>& resultsOut);
+        
+        ///interpolated percentile, found by selection rather than sorting, reorders the data
+        static float percentile(float* data, const int64_t& numElems, const float& percent);
+    };
+    
+}
+
+#endif //__COLUMN_STATISTICS_H__
@@ -32,10 +32,25 @@
 #include "ApplicationInformation.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "ElapsedTimer.h"
 #include "EventAlertUser.h"
 #include "EventListenerInterface.h"
 
 using namespace caret;
+
+namespace {
+    /*
+     * Tracks nesting of events sent while processing
+     * another event, even if a listener throws.
+     */
+    class SendDepthCounter {
+    public:
+        SendDepthCounter(int32_t& depth) : m_depth(depth) { m_depth++; }
+        ~SendDepthCounter() { m_depth--; }
+    private:
+        int32_t& m_depth;
+    };
+}
 /**
  * \class  caret::EventManager
  * \brief  The event manager.
@@ -73,6 +88,10 @@ EventManager::EventManager()
 {
     m_eventIssuedCounter = 0;
     m_eventBlockingCounter.resize(EventTypeEnum::EVENT_COUNT, 0);
+    m_profilingEnabled = false;
+    m_sendDepth = 0;
+    m_topLevelSendCounter = 0;
+    resetProfiling();
 }
 
 /**
@@ -335,22 +354,39 @@ void
 EventManager::sendEvent(Event* event)
 {   
     EventTypeEnum::Enum eventType = event->getEventType();
-    const AString eventNumberString = AString::number(m_eventIssuedCounter);
-    const AString eventMessagePrefix = ("Event "
-                                        + eventNumberString
-                                        + ": "
-                                        + event->toString() 
-                                        + " from thread: " 
-                                        + AString::number((uint64_t)QThread::currentThread())
-                                        + " ");
     
     const int32_t eventTypeIndex = static_cast<int32_t>(eventType);
     CaretAssertVectorIndex(m_eventBlockingCounter, eventTypeIndex);
+    
+    /*
+     * Profiling is off by default, so only look up the profile
+     * when it has been enabled.
+     */
+    EventProfile* profile = NULL;
+    if (m_profilingEnabled) {
+        CaretAssertVectorIndex(m_eventProfiles, eventTypeIndex);
+        profile = &m_eventProfiles[eventTypeIndex];
+        profile->m_sentCount++;
+        if (m_sendDepth == 0) {
+            m_topLevelSendCounter++;
+        }
+        else if (profile->m_lastTopLevelSend == m_topLevelSendCounter) {
+            profile->m_redundantCount++;
+        }
+        profile->m_lastTopLevelSend = m_topLevelSendCounter;
+    }
+    
     if (m_eventBlockingCounter[eventTypeIndex] > 0) {
-        AString msg = (eventMessagePrefix
-                       + " is blocked.  Blocking counter="
-                       + AString::number(m_eventBlockingCounter[eventTypeIndex]));
-        CaretLogFiner(msg);
+        /*
+         * Message is only assembled when FINER logging is enabled
+         * since events are sent very frequently.
+         */
+        CaretLogFiner(getEventMessagePrefix(event)
+                      + " is blocked.  Blocking counter="
+                      + AString::number(m_eventBlockingCounter[eventTypeIndex]));
+        if (profile != NULL) {
+            profile->m_blockedCount++;
+        }
     }
     else {
         if (eventType == EventTypeEnum::EVENT_ALERT_USER) {
@@ -372,13 +408,13 @@ EventManager::sendEvent(Event* event)
          */
         EVENT_LISTENER_CONTAINER listeners = m_eventListeners[eventType];
         
-        const AString eventNumberString = AString::number(m_eventIssuedCounter);
-        
         // Too many prints (JWH)
         //AString msg = (eventMessagePrefix + " SENT.");
         //CaretLogFiner(msg);
         //std::cout << msg << std::endl;
         
+        SendDepthCounter depthCounter(m_sendDepth);
+        
         /*
          * Send event to each of the listeners.
          */
@@ -394,10 +430,15 @@ EventManager::sendEvent(Event* event)
             //<< std::endl;
             
             
-            listener->receiveEvent(event);
+            if (profile != NULL) {
+                receiveEventProfiled(listener, event, profile);
+            }
+            else {
+                listener->receiveEvent(event);
+            }
             
             if (event->isError()) {
-                CaretLogWarning("Event " + eventNumberString + " had error: " + event->toString() + ": " + event->getErrorMessage());
+                CaretLogWarning("Event " + AString::number(m_eventIssuedCounter) + " had error: " + event->toString() + ": " + event->getErrorMessage());
                 break;
             }
         }
@@ -422,10 +463,15 @@ EventManager::sendEvent(Event* event)
                 //<< std::endl;
                 
                 
-                listener->receiveEvent(event);
+                if (profile != NULL) {
+                    receiveEventProfiled(listener, event, profile);
+                }
+                else {
+                    listener->receiveEvent(event);
+                }
                 
                 if (event->isError()) {
-                    CaretLogWarning("Event " + eventNumberString + " had error: " + event->toString());
+                    CaretLogWarning("Event " + AString::number(m_eventIssuedCounter) + " had error: " + event->toString());
                     break;
                 }
             }
@@ -434,10 +480,149 @@ EventManager::sendEvent(Event* event)
             // Too many prints (JWH) CaretLogFine("Event " + eventNumberString + " not processed: " + event->toString());
         }
 
+
         m_eventIssuedCounter++;
     }
 }
 
+/**
+ * Create the prefix used in log messages about an event.  This is
+ * somewhat expensive so it should only be called when the message
+ * will actually be logged.
+ *
+ * @param event
+ *    Event for the message.
+ * @return
+ *    Text containing event number, event description, and thread.
+ */
+AString
+EventManager::getEventMessagePrefix(Event* event) const
+{
+    return ("Event "
+            + AString::number(m_eventIssuedCounter)
+            + ": "
+            + event->toString()
+            + " from thread: "
+            + AString::number((uint64_t)QThread::currentThread())
+            + " ");
+}
+
+/**
+ * Send an event to a listener and record the time the listener
+ * spent processing the event.
+ *
+ * @param listener
+ *    Listener that receives the event.
+ * @param event
+ *    Event that is sent.
+ * @param profile
+ *    Profile of the event's type.
+ */
+void
+EventManager::receiveEventProfiled(EventListenerInterface* listener,
+                                   Event* event,
+                                   EventProfile* profile)
+{
+    ElapsedTimer timer;
+    timer.start();
+    listener->receiveEvent(event);
+    const double seconds = timer.getElapsedTimeSeconds();
+    
+    ListenerProfile& listenerProfile = profile->m_listenerProfiles[typeid(*listener).name()];
+    listenerProfile.m_callCount++;
+    listenerProfile.m_totalSeconds += seconds;
+    profile->m_totalSeconds += seconds;
+}
+
+/**
+ * Enable or disable profiling of events.  When enabled, the
+ * number of each type of event that is sent and the time each
+ * listener spends processing events is recorded.
+ *
+ * @param enabled
+ *    New profiling status.
+ */
+void
+EventManager::setProfilingEnabled(const bool enabled)
+{
+    m_profilingEnabled = enabled;
+}
+
+/**
+ * @return True if events are being profiled.
+ */
+bool
+EventManager::isProfilingEnabled() const
+{
+    return m_profilingEnabled;
+}
+
+/**
+ * Clear all event profiling data.
+ */
+void
+EventManager::resetProfiling()
+{
+    m_eventProfiles.clear();
+    m_eventProfiles.resize(EventTypeEnum::EVENT_COUNT);
+}
+
+/**
+ * @return Text describing profiling data for each type of event
+ * that has been sent while profiling was enabled.  "Repeated"
+ * is the number of times an event was sent again while handling
+ * a single top-level event, these are candidates for coalescing.
+ */
+AString
+EventManager::getProfilingReport() const
+{
+    std::vector<std::pair<double, int32_t> > sortedEvents;
+    for (int32_t i = 0; i < static_cast<int32_t>(m_eventProfiles.size()); i++) {
+        if (m_eventProfiles[i].m_sentCount > 0) {
+            sortedEvents.push_back(std::make_pair(-m_eventProfiles[i].m_totalSeconds, i));
+        }
+    }
+    std::sort(sortedEvents.begin(), sortedEvents.end());
+    
+    AString report("Event profile (sent / blocked / repeated / total milliseconds):");
+    for (std::vector<std::pair<double, int32_t> >::iterator eventIter = sortedEvents.begin();
+         eventIter != sortedEvents.end();
+         eventIter++) {
+        const EventProfile& profile = m_eventProfiles[eventIter->second];
+        report.appendWithNewLine(EventTypeEnum::toName(static_cast<EventTypeEnum::Enum>(eventIter->second))
+                                 + ": "
+                                 + AString::number(profile.m_sentCount)
+                                 + " / "
+                                 + AString::number(profile.m_blockedCount)
+                                 + " / "
+                                 + AString::number(profile.m_redundantCount)
+                                 + " / "
+                                 + AString::number(profile.m_totalSeconds * 1000.0, 'f', 3));
+        
+        std::vector<std::pair<double, AString> > sortedListeners;
+        for (std::map<AString, ListenerProfile>::const_iterator listenerIter = profile.m_listenerProfiles.begin();
+             listenerIter != profile.m_listenerProfiles.end();
+             listenerIter++) {
+            sortedListeners.push_back(std::make_pair(-listenerIter->second.m_totalSeconds, listenerIter->first));
+        }
+        std::sort(sortedListeners.begin(), sortedListeners.end());
+        for (std::vector<std::pair<double, AString> >::iterator listenerIter = sortedListeners.begin();
+             listenerIter != sortedListeners.end();
+             listenerIter++) {
+            const ListenerProfile& listenerProfile = profile.m_listenerProfiles.find(listenerIter->second)->second;
+            report.appendWithNewLine("    "
+                                     + listenerIter->second
+                                     + ": "
+                                     + AString::number(listenerProfile.m_callCount)
+                                     + " calls, "
+                                     + AString::number(listenerProfile.m_totalSeconds * 1000.0, 'f', 3)
+                                     + " ms");
+        }
+    }
+    
+    return report;
+}
+
 /**
  * Send a "simple" event.  A simple event is one for which there is no
  * specialized subclass of "Event".  This method try to prevent sending
@@ -557,12 +742,10 @@ EventManager::blockEvent(const EventTypeEnum::Enum eventType,
     const int32_t eventTypeIndex = static_cast<int32_t>(eventType);
     CaretAssertVectorIndex(m_eventBlockingCounter, eventTypeIndex);
     
-    const AString eventName = EventTypeEnum::toName(eventType);
-    
     if (blockStatus) {
         m_eventBlockingCounter[eventTypeIndex]++;
         CaretLogFiner("Blocking event "
-                      + eventName
+                      + EventTypeEnum::toName(eventType)
                       + " blocking counter is now "
                       + AString::number(m_eventBlockingCounter[eventTypeIndex]));
     }
@@ -570,13 +753,13 @@ EventManager::blockEvent(const EventTypeEnum::Enum eventType,
         if (m_eventBlockingCounter[eventTypeIndex] > 0) {
             m_eventBlockingCounter[eventTypeIndex]--;
             CaretLogFiner("Unblocking event "
-                          + eventName
+                          + EventTypeEnum::toName(eventType)
                           + " blocking counter is now "
                           + AString::number(m_eventBlockingCounter[eventTypeIndex]));
         }
         else {
             const AString message("Trying to unblock event "
-                                  + eventName
+                                  + EventTypeEnum::toName(eventType)
                                   + " but it is not blocked");
             CaretAssertMessage(0, message);
             CaretLogWarning(message);
@@ -23,6 +23,9 @@
 
 #include <stdint.h>
 
+#include <map>
+#include <vector>
+
 #include "CaretObject.h"
 
 #include "EventTypeEnum.h"
@@ -94,11 +97,47 @@ namespace caret {
         
         int64_t getEventIssuedCounter() const;
         
+        void setProfilingEnabled(const bool enabled);
+        
+        bool isProfilingEnabled() const;
+        
+        void resetProfiling();
+        
+        AString getProfilingReport() const;
+        
     private:
+        /**
+         * Time spent by one class of listener processing one type of event
+         */
+        struct ListenerProfile {
+            ListenerProfile() : m_callCount(0), m_totalSeconds(0.0) { }
+            int64_t m_callCount;
+            double m_totalSeconds;
+        };
+        
+        /**
+         * Profiling data for one type of event
+         */
+        struct EventProfile {
+            EventProfile() : m_sentCount(0), m_blockedCount(0), m_redundantCount(0), m_lastTopLevelSend(-1), m_totalSeconds(0.0) { }
+            int64_t m_sentCount;
+            int64_t m_blockedCount;
+            int64_t m_redundantCount;
+            int64_t m_lastTopLevelSend;
+            double m_totalSeconds;
+            std::map<AString, ListenerProfile> m_listenerProfiles;
+        };
+        
         EventManager();
         
         virtual ~EventManager();
         
+        AString getEventMessagePrefix(Event* event) const;
+        
+        void receiveEventProfiled(EventListenerInterface* listener,
+                                  Event* event,
+                                  EventProfile* profile);
+        
         /**
          * Define the container
          */
@@ -135,6 +174,18 @@ namespace caret {
         /** A counter for blocking events of each type */
         std::vector<int64_t> m_eventBlockingCounter;
         
+        /** Profiling of events is enabled */
+        bool m_profilingEnabled;
+        
+        /** Profiling data indexed by event type */
+        std::vector<EventProfile> m_eventProfiles;
+        
+        /** Nesting depth of events sent while processing another event */
+        int32_t m_sendDepth;
+        
+        /** Counter of events not sent from within another event's processing */
+        int64_t m_topLevelSendCounter;
+        
         static EventManager* s_singletonEventManager;
         
     };
@@ -606,6 +606,10 @@ main(int argc, char* argv[])
          */
         CommandOperationManager::deleteCommandOperationManager();
         
+        if (EventManager::get()->isProfilingEnabled()) {
+            cout << qPrintable(EventManager::get()->getProfilingReport()) << endl;
+        }
+        
         /*
         * Delete the session manager.
         */
@@ -634,6 +638,10 @@ void printHelp(const AString& progName)
     << "    -help" << endl
     << "        display this usage text" << endl
     << endl
+    << "    -event-profiling" << endl
+    << "        record the number of events sent and the time taken" << endl
+    << "        by each type of listener, and print a summary at exit" << endl
+    << endl
     << "    -graphics-size  <X Y>" << endl
     << "        Set the size of the graphics region." << endl
     << "        If this option is used you WILL NOT be able" << endl
@@ -712,6 +720,8 @@ void parseCommandLine(const AString& progName, ProgramParameters* myParams, Prog
                 } else if (thisParam == "-help") {
                     printHelp(progName);
                     exit(0);
+                } else if (thisParam == "-event-profiling") {
+                    EventManager::get()->setProfilingEnabled(true);
                 } else if (thisParam == "-logging") {
                     if (myParams->hasNext()) {
                         const AString logLevelName = myParams->nextString("Logging Level").toUpper();
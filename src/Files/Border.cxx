@@ -40,6 +40,7 @@
 #include "MathFunctions.h"
 #include "SurfaceFile.h"
 #include "SurfaceProjectedItem.h"
+#include "SurfaceProjectedItemArrays.h"
 #include "SurfaceProjectionBarycentric.h"
 #include "XmlWriter.h"
 
@@ -384,6 +385,7 @@ Border::removeAllPoints()
         delete m_points[i];
     }
     m_points.clear();
+    invalidatePointArrays();
     
     setModified();
 }
@@ -460,7 +462,10 @@ Border::getPoint(const int32_t indx) const
 }
 
 /**
- * Get the border point at the given index.
+ * Get the border point at the given index.  Discards the point arrays,
+ * since the caller may modify the point.  Don't keep the pointer to
+ * modify the point after a later getPointArrays(), the arrays would
+ * not see the change, call this again instead.
  * @param indx
  *   Index of desired border point.
  * @return
@@ -470,9 +475,49 @@ SurfaceProjectedItem*
 Border::getPoint(const int32_t indx)
 {
     CaretAssertVectorIndex(m_points, indx);
+    invalidatePointArrays();//caller may modify the point
     return m_points[indx];
 }
 
+/**
+ * @return Contiguous copies of all points in this border, for unprojecting
+ *   them in bulk.  Invalidated by anything that may modify the points,
+ *   including the non-const getPoint().
+ */
+const SurfaceProjectedItemArrays*
+Border::getPointArrays() const
+{
+    if (m_pointArrays == NULL)
+    {
+        CaretMutexLocker locked(&m_pointArraysMutex);
+        if (m_pointArrays == NULL)//test again after lock
+        {
+            CaretPointer<SurfaceProjectedItemArrays> newArrays(new SurfaceProjectedItemArrays());
+            const int32_t numPoints = getNumberOfPoints();
+            newArrays->reserve(numPoints);
+            for (int32_t i = 0; i < numPoints; ++i)
+            {
+                newArrays->append(m_points[i]);
+            }
+            m_pointArrays = newArrays;
+        }
+    }
+    return m_pointArrays;
+}
+
+/**
+ * Discard the bulk copy of the points.
+ */
+void
+Border::invalidatePointArrays()
+{
+    if (m_pointArrays != NULL)
+    {
+        CaretMutexLocker locked(&m_pointArraysMutex);
+        m_pointArrays.grabNew(NULL);
+    }
+}
+
 /**
  * Returns the index of the border point nearest
  * the given XYZ coordinate and within the 
@@ -512,13 +557,16 @@ Border::findPointIndexNearestXYZ(const SurfaceFile* surfaceFile,
     int32_t nearestIndex = -1;
     float nearestDistanceSQ = maximumDistance * maximumDistance;
     
-    float pointXYZ[3];
+    std::vector<float> pointXYZ;
+    std::vector<char> pointValid;
+    getPointArrays()->getProjectedPositions(*surfaceFile,
+                                            pointXYZ,
+                                            pointValid,
+                                            true);
     for (int32_t i = 0; i < numPoints; i++) {
-        if (m_points[i]->getProjectedPosition(*surfaceFile, 
-                                              pointXYZ, 
-                                                  true)) {
+        if (pointValid[i]) {
             const float distSQ = MathFunctions::distanceSquared3D(xyz, 
-                                                                  pointXYZ);
+                                                                  &pointXYZ[i * 3]);
             if (distSQ <= nearestDistanceSQ) {
                 nearestDistanceSQ = distSQ;
                 nearestIndex = i;
@@ -564,6 +612,7 @@ Border::addPoint(SurfaceProjectedItem* point)
         }
     }
     m_points.push_back(point);
+    invalidatePointArrays();
     setModified();
 }
 
@@ -708,6 +757,7 @@ Border::removePoint(const int32_t indx)
     CaretAssertVectorIndex(m_points, indx);
     delete m_points[indx];
     m_points.erase(m_points.begin() + indx);
+    invalidatePointArrays();
     setModified();
 }
 
@@ -743,6 +793,7 @@ Border::reverse()
 {
     std::reverse(m_points.begin(),
                  m_points.end());
+    invalidatePointArrays();
     setModified();
 }
 
@@ -1763,6 +1814,7 @@ void Border::readXML3(QXmlStreamReader& xml)
     if (!haveVertices || !haveWeights) throw DataFileException("BorderPart missing required Vertices or Weights element");
     if (vertices.size() != weights.size()) throw DataFileException("Vertices and Weights don't contain the same number of elements");
     int numPoints = (int)vertices.size() / 3;
+    m_points.reserve(numPoints);
     for (int i = 0; i < numPoints; ++i)
     {
         int i3 = i * 3;
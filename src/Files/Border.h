@@ -22,7 +22,9 @@
 /*LICENSE_END*/
 
 #include "BorderException.h"
+#include "CaretMutex.h"
 #include "CaretObjectTracksModification.h"
+#include "CaretPointer.h"
 #include "StructureEnum.h"
 #include "XmlException.h"
 
@@ -34,6 +36,7 @@ namespace caret {
     class GroupAndNameHierarchyItem;
     class SurfaceFile;
     class SurfaceProjectedItem;
+    class SurfaceProjectedItemArrays;
     class XmlWriter;
     
     class Border : public CaretObjectTracksModification {
@@ -77,6 +80,8 @@ namespace caret {
         
         SurfaceProjectedItem* getPoint(const int32_t indx);
         
+        const SurfaceProjectedItemArrays* getPointArrays() const;
+        
         int32_t findPointIndexNearestXYZ(const SurfaceFile* surfaceFile,
                                         const float xyz[3],
                                         const float maximumDistance,
@@ -172,12 +177,19 @@ namespace caret {
         
         void saveBorderForUndoEditing();
         
+        void invalidatePointArrays();
+        
         AString m_name;
         
         AString m_className;
         
         std::vector<SurfaceProjectedItem*> m_points;
         
+        /** contiguous copy of the points for bulk unprojection, rebuilt after the points may have changed */
+        mutable CaretPointer<SurfaceProjectedItemArrays> m_pointArrays;
+        
+        mutable CaretMutex m_pointArraysMutex;
+        
         bool m_closed;
         
         /** RGBA color component assigned to border's class name */
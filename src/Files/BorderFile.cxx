@@ -50,6 +50,7 @@
 #include "MathFunctions.h"
 #include "SurfaceFile.h"
 #include "SurfaceProjectedItem.h"
+#include "SurfaceProjectedItemArrays.h"
 #include "SurfaceProjectionBarycentric.h"
 #include "TextFile.h"
 #include "XmlAttributes.h"
@@ -629,6 +630,7 @@ BorderFile::findAllBordersWithEndPointNearSegmentFirstPoint(const DisplayGroupEn
                                                   border) == false) {
             continue;
         }
+        const Border* constBorder = border;//non-const getPoint() invalidates the border's point arrays
         if (border->getStructure() == surfaceFile->getStructure()) {
             /*
              * Test first endpoint
@@ -638,9 +640,9 @@ BorderFile::findAllBordersWithEndPointNearSegmentFirstPoint(const DisplayGroupEn
             int32_t neartestPointIndex = -1;
             if (numPoints > 0) {
                 float pointXYZ[3];
-                if (border->getPoint(0)->getProjectedPosition(*surfaceFile,
-                                                              pointXYZ,
-                                                              false)) {
+                if (constBorder->getPoint(0)->getProjectedPosition(*surfaceFile,
+                                                                   pointXYZ,
+                                                                   false)) {
                     nearestPointDistanceSquared = MathFunctions::distanceSquared3D(pointXYZ,
                                                                             segFirstXYZ);
                     neartestPointIndex = 0;
@@ -653,9 +655,9 @@ BorderFile::findAllBordersWithEndPointNearSegmentFirstPoint(const DisplayGroupEn
             if (numPoints > 1) {
                 const int32_t lastPointIndex = numPoints - 1;
                 float pointXYZ[3];
-                if (border->getPoint(lastPointIndex)->getProjectedPosition(*surfaceFile,
-                                                                           pointXYZ,
-                                                                           false)) {
+                if (constBorder->getPoint(lastPointIndex)->getProjectedPosition(*surfaceFile,
+                                                                                pointXYZ,
+                                                                                false)) {
                     const float dist2 = MathFunctions::distanceSquared3D(pointXYZ,
                                                                          segFirstXYZ);
                     if (nearestPointDistanceSquared >= 0.0) {
@@ -732,6 +734,8 @@ BorderFile::findAllBordersWithAnyPointNearSegmentFirstPoint(const DisplayGroupEn
     
     BorderFile* nonConstBorderFile = const_cast<BorderFile*>(this);
     
+    std::vector<float> pointXYZ;
+    std::vector<char> pointValid;
     const int32_t numBorders = getNumberOfBorders();
     for (int32_t borderIndex = 0; borderIndex < numBorders; borderIndex++) {
         Border* border = m_borders[borderIndex];
@@ -742,17 +746,19 @@ BorderFile::findAllBordersWithAnyPointNearSegmentFirstPoint(const DisplayGroupEn
         }
         if (border->getStructure() == surfaceFile->getStructure()) {
             /*
-             * Test all points
+             * Test all points, unprojected in bulk
              */
+            const Border* constBorder = border;
+            constBorder->getPointArrays()->getProjectedPositions(*surfaceFile,
+                                                                 pointXYZ,
+                                                                 pointValid,
+                                                                 false);
             float nearestPointDistanceSquared = std::numeric_limits<float>::max();
             int32_t nearestPointIndex = -1;
             const int32_t numPoints = border->getNumberOfPoints();
             for (int32_t pointIndex = 0; pointIndex < numPoints; pointIndex++) {
-                float pointXYZ[3];
-                if (border->getPoint(pointIndex)->getProjectedPosition(*surfaceFile,
-                                                              pointXYZ,
-                                                              false)) {
-                    const float distSQ = MathFunctions::distanceSquared3D(pointXYZ,
+                if (pointValid[pointIndex]) {
+                    const float distSQ = MathFunctions::distanceSquared3D(&pointXYZ[pointIndex * 3],
                                                                           segFirstXYZ);
                     if (distSQ < nearestPointDistanceSquared) {
                         nearestPointDistanceSquared = distSQ;
@@ -935,13 +941,12 @@ BorderFile::findBordersInsideRegionOfInterest(const DisplayGroupEnum::Enum displ
              * so first get all UNIQUE node indices that are used by the border points
              */
             std::set<int32_t> borderNodeIndicesInsideROI;
+            const Border* constBorder = border;
+            const SurfaceProjectedItemArrays* pointArrays = constBorder->getPointArrays();
             const int32_t numberOfPoints = border->getNumberOfPoints();
             for (int32_t iPoint = 0; iPoint < numberOfPoints; iPoint++) {
-                const SurfaceProjectedItem* spi = border->getPoint(iPoint);
-                CaretAssert(spi);
-                const SurfaceProjectionBarycentric* bary = spi->getBarycentricProjection();
-                if (bary != NULL) {
-                    const int32_t* pointNodes = bary->getTriangleNodes();
+                const int32_t* pointNodes = pointArrays->getBarycentricTriangleNodes(iPoint);
+                if (pointNodes != NULL) {
                     borderNodeIndicesInsideROI.insert(pointNodes[0]);
                     borderNodeIndicesInsideROI.insert(pointNodes[1]);
                     borderNodeIndicesInsideROI.insert(pointNodes[2]);
@@ -27,13 +27,13 @@
 #include "CiftiFile.h"
 #include "CiftiMappableDataFile.h"
 #include "CaretLogger.h"
+#include "CaretPointLocator.h"
 #include "DataFileException.h"
 #include "Fiber.h"
 #include "FiberOrientation.h"
 #include "GiftiMetaData.h"
 #include "MathFunctions.h"
 
-#include <limits>
 
 using namespace caret;
 
@@ -101,6 +101,34 @@ CiftiFiberOrientationFile::clearPrivate()
     }
     
     m_fiberOrientations.clear();
+    m_fiberOrientationXYZ.clear();
+    m_pointLocator.grabNew(NULL);
+}
+
+/**
+ * Pack the fiber orientation coordinates and build the point locator
+ * used for nearest coordinate and distance queries.  Must be called
+ * after the fiber orientations have been created.
+ */
+void
+CiftiFiberOrientationFile::createPointLocator()
+{
+    const int64_t numFiberOrientations = getNumberOfFiberOrientations();
+    m_fiberOrientationXYZ.resize(numFiberOrientations * 3);
+    for (int64_t i = 0; i < numFiberOrientations; i++) {
+        const int64_t i3 = i * 3;
+        m_fiberOrientationXYZ[i3]     = m_fiberOrientations[i]->m_xyz[0];
+        m_fiberOrientationXYZ[i3 + 1] = m_fiberOrientations[i]->m_xyz[1];
+        m_fiberOrientationXYZ[i3 + 2] = m_fiberOrientations[i]->m_xyz[2];
+    }
+    
+    if (numFiberOrientations > 0) {
+        m_pointLocator.grabNew(new CaretPointLocator(&m_fiberOrientationXYZ[0],
+                                                     numFiberOrientations));
+    }
+    else {
+        m_pointLocator.grabNew(NULL);
+    }
 }
 
 
@@ -267,6 +295,8 @@ CiftiFiberOrientationFile::initializeWithTestData()
         
         m_fiberOrientations.push_back(fiberOrientation);
     }
+    
+    createPointLocator();
 }
 
 /**
@@ -304,25 +334,55 @@ FiberOrientation*
 CiftiFiberOrientationFile::getFiberOrientationNearestCoordinate(const float xyz[3],
                                                                    const float maximumDistance) const
 {
-    FiberOrientation* nearestFiberOrientation = NULL;
-    float nearestDistance = std::numeric_limits<float>::max();
+    if (m_pointLocator == NULL) {
+        return NULL;
+    }
     
-    const int64_t numFiberOrientations = getNumberOfFiberOrientations();
-    for (int64_t i = 0; i < numFiberOrientations; i++) {
-        const float distance = MathFunctions::distanceSquared3D(xyz,
-                                                                m_fiberOrientations[i]->m_xyz);
-        if (distance < nearestDistance) {
-            if (maximumDistance > 0.0) {
-                if (distance > maximumDistance) {
-                    continue;
-                }
-            }
-            nearestDistance = distance;
-            nearestFiberOrientation = m_fiberOrientations[i];
-        }
+    int32_t nearestIndex = -1;
+    if (maximumDistance > 0.0) {
+        nearestIndex = m_pointLocator->closestPointLimited(xyz,
+                                                           maximumDistance);
+    }
+    else {
+        nearestIndex = m_pointLocator->closestPoint(xyz);
+    }
+    
+    if (nearestIndex < 0) {
+        return NULL;
+    }
+    CaretAssertVectorIndex(m_fiberOrientations, nearestIndex);
+    return m_fiberOrientations[nearestIndex];
+}
+
+/**
+ * Get the indices of all fiber orientations within the given distance
+ * of a coordinate.
+ *
+ * @param xyz
+ *     The coordinate.
+ * @param maximumDistance
+ *     The maximum distance.
+ * @param indicesOut
+ *     Output containing indices of fiber orientations, in ascending order.
+ */
+void
+CiftiFiberOrientationFile::getFiberOrientationIndicesWithinDistance(const float xyz[3],
+                                                                      const float maximumDistance,
+                                                                      std::vector<int64_t>& indicesOut) const
+{
+    indicesOut.clear();
+    if (m_pointLocator == NULL) {
+        return;
     }
     
-    return nearestFiberOrientation;
+    const std::set<LocatorInfo> inRange = m_pointLocator->pointsInRange(xyz,
+                                                                        maximumDistance);
+    indicesOut.reserve(inRange.size());
+    for (std::set<LocatorInfo>::const_iterator iter = inRange.begin();
+         iter != inRange.end();
+         iter++) {
+        indicesOut.push_back(iter->index);
+    }
 }
 
 
@@ -477,6 +537,8 @@ CiftiFiberOrientationFile::readFile(const AString& filename)
             }
         }
         
+        createPointLocator();
+        
         const CiftiXML& ciftiXML = ciftiFile.getCiftiXML();
         m_ciftiXML = new CiftiXML(ciftiXML);
         VolumeSpace::OrientTypes orient[3];
@@ -23,10 +23,12 @@
 
 #include "BrainConstants.h"
 #include "CaretDataFile.h"
+#include "CaretPointer.h"
 #include "DisplayGroupEnum.h"
 
 namespace caret {
 
+    class CaretPointLocator;
     class CiftiXML;
     class FiberOrientation;
     
@@ -48,6 +50,10 @@ namespace caret {
         FiberOrientation* getFiberOrientationNearestCoordinate(const float xyz[3],
                                                                const float maximumDistance) const;
         
+        void getFiberOrientationIndicesWithinDistance(const float xyz[3],
+                                                      const float maximumDistance,
+                                                      std::vector<int64_t>& indicesOut) const;
+        
         void getVolumeSpacing(float volumeSpacingOut[3]) const;
         
         void setDisplayed(const DisplayGroupEnum::Enum displayGroup,
@@ -90,12 +96,20 @@ namespace caret {
 
         void clearPrivate();
         
+        void createPointLocator();
+        
         CiftiXML* m_ciftiXML;
         
         GiftiMetaData* m_metadata;
 
         std::vector<FiberOrientation*> m_fiberOrientations;
         
+        /** XYZ of each fiber orientation packed contiguously (same order as m_fiberOrientations) */
+        std::vector<float> m_fiberOrientationXYZ;
+        
+        /** Spatial index of fiber orientation XYZ, built once after the file is read */
+        CaretPointer<CaretPointLocator> m_pointLocator;
+        
         /** Display status in display group */
         bool m_displayStatusInDisplayGroup[DisplayGroupEnum::NUMBER_OF_GROUPS];
         
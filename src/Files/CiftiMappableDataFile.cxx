@@ -34,6 +34,7 @@
 #include "CiftiFile.h"
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 #include "CiftiParcelLabelFile.h"
+#include "CaretHttpManager.h"
 #include "CaretTemporaryFile.h"
 #include "CiftiXML.h"
 #include "DataFileContentInformation.h"
@@ -583,26 +584,69 @@ CiftiMappableDataFile::readFile(const AString& ciftiMapFileName)
                                                 &isValidFileExtension);
             
             if (isValidFileExtension) {
-                switch (m_fileMapDataType) {
-                    case FILE_MAP_DATA_TYPE_INVALID:
-                        break;
-                    case FILE_MAP_DATA_TYPE_MATRIX:
-                        throw DataFileException(ciftiMapFileName
-                                                + " of type "
-                                                + DataFileTypeEnum::toGuiName(getDataFileType())
-                                                + " cannot be read over the network.  The file must be"
-                                                " accessed by reading individual rows and/or columns"
-                                                " and this cannot be performed over a network.");
-                        break;
-                    case FILE_MAP_DATA_TYPE_MULTI_MAP:
-                        break;
+                /*
+                 * Uncompressed files are read with HTTP byte range
+                 * requests, so only the parts that are used get
+                 * downloaded.  Compressed files can't be read that
+                 * way, so download the entire file.
+                 */
+                if (ciftiMapFileName.endsWith(".gz")) {
+                    switch (m_fileMapDataType) {
+                        case FILE_MAP_DATA_TYPE_INVALID:
+                            break;
+                        case FILE_MAP_DATA_TYPE_MATRIX:
+                            throw DataFileException(ciftiMapFileName
+                                                    + " of type "
+                                                    + DataFileTypeEnum::toGuiName(getDataFileType())
+                                                    + " cannot be read over the network when compressed.  The file must be"
+                                                    " accessed by reading individual rows and/or columns.");
+                            break;
+                        case FILE_MAP_DATA_TYPE_MULTI_MAP:
+                            break;
+                    }
+                    
+                    CaretTemporaryFile tempFile;
+                    tempFile.readFile(ciftiMapFileName);
+                    m_ciftiFile.grabNew(new CiftiFile());
+                    m_ciftiFile->openFile(tempFile.getFileName());
+                    m_ciftiFile->convertToInMemory();
+                }
+                else {
+                    AString username = "";
+                    AString password = "";
+                    AString filenameToOpen = "";
+                    FileInformation fileInfo(ciftiMapFileName);
+                    fileInfo.getRemoteUrlUsernameAndPassword(filenameToOpen,
+                                                             username,
+                                                             password);
+                    if (CaretDataFile::getFileReadingUsername().isEmpty() == false) {
+                        username = CaretDataFile::getFileReadingUsername();
+                        password = CaretDataFile::getFileReadingPassword();
+                    }
+                    if (username.isEmpty() == false) {
+                        CaretHttpManager::setAuthentication(filenameToOpen,
+                                                            username,
+                                                            password);
+                    }
+                    
+                    m_ciftiFile.grabNew(new CiftiFile());
+                    m_ciftiFile->openFile(filenameToOpen);
+                    switch (m_fileMapDataType) {
+                        case FILE_MAP_DATA_TYPE_INVALID:
+                            break;
+                        case FILE_MAP_DATA_TYPE_MATRIX:
+                            break;
+                        case FILE_MAP_DATA_TYPE_MULTI_MAP:
+                            switch (m_fileDataReadingType) {
+                                case FILE_READ_DATA_ALL:
+                                    m_ciftiFile->convertToInMemory();
+                                    break;
+                                case FILE_READ_DATA_AS_NEEDED:
+                                    break;
+                            }
+                            break;
+                    }
                 }
-                
-                CaretTemporaryFile tempFile;
-                tempFile.readFile(ciftiMapFileName);
-                m_ciftiFile.grabNew(new CiftiFile());
-                m_ciftiFile->openFile(tempFile.getFileName());
-                m_ciftiFile->convertToInMemory();
             }
             else {
                 m_ciftiFile.grabNew(new CiftiFile());
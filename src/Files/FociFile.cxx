@@ -41,6 +41,7 @@
 #include "GiftiLabelTable.h"
 #include "GiftiMetaData.h"
 #include "SurfaceProjectedItem.h"
+#include "SurfaceProjectedItemArrays.h"
 #include "XmlAttributes.h"
 #include "XmlSaxParser.h"
 #include "XmlWriter.h"
@@ -144,6 +145,7 @@ FociFile::copyHelperFociFile(const FociFile& ff)
     for (int32_t i = 0; i < numFoci; i++) {
         m_foci.push_back(new Focus(*ff.getFocus(i)));
     }
+    invalidateProjectionArrays();
     
     m_forceUpdateOfGroupAndNameHierarchy = true;
     
@@ -213,6 +215,7 @@ FociFile::clear()
         delete m_foci[i];
     }
     m_foci.clear();
+    invalidateProjectionArrays();
 }
 
 /**
@@ -225,7 +228,10 @@ FociFile::getNumberOfFoci() const
 }
 
 /**
- * Get the focus at the given index.
+ * Get the focus at the given index.  Discards the projection arrays,
+ * since the caller may modify the focus.  Don't keep the pointer to
+ * modify the focus after a later getProjectionArrays(), the arrays
+ * would not see the change, call this again instead.
  * @param indx
  *   Index of the focus.
  * @return
@@ -235,6 +241,7 @@ Focus*
 FociFile::getFocus(const int32_t indx)
 {
     CaretAssertVectorIndex(m_foci, indx);
+    invalidateProjectionArrays();//caller may modify the focus
     return m_foci[indx];
 }
 
@@ -252,6 +259,55 @@ FociFile::getFocus(const int32_t indx) const
     return m_foci[indx];
 }
 
+/**
+ * Get the projections of all foci as contiguous arrays, for unprojecting
+ * them in bulk.  The arrays are kept until anything that may modify the
+ * foci is called, including the non-const getFocus().
+ * @param focusOffsetsOut
+ *   Projections of focus i are at [focusOffsetsOut[i], focusOffsetsOut[i + 1])
+ *   in the arrays.
+ * @return
+ *   Projections of every focus, in order.  Shared, so it stays valid if
+ *   the file discards its copy while the caller is using it.
+ */
+CaretPointer<const SurfaceProjectedItemArrays>
+FociFile::getProjectionArrays(std::vector<int32_t>& focusOffsetsOut) const
+{
+    CaretMutexLocker locked(&m_projectionArraysMutex);
+    if (m_projectionArrays == NULL) {
+        const int32_t numFoci = getNumberOfFoci();
+        CaretPointer<SurfaceProjectedItemArrays> newArrays(new SurfaceProjectedItemArrays());
+        m_projectionOffsets.resize(numFoci + 1);
+        int32_t numProjections = 0;
+        for (int32_t i = 0; i < numFoci; i++) {
+            m_projectionOffsets[i] = numProjections;
+            numProjections += m_foci[i]->getNumberOfProjections();
+        }
+        m_projectionOffsets[numFoci] = numProjections;
+        newArrays->reserve(numProjections);
+        for (int32_t i = 0; i < numFoci; i++) {
+            const Focus* focus = m_foci[i];
+            const int32_t numFocusProjections = focus->getNumberOfProjections();
+            for (int32_t k = 0; k < numFocusProjections; k++) {
+                newArrays->append(focus->getProjection(k));
+            }
+        }
+        m_projectionArrays = newArrays;
+    }
+    focusOffsetsOut = m_projectionOffsets;
+    return m_projectionArrays;
+}
+
+/**
+ * Discard the bulk copy of the projections.
+ */
+void
+FociFile::invalidateProjectionArrays()
+{
+    CaretMutexLocker locked(&m_projectionArraysMutex);
+    m_projectionArrays.grabNew(NULL);
+}
+
 /**
  * Add a focus.  NOTE: This focus file
  * takes ownership of the 'focus' and 
@@ -267,6 +323,7 @@ void
 FociFile::addFocus(Focus* focus)
 {
     m_foci.push_back(focus);
+    invalidateProjectionArrays();
     const AString name = focus->getName();
     if (name.isEmpty() == false) {
         const int32_t nameColorKey = m_nameColorTable->getLabelKeyFromName(name);
@@ -297,6 +354,7 @@ FociFile::removeFocus(const int32_t indx)
     Focus* focus = getFocus(indx);
     m_foci.erase(m_foci.begin() + indx);
     delete focus;
+    invalidateProjectionArrays();
     m_forceUpdateOfGroupAndNameHierarchy = true;
     setModified();
 }
@@ -22,6 +22,8 @@
 /*LICENSE_END*/
 
 #include "CaretDataFile.h"
+#include "CaretMutex.h"
+#include "CaretPointer.h"
 
 namespace caret {
 
@@ -29,6 +31,7 @@ namespace caret {
     class Focus;
     class GiftiLabelTable;
     class GiftiMetaData;
+    class SurfaceProjectedItemArrays;
     
     class FociFile : public CaretDataFile {
         
@@ -67,6 +70,8 @@ namespace caret {
         
         const Focus* getFocus(const int32_t indx) const;
         
+        CaretPointer<const SurfaceProjectedItemArrays> getProjectionArrays(std::vector<int32_t>& focusOffsetsOut) const;
+        
         void removeFocus(const int32_t indx);
         
         void removeFocus(Focus* focus);
@@ -112,6 +117,8 @@ namespace caret {
         
         void initializeFociFile();
         
+        void invalidateProjectionArrays();
+        
         GiftiMetaData* m_metadata;
         
         std::vector<Focus*> m_foci;
@@ -128,6 +135,14 @@ namespace caret {
         /** force an update of the class and name hierarchy */
         bool m_forceUpdateOfGroupAndNameHierarchy;
         
+        /** contiguous copy of all projections for bulk unprojection, rebuilt after the foci may have changed */
+        mutable CaretPointer<SurfaceProjectedItemArrays> m_projectionArrays;
+        
+        /** projections of focus i start at m_projectionOffsets[i] in m_projectionArrays */
+        mutable std::vector<int32_t> m_projectionOffsets;
+        
+        mutable CaretMutex m_projectionArraysMutex;
+        
         /** Version of this FociFile */
         static const int32_t s_fociFileVersion;
         
@@ -23,8 +23,10 @@
 #include "CaretAssert.h"
 #include "CaretHeap.h"
 #include "CaretMutex.h"
+#include "CaretOMP.h"
 #include "FastStatistics.h"
 #include "SurfaceFile.h"
+#include "SurfaceHelperCache.h"
 #include "TopologyHelper.h"
 
 #include <cmath>
@@ -34,6 +36,13 @@
 using namespace caret;
 using namespace std;
 
+GeodesicHelperBase::GeodesicHelperBase()
+{//only for readCacheFile, members are filled in there
+    numNodes = 0;
+    m_avgNodeSpacing = 1.0f;
+    m_corrAreaSmallestFactor = 1.0f;
+}
+
 GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float* correctedAreas)
 {
     CaretPointer<TopologyHelperBase> topoBase(new TopologyHelperBase(surfaceIn));
@@ -55,55 +64,71 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
             sqrtVertAreas[i] = sqrt(sqrtVertAreas[i]);
         }
     }
-    Vector3D tempvec;
-    float tempf, abmag, efmag, cdmag;
-    double nodeSpacingAccum = 0.0f;//since we may be using corrected areas, find average node spacing manually
-    int32_t numEdges = 0;
-    bool firstCorrArea = true;//if all corrected vertex areas are significantly larger than 1, we can make A* faster by multiplying all euclidean distances by it, so find the actual smallest
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        nodeCoords[i] = surfaceIn->getCoordinate(i);
+    }
+    vector<double> nodeSpacingSums(numNodes, 0.0);//per-node results, summed serially afterwards so the parallel loop is deterministic
+    vector<int32_t> nodeEdgeCounts(numNodes, 0);
+    vector<float> nodeSmallestFactor(numNodes, -1.0f);//negative means no neighbors
+#pragma omp CARET_PARFOR schedule(dynamic, 1024)
     for (int32_t i = 0; i < numNodes; ++i)
     {//get neighbors
         vector<int32_t>& neighbors = nodeNeighbors[i];
         neighbors = topoHelpIn.getNodeNeighbors(i);
-        nodeCoords[i] = surfaceIn->getCoordinate(i);
         const Vector3D baseCoord = nodeCoords[i];
         int numNeigh = (int)neighbors.size();
         distances[i].resize(numNeigh);
         for (int32_t j = 0; j < numNeigh; ++j)
         {
-            Vector3D neighCoord = surfaceIn->getCoordinate(neighbors[j]);
-            tempvec = baseCoord - neighCoord;
+            Vector3D tempvec = baseCoord - nodeCoords[neighbors[j]];
             distances[i][j] = tempvec.length();//precompute for speed in other calls
             if (correctedAreas != NULL)
             {
                 float correctionFactor = (sqrtCorrAreas[i] + sqrtCorrAreas[neighbors[j]]) / (sqrtVertAreas[i] + sqrtVertAreas[neighbors[j]]);
-                if (firstCorrArea || correctionFactor < m_corrAreaSmallestFactor)
+                if (nodeSmallestFactor[i] < 0.0f || correctionFactor < nodeSmallestFactor[i])
                 {
-                    m_corrAreaSmallestFactor = correctionFactor;//if this is zero anywhere, it just means that the euclidean part of the heuristic must be ignored (worst case, it does dijkstra)
-                    firstCorrArea = false;
+                    nodeSmallestFactor[i] = correctionFactor;
                 }
                 distances[i][j] *= correctionFactor;
             }
             if (i < neighbors[j])
             {
-                nodeSpacingAccum += distances[i][j];
-                ++numEdges;
+                nodeSpacingSums[i] += distances[i][j];
+                ++nodeEdgeCounts[i];
             }
         }//so few floating point operations, this should turn out symmetric
     }
+    double nodeSpacingAccum = 0.0;//since we may be using corrected areas, find average node spacing manually
+    int32_t numEdges = 0;
+    bool firstCorrArea = true;//if all corrected vertex areas are significantly larger than 1, we can make A* faster by multiplying all euclidean distances by it, so find the actual smallest
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        nodeSpacingAccum += nodeSpacingSums[i];
+        numEdges += nodeEdgeCounts[i];
+        if (nodeSmallestFactor[i] >= 0.0f && (firstCorrArea || nodeSmallestFactor[i] < m_corrAreaSmallestFactor))
+        {
+            m_corrAreaSmallestFactor = nodeSmallestFactor[i];//if this is zero anywhere, it just means that the euclidean part of the heuristic must be ignored (worst case, it does dijkstra)
+            firstCorrArea = false;
+        }
+    }
     m_avgNodeSpacing = nodeSpacingAccum / numEdges;
-    std::vector<int32_t> tempneigh2;
-    std::vector<float> tempdist2;
     nodeNeighbors2.resize(numNodes);
     distances2.resize(numNodes);
     neighbors2PathInfo.resize(numNodes);
     const vector<TopologyEdgeInfo>& myEdgeInfo = topoHelpIn.getEdgeInfo();
     CaretAssert(numEdges == (int32_t)myEdgeInfo.size());//SurfaceFile checks for triangles with duplicated nodes
+    vector<CrawlInfo> edgeCrawl(numEdges);//unfold each edge in parallel, then record them serially in edge order, so the neighbor order doesn't depend on threading
+    vector<float> edgeDist(numEdges, -1.0f);//negative means no valid path across this edge
+    vector<float> edgeCorrFactor(numEdges, -1.0f);
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
     for (int i = 0; i < numEdges; ++i)
     {
         if (myEdgeInfo[i].numTiles < 2)
         {
             continue;//skip edges that have only one triangle
         }
+        float tempf, abmag, efmag, cdmag;
         int32_t neigh1Node, neigh2Node, baseNode, farNode;
         neigh1Node = myEdgeInfo[i].node1;
         neigh2Node = myEdgeInfo[i].node2;
@@ -113,22 +138,15 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
         Vector3D neigh2Coord = nodeCoords[neigh2Node];
         Vector3D baseCoord = nodeCoords[baseNode];
         Vector3D farCoord = nodeCoords[farNode];
-        CrawlInfo tempInfo;
+        CrawlInfo& tempInfo = edgeCrawl[i];
         tempInfo.edgeNodes[0] = neigh1Node;
         tempInfo.edgeNodes[1] = neigh2Node;
-        const int32_t num_reserve = 8;//uses 8 in case it is used on a mesh with haphazard topology
-        nodeNeighbors2[baseNode].reserve(num_reserve);//reserve should be fast if capacity is already num_reserve, and better than reallocating at 2 and 4, if vector allocation is naive doubling
-        nodeNeighbors2[farNode].reserve(num_reserve);//in the extremely rare case of a node with more than num_reserve neighbors, a second allocation plus copy isn't much of a cost
-        distances2[baseNode].reserve(num_reserve);
-        distances2[farNode].reserve(num_reserve);
-        neighbors2PathInfo[baseNode].reserve(num_reserve);
-        neighbors2PathInfo[farNode].reserve(num_reserve);
         Vector3D abhat = (neigh2Coord - neigh1Coord).normal(&abmag);//a is neigh1, b is neigh2, b - a = (vector)ab
         Vector3D ac = farCoord - neigh1Coord;//c is farnode, c - a = (vector)ac
         Vector3D ad = abhat * abhat.dot(ac);//d is the point on the shared edge that farnode (c) is closest to
         Vector3D d = neigh1Coord + ad;//this way we can "unfold" the triangles by projecting the distance of cd, from point d, along the unit vector of the base node to closest point on shared edge
         Vector3D ea = neigh1Coord - baseCoord;//e is the base node, a - e = (vector)ea
-        tempvec = abhat * abhat.dot(ea);//find vector fa, f being the point on shared edge closest to e, the base node
+        Vector3D tempvec = abhat * abhat.dot(ea);//find vector fa, f being the point on shared edge closest to e, the base node
         Vector3D efhat = (ea - tempvec).normal(&efmag);//and subtract it to obtain only the perpendicular, normalize to get unit vector
         cdmag = (d - farCoord).length();//get the length from shared edge to far point
         Vector3D g = d + efhat * cdmag;//get point g, the unfolded position of farnode
@@ -144,14 +162,31 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
         if (correctedAreas != NULL)//apply area correction approximation
         {
             float correctionFactor = (sqrtCorrAreas[baseNode] + sqrtCorrAreas[farNode]) / (sqrtVertAreas[baseNode] + sqrtVertAreas[farNode]);
-            if (correctionFactor < m_corrAreaSmallestFactor)
-            {
-                m_corrAreaSmallestFactor = correctionFactor;//if this is zero anywhere, it just means that the euclidean part of the heuristic must be ignored (worst case, it does dijkstra)
-            }
+            edgeCorrFactor[i] = correctionFactor;
             tempf *= correctionFactor;
             tempInfo.pieceDists[1] *= correctionFactor;
         }//for now, assume it only depends on the expansion of the endpoints, and affects each part equally
         tempInfo.pieceDists[0] = tempf - tempInfo.pieceDists[1];
+        edgeDist[i] = tempf;
+    }
+    const int32_t num_reserve = 8;//uses 8 in case it is used on a mesh with haphazard topology
+    for (int i = 0; i < numEdges; ++i)
+    {
+        if (edgeDist[i] < 0.0f) continue;
+        if (edgeCorrFactor[i] >= 0.0f && edgeCorrFactor[i] < m_corrAreaSmallestFactor)
+        {
+            m_corrAreaSmallestFactor = edgeCorrFactor[i];
+        }
+        int32_t baseNode = myEdgeInfo[i].tiles[0].node3;
+        int32_t farNode = myEdgeInfo[i].tiles[1].node3;
+        CrawlInfo tempInfo = edgeCrawl[i];
+        float tempf = edgeDist[i];
+        nodeNeighbors2[baseNode].reserve(num_reserve);//reserve should be fast if capacity is already num_reserve, and better than reallocating at 2 and 4, if vector allocation is naive doubling
+        nodeNeighbors2[farNode].reserve(num_reserve);//in the extremely rare case of a node with more than num_reserve neighbors, a second allocation plus copy isn't much of a cost
+        distances2[baseNode].reserve(num_reserve);
+        distances2[farNode].reserve(num_reserve);
+        neighbors2PathInfo[baseNode].reserve(num_reserve);
+        neighbors2PathInfo[farNode].reserve(num_reserve);
         nodeNeighbors2[farNode].push_back(baseNode);//record it at both ends, because we are looping through edges
         distances2[farNode].push_back(tempf);
         neighbors2PathInfo[farNode].push_back(tempInfo);
@@ -165,6 +200,76 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
     }
 }
 
+void GeodesicHelperBase::writeCacheFile(const AString& filename, const uint64_t& geometryHash) const
+{
+    CaretBinaryFile outFile(filename, CaretBinaryFile::WRITE_TRUNCATE);
+    int32_t numTris = 0;//the hash covers the triangles, only the node count is needed to sanity check
+    SurfaceHelperCache::writeHeader(outFile, "GEOD", geometryHash, numNodes, numTris);
+    int32_t crawlSize = (int32_t)sizeof(CrawlInfo);
+    outFile.write(&crawlSize, sizeof(int32_t));
+    float floatInfo[2] = { m_avgNodeSpacing, m_corrAreaSmallestFactor };
+    outFile.write(floatInfo, sizeof(floatInfo));
+    SurfaceHelperCache::writeVector(outFile, nodeCoords);
+    SurfaceHelperCache::writeNestedVector(outFile, nodeNeighbors);
+    SurfaceHelperCache::writeNestedVector(outFile, distances);
+    SurfaceHelperCache::writeNestedVector(outFile, nodeNeighbors2);
+    SurfaceHelperCache::writeNestedVector(outFile, distances2);
+    SurfaceHelperCache::writeNestedVector(outFile, neighbors2PathInfo);
+    outFile.close();
+}
+
+GeodesicHelperBase* GeodesicHelperBase::readCacheFile(const AString& filename, const SurfaceFile* surfIn, const uint64_t& geometryHash)
+{
+    CaretBinaryFile inFile(filename, CaretBinaryFile::READ);
+    int32_t numNodes = surfIn->getNumberOfNodes(), numTris = 0;
+    if (!SurfaceHelperCache::readHeader(inFile, "GEOD", geometryHash, numNodes, numTris)) return NULL;
+    int32_t crawlSize;
+    inFile.read(&crawlSize, sizeof(int32_t));
+    if (crawlSize != (int32_t)sizeof(CrawlInfo)) return NULL;
+    float floatInfo[2];
+    inFile.read(floatInfo, sizeof(floatInfo));
+    CaretPointer<GeodesicHelperBase> ret(new GeodesicHelperBase());//in case reading throws
+    ret->numNodes = numNodes;
+    ret->m_avgNodeSpacing = floatInfo[0];
+    ret->m_corrAreaSmallestFactor = floatInfo[1];
+    int64_t maxEntries = 6 * (int64_t)surfIn->getNumberOfTriangles();//neighbor lists are at most 2 entries per triangle per vertex, second neighbors at most 2 per edge
+    SurfaceHelperCache::readVector(inFile, ret->nodeCoords, numNodes);
+    SurfaceHelperCache::readNestedVector(inFile, ret->nodeNeighbors, numNodes, maxEntries);
+    SurfaceHelperCache::readNestedVector(inFile, ret->distances, numNodes, maxEntries);
+    SurfaceHelperCache::readNestedVector(inFile, ret->nodeNeighbors2, numNodes, maxEntries);
+    SurfaceHelperCache::readNestedVector(inFile, ret->distances2, numNodes, maxEntries);
+    SurfaceHelperCache::readNestedVector(inFile, ret->neighbors2PathInfo, numNodes, maxEntries);
+    if ((int32_t)ret->nodeCoords.size() != numNodes)
+    {
+        throw DataFileException(filename, "inconsistent array sizes in geodesic helper cache file");
+    }
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        if (ret->nodeNeighbors[i].size() != ret->distances[i].size() || ret->nodeNeighbors2[i].size() != ret->distances2[i].size() ||
+            ret->nodeNeighbors2[i].size() != ret->neighbors2PathInfo[i].size())
+        {
+            throw DataFileException(filename, "inconsistent array sizes in geodesic helper cache file");
+        }
+        for (size_t j = 0; j < ret->nodeNeighbors[i].size(); ++j)
+        {
+            if (ret->nodeNeighbors[i][j] < 0 || ret->nodeNeighbors[i][j] >= numNodes)
+            {
+                throw DataFileException(filename, "invalid vertex index in geodesic helper cache file");
+            }
+        }
+        for (size_t j = 0; j < ret->nodeNeighbors2[i].size(); ++j)
+        {
+            if (ret->nodeNeighbors2[i][j] < 0 || ret->nodeNeighbors2[i][j] >= numNodes)
+            {
+                throw DataFileException(filename, "invalid vertex index in geodesic helper cache file");
+            }
+        }
+    }
+    GeodesicHelperBase* retPointer = ret.getPointer();
+    ret.releasePointer();
+    return retPointer;
+}
+
 GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& baseIn)
 {
     m_myBase = baseIn;//copy the pointer so it doesn't get changed or deleted while we get its members
@@ -1030,6 +1135,96 @@ int32_t GeodesicHelper::closest(const int32_t& root, const char* roi, bool smoot
     return ret;
 }
 
+void GeodesicHelper::closestAll(const char* roi, const float& maxdist, vector<int32_t>& closestOut, vector<float>& distsOut, bool smooth)
+{//dijkstra from every roi node at once, each node gets labeled with the source whose front reaches it first
+    int32_t i, j, whichnode, whichneigh, numNeigh, numChanged = 0;
+    const int32_t* neighbors;
+    float tempf;
+    closestOut.assign(numNodes, -1);
+    distsOut.assign(numNodes, -1.0f);
+    m_active.clear();
+    for (i = 0; i < numNodes; ++i)
+    {
+        if (roi[i] != 0)
+        {
+            output[i] = 0.0f;
+            changed[numChanged++] = i;
+            marked[i] |= 4;
+            closestOut[i] = i;
+            m_heapIdent[i] = m_active.push(i, 0.0f);
+        }
+    }
+    while (!m_active.isEmpty())
+    {
+        whichnode = m_active.pop();
+        marked[whichnode] |= 1;
+        distsOut[whichnode] = output[whichnode];
+        neighbors = nodeNeighbors[whichnode].data();
+        numNeigh = (int32_t)nodeNeighbors[whichnode].size();
+        for (j = 0; j < numNeigh; ++j)
+        {
+            whichneigh = neighbors[j];
+            if (!(marked[whichneigh] & 1))
+            {
+                tempf = output[whichnode] + distances[whichnode][j];
+                if (tempf <= maxdist)
+                {
+                    if (!(marked[whichneigh] & 4))
+                    {
+                        if (!marked[whichneigh])
+                        {
+                            changed[numChanged++] = whichneigh;
+                        }
+                        marked[whichneigh] |= 4;
+                        output[whichneigh] = tempf;
+                        closestOut[whichneigh] = closestOut[whichnode];
+                        m_heapIdent[whichneigh] = m_active.push(whichneigh, tempf);
+                    } else if (tempf < output[whichneigh]) {
+                        m_active.changekey(m_heapIdent[whichneigh], tempf);
+                        output[whichneigh] = tempf;
+                        closestOut[whichneigh] = closestOut[whichnode];
+                    }
+                }
+            }
+        }
+        if (smooth)
+        {
+            neighbors = nodeNeighbors2[whichnode].data();
+            numNeigh = (int32_t)nodeNeighbors2[whichnode].size();
+            for (j = 0; j < numNeigh; ++j)
+            {
+                whichneigh = neighbors[j];
+                if (!(marked[whichneigh] & 1))
+                {
+                    tempf = output[whichnode] + distances2[whichnode][j];
+                    if (tempf <= maxdist)
+                    {
+                        if (!(marked[whichneigh] & 4))
+                        {
+                            if (!marked[whichneigh])
+                            {
+                                changed[numChanged++] = whichneigh;
+                            }
+                            marked[whichneigh] |= 4;
+                            output[whichneigh] = tempf;
+                            closestOut[whichneigh] = closestOut[whichnode];
+                            m_heapIdent[whichneigh] = m_active.push(whichneigh, tempf);
+                        } else if (tempf < output[whichneigh]) {
+                            m_active.changekey(m_heapIdent[whichneigh], tempf);
+                            output[whichneigh] = tempf;
+                            closestOut[whichneigh] = closestOut[whichnode];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (i = 0; i < numChanged; ++i)
+    {
+        marked[changed[i]] = 0;//minimize reinitialization of arrays
+    }
+}
+
 void GeodesicHelper::aStar(const int32_t root, const int32_t endpoint, bool smooth)
 {
     int32_t whichnode, whichneigh, numNeigh, numChanged = 0;
@@ -1528,3 +1723,16 @@ int32_t GeodesicHelper::getClosestNodeInRoi(const int32_t& root, const char* roi
     }
     return ret;
 }
+
+void GeodesicHelper::getClosestNodesInRoi(const char* roi, const float& maxdist, vector<int32_t>& closestOut, vector<float>& distsOut, bool smoothflag)
+{
+    CaretAssert(maxdist >= 0.0f);
+    if (maxdist < 0.0f)
+    {
+        closestOut.assign(numNodes, -1);
+        distsOut.assign(numNodes, -1.0f);
+        return;
+    }
+    CaretMutexLocker locked(&inUse);
+    closestAll(roi, maxdist, closestOut, distsOut, smoothflag);
+}
@@ -27,6 +27,7 @@
 #include <cmath>
 //for inlining
 
+#include "AString.h"
 #include "CaretMutex.h"
 #include "CaretPointer.h"
 #include "CaretHeap.h"
@@ -48,7 +49,7 @@ namespace caret {
             float edgeWeight, pieceDists[2];
         };
     private:
-        GeodesicHelperBase();//can't construct without arguments
+        GeodesicHelperBase();//only for readCacheFile
         GeodesicHelperBase& operator=(const GeodesicHelperBase& right);//can't assign
         GeodesicHelperBase(const GeodesicHelperBase& right);//can't use copy constructor
         std::vector<std::vector<float> > distances, distances2;
@@ -60,6 +61,9 @@ namespace caret {
         float m_corrAreaSmallestFactor;//so that heuristics can be consistent despite corrected areas
     public:
         explicit GeodesicHelperBase(const SurfaceFile* surfaceIn, const float* correctedAreas = NULL);//NOTE: this is only an APPROXIMATE correction, use the real surface whenever possible
+        ///read a file written by writeCacheFile, returns NULL if it was written for a different surface
+        static GeodesicHelperBase* readCacheFile(const AString& filename, const SurfaceFile* surfIn, const uint64_t& geometryHash);
+        void writeCacheFile(const AString& filename, const uint64_t& geometryHash) const;
         friend class GeodesicHelper;//let it grab the private variables it needs
     };
 
@@ -91,6 +95,7 @@ namespace caret {
         void alltoall(float** out, int32_t** parents, bool smooth);//must be fully allocated
         int32_t closest(const int32_t& root, const char* roi, const float& maxdist, float& distOut, bool smooth);//just closest node
         int32_t closest(const int32_t& root, const char* roi, bool smooth);//just closest node
+        void closestAll(const char* roi, const float& maxdist, std::vector<int32_t>& closestOut, std::vector<float>& distsOut, bool smooth);//closest roi node for every node
         void aStar(const int32_t root, const int32_t endpoint, bool smooth);//faster method for path
         float linePenalty(const Vector3D& pos, const Vector3D& linep1, const Vector3D& linep2, const bool& segment);
         float lineHeuristic(const Vector3D& pos, const Vector3D& linep1, const Vector3D& linep2, const float& remainEucl, const bool& segment);
@@ -141,6 +146,9 @@ namespace caret {
         ///get just the closest node in the region and max distance given, returns -1 if no such node found - roi value of 0 means not in region, anything else is in region
         int32_t getClosestNodeInRoi(const int32_t& root, const char* roi, const float& maxdist, float& distOut, bool smoothflag = true);
         int32_t getClosestNodeInRoi(const int32_t& root, const char* roi, std::vector<int32_t>& pathNodesOut, std::vector<float>& pathDistsOut, bool smoothflag);
+        
+        ///get the closest node in the region for every node in one pass, -1 and distance -1 where no region node is within max distance
+        void getClosestNodesInRoi(const char* roi, const float& maxdist, std::vector<int32_t>& closestOut, std::vector<float>& distsOut, bool smoothflag = true);
     };
 
 } //namespace caret
@@ -0,0 +1,399 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MetricGradientObject.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+#include "Vector3D.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace caret;
+
+MetricGradientObject::MetricGradientObject(SurfaceFile* mySurf, const float* correctedAreas, const bool& averageNormals)
+{
+    CaretAssert(mySurf != NULL);
+    m_numNodes = mySurf->getNumberOfNodes();
+    const float* myNormals = NULL;
+    vector<float> avgNormalStorage;
+    if (averageNormals)
+    {
+        avgNormalStorage = mySurf->computeAverageNormals();
+        myNormals = avgNormalStorage.data();
+    } else {
+        mySurf->computeNormals();
+        myNormals = mySurf->getNormalData();
+    }
+    vector<float> sqrtCorrAreas, sqrtVertAreas;//same logic as AlgorithmMetricGradient
+    vector<float> areaData;
+    const float* vertAreas = NULL;
+    if (correctedAreas != NULL)
+    {
+        sqrtCorrAreas.resize(m_numNodes);
+        mySurf->computeNodeAreas(sqrtVertAreas);
+        for (int32_t i = 0; i < m_numNodes; ++i)
+        {
+            sqrtCorrAreas[i] = sqrt(correctedAreas[i]);
+            sqrtVertAreas[i] = sqrt(sqrtVertAreas[i]);
+        }
+        vertAreas = correctedAreas;
+    } else {
+        mySurf->computeNodeAreas(areaData);
+        vertAreas = areaData.data();
+    }
+    const float* myCoords = mySurf->getCoordinateData();
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
+    m_neighStart.resize(m_numNodes + 1);
+    m_neighStart[0] = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        m_neighStart[i + 1] = m_neighStart[i] + myTopoHelp->getNodeNeighbors(i).size();
+    }
+    int64_t totalNeigh = m_neighStart[m_numNodes];
+    m_neighbors.resize(totalNeigh);
+    m_xmag.resize(totalNeigh);
+    m_ymag.resize(totalNeigh);
+    m_neighArea.resize(totalNeigh);
+    m_fallbackScale.resize(totalNeigh);
+    m_xhat.resize(m_numNodes * 3);
+    m_yhat.resize(m_numNodes * 3);
+    m_centerArea.assign(vertAreas, vertAreas + m_numNodes);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeigh;
+        const int32_t* myNeighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
+        Vector3D myNormal = Vector3D(myNormals + i * 3).normal();
+        Vector3D myCoord = myCoords + i * 3;
+        Vector3D somevec, xhat, yhat;
+        somevec[2] = 0.0;
+        if (abs(myNormal[0]) > abs(myNormal[1]))
+        {//generate a vector not parallel to normal
+            somevec[0] = 0.0;
+            somevec[1] = 1.0;
+        } else {
+            somevec[0] = 1.0;
+            somevec[1] = 0.0;
+        }
+        xhat = myNormal.cross(somevec).normal();
+        yhat = myNormal.cross(xhat).normal();
+        for (int c = 0; c < 3; ++c)
+        {
+            m_xhat[i * 3 + c] = xhat[c];
+            m_yhat[i * 3 + c] = yhat[c];
+        }
+        int64_t base = m_neighStart[i];
+        for (int32_t j = 0; j < numNeigh; ++j)
+        {
+            int32_t whichNode = myNeighbors[j];
+            Vector3D neighCoord = myCoords + whichNode * 3;
+            somevec = neighCoord - myCoord;
+            float origMag = somevec.length();
+            float unrollMag = origMag;
+            float opposite = somevec.dot(myNormal);
+            if (abs(opposite) > 0.035f * origMag)//do not do unrolling on very small angles - this is ~2 degrees
+            {
+                unrollMag = origMag * asin(opposite / origMag) * origMag / opposite;
+            }
+            if (correctedAreas != NULL)
+            {
+                unrollMag *= (sqrtCorrAreas[i] + sqrtCorrAreas[whichNode]) / (sqrtVertAreas[i] + sqrtVertAreas[whichNode]);
+            }
+            float xmag = xhat.dot(somevec);
+            float ymag = yhat.dot(somevec);
+            float mag2d = sqrt(xmag * xmag + ymag * ymag);
+            m_neighbors[base + j] = whichNode;
+            m_xmag[base + j] = xmag * unrollMag / mag2d;//projected direction, with the unrolled length
+            m_ymag[base + j] = ymag * unrollMag / mag2d;
+            m_neighArea[base + j] = vertAreas[whichNode];
+            m_fallbackScale[base + j] = 1.0f / (unrollMag * unrollMag);
+        }
+    }
+    m_operatorBuilt = false;
+    m_opFallbackNode = -1;
+    m_opFailedNode = -1;
+}
+
+void MetricGradientObject::buildOperator(const float* operatorRoi)
+{
+    m_opStart.resize(m_numNodes + 1);
+    m_opStart[0] = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int64_t count = 0;
+        if (operatorRoi == NULL || operatorRoi[i] > 0.0f)
+        {
+            for (int64_t k = m_neighStart[i]; k < m_neighStart[i + 1]; ++k)
+            {
+                if (operatorRoi == NULL || operatorRoi[m_neighbors[k]] > 0.0f) ++count;
+            }
+        }
+        m_opStart[i + 1] = m_opStart[i] + count;
+    }
+    m_opNeighbors.resize(m_opStart[m_numNodes]);
+    m_opWeights.resize(m_opStart[m_numNodes] * 3);
+    m_opUsable.assign(m_numNodes, 0);
+    vector<char> usedFallback(m_numNodes, 0);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {//same decisions as computeGradient, but solved for the weight of each neighbor instead of for one column of data
+        if (operatorRoi != NULL && !(operatorRoi[i] > 0.0f)) continue;
+        const int64_t start = m_neighStart[i], end = m_neighStart[i + 1], opStart = m_opStart[i];
+        const int64_t neighCount = (end - start >= 2 ? m_opStart[i + 1] - opStart : 0);
+        int64_t pos = opStart;
+        for (int64_t k = start; k < end; ++k)
+        {
+            if (operatorRoi == NULL || operatorRoi[m_neighbors[k]] > 0.0f)
+            {
+                m_opNeighbors[pos] = m_neighbors[k];
+                ++pos;
+            }
+        }
+        bool good = false;
+        if (neighCount >= 2)
+        {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = m_centerArea[i];
+            for (int64_t k = start; k < end; ++k)
+            {
+                if (operatorRoi != NULL && !(operatorRoi[m_neighbors[k]] > 0.0f)) continue;
+                const double x = m_xmag[k], y = m_ymag[k], area = m_neighArea[k];
+                a00 += x * x * area;
+                a01 += x * y * area;
+                a02 += x * area;
+                a11 += y * y * area;
+                a12 += y * area;
+                a22 += area;
+            }
+            const double cof00 = a11 * a22 - a12 * a12, cof01 = a01 * a22 - a12 * a02, cof02 = a01 * a12 - a11 * a02;
+            const double det = a00 * cof00 - a01 * cof01 + a02 * cof02;
+            if (det != 0.0)
+            {//first two rows of the inverse of the symmetric A'A, we don't need the intercept
+                const double inv00 = cof00 / det, inv01 = -cof01 / det, inv02 = cof02 / det;
+                const double inv11 = (a00 * a22 - a02 * a02) / det, inv12 = -(a00 * a12 - a01 * a02) / det;
+                good = true;
+                pos = opStart;
+                for (int64_t k = start; k < end; ++k)
+                {
+                    if (operatorRoi != NULL && !(operatorRoi[m_neighbors[k]] > 0.0f)) continue;
+                    const double x = m_xmag[k], y = m_ymag[k], area = m_neighArea[k];
+                    const double c0 = area * (inv00 * x + inv01 * y + inv02), c1 = area * (inv01 * x + inv11 * y + inv12);
+                    if (c0 != c0 || c1 != c1) good = false;
+                    m_opWeights[pos * 3] = c0;//2D weights for now
+                    m_opWeights[pos * 3 + 1] = c1;
+                    ++pos;
+                }
+            }
+        }
+        if (!good && neighCount > 0)
+        {//average the point estimates from each neighbor instead
+            usedFallback[i] = 1;
+            double totalWeight = 0.0;
+            for (int64_t k = start; k < end; ++k)
+            {
+                if (operatorRoi != NULL && !(operatorRoi[m_neighbors[k]] > 0.0f)) continue;
+                totalWeight += m_neighArea[k];
+            }
+            good = true;
+            pos = opStart;
+            for (int64_t k = start; k < end; ++k)
+            {
+                if (operatorRoi != NULL && !(operatorRoi[m_neighbors[k]] > 0.0f)) continue;
+                const double scale = m_fallbackScale[k] * m_neighArea[k] / totalWeight;
+                const double c0 = m_xmag[k] * scale, c1 = m_ymag[k] * scale;
+                if (c0 != c0 || c1 != c1) good = false;
+                m_opWeights[pos * 3] = c0;
+                m_opWeights[pos * 3 + 1] = c1;
+                ++pos;
+            }
+        }
+        if (good)
+        {
+            m_opUsable[i] = 1;
+            for (pos = opStart; pos < m_opStart[i + 1]; ++pos)
+            {
+                const float c0 = m_opWeights[pos * 3], c1 = m_opWeights[pos * 3 + 1];
+                for (int c = 0; c < 3; ++c)
+                {
+                    m_opWeights[pos * 3 + c] = m_xhat[i * 3 + c] * c0 + m_yhat[i * 3 + c] * c1;//unproject back into 3d
+                }
+            }
+        }
+    }
+    m_opFallbackNode = -1;
+    m_opFailedNode = -1;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        if (operatorRoi != NULL && !(operatorRoi[i] > 0.0f)) continue;
+        if (m_opFallbackNode == -1 && usedFallback[i]) m_opFallbackNode = i;
+        if (m_opFailedNode == -1 && !m_opUsable[i]) m_opFailedNode = i;
+    }
+    m_operatorBuilt = true;
+}
+
+void MetricGradientObject::applyOperator(const float* data, const int64_t& stride, const int32_t& numMaps, float* magnitudeOut, float* vectorsOut,
+                                         bool* failedOut) const
+{
+    CaretAssert(m_operatorBuilt);
+    vector<double> accum(numMaps * 3);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        float* magRow = magnitudeOut + i * stride;
+        float* vecRow = (vectorsOut == NULL ? NULL : vectorsOut + i * stride * 3);
+        if (!m_opUsable[i])
+        {
+            for (int32_t m = 0; m < numMaps; ++m) magRow[m] = 0.0f;
+            if (vecRow != NULL)
+            {
+                for (int32_t m = 0; m < numMaps * 3; ++m) vecRow[m] = 0.0f;
+            }
+            continue;
+        }
+        const float* center = data + i * stride;
+        accum.assign(numMaps * 3, 0.0);
+        for (int64_t pos = m_opStart[i]; pos < m_opStart[i + 1]; ++pos)
+        {
+            const float* neighRow = data + m_opNeighbors[pos] * stride;
+            const double w0 = m_opWeights[pos * 3], w1 = m_opWeights[pos * 3 + 1], w2 = m_opWeights[pos * 3 + 2];
+            for (int32_t m = 0; m < numMaps; ++m)
+            {
+                const double diff = neighRow[m] - center[m];
+                accum[m * 3] += w0 * diff;
+                accum[m * 3 + 1] += w1 * diff;
+                accum[m * 3 + 2] += w2 * diff;
+            }
+        }
+        for (int32_t m = 0; m < numMaps; ++m)
+        {
+            float gradVec[3] = { (float)accum[m * 3], (float)accum[m * 3 + 1], (float)accum[m * 3 + 2] };
+            float sanity = gradVec[0] + gradVec[1] + gradVec[2];
+            if (sanity != sanity)
+            {
+                if (failedOut != NULL) *failedOut = true;
+                gradVec[0] = 0.0f;
+                gradVec[1] = 0.0f;
+                gradVec[2] = 0.0f;
+            }
+            if (vecRow != NULL)
+            {
+                vecRow[m * 3] = gradVec[0];
+                vecRow[m * 3 + 1] = gradVec[1];
+                vecRow[m * 3 + 2] = gradVec[2];
+            }
+            magRow[m] = sqrt(gradVec[0] * gradVec[0] + gradVec[1] * gradVec[1] + gradVec[2] * gradVec[2]);
+        }
+    }
+}
+
+void MetricGradientObject::computeGradient(const float* data, float* magnitudeOut, float* vectorsOut, const float* roiData,
+                                           bool* usedFallbackOut, bool* failedOut) const
+{
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        if (roiData != NULL && !(roiData[i] > 0.0f))
+        {
+            magnitudeOut[i] = 0.0f;
+            if (vectorsOut != NULL)
+            {
+                vectorsOut[i] = 0.0f;
+                vectorsOut[i + m_numNodes] = 0.0f;
+                vectorsOut[i + m_numNodes * 2] = 0.0f;
+            }
+            continue;
+        }
+        const float nodeValue = data[i];
+        const int64_t start = m_neighStart[i], end = m_neighStart[i + 1];
+        int neighCount = 0;//within-roi neighbors
+        double grad2d[2] = { 0.0, 0.0 };
+        bool good = false;
+        if (end - start >= 2)
+        {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0, b0 = 0.0, b1 = 0.0, b2 = 0.0;//A'A and A'b for the area weighted regression
+            for (int64_t k = start; k < end; ++k)
+            {
+                const int32_t whichNode = m_neighbors[k];
+                if (roiData != NULL && !(roiData[whichNode] > 0.0f)) continue;
+                ++neighCount;
+                const double diff = data[whichNode] - nodeValue, x = m_xmag[k], y = m_ymag[k], area = m_neighArea[k];
+                a00 += x * x * area;
+                a01 += x * y * area;
+                a02 += x * area;
+                a11 += y * y * area;
+                a12 += y * area;
+                a22 += area;
+                b0 += x * diff * area;
+                b1 += y * diff * area;
+                b2 += diff * area;
+            }
+            if (neighCount >= 2)
+            {
+                a22 += m_centerArea[i];//include center, its coord and value differences are zero
+                const double cof00 = a11 * a22 - a12 * a12, cof01 = a01 * a22 - a12 * a02, cof02 = a01 * a12 - a11 * a02;
+                const double det = a00 * cof00 - a01 * cof01 + a02 * cof02;
+                if (det != 0.0)
+                {//cramer's rule, we don't need the intercept
+                    grad2d[0] = (b0 * cof00 - a01 * (b1 * a22 - a12 * b2) + a02 * (b1 * a12 - a11 * b2)) / det;
+                    grad2d[1] = (a00 * (b1 * a22 - a12 * b2) - b0 * cof01 + a02 * (a01 * b2 - b1 * a02)) / det;
+                    good = (grad2d[0] == grad2d[0] && grad2d[1] == grad2d[1]);
+                }
+            }
+        }
+        if (!good && neighCount > 0)
+        {//average the point estimates from each neighbor instead
+            if (usedFallbackOut != NULL) *usedFallbackOut = true;
+            double totalWeight = 0.0;
+            grad2d[0] = 0.0;
+            grad2d[1] = 0.0;
+            for (int64_t k = start; k < end; ++k)
+            {
+                const int32_t whichNode = m_neighbors[k];
+                if (roiData != NULL && !(roiData[whichNode] > 0.0f)) continue;
+                const double scaledDiff = (data[whichNode] - nodeValue) * m_fallbackScale[k] * m_neighArea[k];
+                grad2d[0] += m_xmag[k] * scaledDiff;
+                grad2d[1] += m_ymag[k] * scaledDiff;
+                totalWeight += m_neighArea[k];
+            }
+            grad2d[0] /= totalWeight;
+            grad2d[1] /= totalWeight;
+            good = (grad2d[0] == grad2d[0] && grad2d[1] == grad2d[1]);
+        }
+        if (!good)
+        {
+            if (failedOut != NULL) *failedOut = true;
+            grad2d[0] = 0.0;
+            grad2d[1] = 0.0;
+        }
+        float gradVec[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            gradVec[c] = m_xhat[i * 3 + c] * grad2d[0] + m_yhat[i * 3 + c] * grad2d[1];//unproject back into 3d
+        }
+        if (vectorsOut != NULL)
+        {
+            vectorsOut[i] = gradVec[0];
+            vectorsOut[i + m_numNodes] = gradVec[1];
+            vectorsOut[i + m_numNodes * 2] = gradVec[2];
+        }
+        magnitudeOut[i] = sqrt(gradVec[0] * gradVec[0] + gradVec[1] * gradVec[1] + gradVec[2] * gradVec[2]);
+    }
+}
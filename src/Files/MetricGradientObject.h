@@ -0,0 +1,89 @@
+#ifndef __METRIC_GRADIENT_OBJECT_H__
+#define __METRIC_GRADIENT_OBJECT_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+//NOTE: this computes the same regression gradient as AlgorithmMetricGradient, but does the per-vertex geometry (normals, unrolled neighbor positions, areas) only once,
+//      so it is much faster when the gradient of many columns on the same surface is needed.
+//
+//NOTE: this object contains no mutable members, and computeGradient does not start any threads of its own, so the intended use is for several threads to compute
+//      the gradients of different columns concurrently with the same instance.
+//
+//NOTE: with a fixed roi (or none), the regression is linear in the data, so buildOperator can solve it once per vertex into a sparse operator
+//      (3 weights per in-roi neighbor), and applyOperator only does multiply-adds, over a block of maps at a time.  The constructor doesn't build it,
+//      because callers whose roi changes per column only use computeGradient.
+
+#include "stdint.h"
+#include "stddef.h"
+#include <vector>
+
+namespace caret {
+    
+    class SurfaceFile;
+    
+    class MetricGradientObject
+    {
+    public:
+        ///correctedAreas, if given, are used instead of the surface's vertex areas, and to scale distances, like -corrected-areas
+        MetricGradientObject(SurfaceFile* mySurf, const float* correctedAreas = NULL, const bool& averageNormals = false);
+        
+        ///solve the regression for every vertex in operatorRoi (or all vertices), must be called before applyOperator, and not while other threads use the object
+        void buildOperator(const float* operatorRoi = NULL);
+        
+        ///vectorsOut, if not NULL, must have room for 3 * number of vertices, and gets X, Y, and Z as consecutive blocks of number of vertices
+        ///vertices outside the roi get zero, and so do vertices where even the fallback method fails, which sets failedOut
+        void computeGradient(const float* data, float* magnitudeOut, float* vectorsOut = NULL, const float* roiData = NULL,
+                             bool* usedFallbackOut = NULL, bool* failedOut = NULL) const;
+        
+        ///gradients of a block of maps with the operator from buildOperator, data is vertex-major: map m at vertex i is data[i * stride + m], for m < numMaps
+        ///magnitudeOut has the same layout, vectorsOut, if not NULL, has 3 values per map: X of map m at vertex i is vectorsOut[(i * stride + m) * 3]
+        ///failedOut is set if a result is not a number (from the data, geometry failures are reported by getOperatorFailedNode)
+        void applyOperator(const float* data, const int64_t& stride, const int32_t& numMaps, float* magnitudeOut, float* vectorsOut = NULL,
+                           bool* failedOut = NULL) const;
+        
+        ///first in-roi vertex where the operator had to use the fallback method, or -1
+        int32_t getOperatorFallbackNode() const { return m_opFallbackNode; }
+        
+        ///first in-roi vertex where the operator could not be computed, and outputs zero, or -1
+        int32_t getOperatorFailedNode() const { return m_opFailedNode; }
+        
+        int32_t getNumberOfNodes() const { return m_numNodes; }
+    private:
+        int32_t m_numNodes;
+        std::vector<float> m_xhat, m_yhat;//per vertex tangent basis, 3 values each
+        std::vector<float> m_centerArea;
+        std::vector<int64_t> m_neighStart;//neighbor lists, compressed row style, m_numNodes + 1 elements
+        std::vector<int32_t> m_neighbors;
+        std::vector<float> m_xmag, m_ymag;//unrolled 2D position of the neighbor, relative to the vertex
+        std::vector<float> m_neighArea;
+        std::vector<float> m_fallbackScale;//1 / unrolled distance squared, for the point estimate fallback
+        std::vector<int64_t> m_opStart;//operator, compressed row style over in-roi neighbors only, vertices outside the roi have no entries
+        std::vector<int32_t> m_opNeighbors;
+        std::vector<float> m_opWeights;//3D gradient weight of each neighbor's difference from the center, 3 values each
+        std::vector<char> m_opUsable;//whether the vertex gets a gradient from the operator, rather than zero
+        int32_t m_opFallbackNode, m_opFailedNode;
+        bool m_operatorBuilt;
+        MetricGradientObject();
+    };
+    
+}
+
+#endif //__METRIC_GRADIENT_OBJECT_H__
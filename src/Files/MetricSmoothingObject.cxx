@@ -140,6 +140,54 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     }
 }
 
+void MetricSmoothingObject::smoothData(const float* dataIn, float* dataOut, const float* roiData, const bool& fixZeros) const
+{
+    CaretAssert(dataIn != NULL);
+    CaretAssert(dataOut != NULL);
+    CaretAssert(dataIn != dataOut);
+    int32_t numNodes = (int32_t)m_weightLists.size();
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        dataOut[i] = smoothNode(dataIn, i, roiData, fixZeros);
+    }
+}
+
+float MetricSmoothingObject::smoothNode(const float* myColumn, const int32_t& node, const float* roiColumn, const bool& fixZeros) const
+{
+    const WeightList& myWeightRef = m_weightLists[node];
+    if (myWeightRef.m_weightSum == 0.0f || (roiColumn != NULL && !(roiColumn[node] > 0.0f)))//skip nodes with no neighbors quickly
+    {
+        return 0.0f;
+    }
+    int32_t numWeights = myWeightRef.m_nodes.size();
+    if (!fixZeros && roiColumn == NULL)
+    {
+        float sum = 0.0f;
+        for (int32_t j = 0; j < numWeights; ++j)
+        {
+            sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+        }
+        return sum / myWeightRef.m_weightSum;
+    }
+    float sum = 0.0f, weightsum = 0.0f;
+    for (int32_t j = 0; j < numWeights; ++j)
+    {
+        int32_t neighbor = myWeightRef.m_nodes[j];
+        float value = myColumn[neighbor];
+        if ((roiColumn == NULL || roiColumn[neighbor] > 0.0f) && (!fixZeros || value != 0.0f))
+        {
+            float weight = myWeightRef.m_weights[j];
+            sum += weight * value;
+            weightsum += weight;
+        }
+    }
+    if (weightsum != 0.0f)
+    {
+        return sum / weightsum;
+    }
+    return 0.0f;
+}
+
 void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const
 {
     CaretAssert(metricIn != NULL);//asserts only, and only basic checks, these functions are private
@@ -149,54 +197,10 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     CaretAssert(whichOutColumn >= 0 && whichOutColumn < metricOut->getNumberOfColumns());
     const float* myColumn = metricIn->getValuePointerForColumn(whichColumn);
     int32_t numNodes = metricIn->getNumberOfNodes();
-    if (fixZeros)//special case early to keep branching down
-    {
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
-        {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
-            {
-                float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
-                {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
-                    if (value != 0.0f)
-                    {
-                        float weight = myWeightRef.m_weights[j];
-                        sum += weight * value;
-                        weightsum += weight;
-                    }
-                }
-                if (weightsum != 0.0f)
-                {
-                    scratch[i] = sum / weightsum;
-                } else {
-                    scratch[i] = 0.0f;
-                }
-            } else {
-                scratch[i] = 0.0f;//but we do need to zero what we skip, so a list of nodes to check may not help
-            }
-        }
-    } else {
 #pragma omp CARET_PARFOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
-        {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
-            {
-                float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
-                {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
-                }
-                scratch[i] = sum / myWeightRef.m_weightSum;
-            } else {
-                scratch[i] = 0.0f;
-            }
-        }
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        scratch[i] = smoothNode(myColumn, i, NULL, fixZeros);
     }
     metricOut->setValuesForColumn(whichOutColumn, scratch);
 }
@@ -213,66 +217,10 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     const float* myColumn = metricIn->getValuePointerForColumn(whichColumn);
     const float* roiColumn = roi->getValuePointerForColumn(whichRoiColumn);
     int32_t numNodes = metricIn->getNumberOfNodes();
-    if (fixZeros)//special case early to keep branching down
-    {
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
-        {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
-            {
-                float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
-                {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
-                    float value = myColumn[neighbor];
-                    if (roiColumn[neighbor] > 0.0f && value != 0.0f)
-                    {
-                        float weight = myWeightRef.m_weights[j];
-                        sum += weight * value;
-                        weightsum += weight;
-                    }
-                }
-                if (weightsum != 0.0f)
-                {
-                    scratch[i] = sum / weightsum;
-                } else {
-                    scratch[i] = 0.0f;
-                }
-            } else {
-                scratch[i] = 0.0f;//but we do need to zero what we skip, so a list of nodes to check may not help
-            }
-        }
-    } else {
 #pragma omp CARET_PARFOR schedule(dynamic)
-        for (int32_t i = 0; i < numNodes; ++i)
-        {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
-            {
-                float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
-                {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
-                    if (roiColumn[neighbor] > 0.0f)
-                    {
-                        float weight = myWeightRef.m_weights[j];
-                        sum += weight * myColumn[neighbor];
-                        weightsum += weight;
-                    }
-                }
-                if (weightsum != 0.0f)
-                {
-                    scratch[i] = sum / weightsum;
-                } else {
-                    scratch[i] = 0.0f;
-                }
-            } else {
-                scratch[i] = 0.0f;
-            }
-        }
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        scratch[i] = smoothNode(myColumn, i, roiColumn, fixZeros);
     }
     metricOut->setValuesForColumn(whichOutColumn, scratch);
 }
@@ -52,6 +52,8 @@ namespace caret {
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        ///raw array version, does not start threads of its own, so that several columns can be smoothed concurrently
+        void smoothData(const float* dataIn, float* dataOut, const float* roiData = NULL, const bool& fixZeros = false) const;
     private:
         struct WeightList
         {
@@ -60,6 +62,7 @@ namespace caret {
             float m_weightSum;
         };
         std::vector<WeightList> m_weightLists;
+        float smoothNode(const float* myColumn, const int32_t& node, const float* roiColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const;
         void precomputeWeights(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
@@ -194,6 +194,33 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
                              rgbaNegativeOne);
     const bool rgbaNegativeOneValid = (rgbaNegativeOne[3] > 0.0);
     
+    /*
+     * When there are many more scalars than lookup table entries
+     * (dense volumes, multi-surface montages), bake the palette into a
+     * lookup table once rather than searching the palette per scalar.
+     * The table has (2 * resolution + 1) entries, so the palette is
+     * sampled every 1/2048 of the normalized range.
+     */
+    const int32_t lookupResolution = 2048;
+    const bool useLookupTableFlag = (numberOfScalars > (8 * lookupResolution));
+    std::vector<float> paletteLookupTable;
+    if (useLookupTableFlag) {
+        palette->getPaletteColorLookupTable(lookupResolution,
+                                            interpolateFlag,
+                                            paletteLookupTable);
+    }
+    const float* paletteLookup = (useLookupTableFlag ? &paletteLookupTable[0] : NULL);
+    
+    /*
+     * Display of values by sign, indexed by (sign + 1), so that the
+     * loop needs one lookup rather than nested tests.
+     */
+    const bool displaySignFlags[3] = {
+        ! hideNegativeValues,
+        ! hideZeroValues,
+        ! hidePositiveValues
+    };
+    
     /*
      * Color all scalars.
      */
@@ -227,24 +254,17 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
         /*
          * Positive/Zero/Negative Test
          */
-        if (scalar > PaletteColorMapping::SMALL_POSITIVE) {   // JWH 24 April 2015    NodeAndVoxelColoring::SMALL_POSITIVE) {
-            if (hidePositiveValues) {
-                continue;
-            }
-        }
-        else if (scalar < PaletteColorMapping::SMALL_NEGATIVE) {  // JWH 24 April 2015  NodeAndVoxelColoring::SMALL_NEGATIVE) {
-            if (hideNegativeValues) {
-                continue;
-            }
-        }
-        else {
+        const int32_t signIndex = ((scalar > PaletteColorMapping::SMALL_POSITIVE)
+                                   ? 2
+                                   : ((scalar < PaletteColorMapping::SMALL_NEGATIVE) ? 0 : 1));
+        if (signIndex == 1) {
             /*
              * May be very near zero so force to zero.
              */
             normalizedValues[i] = 0.0;
-            if (hideZeroValues) {
-                continue;
-            }
+        }
+        if ( ! displaySignFlags[signIndex]) {
+            continue;
         }
         
         /*
@@ -279,6 +299,17 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
                 rgbaOut[3] = rgbaNegativeOne[3];
             }
         }
+        else if (paletteLookup != NULL) {
+            /*
+             * Color scalar using baked palette, transparent entries are all zeros
+             */
+            const float* rgba = paletteLookup + 4 * Palette::getPaletteColorLookupIndex(normalValue,
+                                                                                       lookupResolution);
+            rgbaOut[0] = rgba[0];
+            rgbaOut[1] = rgba[1];
+            rgbaOut[2] = rgba[2];
+            rgbaOut[3] = rgba[3];
+        }
         else {
             /*
              * Color scalar using palette
@@ -212,6 +212,201 @@ namespace
         return inside;
     }
     
+    struct OverlapTri
+    {
+        float m_xyz[3][3];//in voxel index space
+        float m_min[3], m_max[3];
+        float m_weight;//1 for surface triangles, 0.5 for each of the two triangulations of a quad
+        OverlapTri(const Vector3D& xyz1, const Vector3D& xyz2, const Vector3D& xyz3, const float weight);
+    };
+    
+    struct OverlapPoly
+    {//same polyhedron as PolyInfo, but as a consistently wound closed surface in voxel index space, so that overlap volume can be computed exactly
+        std::vector<OverlapTri> m_tris;
+        float m_orientSign;//+1 if the faces wind outward, -1 if inward, 0 if the polyhedron has no volume
+        OverlapPoly(const VolumeSpace& myVolSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int32_t node);
+        float voxelFraction(const int64_t* ijk) const;//fraction of the voxel's volume that is inside the polyhedron
+    private:
+        void addTri(const VolumeSpace& myVolSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int32_t root, const int32_t node2, const int32_t node3);
+    };
+    
+    OverlapTri::OverlapTri(const Vector3D& xyz1, const Vector3D& xyz2, const Vector3D& xyz3, const float weight)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            m_xyz[0][i] = xyz1[i];
+            m_xyz[1][i] = xyz2[i];
+            m_xyz[2][i] = xyz3[i];
+            m_min[i] = min(min(xyz1[i], xyz2[i]), xyz3[i]);
+            m_max[i] = max(max(xyz1[i], xyz2[i]), xyz3[i]);
+        }
+        m_weight = weight;
+    }
+    
+    void OverlapPoly::addTri(const VolumeSpace& myVolSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int32_t root, const int32_t node2, const int32_t node3)
+    {
+        Vector3D innerRoot, inner2, inner3, outerRoot, outer2, outer3;
+        myVolSpace.spaceToIndex(innerSurf->getCoordinate(root), innerRoot);//the index transform is affine, so volume fractions are unchanged
+        myVolSpace.spaceToIndex(innerSurf->getCoordinate(node2), inner2);
+        myVolSpace.spaceToIndex(innerSurf->getCoordinate(node3), inner3);
+        myVolSpace.spaceToIndex(outerSurf->getCoordinate(root), outerRoot);
+        myVolSpace.spaceToIndex(outerSurf->getCoordinate(node2), outer2);
+        myVolSpace.spaceToIndex(outerSurf->getCoordinate(node3), outer3);
+        m_tris.push_back(OverlapTri(outerRoot, outer2, outer3, 1.0f));
+        m_tris.push_back(OverlapTri(innerRoot, inner3, inner2, 1.0f));//reversed, so the closed surface has consistent winding
+        //the quad may not be planar, so use both triangulations at half weight, like the half-inside result of QuadInfo
+        m_tris.push_back(OverlapTri(inner2, inner3, outer3, 0.5f));
+        m_tris.push_back(OverlapTri(inner2, outer3, outer2, 0.5f));
+        m_tris.push_back(OverlapTri(inner2, inner3, outer2, 0.5f));
+        m_tris.push_back(OverlapTri(inner3, outer3, outer2, 0.5f));
+    }
+    
+    OverlapPoly::OverlapPoly(const VolumeSpace& myVolSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int32_t node)
+    {
+        CaretPointer<TopologyHelper> myTopoHelp = innerSurf->getTopologyHelper();
+        int numTiles;
+        const int* myTiles = myTopoHelp->getNodeTiles(node, numTiles);
+        for (int i = 0; i < numTiles; ++i)
+        {
+            const int32_t* myTri = innerSurf->getTriangle(myTiles[i]);
+            if (myTri[0] == node)
+            {
+                addTri(myVolSpace, innerSurf, outerSurf, myTri[0], myTri[1], myTri[2]);
+            } else {
+                if (myTri[1] == node)
+                {
+                    addTri(myVolSpace, innerSurf, outerSurf, myTri[1], myTri[2], myTri[0]);
+                } else {
+                    addTri(myVolSpace, innerSurf, outerSurf, myTri[2], myTri[0], myTri[1]);
+                }
+            }
+        }
+        double signedVolume = 0.0;//divergence theorem, 6 times the signed volume
+        int numTris = (int)m_tris.size();
+        for (int i = 0; i < numTris; ++i)
+        {
+            const float (&v)[3][3] = m_tris[i].m_xyz;
+            signedVolume += m_tris[i].m_weight * (v[0][0] * ((double)v[1][1] * v[2][2] - (double)v[1][2] * v[2][1]) -
+                                                  v[0][1] * ((double)v[1][0] * v[2][2] - (double)v[1][2] * v[2][0]) +
+                                                  v[0][2] * ((double)v[1][0] * v[2][1] - (double)v[1][1] * v[2][0]));
+        }
+        if (signedVolume > 0.0)
+        {
+            m_orientSign = 1.0f;
+        } else if (signedVolume < 0.0) {
+            m_orientSign = -1.0f;
+        } else {
+            m_orientSign = 0.0f;
+        }
+    }
+    
+    const int MAX_CLIP_VERTS = 12;//a triangle clipped by 6 planes can have at most 9 vertices
+    
+    //Sutherland-Hodgman clip of a planar polygon against one axis-aligned plane, returns the new number of vertices
+    int clipPolygon(const float (*inVerts)[3], const int numIn, const int axis, const float value, const bool keepAbove, float (*outVerts)[3])
+    {
+        int numOut = 0;
+        for (int i = 0; i < numIn; ++i)
+        {
+            const float* cur = inVerts[i];
+            const float* next = inVerts[(i + 1) % numIn];
+            bool curIn = (keepAbove ? cur[axis] >= value : cur[axis] <= value);
+            bool nextIn = (keepAbove ? next[axis] >= value : next[axis] <= value);
+            if (curIn)
+            {
+                outVerts[numOut][0] = cur[0]; outVerts[numOut][1] = cur[1]; outVerts[numOut][2] = cur[2];
+                ++numOut;
+            }
+            if (curIn != nextIn)
+            {
+                float t = (value - cur[axis]) / (next[axis] - cur[axis]);
+                for (int j = 0; j < 3; ++j)
+                {
+                    outVerts[numOut][j] = cur[j] + t * (next[j] - cur[j]);
+                }
+                outVerts[numOut][axis] = value;//avoid rounding putting it on the wrong side
+                ++numOut;
+            }
+        }
+        return numOut;
+    }
+    
+    //integral of (z - zBase) over the xy projection of a planar polygon, signed by the winding of the projection
+    double projectedHeightIntegral(const float (*verts)[3], const int numVerts, const float zBase)
+    {
+        double ret = 0.0;
+        for (int i = 1; i < numVerts - 1; ++i)
+        {
+            double area2 = ((double)verts[i][0] - verts[0][0]) * ((double)verts[i + 1][1] - verts[0][1]) -
+                           ((double)verts[i + 1][0] - verts[0][0]) * ((double)verts[i][1] - verts[0][1]);
+            ret += area2 * ((verts[0][2] + verts[i][2] + verts[i + 1][2]) / 3.0 - zBase);
+        }
+        return ret * 0.5;
+    }
+    
+    //signed area of the xy projection of a polygon
+    double projectedArea(const float (*verts)[3], const int numVerts)
+    {
+        double ret = 0.0;
+        for (int i = 1; i < numVerts - 1; ++i)
+        {
+            ret += ((double)verts[i][0] - verts[0][0]) * ((double)verts[i + 1][1] - verts[0][1]) -
+                   ((double)verts[i + 1][0] - verts[0][0]) * ((double)verts[i][1] - verts[0][1]);
+        }
+        return ret * 0.5;
+    }
+    
+    float OverlapPoly::voxelFraction(const int64_t* ijk) const
+    {//for each vertical line through the voxel, the faces above and below the inside segments contribute their height clamped to the voxel's z range, signed by facing direction
+        if (m_orientSign == 0.0f) return 0.0f;
+        float lowCorner[3], highCorner[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            lowCorner[i] = ijk[i] - 0.5f;
+            highCorner[i] = ijk[i] + 0.5f;
+        }
+        double total = 0.0;
+        float bufA[MAX_CLIP_VERTS][3], bufB[MAX_CLIP_VERTS][3];
+        int numTris = (int)m_tris.size();
+        for (int t = 0; t < numTris; ++t)
+        {
+            const OverlapTri& thisTri = m_tris[t];
+            if (thisTri.m_max[0] <= lowCorner[0] || thisTri.m_min[0] >= highCorner[0] ||
+                thisTri.m_max[1] <= lowCorner[1] || thisTri.m_min[1] >= highCorner[1] ||
+                thisTri.m_max[2] <= lowCorner[2])//entirely below the voxel contributes zero height
+            {
+                continue;
+            }
+            for (int i = 0; i < 3; ++i)
+            {
+                bufA[i][0] = thisTri.m_xyz[i][0]; bufA[i][1] = thisTri.m_xyz[i][1]; bufA[i][2] = thisTri.m_xyz[i][2];
+            }
+            int numVerts = 3;
+            numVerts = clipPolygon(bufA, numVerts, 0, lowCorner[0], true, bufB);
+            numVerts = clipPolygon(bufB, numVerts, 0, highCorner[0], false, bufA);
+            numVerts = clipPolygon(bufA, numVerts, 1, lowCorner[1], true, bufB);
+            numVerts = clipPolygon(bufB, numVerts, 1, highCorner[1], false, bufA);
+            if (numVerts < 3) continue;
+            double contribution;
+            if (thisTri.m_min[2] >= lowCorner[2] && thisTri.m_max[2] <= highCorner[2])
+            {
+                contribution = projectedHeightIntegral(bufA, numVerts, lowCorner[2]);
+            } else {
+                float bufC[MAX_CLIP_VERTS][3];
+                int numAbove = clipPolygon(bufA, numVerts, 2, highCorner[2], true, bufB);//above the voxel contributes the full voxel height
+                contribution = projectedArea(bufB, numAbove);
+                int numBelow = clipPolygon(bufA, numVerts, 2, highCorner[2], false, bufB);
+                int numInside = clipPolygon(bufB, numBelow, 2, lowCorner[2], true, bufC);
+                contribution += projectedHeightIntegral(bufC, numInside, lowCorner[2]);
+            }
+            total += thisTri.m_weight * contribution;
+        }
+        float ret = (float)(total * m_orientSign);//voxel volume is 1 in index space
+        if (ret < 0.0f) return 0.0f;//can happen for self-intersecting polyhedra
+        if (ret > 1.0f) return 1.0f;
+        return ret;
+    }
+    
     float computeVoxelFraction(const VolumeSpace& myVolSpace, const int64_t* ijk, PolyInfo& myPoly, const int divisions,
                                                                 const Vector3D& ivec, const Vector3D& jvec, const Vector3D& kvec)
     {
@@ -247,10 +442,11 @@ void RibbonMappingHelper::computeWeightsRibbon(vector<vector<VoxelWeight> >& myW
     {
         throw CaretException("input surfaces to ribbon mapping do not have vertex correspondence");
     }
-    if (numDivisions < 1)
+    if (numDivisions < 0)
     {
-        throw CaretException("number of voxel subdivisions must be positive for ribbon mapping");
+        throw CaretException("number of voxel subdivisions must not be negative for ribbon mapping");
     }
+    bool exactOverlap = (numDivisions == 0);
     int64_t numNodes = outerSurf->getNumberOfNodes();
     myWeightsOut.resize(numNodes);
     Vector3D origin, ivec, jvec, kvec;//these are the spatial projections of the ijk unit vectors (also, the offset that specifies the origin)
@@ -269,7 +465,14 @@ void RibbonMappingHelper::computeWeightsRibbon(vector<vector<VoxelWeight> >& myW
             myWeightsOut[node].reserve(maxVoxelCount);
             float tempf;
             int64_t node3 = node * 3;
-            PolyInfo myPoly(innerSurf, outerSurf, node);//build the polygon
+            CaretPointer<PolyInfo> myPoly;
+            CaretPointer<OverlapPoly> myOverlapPoly;
+            if (exactOverlap)
+            {
+                myOverlapPoly.grabNew(new OverlapPoly(myVolSpace, innerSurf, outerSurf, node));//build the polygon
+            } else {
+                myPoly.grabNew(new PolyInfo(innerSurf, outerSurf, node));
+            }
             Vector3D minIndex, maxIndex, tempvec;
             myVolSpace.spaceToIndex(innerCoords + node3, minIndex);//find the bounding box in VOLUME INDEX SPACE, starting with the center nodes
             maxIndex = minIndex;
@@ -314,7 +517,12 @@ void RibbonMappingHelper::computeWeightsRibbon(vector<vector<VoxelWeight> >& myW
                     {
                         if (roiFrame == NULL || roiFrame[myVolSpace.getIndex(ijk)] > 0.0f)
                         {
-                            tempf = computeVoxelFraction(myVolSpace, ijk, myPoly, numDivisions, ivec, jvec, kvec);
+                            if (exactOverlap)
+                            {
+                                tempf = myOverlapPoly->voxelFraction(ijk);
+                            } else {
+                                tempf = computeVoxelFraction(myVolSpace, ijk, *myPoly, numDivisions, ivec, jvec, kvec);
+                            }
                             if (tempf != 0.0f)
                             {
                                 myWeightsOut[node].push_back(VoxelWeight(tempf, ijk));
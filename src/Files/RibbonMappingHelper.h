@@ -49,6 +49,7 @@ namespace caret
     {
     public:
         ///compute per-vertex ribbon mapping weights - surfaces must have vertex correspondence, or an exception is thrown
+        ///numDivisions of 0 computes the exact polyhedron/voxel overlap instead of sampling NxNxN points per voxel
         static void computeWeightsRibbon(std::vector<std::vector<VoxelWeight> >& myWeightsOut, const VolumeSpace& myVolSpace,
                                          const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const float* roiFrame = NULL, const int& numDivisions = 3);
     };
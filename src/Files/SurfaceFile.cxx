@@ -44,6 +44,7 @@
 #include "GeodesicHelper.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
+#include "SurfaceHelperCache.h"
 #include "TopologyHelper.h"
 
 using namespace caret;
@@ -747,7 +748,7 @@ void SurfaceFile::getGeodesicHelper(CaretPointer<GeodesicHelper>& helpOut) const
         {
             m_geoHelpers.clear();//just to be sure
             m_geoHelperIndex = 0;
-            m_geoBase.grabNew(new GeodesicHelperBase(this));//yes, this takes some time, and is single threaded at the moment
+            m_geoBase = SurfaceHelperCache::getGeodesicHelperBase(this);//yes, this takes some time, so it can be loaded from the helper cache
         }//keep locked while searching
         int32_t& myIndex = m_geoHelperIndex;
         int32_t myEnd = m_geoHelpers.size();
@@ -795,7 +796,7 @@ void SurfaceFile::getTopologyHelper(CaretPointer<TopologyHelper>& helpOut, bool
         }
         if (m_topoBase == NULL || (infoSorted && !m_topoBase->isNodeInfoSorted()))
         {
-            m_topoBase.grabNew(new TopologyHelperBase(this, infoSorted));
+            m_topoBase = SurfaceHelperCache::getTopologyHelperBase(this, infoSorted);
         }
     }
     CaretPointer<TopologyHelper> ret(new TopologyHelper(m_topoBase));
@@ -0,0 +1,271 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceHelperCache.h"
+
+#include "CaretLogger.h"
+#include "GeodesicHelper.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcessEnvironment>
+#include <QTemporaryFile>
+
+#include <cstring>
+
+#ifdef CARET_OS_WINDOWS
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const char CACHE_MAGIC[8] = { 'W', 'B', 'H', 'E', 'L', 'P', 'E', 'R' };
+    const int32_t CACHE_FORMAT_VERSION = 1;
+    const uint32_t CACHE_BYTE_ORDER_CHECK = 0x01020304;
+    const int64_t DEFAULT_CACHE_LIMIT_MB = 4096;
+    
+    //64 bit FNV-1a
+    const uint64_t HASH_START = 14695981039346656037ULL;
+    
+    uint64_t hashBytes(const void* data, const int64_t& numBytes, uint64_t hash)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (int64_t i = 0; i < numBytes; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+    
+    AString getCacheFileName(const AString& cacheDir, const uint64_t& hash, const AString& extension)
+    {
+        return cacheDir + "/" + AString::number((qulonglong)hash, 16).rightJustified(16, '0') + extension;
+    }
+    
+    ///mark a cache file as recently used, eviction goes by modification time
+    void touchCacheFile(const AString& cacheFileName)
+    {
+#ifdef CARET_OS_WINDOWS
+        _utime(cacheFileName.toLocal8Bit().constData(), NULL);
+#else
+        utime(cacheFileName.toLocal8Bit().constData(), NULL);
+#endif
+    }
+    
+    int64_t getCacheLimitBytes()
+    {
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        AString limitString = env.value("WORKBENCH_HELPER_CACHE_MAX_MB");
+        int64_t limitMB = DEFAULT_CACHE_LIMIT_MB;
+        if (!limitString.isEmpty())
+        {
+            bool ok = false;
+            limitMB = limitString.toLongLong(&ok);
+            if (!ok || limitMB < 0)
+            {
+                CaretLogWarning("invalid value '" + limitString + "' for WORKBENCH_HELPER_CACHE_MAX_MB, using default");
+                limitMB = DEFAULT_CACHE_LIMIT_MB;
+            }
+        }
+        return limitMB * 1024 * 1024;
+    }
+    
+    ///delete least recently used cache files until the directory is under the size limit, never deleting the file just saved
+    void pruneCache(const AString& cacheDir, const AString& keepFileName)
+    {
+        QStringList filters;
+        filters << "*.topo" << "*.geo";
+        QFileInfoList cacheFiles = QDir(cacheDir).entryInfoList(filters, QDir::Files, QDir::Time | QDir::Reversed);//oldest first
+        int64_t totalSize = 0;
+        for (int i = 0; i < cacheFiles.size(); ++i)
+        {
+            totalSize += cacheFiles[i].size();
+        }
+        const int64_t limit = getCacheLimitBytes();
+        QString keepPath = QFileInfo(keepFileName).absoluteFilePath();
+        for (int i = 0; i < cacheFiles.size() && totalSize > limit; ++i)
+        {
+            if (cacheFiles[i].absoluteFilePath() == keepPath) continue;
+            if (QFile::remove(cacheFiles[i].absoluteFilePath()))
+            {
+                totalSize -= cacheFiles[i].size();
+            }//another process may have removed it already
+        }
+    }
+    
+    ///write to a temporary file and rename it into place, so other processes never see a partial file
+    template<typename T>
+    void saveToCache(const T* helperBase, const AString& cacheFileName, const uint64_t& hash)
+    {
+        try
+        {
+            QTemporaryFile tempFile(cacheFileName + ".XXXXXX");
+            tempFile.setAutoRemove(false);
+            if (!tempFile.open())
+            {
+                CaretLogWarning("unable to create temporary file for surface helper cache in " + QFileInfo(cacheFileName).absolutePath());
+                return;
+            }
+            AString tempName = tempFile.fileName();
+            tempFile.close();
+            helperBase->writeCacheFile(tempName, hash);
+            if (!QFile::rename(tempName, cacheFileName))
+            {//another process probably saved the same file first
+                QFile::remove(tempName);
+            }
+            pruneCache(QFileInfo(cacheFileName).absolutePath(), cacheFileName);
+        } catch (DataFileException& e) {
+            CaretLogWarning("failed to write surface helper cache file '" + cacheFileName + "': " + e.whatString());
+        }
+    }
+}
+
+AString SurfaceHelperCache::getCacheDirectory()
+{
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    AString ret = env.value("WORKBENCH_HELPER_CACHE_DIR");
+    if (ret.isEmpty()) return ret;
+    if (!QDir(ret).exists())
+    {
+        CaretLogWarning("surface helper cache directory '" + ret + "' does not exist, not caching");
+        return AString();
+    }
+    return ret;
+}
+
+uint64_t SurfaceHelperCache::computeTopologyHash(const SurfaceFile* surfIn)
+{
+    int32_t counts[2] = { surfIn->getNumberOfNodes(), surfIn->getNumberOfTriangles() };
+    uint64_t ret = hashBytes(counts, sizeof(counts), HASH_START);
+    if (counts[1] > 0)
+    {
+        ret = hashBytes(surfIn->getTriangle(0), counts[1] * 3 * sizeof(int32_t), ret);
+    }
+    return ret;
+}
+
+uint64_t SurfaceHelperCache::computeGeometryHash(const SurfaceFile* surfIn)
+{
+    uint64_t ret = computeTopologyHash(surfIn);
+    int32_t numNodes = surfIn->getNumberOfNodes();
+    if (numNodes > 0)
+    {
+        ret = hashBytes(surfIn->getCoordinateData(), numNodes * 3 * sizeof(float), ret);
+    }
+    return ret;
+}
+
+CaretPointer<TopologyHelperBase> SurfaceHelperCache::getTopologyHelperBase(const SurfaceFile* surfIn, const bool& sortNeighbors)
+{
+    CaretPointer<TopologyHelperBase> ret;
+    AString cacheDir = getCacheDirectory();
+    if (cacheDir.isEmpty())
+    {
+        ret.grabNew(new TopologyHelperBase(surfIn, sortNeighbors));
+        return ret;
+    }
+    uint64_t hash = computeTopologyHash(surfIn);
+    AString cacheFileName = getCacheFileName(cacheDir, hash, (sortNeighbors ? ".sorted.topo" : ".topo"));//neighbor order differs when sorted, so don't share cache files
+    if (QFile::exists(cacheFileName))
+    {
+        try
+        {
+            ret.grabNew(TopologyHelperBase::readCacheFile(cacheFileName, surfIn, hash));
+            if (ret != NULL)
+            {
+                touchCacheFile(cacheFileName);
+                return ret;
+            }
+        } catch (DataFileException& e) {
+            CaretLogWarning("ignoring unreadable surface helper cache file '" + cacheFileName + "': " + e.whatString());
+        }
+    }
+    ret.grabNew(new TopologyHelperBase(surfIn, sortNeighbors));
+    saveToCache(ret.getPointer(), cacheFileName, hash);
+    return ret;
+}
+
+CaretPointer<GeodesicHelperBase> SurfaceHelperCache::getGeodesicHelperBase(const SurfaceFile* surfIn)
+{
+    CaretPointer<GeodesicHelperBase> ret;
+    AString cacheDir = getCacheDirectory();
+    if (cacheDir.isEmpty())
+    {
+        ret.grabNew(new GeodesicHelperBase(surfIn));
+        return ret;
+    }
+    uint64_t hash = computeGeometryHash(surfIn);//distances depend on coordinates
+    AString cacheFileName = getCacheFileName(cacheDir, hash, ".geo");
+    if (QFile::exists(cacheFileName))
+    {
+        try
+        {
+            ret.grabNew(GeodesicHelperBase::readCacheFile(cacheFileName, surfIn, hash));
+            if (ret != NULL)
+            {
+                touchCacheFile(cacheFileName);
+                return ret;
+            }
+        } catch (DataFileException& e) {
+            CaretLogWarning("ignoring unreadable surface helper cache file '" + cacheFileName + "': " + e.whatString());
+        }
+    }
+    ret.grabNew(new GeodesicHelperBase(surfIn));
+    saveToCache(ret.getPointer(), cacheFileName, hash);
+    return ret;
+}
+
+void SurfaceHelperCache::writeHeader(CaretBinaryFile& file, const char fileType[4], const uint64_t& hash, const int32_t& numNodes, const int32_t& numTris)
+{
+    file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    file.write(fileType, 4);
+    file.write(&CACHE_FORMAT_VERSION, sizeof(int32_t));
+    file.write(&CACHE_BYTE_ORDER_CHECK, sizeof(uint32_t));
+    file.write(&hash, sizeof(uint64_t));
+    file.write(&numNodes, sizeof(int32_t));
+    file.write(&numTris, sizeof(int32_t));
+}
+
+bool SurfaceHelperCache::readHeader(CaretBinaryFile& file, const char fileType[4], const uint64_t& hash, const int32_t& numNodes, const int32_t& numTris)
+{
+    char magic[8], type[4];
+    int32_t version, fileNodes, fileTris;
+    uint32_t byteOrder;
+    uint64_t fileHash;
+    file.read(magic, sizeof(magic));
+    file.read(type, sizeof(type));
+    file.read(&version, sizeof(int32_t));
+    file.read(&byteOrder, sizeof(uint32_t));
+    file.read(&fileHash, sizeof(uint64_t));
+    file.read(&fileNodes, sizeof(int32_t));
+    file.read(&fileTris, sizeof(int32_t));
+    return (memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0 && memcmp(type, fileType, sizeof(type)) == 0 &&
+            version == CACHE_FORMAT_VERSION && byteOrder == CACHE_BYTE_ORDER_CHECK &&
+            fileHash == hash && fileNodes == numNodes && fileTris == numTris);
+}
@@ -0,0 +1,129 @@
+#ifndef __SURFACE_HELPER_CACHE_H__
+#define __SURFACE_HELPER_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretBinaryFile.h"
+#include "CaretPointer.h"
+#include "DataFileException.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    class GeodesicHelperBase;
+    class SurfaceFile;
+    class TopologyHelperBase;
+    
+    ///saves the expensive helper bases of fixed meshes to disk, keyed by a hash of the surface, so repeated commands on the same mesh can skip building them
+    ///caching is only done when the environment variable WORKBENCH_HELPER_CACHE_DIR names a directory
+    ///the directory is kept under WORKBENCH_HELPER_CACHE_MAX_MB (default 4096) by deleting the least recently used files after each save
+    class SurfaceHelperCache
+    {
+        SurfaceHelperCache();
+    public:
+        ///returns empty string if caching is disabled
+        static AString getCacheDirectory();
+        
+        ///hash of the vertex count and triangles
+        static uint64_t computeTopologyHash(const SurfaceFile* surfIn);
+        
+        ///hash of the topology and the coordinates
+        static uint64_t computeGeometryHash(const SurfaceFile* surfIn);
+        
+        ///load from the cache if possible, otherwise build (and save if caching is enabled)
+        static CaretPointer<TopologyHelperBase> getTopologyHelperBase(const SurfaceFile* surfIn, const bool& sortNeighbors);
+        
+        ///load from the cache if possible, otherwise build (and save if caching is enabled)
+        static CaretPointer<GeodesicHelperBase> getGeodesicHelperBase(const SurfaceFile* surfIn);
+        
+        ///common header for cache files, so stale or foreign files are rejected instead of misread
+        static void writeHeader(CaretBinaryFile& file, const char fileType[4], const uint64_t& hash, const int32_t& numNodes, const int32_t& numTris);
+        
+        ///returns false if the file was written for a different surface, type, format version, or machine
+        static bool readHeader(CaretBinaryFile& file, const char fileType[4], const uint64_t& hash, const int32_t& numNodes, const int32_t& numTris);
+        
+        template<typename T>
+        static void writeVector(CaretBinaryFile& file, const std::vector<T>& data)
+        {
+            int64_t size = (int64_t)data.size();
+            file.write(&size, sizeof(int64_t));
+            if (size > 0) file.write(data.data(), size * sizeof(T));
+        }
+        
+        template<typename T>
+        static void readVector(CaretBinaryFile& file, std::vector<T>& data, const int64_t& maxSize)
+        {
+            int64_t size;
+            file.read(&size, sizeof(int64_t));
+            if (size < 0 || size > maxSize)
+            {
+                throw DataFileException(file.getFilename(), "invalid array size in helper cache file");
+            }
+            data.resize(size);
+            if (size > 0) file.read(data.data(), size * sizeof(T));
+        }
+        
+        ///flattens per-vertex lists into counts and one contiguous array
+        template<typename T>
+        static void writeNestedVector(CaretBinaryFile& file, const std::vector<std::vector<T> >& data)
+        {
+            std::vector<int32_t> counts(data.size());
+            std::vector<T> flat;
+            for (size_t i = 0; i < data.size(); ++i)
+            {
+                counts[i] = (int32_t)data[i].size();
+                flat.insert(flat.end(), data[i].begin(), data[i].end());
+            }
+            writeVector(file, counts);
+            writeVector(file, flat);
+        }
+        
+        template<typename T>
+        static void readNestedVector(CaretBinaryFile& file, std::vector<std::vector<T> >& data, const int64_t& outerSize, const int64_t& maxFlatSize)
+        {
+            std::vector<int32_t> counts;
+            std::vector<T> flat;
+            readVector(file, counts, outerSize);
+            readVector(file, flat, maxFlatSize);
+            if ((int64_t)counts.size() != outerSize)
+            {
+                throw DataFileException(file.getFilename(), "wrong number of vertices in helper cache file");
+            }
+            data.resize(outerSize);
+            int64_t offset = 0;
+            for (int64_t i = 0; i < outerSize; ++i)
+            {
+                if (counts[i] < 0 || offset + counts[i] > (int64_t)flat.size())
+                {
+                    throw DataFileException(file.getFilename(), "inconsistent array sizes in helper cache file");
+                }
+                data[i].assign(flat.begin() + offset, flat.begin() + offset + counts[i]);
+                offset += counts[i];
+            }
+        }
+    };
+    
+}
+
+#endif //__SURFACE_HELPER_CACHE_H__
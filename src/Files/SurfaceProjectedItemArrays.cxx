@@ -0,0 +1,191 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SurfaceProjectedItemArrays.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "MathFunctions.h"
+#include "SurfaceFile.h"
+#include "SurfaceProjectedItem.h"
+#include "SurfaceProjectionBarycentric.h"
+#include "TopologyHelper.h"
+
+using namespace caret;
+using namespace std;
+
+SurfaceProjectedItemArrays::SurfaceProjectedItemArrays()
+{
+}
+
+void SurfaceProjectedItemArrays::clear()
+{
+    m_structures.clear();
+    m_baryNodes.clear();
+    m_baryAreas.clear();
+    m_baryDistance.clear();
+    m_baryNumNodes.clear();
+    m_baryValid.clear();
+    m_vanEssenIndex.clear();
+    m_vanEssen.clear();
+    m_stereoXYZ.clear();
+    m_stereoValid.clear();
+}
+
+void SurfaceProjectedItemArrays::reserve(const int64_t numItems)
+{
+    m_structures.reserve(numItems);
+    m_baryNodes.reserve(numItems * 3);
+    m_baryAreas.reserve(numItems * 3);
+    m_baryDistance.reserve(numItems);
+    m_baryNumNodes.reserve(numItems);
+    m_baryValid.reserve(numItems);
+    m_vanEssenIndex.reserve(numItems);
+    m_stereoXYZ.reserve(numItems * 3);
+    m_stereoValid.reserve(numItems);
+}
+
+void SurfaceProjectedItemArrays::append(const SurfaceProjectedItem* item)
+{
+    CaretAssert(item != NULL);
+    m_structures.push_back(item->getStructure());
+    const SurfaceProjectionBarycentric* myBary = item->getBarycentricProjection();
+    const int32_t* nodes = myBary->getTriangleNodes();
+    const float* areas = myBary->getTriangleAreas();
+    for (int k = 0; k < 3; ++k)
+    {
+        m_baryNodes.push_back(nodes[k]);
+        m_baryAreas.push_back(areas[k]);
+    }
+    m_baryDistance.push_back(myBary->getSignedDistanceAboveSurface());
+    m_baryNumNodes.push_back(myBary->getProjectionSurfaceNumberOfNodes());
+    m_baryValid.push_back(myBary->isValid() ? 1 : 0);
+    const SurfaceProjectionVanEssen* myVanEssen = item->getVanEssenProjection();
+    if (myVanEssen->isValid())
+    {
+        m_vanEssenIndex.push_back((int32_t)m_vanEssen.size());
+        m_vanEssen.push_back(*myVanEssen);
+    } else {
+        m_vanEssenIndex.push_back(-1);
+    }
+    const float* stereoXYZ = item->getStereotaxicXYZ();
+    for (int k = 0; k < 3; ++k)
+    {
+        m_stereoXYZ.push_back(stereoXYZ[k]);
+    }
+    m_stereoValid.push_back(item->isStereotaxicXYZValid() ? 1 : 0);
+}
+
+StructureEnum::Enum SurfaceProjectedItemArrays::getStructure(const int64_t index) const
+{
+    CaretAssertVectorIndex(m_structures, index);
+    return m_structures[index];
+}
+
+const int32_t* SurfaceProjectedItemArrays::getBarycentricTriangleNodes(const int64_t index) const
+{
+    CaretAssertVectorIndex(m_baryValid, index);
+    if (!m_baryValid[index]) return NULL;
+    return m_baryNodes.data() + index * 3;
+}
+
+void SurfaceProjectedItemArrays::getProjectedPositions(const SurfaceFile& surfaceFile, vector<float>& xyzOut, vector<char>& validOut,
+                                                       const bool isUnprojectedOntoSurface) const
+{
+    unprojectAll(surfaceFile, xyzOut, validOut, 0.0f, isUnprojectedOntoSurface);
+}
+
+void SurfaceProjectedItemArrays::getProjectedPositionsAboveSurface(const SurfaceFile& surfaceFile, vector<float>& xyzOut, vector<char>& validOut,
+                                                                   const float distanceAboveSurface) const
+{
+    unprojectAll(surfaceFile, xyzOut, validOut, distanceAboveSurface, true);
+}
+
+void SurfaceProjectedItemArrays::unprojectAll(const SurfaceFile& surfaceFile, vector<float>& xyzOut, vector<char>& validOut,
+                                              const float offsetFromSurface, const bool useOffset) const
+{//this is SurfaceProjectionBarycentric::unprojectToSurface inlined over the arrays, then the van essen and stereotaxic fallbacks
+    const int64_t numItems = getNumberOfItems();
+    xyzOut.resize(numItems * 3);
+    validOut.resize(numItems);
+    if (numItems == 0) return;
+    const int32_t numNodes = surfaceFile.getNumberOfNodes();
+    const float* coords = surfaceFile.getCoordinateData();
+    const float* normals = surfaceFile.getNormalData();
+    CaretPointer<TopologyHelper> myTopoHelp = surfaceFile.getTopologyHelper();
+#pragma omp CARET_PARFOR schedule(static) if (numItems > 1000)//borders are drawn one at a time, avoid thread startup for short ones
+    for (int64_t i = 0; i < numItems; ++i)
+    {
+        float* xyz = xyzOut.data() + i * 3;
+        bool valid = false;
+        if (m_baryValid[i] && (m_baryNumNodes[i] <= 0 || m_baryNumNodes[i] == numNodes))
+        {
+            const int32_t* nodes = m_baryNodes.data() + i * 3;
+            const float* areas = m_baryAreas.data() + i * 3;
+            CaretAssert(nodes[0] < numNodes && nodes[1] < numNodes && nodes[2] < numNodes);
+            if (myTopoHelp->getNodeHasNeighbors(nodes[0]) && myTopoHelp->getNodeHasNeighbors(nodes[1]) && myTopoHelp->getNodeHasNeighbors(nodes[2]))
+            {
+                const float* c1 = coords + nodes[0] * 3;
+                const float* c2 = coords + nodes[1] * 3;
+                const float* c3 = coords + nodes[2] * 3;
+                float baryXYZ[3], baryNormal[3];
+                if (nodes[0] == nodes[1] && nodes[1] == nodes[2])
+                {
+                    const float* nodeNormal = normals + nodes[0] * 3;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        baryXYZ[k] = c1[k];
+                        baryNormal[k] = nodeNormal[k];
+                    }
+                    valid = true;
+                } else {
+                    float area = areas[0] + areas[1] + areas[2];
+                    if (area != 0.0f)
+                    {
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            baryXYZ[k] = (areas[0] * c1[k] + areas[1] * c2[k] + areas[2] * c3[k]) / area;
+                        }
+                        valid = MathFunctions::normalVector(c1, c2, c3, baryNormal);
+                    }
+                }
+                if (valid)
+                {
+                    const float offset = (useOffset ? offsetFromSurface : m_baryDistance[i]);
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        xyz[k] = baryXYZ[k] + baryNormal[k] * offset;
+                    }
+                }
+            }
+        }
+        if (!valid && m_vanEssenIndex[i] >= 0)
+        {
+            valid = m_vanEssen[m_vanEssenIndex[i]].unprojectToSurface(surfaceFile, xyz, offsetFromSurface, useOffset);
+        }
+        if (!valid && m_stereoValid[i])
+        {
+            const float* stereoXYZ = m_stereoXYZ.data() + i * 3;
+            xyz[0] = stereoXYZ[0];
+            xyz[1] = stereoXYZ[1];
+            xyz[2] = stereoXYZ[2];
+            valid = true;
+        }
+        validOut[i] = (valid ? 1 : 0);
+    }
+}
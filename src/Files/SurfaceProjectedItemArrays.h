@@ -0,0 +1,92 @@
+#ifndef __SURFACE_PROJECTED_ITEM_ARRAYS_H__
+#define __SURFACE_PROJECTED_ITEM_ARRAYS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "StructureEnum.h"
+#include "SurfaceProjectionVanEssen.h"
+
+#include <vector>
+
+namespace caret
+{
+    
+    class SurfaceFile;
+    class SurfaceProjectedItem;
+    
+    ///contiguous copy of the projections of many SurfaceProjectedItems, for unprojecting them in bulk
+    class SurfaceProjectedItemArrays
+    {
+    public:
+        SurfaceProjectedItemArrays();
+        
+        void clear();
+        
+        void reserve(const int64_t numItems);
+        
+        void append(const SurfaceProjectedItem* item);
+        
+        int64_t getNumberOfItems() const { return (int64_t)m_structures.size(); }
+        
+        StructureEnum::Enum getStructure(const int64_t index) const;
+        
+        ///returns NULL if the item has no valid barycentric projection
+        const int32_t* getBarycentricTriangleNodes(const int64_t index) const;
+        
+        ///same fallback order as SurfaceProjectedItem::getProjectedPosition, validOut is 1 where the position is valid
+        void getProjectedPositions(const SurfaceFile& surfaceFile,
+                                   std::vector<float>& xyzOut,
+                                   std::vector<char>& validOut,
+                                   const bool isUnprojectedOntoSurface) const;
+        
+        ///same as SurfaceProjectedItem::getProjectedPositionAboveSurface, for every item
+        void getProjectedPositionsAboveSurface(const SurfaceFile& surfaceFile,
+                                               std::vector<float>& xyzOut,
+                                               std::vector<char>& validOut,
+                                               const float distanceAboveSurface) const;
+        
+    private:
+        void unprojectAll(const SurfaceFile& surfaceFile,
+                          std::vector<float>& xyzOut,
+                          std::vector<char>& validOut,
+                          const float offsetFromSurface,
+                          const bool useOffset) const;
+        
+        std::vector<StructureEnum::Enum> m_structures;
+        
+        //barycentric projection, 3 nodes and 3 areas per item
+        std::vector<int32_t> m_baryNodes;
+        std::vector<float> m_baryAreas;
+        std::vector<float> m_baryDistance;
+        std::vector<int32_t> m_baryNumNodes;
+        std::vector<char> m_baryValid;
+        
+        //index into m_vanEssen, or -1, van essen projections are rare, so they are stored sparsely
+        std::vector<int32_t> m_vanEssenIndex;
+        std::vector<SurfaceProjectionVanEssen> m_vanEssen;
+        
+        //stereotaxic fallback, 3 per item
+        std::vector<float> m_stereoXYZ;
+        std::vector<char> m_stereoValid;
+    };
+    
+}
+
+#endif //__SURFACE_PROJECTED_ITEM_ARRAYS_H__
@@ -34,6 +34,7 @@
 #include "TopologyHelper.h"
 #include "Vector3D.h"
 
+#include <algorithm>
 #include <set>
 #include <map>
 
@@ -81,6 +82,61 @@ void SurfaceResamplingHelper::resampleNormal(const float* input, float* output,
     }
 }
 
+void SurfaceResamplingHelper::resampleNormalMulti(const float* const* inputs, float* const* outputs, const int& numColumns, const float& invalidVal) const
+{
+    int numNodes = (int)m_weights.size() - 1;
+    if (numNodes < 0 || numColumns < 1) return;
+    const int BLOCK_COLUMNS = 32;//columns per tile, so each weight is loaded once per block and the tile row for a node is a couple of cache lines
+    int tileWidth = min(BLOCK_COLUMNS, numColumns);
+    vector<float> tile((int64_t)m_numInputNodes * tileWidth);
+    for (int blockStart = 0; blockStart < numColumns; blockStart += tileWidth)
+    {
+        int blockCols = min(tileWidth, numColumns - blockStart);
+        const float* const* blockInputs = inputs + blockStart;
+        float* const* blockOutputs = outputs + blockStart;
+#pragma omp CARET_PARFOR schedule(static, 4096)
+        for (int n = 0; n < m_numInputNodes; ++n)
+        {//transpose to vertex-major, so the gather for one weight reads all columns contiguously
+            float* tileRow = tile.data() + (int64_t)n * blockCols;
+            for (int c = 0; c < blockCols; ++c)
+            {
+                tileRow[c] = blockInputs[c][n];
+            }
+        }
+#pragma omp CARET_PAR
+        {
+            vector<double> accum(blockCols);
+#pragma omp CARET_FOR schedule(dynamic, 256)
+            for (int i = 0; i < numNodes; ++i)
+            {
+                WeightElem* end = m_weights[i + 1], *elem = m_weights[i];
+                if (elem != end)
+                {
+                    for (int c = 0; c < blockCols; ++c) accum[c] = 0.0;
+                    for (; elem != end; ++elem)
+                    {
+                        const float* tileRow = tile.data() + (int64_t)elem->node * blockCols;
+                        const double weight = elem->weight;
+                        for (int c = 0; c < blockCols; ++c)
+                        {
+                            accum[c] += tileRow[c] * weight;//weights already sum to 1, same as resampleNormal
+                        }
+                    }
+                    for (int c = 0; c < blockCols; ++c)
+                    {
+                        blockOutputs[c][i] = accum[c];
+                    }
+                } else {
+                    for (int c = 0; c < blockCols; ++c)
+                    {
+                        blockOutputs[c][i] = invalidVal;
+                    }
+                }
+            }
+        }
+    }
+}
+
 void SurfaceResamplingHelper::resample3DCoord(const float* input, float* output) const
 {
     int numNodes = (int)m_weights.size() - 1;
@@ -537,6 +593,7 @@ void SurfaceResamplingHelper::compactWeights(const vector<map<int, float> >& wei
 {
     int compactsize = 0;
     int numNodes = (int)weights.size();
+    m_numInputNodes = 0;
     m_weights = CaretArray<WeightElem*>(numNodes + 1);//include a "one-after" pointer
     for (int i = 0; i < numNodes; ++i)
     {
@@ -550,6 +607,7 @@ void SurfaceResamplingHelper::compactWeights(const vector<map<int, float> >& wei
         for (map<int, float>::const_iterator iter = weights[i].begin(); iter != weights[i].end(); ++iter)
         {
             m_storagechunk[curpos] = WeightElem(iter->first, iter->second);
+            if (iter->first >= m_numInputNodes) m_numInputNodes = iter->first + 1;
             ++curpos;
         }
     }
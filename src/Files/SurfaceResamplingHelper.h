@@ -42,6 +42,7 @@ namespace caret {
         };
         CaretArray<WeightElem> m_storagechunk;
         CaretArray<WeightElem*> m_weights;
+        int m_numInputNodes;//one more than the largest node referenced by the weights, for sizing the batch tiles
         static bool checkSphere(const SurfaceFile* surface);
         static void changeRadius(const float& radius, const SurfaceFile* input, SurfaceFile* output);
         void computeWeightsAdapBaryArea(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentAreas, const float* newAreas, const float* currentRoi);
@@ -49,11 +50,13 @@ namespace caret {
         static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
         void compactWeights(const std::vector<std::map<int, float> >& weights);
     public:
-        SurfaceResamplingHelper() { }
+        SurfaceResamplingHelper() : m_numInputNodes(0) { }
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                 const float* currentAreas = NULL, const float* newAreas = NULL, const float* currentRoi = NULL);
         ///resample real-valued data by means of weights
         void resampleNormal(const float* input, float* output, const float& invalidVal = 0.0f) const;
+        ///resample many columns of real-valued data at once, makes one pass through the weights per block of columns instead of one per column
+        void resampleNormalMulti(const float* const* inputs, float* const* outputs, const int& numColumns, const float& invalidVal = 0.0f) const;
         ///resample 3D coordinate data by means of weights
         void resample3DCoord(const float* input, float* output) const;
         ///resample label-like data according to which value gets the largest weight sum
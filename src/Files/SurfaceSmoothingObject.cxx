@@ -0,0 +1,165 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SurfaceSmoothingObject.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "MathFunctions.h"
+#include "ProgressObject.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+
+using namespace std;
+using namespace caret;
+
+SurfaceSmoothingObject::SurfaceSmoothingObject(const SurfaceFile* mySurf)
+{
+    CaretAssert(mySurf != NULL);
+    m_numNodes = mySurf->getNumberOfNodes();
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper(true);//the area weights need the neighbors sorted around the vertex
+    m_neighStart.resize(m_numNodes + 1);
+    m_neighStart[0] = 0;
+    m_maxNeighbors = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeigh;
+        myTopoHelp->getNodeNeighbors(i, numNeigh);
+        if (numNeigh > m_maxNeighbors) m_maxNeighbors = numNeigh;
+        m_neighStart[i + 1] = m_neighStart[i] + numNeigh;
+    }
+    m_neighbors.resize(m_neighStart[m_numNodes]);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeigh;
+        const int32_t* neighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
+        for (int32_t j = 0; j < numNeigh; ++j)
+        {
+            m_neighbors[m_neighStart[i] + j] = neighbors[j];
+        }
+    }
+}
+
+void SurfaceSmoothingObject::smooth(vector<float>& xInOut, vector<float>& yInOut, vector<float>& zInOut, const float& strength, const int32_t& iterations,
+                                    LevelProgress* progress) const
+{
+    if ((int32_t)xInOut.size() != m_numNodes || (int32_t)yInOut.size() != m_numNodes || (int32_t)zInOut.size() != m_numNodes)
+    {
+        throw CaretException("coordinate arrays do not match the surface number of vertices");
+    }
+    if (m_numNodes <= 0 || iterations <= 0) return;
+    const float inverseStrength = 1.0 - strength;
+    vector<float> xOut(m_numNodes), yOut(m_numNodes), zOut(m_numNodes);
+    float* coordIn[3] = { xInOut.data(), yInOut.data(), zInOut.data() };
+    float* coordOut[3] = { xOut.data(), yOut.data(), zOut.data() };
+    for (int32_t iter = 0; iter < iterations; ++iter)
+    {
+#pragma omp CARET_PAR
+        {
+            vector<float> triangleAreas(m_maxNeighbors), triangleCenters(m_maxNeighbors * 3);
+#pragma omp CARET_FOR schedule(static)
+            for (int32_t iNode = 0; iNode < m_numNodes; ++iNode)
+            {
+                const int64_t start = m_neighStart[iNode];
+                const int32_t numNeighbors = (int32_t)(m_neighStart[iNode + 1] - start);
+                const float c1[3] = { coordIn[0][iNode], coordIn[1][iNode], coordIn[2][iNode] };
+                if (numNeighbors < 2)
+                {
+                    for (int k = 0; k < 3; ++k) coordOut[k][iNode] = c1[k];
+                    continue;
+                }
+                double totalArea = 0.0;
+                for (int32_t jn = 0; jn < numNeighbors; ++jn)
+                {//triangle formed by the vertex and two consecutive neighbors
+                    const int32_t n1 = m_neighbors[start + jn];
+                    const int32_t n2 = m_neighbors[start + (jn + 1 < numNeighbors ? jn + 1 : 0)];
+                    const float c2[3] = { coordIn[0][n1], coordIn[1][n1], coordIn[2][n1] };
+                    const float c3[3] = { coordIn[0][n2], coordIn[1][n2], coordIn[2][n2] };
+                    const float area = MathFunctions::triangleArea(c1, c2, c3);
+                    triangleAreas[jn] = area;
+                    totalArea += area;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        triangleCenters[jn * 3 + k] = (c1[k] + c2[k] + c3[k]) / 3.0;
+                    }
+                }
+                float neighborAverage[3] = { 0.0f, 0.0f, 0.0f };
+                for (int32_t j = 0; j < numNeighbors; ++j)
+                {
+                    if (triangleAreas[j] > 0.0)
+                    {
+                        const float weight = triangleAreas[j] / totalArea;
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            neighborAverage[k] += weight * triangleCenters[j * 3 + k];
+                        }
+                    }
+                }
+                for (int k = 0; k < 3; ++k)
+                {
+                    coordOut[k][iNode] = c1[k] * inverseStrength + neighborAverage[k] * strength;
+                }
+            }
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            swap(coordIn[k], coordOut[k]);
+        }
+        if (progress != NULL)
+        {
+            progress->reportProgress(((float)iter + 1) / iterations);
+        }
+    }
+    if (coordIn[0] != xInOut.data())
+    {//odd number of iterations, result is in the scratch arrays
+        xInOut.swap(xOut);
+        yInOut.swap(yOut);
+        zInOut.swap(zOut);
+    }
+}
+
+void SurfaceSmoothingObject::getCoordinates(const SurfaceFile* mySurf, vector<float>& xOut, vector<float>& yOut, vector<float>& zOut)
+{
+    const int32_t numNodes = mySurf->getNumberOfNodes();
+    const float* coords = mySurf->getCoordinateData();
+    xOut.resize(numNodes);
+    yOut.resize(numNodes);
+    zOut.resize(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        xOut[i] = coords[i * 3];
+        yOut[i] = coords[i * 3 + 1];
+        zOut[i] = coords[i * 3 + 2];
+    }
+}
+
+void SurfaceSmoothingObject::setCoordinates(SurfaceFile* mySurf, const vector<float>& x, const vector<float>& y, const vector<float>& z)
+{
+    const int32_t numNodes = mySurf->getNumberOfNodes();
+    CaretAssert((int32_t)x.size() == numNodes && (int32_t)y.size() == numNodes && (int32_t)z.size() == numNodes);
+    vector<float> coords(numNodes * 3);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        coords[i * 3] = x[i];
+        coords[i * 3 + 1] = y[i];
+        coords[i * 3 + 2] = z[i];
+    }
+    mySurf->setCoordinates(coords.data());
+}
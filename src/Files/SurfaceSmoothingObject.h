@@ -0,0 +1,58 @@
+#ifndef __SURFACE_SMOOTHING_OBJECT_H__
+#define __SURFACE_SMOOTHING_OBJECT_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+//NOTE: this does the same area weighted neighbor averaging as AlgorithmSurfaceSmoothing, but keeps the sorted neighbor lists in a flat array, so that it can be
+//      constructed once and used for many rounds of smoothing (as in inflation).  Each iteration computes every vertex from the previous iteration's coordinates
+//      (Jacobi style), so results are identical regardless of the number of threads.
+
+#include "stdint.h"
+#include "stddef.h"
+#include <vector>
+
+namespace caret {
+    
+    class LevelProgress;
+    class SurfaceFile;
+    
+    class SurfaceSmoothingObject
+    {
+    public:
+        SurfaceSmoothingObject(const SurfaceFile* mySurf);
+        
+        ///coordinates are separate x, y, and z arrays, progress (if given) is reported as the fraction of iterations done
+        void smooth(std::vector<float>& xInOut, std::vector<float>& yInOut, std::vector<float>& zInOut, const float& strength, const int32_t& iterations,
+                    LevelProgress* progress = NULL) const;
+        
+        ///converts to and from the layout used by smooth()
+        static void getCoordinates(const SurfaceFile* mySurf, std::vector<float>& xOut, std::vector<float>& yOut, std::vector<float>& zOut);
+        static void setCoordinates(SurfaceFile* mySurf, const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z);
+    private:
+        int32_t m_numNodes, m_maxNeighbors;
+        std::vector<int64_t> m_neighStart;//m_numNodes + 1 elements
+        std::vector<int32_t> m_neighbors;//in order around each vertex
+        SurfaceSmoothingObject();
+    };
+    
+}
+
+#endif //__SURFACE_SMOOTHING_OBJECT_H__
@@ -19,8 +19,10 @@
 /*LICENSE_END*/
 
 #include "SurfaceFile.h"
+#include "SurfaceHelperCache.h"
 #include "TopologyHelper.h"
 #include "CaretAssert.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -109,6 +111,140 @@ TopologyHelperBase::TopologyHelperBase(const SurfaceFile* surfIn, bool sortFlag)
     }
 }
 
+TopologyHelperBase::TopologyHelperBase()
+{//only for readCacheFile, members are filled in there
+    m_maxNeigh = -1;
+    m_maxTiles = -1;
+    m_numNodes = 0;
+    m_numTris = 0;
+    m_neighborsSorted = false;
+}
+
+void TopologyHelperBase::writeCacheFile(const AString& filename, const uint64_t& topologyHash) const
+{
+    CaretBinaryFile outFile(filename, CaretBinaryFile::WRITE_TRUNCATE);
+    SurfaceHelperCache::writeHeader(outFile, "TOPO", topologyHash, m_numNodes, m_numTris);
+    int32_t sizes[3] = { (int32_t)sizeof(TopologyEdgeInfo), (int32_t)sizeof(TopologyTileInfo), (m_neighborsSorted ? 1 : 0) };
+    outFile.write(sizes, sizeof(sizes));
+    int32_t maxes[2] = { m_maxNeigh, m_maxTiles };
+    outFile.write(maxes, sizeof(maxes));
+    vector<int32_t> neighCounts(m_numNodes), tileCounts(m_numNodes), neighbors, edges, tiles, whichVertex;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        const NodeInfo& thisInfo = m_nodeInfo[i];
+        neighCounts[i] = (int32_t)thisInfo.m_neighbors.size();
+        tileCounts[i] = (int32_t)thisInfo.m_tiles.size();
+        neighbors.insert(neighbors.end(), thisInfo.m_neighbors.begin(), thisInfo.m_neighbors.end());
+        edges.insert(edges.end(), thisInfo.m_edges.begin(), thisInfo.m_edges.end());
+        tiles.insert(tiles.end(), thisInfo.m_tiles.begin(), thisInfo.m_tiles.end());
+        whichVertex.insert(whichVertex.end(), thisInfo.m_whichVertex.begin(), thisInfo.m_whichVertex.end());
+    }
+    SurfaceHelperCache::writeVector(outFile, neighCounts);
+    SurfaceHelperCache::writeVector(outFile, tileCounts);
+    SurfaceHelperCache::writeVector(outFile, neighbors);
+    SurfaceHelperCache::writeVector(outFile, edges);
+    SurfaceHelperCache::writeVector(outFile, tiles);
+    SurfaceHelperCache::writeVector(outFile, whichVertex);
+    SurfaceHelperCache::writeVector(outFile, m_boundaryCount);
+    SurfaceHelperCache::writeVector(outFile, m_edgeInfo);//plain structs, the header check rejects files from a build with a different layout
+    SurfaceHelperCache::writeVector(outFile, m_tileInfo);
+    outFile.close();
+}
+
+TopologyHelperBase* TopologyHelperBase::readCacheFile(const AString& filename, const SurfaceFile* surfIn, const uint64_t& topologyHash)
+{
+    CaretBinaryFile inFile(filename, CaretBinaryFile::READ);
+    int32_t numNodes = surfIn->getNumberOfNodes(), numTris = surfIn->getNumberOfTriangles();
+    if (!SurfaceHelperCache::readHeader(inFile, "TOPO", topologyHash, numNodes, numTris)) return NULL;
+    int32_t sizes[3], maxes[2];
+    inFile.read(sizes, sizeof(sizes));
+    if (sizes[0] != (int32_t)sizeof(TopologyEdgeInfo) || sizes[1] != (int32_t)sizeof(TopologyTileInfo)) return NULL;
+    inFile.read(maxes, sizeof(maxes));
+    CaretPointer<TopologyHelperBase> ret(new TopologyHelperBase());//in case reading throws
+    ret->m_numNodes = numNodes;
+    ret->m_numTris = numTris;
+    ret->m_neighborsSorted = (sizes[2] != 0);
+    ret->m_maxNeigh = maxes[0];
+    ret->m_maxTiles = maxes[1];
+    int64_t maxEntries = 6 * (int64_t)numTris;//each triangle contributes 2 neighbor entries to each of its 3 vertices at most
+    vector<int32_t> neighCounts, tileCounts, neighbors, edges, tiles, whichVertex;
+    SurfaceHelperCache::readVector(inFile, neighCounts, numNodes);
+    SurfaceHelperCache::readVector(inFile, tileCounts, numNodes);
+    SurfaceHelperCache::readVector(inFile, neighbors, maxEntries);
+    SurfaceHelperCache::readVector(inFile, edges, maxEntries);
+    SurfaceHelperCache::readVector(inFile, tiles, 3 * (int64_t)numTris);
+    SurfaceHelperCache::readVector(inFile, whichVertex, 3 * (int64_t)numTris);
+    SurfaceHelperCache::readVector(inFile, ret->m_boundaryCount, numNodes);
+    SurfaceHelperCache::readVector(inFile, ret->m_edgeInfo, 3 * (int64_t)numTris);
+    SurfaceHelperCache::readVector(inFile, ret->m_tileInfo, numTris);
+    if ((int32_t)neighCounts.size() != numNodes || (int32_t)tileCounts.size() != numNodes || neighbors.size() != edges.size() ||
+        tiles.size() != whichVertex.size() || (int32_t)ret->m_boundaryCount.size() != numNodes || (int32_t)ret->m_tileInfo.size() != numTris)
+    {
+        throw DataFileException(filename, "inconsistent array sizes in topology helper cache file");
+    }
+    int32_t numEdges = (int32_t)ret->m_edgeInfo.size();//don't trust indices from disk, anything out of range would be used unchecked later
+    for (int64_t i = 0; i < (int64_t)neighbors.size(); ++i)
+    {
+        if (neighbors[i] < 0 || neighbors[i] >= numNodes || edges[i] < 0 || edges[i] >= numEdges)
+        {
+            throw DataFileException(filename, "invalid neighbor or edge index in topology helper cache file");
+        }
+    }
+    for (int64_t i = 0; i < (int64_t)tiles.size(); ++i)
+    {
+        if (tiles[i] < 0 || tiles[i] >= numTris || whichVertex[i] < 0 || whichVertex[i] > 2)
+        {
+            throw DataFileException(filename, "invalid tile index in topology helper cache file");
+        }
+    }
+    for (int32_t i = 0; i < numEdges; ++i)
+    {
+        const TopologyEdgeInfo& thisEdge = ret->m_edgeInfo[i];
+        if (thisEdge.node1 < 0 || thisEdge.node1 >= numNodes || thisEdge.node2 < 0 || thisEdge.node2 >= numNodes || thisEdge.numTiles < 1)
+        {
+            throw DataFileException(filename, "invalid edge in topology helper cache file");
+        }
+        int32_t numEdgeTiles = min(thisEdge.numTiles, 2);//numTiles can be more than 2 on bad topology, but only 2 are stored
+        for (int32_t j = 0; j < numEdgeTiles; ++j)
+        {
+            if (thisEdge.tiles[j].tile < 0 || thisEdge.tiles[j].tile >= numTris || thisEdge.tiles[j].node3 < 0 || thisEdge.tiles[j].node3 >= numNodes ||
+                thisEdge.tiles[j].whichEdge < 0 || thisEdge.tiles[j].whichEdge > 2)
+            {
+                throw DataFileException(filename, "invalid edge in topology helper cache file");
+            }
+        }
+    }
+    for (int32_t i = 0; i < numTris; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            if (ret->m_tileInfo[i].edges[j].edge < 0 || ret->m_tileInfo[i].edges[j].edge >= numEdges)
+            {
+                throw DataFileException(filename, "invalid tile edge index in topology helper cache file");
+            }
+        }
+    }
+    ret->m_nodeInfo.resize(numNodes);
+    int64_t neighOffset = 0, tileOffset = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        if (neighCounts[i] < 0 || tileCounts[i] < 0 || neighCounts[i] > ret->m_maxNeigh || tileCounts[i] > ret->m_maxTiles || neighOffset + neighCounts[i] > (int64_t)neighbors.size() || tileOffset + tileCounts[i] > (int64_t)tiles.size())
+        {
+            throw DataFileException(filename, "inconsistent array sizes in topology helper cache file");
+        }
+        NodeInfo& thisInfo = ret->m_nodeInfo[i];
+        thisInfo.m_neighbors.assign(neighbors.begin() + neighOffset, neighbors.begin() + neighOffset + neighCounts[i]);
+        thisInfo.m_edges.assign(edges.begin() + neighOffset, edges.begin() + neighOffset + neighCounts[i]);
+        thisInfo.m_tiles.assign(tiles.begin() + tileOffset, tiles.begin() + tileOffset + tileCounts[i]);
+        thisInfo.m_whichVertex.assign(whichVertex.begin() + tileOffset, whichVertex.begin() + tileOffset + tileCounts[i]);
+        neighOffset += neighCounts[i];
+        tileOffset += tileCounts[i];
+    }
+    TopologyHelperBase* retPointer = ret.getPointer();
+    ret.releasePointer();
+    return retPointer;
+}
+
 //1) check mark array
 //      a) if marked, find edge, add triangle to edge
 //      b) if unmarked, make edge from triangle, add neighbor, add reverse neighbor
@@ -22,6 +22,7 @@
 /*LICENSE_END*/
 
 #include <vector>
+#include "AString.h"
 #include "CaretPointer.h"
 
 namespace caret {
@@ -79,7 +80,7 @@ namespace caret {
     
     class TopologyHelperBase
     {
-        TopologyHelperBase();//prevent default, copy, assign
+        TopologyHelperBase();//only for readCacheFile, prevent copy, assign
         TopologyHelperBase(const TopologyHelperBase&);
         TopologyHelperBase& operator=(const TopologyHelperBase&);
         void processTileNeighbor(std::vector<TopologyEdgeInfo>& tempEdgeInfo, CaretArray<int32_t>& scratch, const int32_t& root, const int32_t& neighbor, const int32_t& thirdNode, const int32_t& tile, const int32_t& tileEdge, const bool& reversed);
@@ -109,6 +110,9 @@ namespace caret {
         bool m_neighborsSorted;
     public:
         TopologyHelperBase(const SurfaceFile* surfIn, bool sortNeighbors = false);
+        ///read a file written by writeCacheFile, returns NULL if it was written for a different surface
+        static TopologyHelperBase* readCacheFile(const AString& filename, const SurfaceFile* surfIn, const uint64_t& topologyHash);
+        void writeCacheFile(const AString& filename, const uint64_t& topologyHash) const;
         bool isNodeInfoSorted() const {
             return m_neighborsSorted;
         }
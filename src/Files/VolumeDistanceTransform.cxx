@@ -0,0 +1,146 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "VolumeDistanceTransform.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "Vector3D.h"
+#include "VolumeSpace.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const float INF = numeric_limits<float>::infinity();
+    
+    ///lower envelope of parabolas along one line, spacing2 is the squared voxel spacing along the line
+    void transformLine(const float* f, const int64_t* nearestIn, const int64_t& length, const double& spacing2,
+                       int64_t* hullSites, double* hullBounds, float* distOut, int64_t* nearestOut)
+    {
+        int64_t k = -1;
+        for (int64_t q = 0; q < length; ++q)
+        {
+            if (f[q] == INF) continue;
+            double s = 0.0;
+            while (k >= 0)
+            {
+                const int64_t v = hullSites[k];
+                s = ((f[q] + spacing2 * q * q) - (f[v] + spacing2 * v * v)) / (2.0 * spacing2 * (q - v));
+                if (s > hullBounds[k]) break;
+                --k;
+            }
+            ++k;
+            hullSites[k] = q;
+            hullBounds[k] = (k == 0 ? -numeric_limits<double>::infinity() : s);
+            hullBounds[k + 1] = numeric_limits<double>::infinity();
+        }
+        if (k < 0)
+        {
+            for (int64_t q = 0; q < length; ++q)
+            {
+                distOut[q] = INF;
+                nearestOut[q] = -1;
+            }
+            return;
+        }
+        int64_t j = 0;
+        for (int64_t q = 0; q < length; ++q)
+        {
+            while (hullBounds[j + 1] < q) ++j;
+            const int64_t v = hullSites[j];
+            distOut[q] = spacing2 * (q - v) * (q - v) + f[v];
+            nearestOut[q] = nearestIn[v];
+        }
+    }
+    
+    ///runs transformLine on every line along one axis, in place
+    void transformAxis(const int64_t dims[3], const int& axis, const double& spacing2, vector<float>& dist, vector<int64_t>& nearest)
+    {
+        const int64_t strides[3] = { 1, dims[0], dims[0] * dims[1] };
+        const int other1 = (axis == 0 ? 1 : 0), other2 = (axis == 2 ? 1 : 2);
+        const int64_t length = dims[axis], stride = strides[axis];
+        const int64_t numLines = dims[other1] * dims[other2];
+#pragma omp CARET_PAR
+        {
+            vector<float> lineIn(length), lineOut(length);
+            vector<int64_t> nearIn(length), nearOut(length), hullSites(length);
+            vector<double> hullBounds(length + 1);
+#pragma omp CARET_FOR schedule(static)
+            for (int64_t line = 0; line < numLines; ++line)
+            {
+                const int64_t start = (line % dims[other1]) * strides[other1] + (line / dims[other1]) * strides[other2];
+                for (int64_t q = 0; q < length; ++q)
+                {
+                    lineIn[q] = dist[start + q * stride];
+                    nearIn[q] = nearest[start + q * stride];
+                }
+                transformLine(lineIn.data(), nearIn.data(), length, spacing2, hullSites.data(), hullBounds.data(), lineOut.data(), nearOut.data());
+                for (int64_t q = 0; q < length; ++q)
+                {
+                    dist[start + q * stride] = lineOut[q];
+                    nearest[start + q * stride] = nearOut[q];
+                }
+            }
+        }
+    }
+}
+
+bool VolumeDistanceTransform::isSeparable(const VolumeSpace& mySpace)
+{
+    Vector3D ivec, jvec, kvec, origin;
+    mySpace.getSpacingVectors(ivec, jvec, kvec, origin);
+    const float tolerance = 0.0001f;
+    if (abs(ivec.dot(jvec)) > tolerance * ivec.length() * jvec.length()) return false;
+    if (abs(jvec.dot(kvec)) > tolerance * jvec.length() * kvec.length()) return false;
+    if (abs(kvec.dot(ivec)) > tolerance * kvec.length() * ivec.length()) return false;
+    return true;
+}
+
+void VolumeDistanceTransform::compute(const VolumeSpace& mySpace, const vector<char>& isSource, vector<float>& distSquaredOut, vector<int64_t>& nearestOut)
+{
+    CaretAssert(isSeparable(mySpace));
+    const int64_t* dims = mySpace.getDims();
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    CaretAssert((int64_t)isSource.size() == frameSize);
+    Vector3D steps[3], origin;
+    mySpace.getSpacingVectors(steps[0], steps[1], steps[2], origin);
+    distSquaredOut.resize(frameSize);
+    nearestOut.resize(frameSize);
+    for (int64_t i = 0; i < frameSize; ++i)
+    {
+        if (isSource[i])
+        {
+            distSquaredOut[i] = 0.0f;
+            nearestOut[i] = i;
+        } else {
+            distSquaredOut[i] = INF;
+            nearestOut[i] = -1;
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const double spacing = steps[axis].length();
+        transformAxis(dims, axis, spacing * spacing, distSquaredOut, nearestOut);
+    }
+}
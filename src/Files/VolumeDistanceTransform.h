@@ -0,0 +1,44 @@
+#ifndef __VOLUME_DISTANCE_TRANSFORM_H__
+#define __VOLUME_DISTANCE_TRANSFORM_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+    
+    class VolumeSpace;
+    
+    ///exact euclidean distance transform (Felzenszwalb and Huttenlocher), linear time in the number of voxels
+    class VolumeDistanceTransform
+    {
+    public:
+        ///the transform is separable only when the index vectors are orthogonal (rotation is fine, skew is not)
+        static bool isSeparable(const VolumeSpace& mySpace);
+        
+        ///squared distance in mm from every voxel center to the nearest source voxel center, and the frame index of that source (-1 if there are no sources)
+        static void compute(const VolumeSpace& mySpace, const std::vector<char>& isSource, std::vector<float>& distSquaredOut, std::vector<int64_t>& nearestOut);
+    };
+    
+}
+
+#endif //__VOLUME_DISTANCE_TRANSFORM_H__
@@ -26,6 +26,7 @@
 
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretTemporaryFile.h"
 #include "ChartDataCartesian.h"
 #include "ChartDataSource.h"
@@ -45,6 +46,7 @@
 #include "VolumeFileVoxelColorizer.h"
 #include "VolumeSpline.h"
 
+#include <algorithm>
 #include <limits>
 
 using namespace caret;
@@ -53,6 +55,8 @@ using namespace std;
 const float VolumeFile::INVALID_INTERP_VALUE = 0.0f;//we may want NaN or something more obvious
 bool VolumeFile::s_voxelColoringEnabled = true;
 
+int16_t VolumeFile::s_defaultWritingDataType = NIFTI_TYPE_FLOAT32;
+
 /**
  * Static method that sets the status of voxel coloring.  Coloring may take
  * time and is almost never needed during command line operations (wb_command).
@@ -74,6 +78,18 @@ VolumeFile::setVoxelColoringEnabled(const bool enabled)
 }
 
 
+void VolumeFile::setDefaultWritingDataType(const int16_t& type)
+{
+    if (!NiftiHeader::isSupportedOutputType(type)) throw DataFileException("unsupported datatype for volume output: " + AString::number(type));
+    s_defaultWritingDataType = type;
+}
+
+void VolumeFile::setWritingDataType(const int16_t& type)
+{
+    if (!NiftiHeader::isSupportedOutputType(type)) throw DataFileException("unsupported datatype for volume output: " + AString::number(type));
+    m_writingDataType = type;
+}
+
 VolumeFile::VolumeFile()
 : VolumeBase(), CaretMappableDataFile(DataFileTypeEnum::VOLUME)
 {
@@ -85,6 +101,7 @@ VolumeFile::VolumeFile()
         m_chartingEnabledForTab[i] = false;
     }
     m_volumeFileEditorDelegate.grabNew(NULL);
+    m_writingDataType = s_defaultWritingDataType;
     validateMembers();
 }
 
@@ -99,6 +116,7 @@ VolumeFile::VolumeFile(const vector<int64_t>& dimensionsIn, const vector<vector<
         m_chartingEnabledForTab[i] = false;
     }
     m_volumeFileEditorDelegate.grabNew(NULL);
+    m_writingDataType = s_defaultWritingDataType;
     validateMembers();
     setType(whatType);
 }
@@ -311,7 +329,24 @@ VolumeFile::writeFile(const AString& filename)
     outHeader.clearDataScaling();
     outHeader.setSForm(getVolumeSpace().getSform());
     outHeader.setDimensions(getOriginalDimensions());
-    outHeader.setDataType(NIFTI_TYPE_FLOAT32);
+    int16_t outType = m_writingDataType;
+    if (getType() == SubvolumeAttributes::LABEL) outType = NIFTI_TYPE_FLOAT32;//label keys must stay exact, don't let an integer output type scale them
+    outHeader.setDataType(outType);
+    if (outType != NIFTI_TYPE_FLOAT32 && outType != NIFTI_TYPE_FLOAT64)
+    {//integer output, check whether the data needs scaling to fit
+        double minVal = numeric_limits<double>::infinity(), maxVal = -numeric_limits<double>::infinity(), mult, offset;
+        bool allIntegers = true;
+        vector<int64_t> myDims;
+        getDimensions(myDims);
+        for (int64_t b = 0; b < myDims[3]; ++b)
+        {
+            NiftiHeader::accumulateDataRange(getFrame(b), myDims[0] * myDims[1] * myDims[2], minVal, maxVal, allIntegers);
+        }
+        if (NiftiHeader::computeDataScaling(outType, minVal, maxVal, allIntegers, mult, offset))
+        {
+            outHeader.setDataScaling(mult, offset);
+        }
+    }
     NiftiIO myIO;
     int outVersion = 1;
     if (!outHeader.canWriteVersion(1)) outVersion = 2;
@@ -415,6 +450,87 @@ float VolumeFile::interpolateValue(const float coordIn1, const float coordIn2, c
     return INVALID_INTERP_VALUE;
 }
 
+void VolumeFile::interpolateValues(const float* coordsIn, const int64_t& numCoords, float* valuesOut, InterpType interp, bool* validOut, const int64_t brickIndex, const int64_t component) const
+{
+    const int64_t* dimensions = getDimensionsPtr();
+    CaretAssert(brickIndex >= 0 && brickIndex < dimensions[3]);
+    CaretAssert(component >= 0 && component < dimensions[4]);
+    const vector<vector<float> >& inverse = getVolumeSpace().getInverseSform();
+    const float inv[12] = { inverse[0][0], inverse[0][1], inverse[0][2], inverse[0][3],
+                            inverse[1][0], inverse[1][1], inverse[1][2], inverse[1][3],
+                            inverse[2][0], inverse[2][1], inverse[2][2], inverse[2][3] };//flatten once, so the inner loops don't chase vector pointers
+    const int64_t dimi = dimensions[0], dimj = dimensions[1], dimk = dimensions[2], slice = dimi * dimj;
+    const float* frame = getFrame(brickIndex, component);
+    VolumeSpline* mySpline = NULL;
+    if (interp == CUBIC)
+    {
+        validateSpline(brickIndex, component);//once for the whole batch, rather than taking the lock check per coordinate
+        mySpline = &(m_frameSplines[component * dimensions[3] + brickIndex]);
+    }
+    const int64_t BLOCK_SIZE = 256;
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t blockStart = 0; blockStart < numCoords; blockStart += BLOCK_SIZE)
+    {
+        float blockInd[3][BLOCK_SIZE];
+        const int64_t blockCount = min(BLOCK_SIZE, numCoords - blockStart);
+        const float* blockCoords = coordsIn + blockStart * 3;
+        for (int64_t n = 0; n < blockCount; ++n)
+        {//branch-free, so the transform vectorizes
+            const float* coord = blockCoords + n * 3;
+            blockInd[0][n] = coord[0] * inv[0] + coord[1] * inv[1] + coord[2] * inv[2] + inv[3];
+            blockInd[1][n] = coord[0] * inv[4] + coord[1] * inv[5] + coord[2] * inv[6] + inv[7];
+            blockInd[2][n] = coord[0] * inv[8] + coord[1] * inv[9] + coord[2] * inv[10] + inv[11];
+        }
+        float* blockOut = valuesOut + blockStart;
+        bool* blockValid = (validOut == NULL ? NULL : validOut + blockStart);
+        switch (interp)
+        {
+            case CUBIC:
+            case TRILINEAR:
+                for (int64_t n = 0; n < blockCount; ++n)
+                {
+                    const float index1 = blockInd[0][n], index2 = blockInd[1][n], index3 = blockInd[2][n];
+                    const int64_t ind1low = (int64_t)floor(index1), ind2low = (int64_t)floor(index2), ind3low = (int64_t)floor(index3);
+                    if (ind1low < 0 || ind2low < 0 || ind3low < 0 || ind1low + 1 >= dimi || ind2low + 1 >= dimj || ind3low + 1 >= dimk)
+                    {//same validity rule as interpolateValue
+                        blockOut[n] = INVALID_INTERP_VALUE;
+                        if (blockValid != NULL) blockValid[n] = false;
+                        continue;
+                    }
+                    if (blockValid != NULL) blockValid[n] = true;
+                    if (interp == CUBIC)
+                    {
+                        blockOut[n] = mySpline->sample(index1, index2, index3);
+                        continue;
+                    }
+                    const float* base = frame + ind1low + dimi * ind2low + slice * ind3low;
+                    const float xhighWeight = index1 - ind1low, yhighWeight = index2 - ind2low, zhighWeight = index3 - ind3low;
+                    const float xlowWeight = 1.0f - xhighWeight, ylowWeight = 1.0f - yhighWeight, zlowWeight = 1.0f - zhighWeight;
+                    const float x00 = xlowWeight * base[0] + xhighWeight * base[1];
+                    const float x10 = xlowWeight * base[dimi] + xhighWeight * base[dimi + 1];
+                    const float x01 = xlowWeight * base[slice] + xhighWeight * base[slice + 1];
+                    const float x11 = xlowWeight * base[slice + dimi] + xhighWeight * base[slice + dimi + 1];
+                    blockOut[n] = zlowWeight * (ylowWeight * x00 + yhighWeight * x10) + zhighWeight * (ylowWeight * x01 + yhighWeight * x11);
+                }
+                break;
+            case ENCLOSING_VOXEL:
+                for (int64_t n = 0; n < blockCount; ++n)
+                {
+                    const int64_t index1 = (int64_t)floor(0.5f + blockInd[0][n]), index2 = (int64_t)floor(0.5f + blockInd[1][n]), index3 = (int64_t)floor(0.5f + blockInd[2][n]);
+                    if (index1 < 0 || index2 < 0 || index3 < 0 || index1 >= dimi || index2 >= dimj || index3 >= dimk)
+                    {
+                        blockOut[n] = INVALID_INTERP_VALUE;
+                        if (blockValid != NULL) blockValid[n] = false;
+                    } else {
+                        blockOut[n] = frame[index1 + dimi * index2 + slice * index3];
+                        if (blockValid != NULL) blockValid[n] = true;
+                    }
+                }
+                break;
+        }
+    }
+}
+
 void VolumeFile::validateSpline(const int64_t brickIndex, const int64_t component) const
 {
     const int64_t* dimensions = getDimensionsPtr();
@@ -495,107 +611,106 @@ bool VolumeFile::matchesVolumeSpace(const int64_t dims[3], const vector<vector<f
 
 void VolumeFile::parseExtensions()
 {
-    const int NIFTI_ECODE_CARET = 30;//this should probably go in nifti1.h
     if (m_header != NULL && m_header->getType() == AbstractHeader::NIFTI)
     {
-        const NiftiHeader& myHeader = *((NiftiHeader*)m_header.getPointer());
-        int numExtensions = (int)myHeader.m_extensions.size();
-        int whichExt = -1, whichType = -1;//type will track caret's preference in which extension to read, the greater the type, the more it prefers it
-        for (int i = 0; i < numExtensions; ++i)
+        readCaretExtension(*((NiftiHeader*)m_header.getPointer()), m_caretVolExt);
+    }
+    validateMembers();
+}
+
+bool VolumeFile::readCaretExtension(const NiftiHeader& myHeader, CaretVolumeExtension& extOut)
+{
+    const int NIFTI_ECODE_CARET = 30;//this should probably go in nifti1.h
+    int numExtensions = (int)myHeader.m_extensions.size();
+    int whichExt = -1, whichType = -1;//type will track caret's preference in which extension to read, the greater the type, the more it prefers it
+    for (int i = 0; i < numExtensions; ++i)
+    {
+        const NiftiExtension& myNiftiExtension = *(myHeader.m_extensions[i]);
+        switch (myNiftiExtension.m_ecode)
         {
-            const NiftiExtension& myNiftiExtension = *(myHeader.m_extensions[i]);
-            switch (myNiftiExtension.m_ecode)
-            {
-                case NIFTI_ECODE_CARET:
-                    if (100 > whichType)//mostly to make it use the first caret extension it finds in the list of extensions
-                    {
-                        whichExt = i;
-                        whichType = 100;//caret extension gets maximum priority
-                    }
-                    break;
-                default:
-                    break;
-            }
-            break;
+            case NIFTI_ECODE_CARET:
+                if (100 > whichType)//mostly to make it use the first caret extension it finds in the list of extensions
+                {
+                    whichExt = i;
+                    whichType = 100;//caret extension gets maximum priority
+                }
+                break;
+            default:
+                break;
         }
-        if (whichExt != -1)
+        break;
+    }
+    if (whichExt != -1)
+    {
+        switch (whichType)
         {
-            switch (whichType)
+            case 100://caret extension
             {
-                case 100://caret extension
-                {
-                    QByteArray myByteArray(myHeader.m_extensions[whichExt]->m_bytes.data(), myHeader.m_extensions[whichExt]->m_bytes.size());
-                    AString myString(myByteArray);
-                    m_caretVolExt.readFromXmlString(myString);
-                    break;
-                }
-                default:
-                    break;
+                QByteArray myByteArray(myHeader.m_extensions[whichExt]->m_bytes.data(), myHeader.m_extensions[whichExt]->m_bytes.size());
+                AString myString(myByteArray);
+                extOut.readFromXmlString(myString);
+                return true;
             }
+            default:
+                break;
         }
     }
-    validateMembers();
+    return false;
 }
 
 void VolumeFile::updateCaretExtension()
+{
+    if (m_header == NULL) m_header.grabNew(new NiftiHeader());
+    switch (m_header->getType())
+    {
+        case AbstractHeader::NIFTI:
+            writeCaretExtension(*((NiftiHeader*)m_header.getPointer()), m_caretVolExt);
+            break;
+    }
+}
+
+void VolumeFile::writeCaretExtension(NiftiHeader& myHeader, CaretVolumeExtension& caretExt)
 {
     const int NIFTI_ECODE_CARET = 30;//this should probably go in nifti1.h
     stringstream mystream;
     XmlWriter myWriter(mystream);
-    m_caretVolExt.writeAsXML(myWriter);
+    caretExt.writeAsXML(myWriter);
     string myStr = mystream.str();
-    if (m_header == NULL) m_header.grabNew(new NiftiHeader());
-    switch (m_header->getType())
+    int numExtensions = (int)myHeader.m_extensions.size();
+    for (int i = 0; i < numExtensions; ++i)//erase all existing caret extensions
     {
-        case AbstractHeader::NIFTI:
+        NiftiExtension* myNiftiExtension = myHeader.m_extensions[i];
+        if (myNiftiExtension->m_ecode == NIFTI_ECODE_CARET)
         {
-            NiftiHeader& myHeader = *((NiftiHeader*)m_header.getPointer());
-            int numExtensions = (int)myHeader.m_extensions.size();
-            for (int i = 0; i < numExtensions; ++i)//erase all existing caret extensions
-            {
-                NiftiExtension* myNiftiExtension = myHeader.m_extensions[i];
-                if (myNiftiExtension->m_ecode == NIFTI_ECODE_CARET)
-                {
-                    myHeader.m_extensions.erase(myHeader.m_extensions.begin() + i);
-                    --i;
-                    --numExtensions;
-                }
-            }
-            CaretPointer<NiftiExtension> newExt(new NiftiExtension());
-            newExt->m_ecode = NIFTI_ECODE_CARET;
-            int length = myStr.length();
-            newExt->m_bytes.resize(length + 1);//allocate a null byte for safety
-            for (int i = 0; i < length; ++i)
-            {
-                newExt->m_bytes[i] = myStr[i];
-            }
-            newExt->m_bytes[length] = '\0';
-            myHeader.m_extensions.push_back(newExt);
-            break;
+            myHeader.m_extensions.erase(myHeader.m_extensions.begin() + i);
+            --i;
+            --numExtensions;
         }
     }
+    CaretPointer<NiftiExtension> newExt(new NiftiExtension());
+    newExt->m_ecode = NIFTI_ECODE_CARET;
+    int length = myStr.length();
+    newExt->m_bytes.resize(length + 1);//allocate a null byte for safety
+    for (int i = 0; i < length; ++i)
+    {
+        newExt->m_bytes[i] = myStr[i];
+    }
+    newExt->m_bytes[length] = '\0';
+    myHeader.m_extensions.push_back(newExt);
 }
 
-void VolumeFile::validateMembers()
+void VolumeFile::validateCaretExtension(CaretVolumeExtension& caretExt, const int64_t& numMaps)
 {
-    m_dataRangeValid = false;
-    const int64_t* dimensions = getDimensionsPtr();
-    m_frameSplineValid = vector<bool>(dimensions[3] * dimensions[4], false);
-    m_frameSplines = vector<VolumeSpline>(dimensions[3] * dimensions[4]);//release any previous spline memory
-    m_splinesValid = true;//this now indicates only if they need to all be recalculated - the frame vectors will always have the correct length
-    int numMaps = getNumberOfMaps();
-    m_brickAttributes.resize(numMaps);//only resize, if this was called from reinitialize, it has called clear() beforehand
-    m_brickStatisticsValid = true;
-    int curAttribNum = (int)m_caretVolExt.m_attributes.size();
+    int64_t curAttribNum = (int64_t)caretExt.m_attributes.size();
     if (curAttribNum != numMaps)
     {
-        m_caretVolExt.m_attributes.resize(numMaps);
+        caretExt.m_attributes.resize(numMaps);
     }
     bool isLabel = false;
     SubvolumeAttributes::VolumeType theType = SubvolumeAttributes::ANATOMY;
-    if (numMaps > 0 && curAttribNum > 0 && m_caretVolExt.m_attributes[0] != NULL)
+    if (numMaps > 0 && curAttribNum > 0 && caretExt.m_attributes[0] != NULL)
     {
-        theType = m_caretVolExt.m_attributes[0]->m_type;
+        theType = caretExt.m_attributes[0]->m_type;
         if (theType == SubvolumeAttributes::UNKNOWN)
         {
             theType = SubvolumeAttributes::ANATOMY;
@@ -605,33 +720,46 @@ void VolumeFile::validateMembers()
             isLabel = true;
         }
     }
-    for (int i = 0; i < numMaps; ++i)
+    for (int64_t i = 0; i < numMaps; ++i)
     {
-        if (m_caretVolExt.m_attributes[i] == NULL)
+        if (caretExt.m_attributes[i] == NULL)
         {
-            m_caretVolExt.m_attributes[i].grabNew(new SubvolumeAttributes());
+            caretExt.m_attributes[i].grabNew(new SubvolumeAttributes());
         }
-        m_caretVolExt.m_attributes[i]->m_type = theType;
+        caretExt.m_attributes[i]->m_type = theType;
         if (isLabel)
         {
-            m_caretVolExt.m_attributes[i]->m_palette.grabNew(NULL);
-            if (m_caretVolExt.m_attributes[i]->m_labelTable == NULL)
+            caretExt.m_attributes[i]->m_palette.grabNew(NULL);
+            if (caretExt.m_attributes[i]->m_labelTable == NULL)
             {
-                m_caretVolExt.m_attributes[i]->m_labelTable.grabNew(new GiftiLabelTable());//TODO: populate the label table by means of the frame values?
+                caretExt.m_attributes[i]->m_labelTable.grabNew(new GiftiLabelTable());//TODO: populate the label table by means of the frame values?
             }
         } else {
-            m_caretVolExt.m_attributes[i]->m_labelTable.grabNew(NULL);
-            if (m_caretVolExt.m_attributes[i]->m_palette == NULL)
+            caretExt.m_attributes[i]->m_labelTable.grabNew(NULL);
+            if (caretExt.m_attributes[i]->m_palette == NULL)
             {
-                m_caretVolExt.m_attributes[i]->m_palette.grabNew(new PaletteColorMapping());
+                caretExt.m_attributes[i]->m_palette.grabNew(new PaletteColorMapping());
                 if (theType == SubvolumeAttributes::ANATOMY)
                 {
-                    m_caretVolExt.m_attributes[i]->m_palette->setSelectedPaletteName(Palette::GRAY_INTERP_POSITIVE_PALETTE_NAME);
-                    m_caretVolExt.m_attributes[i]->m_palette->setScaleMode(PaletteScaleModeEnum::MODE_AUTO_SCALE_PERCENTAGE);
+                    caretExt.m_attributes[i]->m_palette->setSelectedPaletteName(Palette::GRAY_INTERP_POSITIVE_PALETTE_NAME);
+                    caretExt.m_attributes[i]->m_palette->setScaleMode(PaletteScaleModeEnum::MODE_AUTO_SCALE_PERCENTAGE);
                 }
             }
         }
     }
+}
+
+void VolumeFile::validateMembers()
+{
+    m_dataRangeValid = false;
+    const int64_t* dimensions = getDimensionsPtr();
+    m_frameSplineValid = vector<bool>(dimensions[3] * dimensions[4], false);
+    m_frameSplines = vector<VolumeSpline>(dimensions[3] * dimensions[4]);//release any previous spline memory
+    m_splinesValid = true;//this now indicates only if they need to all be recalculated - the frame vectors will always have the correct length
+    int numMaps = getNumberOfMaps();
+    m_brickAttributes.resize(numMaps);//only resize, if this was called from reinitialize, it has called clear() beforehand
+    m_brickStatisticsValid = true;
+    validateCaretExtension(m_caretVolExt, numMaps);
     
     setPaletteNormalizationMode(PaletteNormalizationModeEnum::NORMALIZATION_SELECTED_MAP_DATA);
     
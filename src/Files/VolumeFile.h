@@ -38,6 +38,7 @@
 namespace caret {
     
     class GroupAndNameHierarchyModel;
+    class NiftiHeader;
     class VolumeFileEditorDelegate;
     class VolumeFileVoxelColorizer;
     class VolumeSpline;
@@ -117,6 +118,10 @@ namespace caret {
         
         CaretPointer<VolumeFileEditorDelegate> m_volumeFileEditorDelegate;
         
+        int16_t m_writingDataType;
+        
+        static int16_t s_defaultWritingDataType;
+        
     protected:
         virtual void saveFileDataToScene(const SceneAttributes* sceneAttributes,
                                          SceneClass* sceneClass);
@@ -140,6 +145,20 @@ namespace caret {
         
         static void setVoxelColoringEnabled(const bool enabled);
         
+        ///nifti datatype for new VolumeFile objects and on-disk volume output, set by wb_command's -output-datatype option
+        static void setDefaultWritingDataType(const int16_t& type);
+        
+        static int16_t getDefaultWritingDataType() { return s_defaultWritingDataType; }
+        
+        ///parse the caret extension of a nifti header, returns false if it has none (also used by the frame streaming classes)
+        static bool readCaretExtension(const NiftiHeader& header, CaretVolumeExtension& extOut);
+        
+        ///replace any caret extensions in a nifti header with the given one
+        static void writeCaretExtension(NiftiHeader& header, CaretVolumeExtension& caretExt);
+        
+        ///resize to the number of maps and fill in missing types, palettes and label tables, the same way a loaded VolumeFile does
+        static void validateCaretExtension(CaretVolumeExtension& caretExt, const int64_t& numMaps);
+        
         VolumeFile();
         VolumeFile(const std::vector<int64_t>& dimensionsIn, const std::vector<std::vector<float> >& indexToSpace, const int64_t numComponents = 1, SubvolumeAttributes::VolumeType whatType = SubvolumeAttributes::ANATOMY);
         ~VolumeFile();
@@ -168,6 +187,10 @@ namespace caret {
 
         float interpolateValue(const float coordIn1, const float coordIn2, const float coordIn3, InterpType interp = TRILINEAR, bool* validOut = NULL, const int64_t brickIndex = 0, const int64_t component = 0) const;
 
+        ///interpolate many coordinates (xyz interleaved) from one frame at once, validOut is NULL or an array of numCoords
+        void interpolateValues(const float* coordsIn, const int64_t& numCoords, float* valuesOut, InterpType interp = TRILINEAR, bool* validOut = NULL,
+                               const int64_t brickIndex = 0, const int64_t component = 0) const;
+
         ///returns true if volume space matches in spatial dimensions and sform
         bool matchesVolumeSpace(const VolumeFile* right) const;
         
@@ -180,6 +203,11 @@ namespace caret {
         void readFile(const AString& filename);
 
         void writeFile(const AString& filename);
+        
+        ///nifti datatype used by writeFile, integer types get scaling computed from the data
+        void setWritingDataType(const int16_t& type);
+        
+        int16_t getWritingDataType() const { return m_writingDataType; }
 
         bool isEmpty() const { return VolumeBase::isEmpty(); }
         
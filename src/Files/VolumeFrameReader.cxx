@@ -0,0 +1,204 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeFrameReader.h"
+
+#include "CaretAssert.h"
+#include "CaretBinaryFile.h"
+#include "CaretTemporaryFile.h"
+#include "DataFile.h"
+#include "DataFileException.h"
+#include "VolumeFile.h"
+
+#include <QDir>
+#include <QTemporaryFile>
+
+using namespace caret;
+using namespace std;
+
+VolumeFrameReader::VolumeFrameReader()
+{
+    m_numBricks = 0;
+    m_frameSize = 0;
+    m_numComponents = 0;
+    m_fullDims = 0;
+}
+
+VolumeFrameReader::~VolumeFrameReader()
+{
+}
+
+void VolumeFrameReader::openFile(const AString& filename)
+{
+    close();
+    AString fileToRead = filename;
+    if (DataFile::isFileOnNetwork(filename))
+    {
+        m_tempFile.grabNew(new CaretTemporaryFile());
+        m_tempFile->readFile(filename);
+        fileToRead = m_tempFile->getFileName();
+    }
+    m_fileName = filename;
+    m_readFileName = fileToRead;
+    m_io.openRead(fileToRead);
+    const NiftiHeader& inHeader = m_io.getHeader();
+    m_numComponents = m_io.getNumComponents();
+    m_origDims = m_io.getDimensions();
+    m_fullDims = 3;//deal with nifti with less than 3 dimensions, same as VolumeFile::readFile
+    if (m_origDims.size() < 3) m_fullDims = (int)m_origDims.size();
+    m_extraDims.clear();
+    if (m_origDims.size() > 3)
+    {
+        m_extraDims = vector<int64_t>(m_origDims.begin() + 3, m_origDims.end());
+    }
+    while (m_origDims.size() < 3) m_origDims.push_back(1);
+    m_frameSize = m_origDims[0] * m_origDims[1] * m_origDims[2];
+    m_numBricks = 1;
+    for (int i = 0; i < (int)m_extraDims.size(); ++i)
+    {
+        m_numBricks *= m_extraDims[i];
+    }
+    m_volSpace = VolumeSpace(m_origDims.data(), inHeader.getSForm());
+    m_caretVolExt.clear();
+    VolumeFile::readCaretExtension(inHeader, m_caretVolExt);
+    VolumeFile::validateCaretExtension(m_caretVolExt, m_numBricks);//so map names and types look the same as when loaded by VolumeFile
+}
+
+SubvolumeAttributes::VolumeType VolumeFrameReader::getType() const
+{
+    if (m_caretVolExt.m_attributes.empty()) return SubvolumeAttributes::ANATOMY;
+    return m_caretVolExt.m_attributes[0]->m_type;
+}
+
+AString VolumeFrameReader::getMapName(const int64_t& mapIndex) const
+{
+    CaretAssertVectorIndex(m_caretVolExt.m_attributes, mapIndex);
+    return m_caretVolExt.m_attributes[mapIndex]->m_guiLabel;
+}
+
+int64_t VolumeFrameReader::getMapIndexFromNameOrNumber(const AString& mapName) const
+{
+    bool ok = false;
+    int64_t ret = mapName.toInt(&ok) - 1;//compensate for 1-indexing that command line parsing uses
+    if (ok)
+    {
+        if (ret < 0 || ret >= m_numBricks) ret = -1;
+        return ret;
+    }//don't search by name if it parsed as an integer, same as CaretMappableDataFile
+    for (int64_t i = 0; i < m_numBricks; ++i)
+    {
+        if (mapName == getMapName(i)) return i;
+    }
+    return -1;
+}
+
+void VolumeFrameReader::readFrame(float* frameOut, const int64_t& brickIndex, const int64_t& component)
+{
+    CaretAssert(brickIndex >= 0 && brickIndex < m_numBricks);
+    CaretAssert(component >= 0 && component < m_numComponents);
+    vector<int64_t> indexSelect(m_extraDims.size());
+    int64_t remaining = brickIndex;
+    for (int i = 0; i < (int)m_extraDims.size(); ++i)
+    {//brick index is flat with the first extra dimension varying fastest, same as VolumeBase
+        indexSelect[i] = remaining % m_extraDims[i];
+        remaining /= m_extraDims[i];
+    }
+    if (m_numComponents == 1)
+    {
+        m_io.readData(frameOut, m_fullDims, indexSelect);
+    } else {
+        m_readBuffer.resize(m_frameSize * m_numComponents);
+        m_io.readData(m_readBuffer.data(), m_fullDims, indexSelect);
+        for (int64_t i = 0; i < m_frameSize; ++i)
+        {
+            frameOut[i] = m_readBuffer[i * m_numComponents + component];
+        }
+    }
+}
+
+void VolumeFrameReader::decompressForSliceReads()
+{
+    if (!m_readFileName.endsWith(".gz") || m_decompressedFile != NULL) return;
+    AString tempPath = QDir::tempPath();
+    if (!tempPath.endsWith('/')) tempPath += '/';
+    CaretPointer<QTemporaryFile> tempOut(new QTemporaryFile(tempPath + "wb_decompressed.XXXXXX.nii"));
+    if (!tempOut->open())
+    {
+        throw DataFileException(m_fileName, "unable to create temporary file for decompression");
+    }
+    CaretBinaryFile inFile(m_readFileName, CaretBinaryFile::READ);
+    vector<char> buffer(1 << 24);
+    int64_t numRead = 0;
+    do
+    {//whole file including header and extensions, so the copy opens the same way
+        inFile.read(buffer.data(), buffer.size(), &numRead);
+        if (numRead > 0 && tempOut->write(buffer.data(), numRead) != numRead)
+        {
+            throw DataFileException(m_fileName, "failed to write decompressed data to temporary file '" + tempOut->fileName() + "'");
+        }
+    } while (numRead == (int64_t)buffer.size());
+    inFile.close();
+    tempOut->close();
+    m_io.close();
+    m_io.openRead(tempOut->fileName());
+    m_decompressedFile = tempOut;
+}
+
+void VolumeFrameReader::readSlices(float* slicesOut, const int64_t& firstSlice, const int64_t& numSlices, const int64_t& brickIndex)
+{
+    CaretAssert(m_numComponents == 1);
+    if (m_numComponents != 1) throw DataFileException(m_fileName, "reading slices of multi-component volumes is not supported");
+    CaretAssert(firstSlice >= 0 && numSlices >= 0 && firstSlice + numSlices <= m_origDims[2]);
+    if (m_fullDims < 3)
+    {//1 or 2 dimensional file, there is only one slice
+        CaretAssert(firstSlice == 0 && numSlices <= 1);
+        if (numSlices > 0) readFrame(slicesOut, brickIndex);
+        return;
+    }
+    vector<int64_t> indexSelect(m_extraDims.size() + 1);
+    int64_t remaining = brickIndex;
+    for (int i = 0; i < (int)m_extraDims.size(); ++i)
+    {
+        indexSelect[i + 1] = remaining % m_extraDims[i];
+        remaining /= m_extraDims[i];
+    }
+    int64_t sliceSize = m_origDims[0] * m_origDims[1];
+    for (int64_t k = 0; k < numSlices; ++k)
+    {//slices are sequential within a frame, so this doesn't seek backwards
+        indexSelect[0] = firstSlice + k;
+        m_io.readData(slicesOut + k * sliceSize, 2, indexSelect);
+    }
+}
+
+void VolumeFrameReader::close()
+{
+    m_io.close();
+    m_tempFile.grabNew(NULL);
+    m_decompressedFile.grabNew(NULL);
+    m_fileName = "";
+    m_readFileName = "";
+    m_caretVolExt.clear();
+    m_origDims.clear();
+    m_extraDims.clear();
+    m_numBricks = 0;
+    m_frameSize = 0;
+    m_numComponents = 0;
+}
@@ -0,0 +1,100 @@
+#ifndef __VOLUME_FRAME_READER_H__
+#define __VOLUME_FRAME_READER_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretPointer.h"
+#include "CaretVolumeExtension.h"
+#include "NiftiIO.h"
+#include "VolumeSpace.h"
+
+#include <stdint.h>
+#include <vector>
+
+class QTemporaryFile;
+
+namespace caret {
+
+    class CaretTemporaryFile;
+    
+    ///reads a volume file one frame (or group of slices) at a time without loading the voxel data, the on-disk counterpart of VolumeFile::readFile
+    class VolumeFrameReader
+    {
+        VolumeFrameReader(const VolumeFrameReader&);
+        VolumeFrameReader& operator=(const VolumeFrameReader&);
+        NiftiIO m_io;
+        CaretPointer<CaretTemporaryFile> m_tempFile;//for files on the network, keeps the downloaded copy alive
+        CaretPointer<QTemporaryFile> m_decompressedFile;
+        AString m_fileName, m_readFileName;
+        VolumeSpace m_volSpace;
+        CaretVolumeExtension m_caretVolExt;
+        std::vector<int64_t> m_origDims, m_extraDims;
+        int64_t m_numBricks, m_frameSize;
+        int m_numComponents, m_fullDims;
+        std::vector<float> m_readBuffer;
+    public:
+        VolumeFrameReader();
+        ~VolumeFrameReader();
+        
+        void openFile(const AString& filename);
+        
+        const AString& getFileName() const { return m_fileName; }
+        
+        const VolumeSpace& getVolumeSpace() const { return m_volSpace; }
+        
+        bool matchesVolumeSpace(const VolumeSpace& otherSpace) const { return m_volSpace.matches(otherSpace); }
+        
+        ///always has at least 3 elements, like VolumeFile
+        const std::vector<int64_t>& getOriginalDimensions() const { return m_origDims; }
+        
+        int64_t getNumberOfMaps() const { return m_numBricks; }
+        
+        int getNumberOfComponents() const { return m_numComponents; }
+        
+        int64_t getFrameSize() const { return m_frameSize; }
+        
+        SubvolumeAttributes::VolumeType getType() const;
+        
+        AString getMapName(const int64_t& mapIndex) const;
+        
+        ///same rules as CaretMappableDataFile::getMapIndexFromNameOrNumber, returns -1 if not found
+        int64_t getMapIndexFromNameOrNumber(const AString& mapName) const;
+        
+        ///name, type, palette and label table of each map
+        const CaretVolumeExtension& getCaretExtension() const { return m_caretVolExt; }
+        
+        ///read one frame of one component
+        void readFrame(float* frameOut, const int64_t& brickIndex, const int64_t& component = 0);
+        
+        ///if the file is gzipped, decompress it once to a temporary file and read from that instead, so reading slices of every frame in turn, or frames out of order, doesn't restart decompression each time
+        void decompressForSliceReads();
+        
+        ///read a contiguous range of k slices from one frame, only for single component files
+        void readSlices(float* slicesOut, const int64_t& firstSlice, const int64_t& numSlices, const int64_t& brickIndex);
+        
+        void close();
+    };
+    
+}
+
+#endif //__VOLUME_FRAME_READER_H__
@@ -0,0 +1,222 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeFrameWriter.h"
+
+#include "CaretAssert.h"
+#include "DataFileException.h"
+#include "MultiDimIterator.h"
+#include "VolumeFile.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+VolumeFrameWriter::VolumeFrameWriter()
+{
+    m_numBricks = 0;
+    m_frameSize = 0;
+    m_nextBrick = 0;
+    m_headerWritten = false;
+    m_finished = false;
+    m_outVersion = 1;
+    m_minVal = 0.0;
+    m_maxVal = 0.0;
+    m_allIntegers = true;
+}
+
+VolumeFrameWriter::~VolumeFrameWriter()
+{
+    if (m_headerWritten && !m_finished)
+    {
+        m_io.close();
+        if (m_floatName != "")
+        {
+            QFile::remove(m_floatName);
+        }
+        if (m_writingName != m_fileName)
+        {//don't leave partial temporary files lying around after an exception
+            QFile::remove(m_writingName);
+        }
+    }
+}
+
+void VolumeFrameWriter::setWritingFile(const AString& filename, const bool& useTemporaryFile)
+{
+    CaretAssert(!m_headerWritten);
+    m_fileName = filename;
+    if (useTemporaryFile)
+    {//keep the same file name ending, so that compression is still detected from the extension
+        QFileInfo myInfo(filename);
+        m_writingName = myInfo.absolutePath() + "/.wbtemp_" + AString::number(QCoreApplication::applicationPid()) + "_" + myInfo.fileName();
+    } else {
+        m_writingName = filename;
+    }
+}
+
+void VolumeFrameWriter::writeHeader(const vector<int64_t>& dims, const vector<vector<float> >& sform, CaretVolumeExtension& extension)
+{
+    CaretAssert(!m_headerWritten);
+    if (m_fileName == "") throw DataFileException("no filename set for on-disk volume output");
+    if (dims.size() < 3) throw DataFileException(m_fileName, "volume output must have at least 3 dimensions");
+    m_origDims = dims;
+    m_extraDims = vector<int64_t>(dims.begin() + 3, dims.end());
+    m_volSpace = VolumeSpace(dims.data(), sform);
+    m_frameSize = dims[0] * dims[1] * dims[2];
+    m_numBricks = 1;
+    for (int i = 0; i < (int)m_extraDims.size(); ++i)
+    {
+        m_numBricks *= m_extraDims[i];
+    }
+    VolumeFile::validateCaretExtension(extension, m_numBricks);
+    NiftiHeader outHeader;//same as VolumeFile::writeFile, without a previous header to copy
+    outHeader.setSForm(sform);
+    outHeader.setDimensions(dims);
+    int16_t outType = VolumeFile::getDefaultWritingDataType();
+    for (int i = 0; i < (int)extension.m_attributes.size(); ++i)
+    {
+        if (extension.m_attributes[i]->m_type == SubvolumeAttributes::LABEL) outType = NIFTI_TYPE_FLOAT32;//same as VolumeFile::writeFile, label keys must stay exact
+    }
+    outHeader.setDataType(outType);
+    VolumeFile::writeCaretExtension(outHeader, extension);
+    int outVersion = 1;
+    if (!outHeader.canWriteVersion(1)) outVersion = 2;
+    if (outType == NIFTI_TYPE_FLOAT32 || outType == NIFTI_TYPE_FLOAT64)
+    {
+        m_floatName = "";
+        m_io.writeNew(m_writingName, outHeader, outVersion);
+    } else {//integer scaling needs the range of all frames, so write floats to an uncompressed temporary and convert it at the end
+        m_outHeader = outHeader;
+        m_outVersion = outVersion;
+        m_minVal = numeric_limits<double>::infinity();
+        m_maxVal = -numeric_limits<double>::infinity();
+        m_allIntegers = true;
+        QFileInfo myInfo(m_writingName);
+        m_floatName = myInfo.absolutePath() + "/.wbtemp_float_" + AString::number(QCoreApplication::applicationPid()) + "_" + myInfo.completeBaseName() + ".nii";
+        NiftiHeader floatHeader = outHeader;
+        floatHeader.setDataType(NIFTI_TYPE_FLOAT32);
+        m_io.writeNew(m_floatName, floatHeader, outVersion);
+    }
+    m_nextBrick = 0;
+    m_headerWritten = true;
+    m_finished = false;
+}
+
+void VolumeFrameWriter::writeHeader(const vector<int64_t>& dims, const vector<vector<float> >& sform)
+{
+    CaretVolumeExtension myExt;//empty extension gets anatomy defaults from validateCaretExtension
+    writeHeader(dims, sform, myExt);
+}
+
+void VolumeFrameWriter::writeHeader(const VolumeSpace& volSpace, const vector<AString>& mapNames)
+{
+    CaretVolumeExtension myExt;
+    VolumeFile::validateCaretExtension(myExt, mapNames.size());
+    for (int64_t i = 0; i < (int64_t)mapNames.size(); ++i)
+    {
+        myExt.m_attributes[i]->m_guiLabel = mapNames[i];
+    }
+    const int64_t* spaceDims = volSpace.getDims();
+    vector<int64_t> dims(spaceDims, spaceDims + 3);
+    if (mapNames.size() > 1) dims.push_back(mapNames.size());//VolumeFile::reinitialize does the same
+    writeHeader(dims, volSpace.getSform(), myExt);
+}
+
+void VolumeFrameWriter::writeFrame(const float* frameIn, const int64_t& brickIndex)
+{
+    CaretAssert(m_headerWritten && !m_finished);
+    if (brickIndex != m_nextBrick)
+    {
+        throw DataFileException(m_fileName, "frames of on-disk volume output must be written in order, expected frame " +
+                                AString::number(m_nextBrick + 1) + ", got " + AString::number(brickIndex + 1));
+    }
+    vector<int64_t> indexSelect(m_extraDims.size());
+    int64_t remaining = brickIndex;
+    for (int i = 0; i < (int)m_extraDims.size(); ++i)
+    {//first extra dimension varies fastest, same as VolumeBase
+        indexSelect[i] = remaining % m_extraDims[i];
+        remaining /= m_extraDims[i];
+    }
+    m_io.writeData(frameIn, 3, indexSelect);
+    if (m_floatName != "") NiftiHeader::accumulateDataRange(frameIn, m_frameSize, m_minVal, m_maxVal, m_allIntegers);
+    ++m_nextBrick;
+}
+
+void VolumeFrameWriter::writeVolumeFile(VolumeFile& volume)
+{
+    CaretAssert(!m_headerWritten);
+    volume.writeFile(m_writingName);//finish() still does the rename if a temporary file is used
+    m_volSpace = volume.getVolumeSpace();
+    m_numBricks = volume.getNumberOfMaps();
+    m_nextBrick = m_numBricks;
+    m_headerWritten = true;
+    m_finished = false;
+}
+
+void VolumeFrameWriter::finish()
+{
+    if (!m_headerWritten) throw DataFileException(m_fileName, "on-disk volume output was never written");
+    if (m_finished) return;
+    if (m_nextBrick != m_numBricks)
+    {
+        throw DataFileException(m_fileName, "on-disk volume output was not completely written, only " +
+                                AString::number(m_nextBrick) + " of " + AString::number(m_numBricks) + " frames");
+    }
+    m_io.close();
+    if (m_floatName != "")
+    {
+        double mult, offset;
+        if (NiftiHeader::computeDataScaling(m_outHeader.getDataType(), m_minVal, m_maxVal, m_allIntegers, mult, offset))
+        {
+            m_outHeader.setDataScaling(mult, offset);
+        }
+        NiftiIO floatIO;
+        floatIO.openRead(m_floatName);
+        m_io.writeNew(m_writingName, m_outHeader, m_outVersion);
+        vector<float> scratchFrame(m_frameSize);
+        for (MultiDimIterator<int64_t> iter(m_extraDims); !iter.atEnd(); ++iter)
+        {//same frame order as writeFrame
+            floatIO.readData(scratchFrame.data(), 3, *iter);
+            m_io.writeData(scratchFrame.data(), 3, *iter);
+        }
+        floatIO.close();
+        m_io.close();
+        QFile::remove(m_floatName);
+        m_floatName = "";
+    }
+    if (m_writingName != m_fileName)
+    {
+        if (QFile::exists(m_fileName) && !QFile::remove(m_fileName))
+        {
+            throw DataFileException(m_fileName, "unable to remove old file to replace it with temporary file '" + m_writingName + "'");
+        }
+        if (!QFile::rename(m_writingName, m_fileName))
+        {
+            throw DataFileException(m_fileName, "unable to rename temporary file '" + m_writingName + "'");
+        }
+    }
+    m_finished = true;
+}
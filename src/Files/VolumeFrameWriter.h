@@ -0,0 +1,90 @@
+#ifndef __VOLUME_FRAME_WRITER_H__
+#define __VOLUME_FRAME_WRITER_H__
+
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretVolumeExtension.h"
+#include "NiftiIO.h"
+#include "VolumeSpace.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    class VolumeFile;
+    
+    ///writes a float volume file one frame at a time, the on-disk counterpart of VolumeFile::writeFile
+    class VolumeFrameWriter
+    {
+        VolumeFrameWriter(const VolumeFrameWriter&);
+        VolumeFrameWriter& operator=(const VolumeFrameWriter&);
+        NiftiIO m_io;
+        AString m_fileName, m_writingName, m_floatName;//m_floatName is a float32 temporary when the output is an integer type, converted in finish()
+        NiftiHeader m_outHeader;
+        int m_outVersion;
+        double m_minVal, m_maxVal;
+        bool m_allIntegers;
+        VolumeSpace m_volSpace;
+        std::vector<int64_t> m_origDims, m_extraDims;
+        int64_t m_numBricks, m_frameSize, m_nextBrick;
+        bool m_headerWritten, m_finished;
+    public:
+        VolumeFrameWriter();
+        ~VolumeFrameWriter();
+        
+        ///set the output name, if useTemporaryFile is true, writes to a different file in the same directory and renames it when finished (for when the output overwrites an input)
+        void setWritingFile(const AString& filename, const bool& useTemporaryFile = false);
+        
+        const AString& getFileName() const { return m_fileName; }
+        
+        ///creates the file, dims has at least 3 elements, extra dimensions are flattened into map indices the same as VolumeFile, extension is resized and filled in to match
+        void writeHeader(const std::vector<int64_t>& dims, const std::vector<std::vector<float> >& sform, CaretVolumeExtension& extension);
+        
+        ///anatomy-style output with unnamed maps, like a freshly reinitialized VolumeFile
+        void writeHeader(const std::vector<int64_t>& dims, const std::vector<std::vector<float> >& sform);
+        
+        ///anatomy-style output, one map per name
+        void writeHeader(const VolumeSpace& volSpace, const std::vector<AString>& mapNames);
+        
+        bool isHeaderWritten() const { return m_headerWritten; }
+        
+        const VolumeSpace& getVolumeSpace() const { return m_volSpace; }
+        
+        int64_t getNumberOfMaps() const { return m_numBricks; }
+        
+        int64_t getFrameSize() const { return m_frameSize; }
+        
+        ///frames must be written in order, so that compressed output works
+        void writeFrame(const float* frameIn, const int64_t& brickIndex);
+        
+        ///write a complete in-memory volume instead of using writeHeader and writeFrame, for data that frames can't represent, like multiple components
+        void writeVolumeFile(VolumeFile& volume);
+        
+        ///closes the file, and renames the temporary file if used, throws if not all frames were written
+        void finish();
+    };
+    
+}
+
+#endif //__VOLUME_FRAME_WRITER_H__
@@ -0,0 +1,363 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "VolumeGradientObject.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "MathFunctions.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    //bit of a neighbor in the neighborhood mask, the center (bit 13) is never set for a valid neighbor
+    int neighborBit(const int& di, const int& dj, const int& dk)
+    {
+        return (dk + 1) * 9 + (dj + 1) * 3 + (di + 1);
+    }
+    
+    const uint32_t OUTSIDE_ROI = 1u << 13;
+    
+    void addToRegression(double regress[4][4], const Vector3D& displacement)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                regress[r][c] += displacement[r] * displacement[c];
+            }
+            regress[r][3] += displacement[r];
+            regress[3][r] += displacement[r];
+        }
+        regress[3][3] += 1.0;
+    }
+    
+    //gauss-jordan with partial pivoting, returns false if singular
+    bool invert4(double mat[4][4], double inv[4][4])
+    {
+        for (int r = 0; r < 4; ++r)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                inv[r][c] = (r == c ? 1.0 : 0.0);
+            }
+        }
+        for (int c = 0; c < 4; ++c)
+        {
+            int pivot = c;
+            for (int r = c + 1; r < 4; ++r)
+            {
+                if (abs(mat[r][c]) > abs(mat[pivot][c])) pivot = r;
+            }
+            if (mat[pivot][c] == 0.0) return false;
+            for (int k = 0; k < 4; ++k)
+            {
+                swap(mat[c][k], mat[pivot][k]);
+                swap(inv[c][k], inv[pivot][k]);
+            }
+            const double scale = 1.0 / mat[c][c];
+            for (int k = 0; k < 4; ++k)
+            {
+                mat[c][k] *= scale;
+                inv[c][k] *= scale;
+            }
+            for (int r = 0; r < 4; ++r)
+            {
+                if (r == c) continue;
+                const double factor = mat[r][c];
+                for (int k = 0; k < 4; ++k)
+                {
+                    mat[r][k] -= factor * mat[c][k];
+                    inv[r][k] -= factor * inv[c][k];
+                }
+            }
+        }
+        return true;
+    }
+}
+
+VolumeGradientObject::VolumeGradientObject(const VolumeSpace& mySpace, const float* roiFrame) : m_space(mySpace)
+{
+    const int64_t* dims = m_space.getDims();
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    const vector<vector<float> >& sform = m_space.getSform();
+    float ivec[3], jvec[3], kvec[3];
+    for (int r = 0; r < 3; ++r)
+    {
+        ivec[r] = sform[r][0];
+        jvec[r] = sform[r][1];
+        kvec[r] = sform[r][2];
+    }
+    vector<uint32_t> masks(frameSize);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t k = 0; k < dims[2]; ++k)
+    {
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                const int64_t voxel = m_space.getIndex(i, j, k);
+                if (roiFrame != NULL && !(roiFrame[voxel] > 0.0f))
+                {
+                    masks[voxel] = OUTSIDE_ROI;
+                    continue;
+                }
+                uint32_t mask = 0;
+                for (int dk = -1; dk <= 1; ++dk)
+                {
+                    for (int dj = -1; dj <= 1; ++dj)
+                    {
+                        for (int di = -1; di <= 1; ++di)
+                        {
+                            if (di == 0 && dj == 0 && dk == 0) continue;
+                            if (!m_space.indexValid(i + di, j + dj, k + dk)) continue;
+                            if (roiFrame != NULL && !(roiFrame[m_space.getIndex(i + di, j + dj, k + dk)] > 0.0f)) continue;
+                            mask |= 1u << neighborBit(di, dj, dk);
+                        }
+                    }
+                }
+                masks[voxel] = mask;
+            }
+        }
+    }
+    m_voxelStencil.resize(frameSize);
+    m_stencilStart.push_back(0);
+    map<uint32_t, int32_t> stencilLookup;
+    uint32_t lastMask = OUTSIDE_ROI;
+    int32_t lastStencil = -1;
+    for (int64_t voxel = 0; voxel < frameSize; ++voxel)
+    {
+        const uint32_t mask = masks[voxel];
+        if (mask != lastMask)
+        {
+            if (mask == OUTSIDE_ROI)
+            {
+                lastStencil = -1;
+            } else {
+                map<uint32_t, int32_t>::iterator iter = stencilLookup.find(mask);
+                if (iter == stencilLookup.end())
+                {
+                    lastStencil = (int32_t)(m_stencilStart.size() - 1);
+                    stencilLookup[mask] = lastStencil;
+                    addStencil(mask, ivec, jvec, kvec);
+                } else {
+                    lastStencil = iter->second;
+                }
+            }
+            lastMask = mask;
+        }
+        m_voxelStencil[voxel] = lastStencil;
+    }
+}
+
+void VolumeGradientObject::addStencil(const uint32_t& neighborMask, const float ivecIn[3], const float jvecIn[3], const float kvecIn[3])
+{//same neighbor choices as AlgorithmVolumeGradient, including the order of the checks
+    const Vector3D ivec(ivecIn), jvec(jvecIn), kvec(kvecIn);
+    const int64_t* dims = m_space.getDims();
+    const int stencil[] = { 0, 0, 1,
+                            0, 0, -1,
+                            0, 1, 0,
+                            0, -1, 0,
+                            1, 0, 0,
+                            -1, 0, 0 };
+    vector<Vector3D> voxelDirs, displacements;
+    double regress[4][4] = { { 0.0, 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0, 1.0 } };//count the center voxel in case neighbors are missing
+    int dircheck = 0;
+    for (int neighbase = 0; neighbase < 18; neighbase += 3)
+    {
+        if (neighborMask & (1u << neighborBit(stencil[neighbase], stencil[neighbase + 1], stencil[neighbase + 2])))
+        {
+            dircheck |= 1<<(neighbase / 6);
+            Vector3D voxelDir(stencil[neighbase], stencil[neighbase + 1], stencil[neighbase + 2]);
+            Vector3D displacement = ivec * voxelDir[0] + jvec * voxelDir[1] + kvec * voxelDir[2];
+            voxelDirs.push_back(voxelDir);
+            displacements.push_back(displacement);
+            addToRegression(regress, displacement);
+        }
+    }
+    bool useRegression = (dircheck == 7);//have at least one neighbor in every index axis
+    if (!useRegression)
+    {//fallback 1: regression with 26-neighbors
+        Vector3D directions[3];
+        int dirUsed = 0;
+        if (dircheck & 1)
+        {
+            directions[dirUsed][0] = 1;
+            ++dirUsed;
+        }
+        if (dircheck & 2)
+        {
+            directions[dirUsed][1] = 1;
+            ++dirUsed;
+        }
+        if (dircheck & 4)
+        {
+            directions[dirUsed][2] = 1;
+            ++dirUsed;
+        }
+        Vector3D voxelDir;
+        for (int dk = -1; dk <= 1; ++dk)
+        {
+            voxelDir[2] = dk;
+            int kabs = abs(dk);
+            for (int dj = -1; dj <= 1; ++dj)
+            {
+                int jabs = abs(dj) + kabs;
+                if (jabs > 0)
+                {
+                    voxelDir[1] = dj;
+                    for (int di = -1; di <= 1; ++di)
+                    {
+                        if (jabs + abs(di) > 1 && (neighborMask & (1u << neighborBit(di, dj, dk))))//only add non-face neighbors
+                        {
+                            if (dirUsed < 3)//check for singularity via base vectors being dependent, voxelDir[0] is still the previous neighbor's here, as in the original
+                            {
+                                bool newDir = true;
+                                switch (dirUsed)
+                                {
+                                    case 0:
+                                    default:
+                                        break;
+                                    case 1:
+                                        if (voxelDir.cross(directions[0]).length() < 0.01f) newDir = false;
+                                        break;
+                                    case 2:
+                                        if (voxelDir.cross(directions[0]).cross(voxelDir.cross(directions[1])).length() < 0.01f)
+                                            newDir = false;
+                                        break;
+                                }
+                                if (newDir)
+                                {
+                                    directions[dirUsed] = voxelDir;
+                                    ++dirUsed;
+                                }
+                            }
+                            voxelDir[0] = di;
+                            Vector3D displacement = ivec * voxelDir[0] + jvec * voxelDir[1] + kvec * voxelDir[2];
+                            voxelDirs.push_back(voxelDir);
+                            displacements.push_back(displacement);
+                            addToRegression(regress, displacement);
+                        }
+                    }
+                }
+            }
+        }
+        useRegression = (dirUsed == 3);
+    }
+    vector<Vector3D> weights;
+    if (useRegression)
+    {
+        double inverse[4][4];
+        bool good = invert4(regress, inverse);
+        for (int e = 0; e < (int)displacements.size(); ++e)
+        {
+            Vector3D weight;
+            for (int r = 0; r < 3; ++r)
+            {
+                if (good)
+                {
+                    weight[r] = inverse[r][0] * displacements[e][0] + inverse[r][1] * displacements[e][1] + inverse[r][2] * displacements[e][2] + inverse[r][3];
+                } else {
+                    weight[r] = numeric_limits<float>::quiet_NaN();//singular, the result gets replaced with zero like other non-numeric results
+                }
+            }
+            weights.push_back(weight);
+        }
+    } else {//fallback 2: average forward differences in 26-neighborhood
+        voxelDirs.clear();
+        displacements.clear();
+        for (int dk = -1; dk <= 1; ++dk)
+        {
+            for (int dj = -1; dj <= 1; ++dj)
+            {
+                for (int di = -1; di <= 1; ++di)
+                {
+                    if (!(neighborMask & (1u << neighborBit(di, dj, dk)))) continue;//also skips the center
+                    Vector3D voxelDir(di, dj, dk);
+                    Vector3D displacement = ivec * voxelDir[0] + jvec * voxelDir[1] + kvec * voxelDir[2];
+                    float length = displacement.length();
+                    if (length > 0.0f)
+                    {
+                        voxelDirs.push_back(voxelDir);
+                        weights.push_back(displacement / (length * length));//once to normalize vector, and once to find gradient magnitude
+                    }
+                }
+            }
+        }
+        for (int e = 0; e < (int)weights.size(); ++e)
+        {
+            weights[e] = weights[e] / weights.size();
+        }
+    }
+    for (int e = 0; e < (int)voxelDirs.size(); ++e)
+    {
+        m_stencilOffsets.push_back((int64_t)voxelDirs[e][0] + ((int64_t)voxelDirs[e][1] + (int64_t)voxelDirs[e][2] * dims[1]) * dims[0]);
+        for (int r = 0; r < 3; ++r)
+        {
+            m_stencilWeights.push_back(weights[e][r]);
+        }
+    }
+    m_stencilStart.push_back((int64_t)m_stencilOffsets.size());
+}
+
+void VolumeGradientObject::computeGradient(const float* frame, float* magnitudeOut, float* vectorsOut) const
+{
+    const int64_t* dims = m_space.getDims();
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t voxel = 0; voxel < frameSize; ++voxel)
+    {
+        float gradient[3] = { 0.0f, 0.0f, 0.0f }, magnitude = 0.0f;
+        const int32_t whichStencil = m_voxelStencil[voxel];
+        if (whichStencil >= 0)
+        {
+            const float center = frame[voxel];
+            for (int64_t e = m_stencilStart[whichStencil]; e < m_stencilStart[whichStencil + 1]; ++e)
+            {
+                const float valdiff = frame[voxel + m_stencilOffsets[e]] - center;
+                gradient[0] += m_stencilWeights[e * 3] * valdiff;
+                gradient[1] += m_stencilWeights[e * 3 + 1] * valdiff;
+                gradient[2] += m_stencilWeights[e * 3 + 2] * valdiff;
+            }
+            magnitude = sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2]);
+            if (!MathFunctions::isNumeric(magnitude))
+            {
+                magnitude = 0.0f;
+                gradient[0] = 0.0f;
+                gradient[1] = 0.0f;
+                gradient[2] = 0.0f;
+            }
+        }
+        magnitudeOut[voxel] = magnitude;
+        if (vectorsOut != NULL)
+        {
+            vectorsOut[voxel] = gradient[0];
+            vectorsOut[voxel + frameSize] = gradient[1];
+            vectorsOut[voxel + frameSize * 2] = gradient[2];
+        }
+    }
+}
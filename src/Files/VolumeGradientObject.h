@@ -0,0 +1,58 @@
+#ifndef __VOLUME_GRADIENT_OBJECT_H__
+#define __VOLUME_GRADIENT_OBJECT_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+//NOTE: this computes the same regression gradient as AlgorithmVolumeGradient, but the choice of neighbors and the regression depend only on which of the
+//      26 neighbors exist and are inside the roi, so the weights are solved once per distinct neighborhood, and each frame only needs multiply-adds.
+//
+//NOTE: computeGradient parallelizes over voxels, and contains no mutable members, so it can also be called from several threads on different frames.
+
+#include "VolumeSpace.h"
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+    
+    class VolumeGradientObject
+    {
+    public:
+        ///roiFrame, if given, excludes voxels with values <= 0, both as centers and as neighbors
+        VolumeGradientObject(const VolumeSpace& mySpace, const float* roiFrame = NULL);
+        
+        ///vectorsOut, if not NULL, must have room for 3 frames, and gets X, Y, and Z as consecutive frames
+        ///voxels outside the roi get zero, and so do voxels where the result is not a number
+        void computeGradient(const float* frame, float* magnitudeOut, float* vectorsOut = NULL) const;
+        
+    private:
+        VolumeSpace m_space;
+        std::vector<int32_t> m_voxelStencil;//index into the stencils, -1 for outside the roi
+        std::vector<int64_t> m_stencilStart;//stencils, compressed row style, one per distinct neighborhood
+        std::vector<int64_t> m_stencilOffsets;//linear index offset of the neighbor
+        std::vector<float> m_stencilWeights;//3D gradient weight of the neighbor's difference from the center, 3 values each
+        
+        void addStencil(const uint32_t& neighborMask, const float ivec[3], const float jvec[3], const float kvec[3]);
+        VolumeGradientObject();
+    };
+    
+}
+
+#endif //__VOLUME_GRADIENT_OBJECT_H__
@@ -56,6 +56,7 @@ namespace caret
         void setSpace(const int64_t dims[3], const float sform[12]);
         const int64_t* getDims() const { return m_dims; }
         const std::vector<std::vector<float> >& getSform() const { return m_sform; }
+        const std::vector<std::vector<float> >& getInverseSform() const { return m_inverse; }
         void getSpacingVectors(Vector3D& iStep, Vector3D& jStep, Vector3D& kStep, Vector3D& origin) const;
         float getVoxelVolume() const;
         bool matches(const VolumeSpace& right) const;//allows slight mismatches
@@ -470,6 +470,85 @@ void NiftiHeader::setDataScaling(const double& mult, const double& offset)
     m_header.scl_inter = offset;
 }
 
+bool NiftiHeader::isSupportedOutputType(const int16_t& type)
+{
+    switch (type)
+    {
+        case NIFTI_TYPE_FLOAT32:
+        case NIFTI_TYPE_FLOAT64:
+        case NIFTI_TYPE_INT8:
+        case NIFTI_TYPE_UINT8:
+        case NIFTI_TYPE_INT16:
+        case NIFTI_TYPE_UINT16:
+        case NIFTI_TYPE_INT32:
+        case NIFTI_TYPE_UINT32:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool NiftiHeader::computeDataScaling(const int16_t& type, const double& minVal, const double& maxVal, const bool& allIntegers, double& multOut, double& offsetOut)
+{
+    multOut = 1.0;
+    offsetOut = 0.0;
+    double typeMin, typeMax;
+    switch (type)
+    {
+        case NIFTI_TYPE_INT8:
+            typeMin = numeric_limits<int8_t>::min();
+            typeMax = numeric_limits<int8_t>::max();
+            break;
+        case NIFTI_TYPE_UINT8:
+            typeMin = 0;
+            typeMax = numeric_limits<uint8_t>::max();
+            break;
+        case NIFTI_TYPE_INT16:
+            typeMin = numeric_limits<int16_t>::min();
+            typeMax = numeric_limits<int16_t>::max();
+            break;
+        case NIFTI_TYPE_UINT16:
+            typeMin = 0;
+            typeMax = numeric_limits<uint16_t>::max();
+            break;
+        case NIFTI_TYPE_INT32:
+            typeMin = numeric_limits<int32_t>::min();
+            typeMax = numeric_limits<int32_t>::max();
+            break;
+        case NIFTI_TYPE_UINT32:
+            typeMin = 0;
+            typeMax = numeric_limits<uint32_t>::max();
+            break;
+        case NIFTI_TYPE_FLOAT32:
+        case NIFTI_TYPE_FLOAT64:
+            return false;//floating point types don't need scaling
+        default:
+            CaretAssert(0);
+            throw DataFileException("datatype " + QString::number(type) + " is not supported for output");
+    }
+    if (!(minVal <= maxVal)) return false;//no data, or NaN
+    if (allIntegers && minVal >= typeMin && maxVal <= typeMax) return false;//integer data that fits is stored exactly
+    if (maxVal == minVal)
+    {
+        offsetOut = minVal;//every value is stored as 0
+        return true;
+    }
+    multOut = (maxVal - minVal) / (typeMax - typeMin);//use the full range of the type
+    offsetOut = minVal - typeMin * multOut;
+    return true;
+}
+
+void NiftiHeader::accumulateDataRange(const float* data, const int64_t& count, double& minInOut, double& maxInOut, bool& allIntegersInOut)
+{
+    for (int64_t i = 0; i < count; ++i)
+    {
+        if (!MathFunctions::isNumeric(data[i])) continue;
+        if (data[i] < minInOut) minInOut = data[i];
+        if (data[i] > maxInOut) maxInOut = data[i];
+        if (allIntegersInOut && data[i] != floor(data[i])) allIntegersInOut = false;
+    }
+}
+
 void NiftiHeader::read(CaretBinaryFile& inFile)
 {
     nifti_1_header buffer1;
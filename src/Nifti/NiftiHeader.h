@@ -70,6 +70,12 @@ namespace caret
         void setDataScaling(const double& mult, const double& offset);
         ///get the FSL "scale" space
         std::vector<std::vector<float> > getFSLSpace() const;
+        ///whether type is a real-valued type that can be used for writing (float, or an integer of up to 32 bits)
+        static bool isSupportedOutputType(const int16_t& type);
+        ///choose scl_slope/scl_inter so that data in [minVal, maxVal] fits an integer type, returns false if no scaling is needed
+        static bool computeDataScaling(const int16_t& type, const double& minVal, const double& maxVal, const bool& allIntegers, double& multOut, double& offsetOut);
+        ///update the range info for computeDataScaling with more data, start with min = +inf, max = -inf, allIntegers = true, nonfinite values are ignored
+        static void accumulateDataRange(const float* data, const int64_t& count, double& minInOut, double& maxInOut, bool& allIntegersInOut);
         
         bool operator==(const NiftiHeader& rhs) const;//for testing purposes
         bool operator!=(const NiftiHeader& rhs) const { return !((*this) == rhs); }
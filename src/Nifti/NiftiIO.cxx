@@ -20,6 +20,7 @@
 
 #include "NiftiIO.h"
 
+#include "CaretProfiler.h"
 #include "DataFileException.h"
 
 using namespace std;
@@ -28,7 +29,10 @@ using namespace caret;
 void NiftiIO::openRead(const QString& filename)
 {
     m_file.open(filename);
-    m_header.read(m_file);
+    {
+        CaretProfiler::IOTimer myTimer(CaretProfiler::PARSE, filename);
+        m_header.read(m_file);
+    }
     if (m_header.getDataType() == DT_BINARY)
     {
         throw DataFileException("file uses the binary datatype, which is unsupported: " + filename);
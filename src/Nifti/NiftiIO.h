@@ -25,6 +25,7 @@
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
 #include "DataFileException.h"
+#include "MathFunctions.h"
 #include "NiftiHeader.h"
 
 #include <QString>
@@ -59,13 +60,18 @@ namespace caret
         //to read/write 1 frame of a standard volume file, call with fullDims = 3, indexSelect containing indexes for any of dims 4-7 that exist
         //NOTE: you need to provide storage for all components within the range, if getNumComponents() == 3 and fullDims == 0, you need 3 elements allocated
         template<typename T>
-        void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
+        void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false, const int64_t& numSlices = 1);//numSlices reads consecutive indices along the first selected dimension in one call
         template<typename T>
-        void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
+        void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& numSlices = 1);
+        //flat access to the data in file order, counted in elements (components count as separate elements), for callers that need ranges that don't line up with dimensions
+        template<typename T>
+        void readElements(T* dataOut, const int64_t& firstElem, const int64_t& numElems, const bool& tolerateShortRead = false);
+        template<typename T>
+        void writeElements(const T* dataIn, const int64_t& firstElem, const int64_t& numElems);
     };
     
     template<typename T>
-    void NiftiIO::readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead)
+    void NiftiIO::readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead, const int64_t& numSlices)
     {
         CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
         CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
@@ -82,8 +88,17 @@ namespace caret
             numSkip += indexSelect[curDim - fullDims] * numDimSkip;
             numDimSkip *= m_dims[curDim];
         }
+        CaretAssert(numSlices >= 1 && (numSlices == 1 || (fullDims < (int)m_dims.size() && indexSelect[0] + numSlices <= m_dims[fullDims])));
+        numElems *= numSlices;//consecutive indices along the first selected dimension are contiguous on disk
+        readElements(dataOut, numSkip, numElems, tolerateShortRead);
+    }
+    
+    template<typename T>
+    void NiftiIO::readElements(T* dataOut, const int64_t& firstElem, const int64_t& numElems, const bool& tolerateShortRead)
+    {
+        CaretAssert(firstElem >= 0 && numElems >= 0);
         m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
+        m_file.seek(firstElem * numBytesPerElem() + m_header.getDataOffset());
         int64_t numRead = 0;
         m_file.read(m_scratch.data(), m_scratch.size(), &numRead);
         if ((numRead != (int64_t)m_scratch.size() && !tolerateShortRead) || numRead < 0)//for now, assume read giving -1 is always a problem
@@ -136,7 +151,7 @@ namespace caret
     }
     
     template<typename T>
-    void NiftiIO::writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect)
+    void NiftiIO::writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& numSlices)
     {
         CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
         CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
@@ -153,8 +168,17 @@ namespace caret
             numSkip += indexSelect[curDim - fullDims] * numDimSkip;
             numDimSkip *= m_dims[curDim];
         }
+        CaretAssert(numSlices >= 1 && (numSlices == 1 || (fullDims < (int)m_dims.size() && indexSelect[0] + numSlices <= m_dims[fullDims])));
+        numElems *= numSlices;//consecutive indices along the first selected dimension are contiguous on disk
+        writeElements(dataIn, numSkip, numElems);
+    }
+    
+    template<typename T>
+    void NiftiIO::writeElements(const T* dataIn, const int64_t& firstElem, const int64_t& numElems)
+    {
+        CaretAssert(firstElem >= 0 && numElems >= 0);
         m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
+        m_file.seek(firstElem * numBytesPerElem() + m_header.getDataOffset());
         switch (m_header.getDataType())
         {
             case NIFTI_TYPE_UINT8:
@@ -248,15 +272,29 @@ namespace caret
         if (std::numeric_limits<TO>::is_integer)//do round to nearest when integer output type
         {
             if (doScale)
-            {
+            {//converting NaN or inf to an integer is undefined, and they are excluded from the scaling range anyway, so write whatever decodes closest to 0
+                long double zeroRaw = floor(0.5 - (long double)offset / mult);
+                if (zeroRaw < (long double)std::numeric_limits<TO>::min()) zeroRaw = std::numeric_limits<TO>::min();
+                if (zeroRaw > (long double)std::numeric_limits<TO>::max()) zeroRaw = std::numeric_limits<TO>::max();
+                const TO zeroOut = (TO)zeroRaw;
                 for (int64_t i = 0; i < count; ++i)
                 {
-                    out[i] = (TO)floor(0.5 + ((long double)in[i] - offset) / mult);//we don't always need that much precision, but it will still be faster than hard drives
+                    if (MathFunctions::isNumeric(in[i]))
+                    {
+                        out[i] = (TO)floor(0.5 + ((long double)in[i] - offset) / mult);//we don't always need that much precision, but it will still be faster than hard drives
+                    } else {
+                        out[i] = zeroOut;
+                    }
                 }
             } else {
                 for (int64_t i = 0; i < count; ++i)
                 {
-                    out[i] = (TO)floor(0.5 + in[i]);
+                    if (MathFunctions::isNumeric(in[i]))
+                    {
+                        out[i] = (TO)floor(0.5 + in[i]);
+                    } else {
+                        out[i] = 0;
+                    }
                 }
             }
         } else {
@@ -63,25 +63,9 @@ void OperationBackendAverageDenseROI::useParameters(OperationParameters* myParam
     AString indexListString, outfileName;
     indexListString = myParams->getString(1);
     outfileName = myParams->getString(2);
-    CiftiXML baseXML;
-    bool ok = false;
-    vector<int> indexList;
-    QStringList indexStrings = indexListString.split(",");
-    int numStrings = (int)indexStrings.size();
-    indexList.resize(numStrings);
-    for (int i = 0; i < numStrings; ++i)
-    {
-        indexList[i] = indexStrings[i].toInt(&ok);
-        if (!ok)
-        {
-            throw OperationException("failed to parse '" + indexStrings[i] + "' as integer");
-        }
-        if (indexList[i] < 0)
-        {
-            throw OperationException("negative integers are not valid cifti indexes");
-        }
-    }
+    vector<int> indexList = parseIndexList(indexListString);
     vector<CaretPointer<const CiftiFile> > ciftiList;
+    vector<const CiftiFile*> ciftiPointers;
     string myLine;
     while (cin.good())
     {
@@ -100,54 +84,91 @@ void OperationBackendAverageDenseROI::useParameters(OperationParameters* myParam
         }
         CaretPointer<CiftiFile> tempCifti(new CiftiFile(myLine.c_str()));//can't skip parsing XML, as different arguments could be different cifti versions, which results in different dimension order
         ciftiList.push_back(tempCifti);
+        ciftiPointers.push_back(tempCifti);
     }
-    int numCifti = (int)ciftiList.size();
-    if (numCifti > 0)
+    if (ciftiList.size() > 0)
     {
-        baseXML = ciftiList[0]->getCiftiXML();
-        if (baseXML.getNumberOfDimensions() != 2) throw OperationException("this command currently only supports 2D cifti");
-        int numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-        int rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW);
-        vector<double> accum(rowSize, 0.0);
-        vector<float> rowScratch(rowSize);
-        for (int i = 0; i < numCifti; ++i)
-        {
-            if (baseXML != ciftiList[i]->getCiftiXML())//equality testing is smart, compares mapping equivalence, despite multiple ways to specify some mappings
-            {
-                throw OperationException("error, cifti header of file #" + AString::number(i + 1) + " doesn't match");
-            }
-            for (int j = 0; j < numStrings; ++j)
-            {
-                if (indexList[j] >= numRows)
-                {
-                    throw OperationException("error, cifti index outside number of rows");
-                }
-                ciftiList[i]->getRow(rowScratch.data(), indexList[j]);
-                for (int k = 0; k < rowSize; ++k)
-                {
-                    accum[k] += rowScratch[k];
-                }
-            }
-        }
-        for (int k = 0; k < rowSize; ++k)
+        vector<float> outRow;
+        computeAverageRows(ciftiPointers, indexList, outRow);
+        writeRowFile(outfileName, outRow);
+    }
+}
+
+vector<int> OperationBackendAverageDenseROI::parseIndexList(const AString& indexListString)
+{
+    bool ok = false;
+    QStringList indexStrings = indexListString.split(",");
+    int numStrings = (int)indexStrings.size();
+    vector<int> indexList(numStrings);
+    for (int i = 0; i < numStrings; ++i)
+    {
+        indexList[i] = indexStrings[i].toInt(&ok);
+        if (!ok)
         {
-            rowScratch[k] = accum[k] / numCifti / numStrings;
+            throw OperationException("failed to parse '" + indexStrings[i] + "' as integer");
         }
-        int32_t outSize = rowSize;
-        if (ByteOrderEnum::isSystemBigEndian())
+        if (indexList[i] < 0)
         {
-            ByteSwapping::swapBytes(rowScratch.data(), rowSize);//beware, we are doing the byteswapping in place
-            ByteSwapping::swapBytes(&outSize, 1);
+            throw OperationException("negative integers are not valid cifti indexes");
         }
-        ofstream outfile(outfileName.toLocal8Bit().constData(), ios_base::out | ios_base::binary | ios_base::trunc);
-        if (!outfile.write((char*)&outSize, 4))
+    }
+    return indexList;
+}
+
+void OperationBackendAverageDenseROI::writeRowFile(const AString& outfileName, const vector<float>& row)
+{
+    vector<float> outRow = row;
+    int32_t outSize = (int32_t)outRow.size();
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(outRow.data(), outRow.size());
+        ByteSwapping::swapBytes(&outSize, 1);
+    }
+    ofstream outfile(outfileName.toLocal8Bit().constData(), ios_base::out | ios_base::binary | ios_base::trunc);
+    if (!outfile.write((char*)&outSize, 4))
+    {
+        throw OperationException("error writing output");
+    }
+    if (!outfile.write((char*)outRow.data(), outRow.size() * sizeof(float)))
+    {
+        throw OperationException("error writing output");
+    }
+    outfile.close();
+}
+
+void OperationBackendAverageDenseROI::computeAverageRows(const vector<const CiftiFile*>& ciftiList, const vector<int>& indexList, vector<float>& output)
+{
+    int numCifti = (int)ciftiList.size();
+    int numStrings = (int)indexList.size();
+    if (numCifti == 0) throw OperationException("no cifti files specified");
+    const CiftiXML& baseXML = ciftiList[0]->getCiftiXML();
+    if (baseXML.getNumberOfDimensions() != 2) throw OperationException("this command currently only supports 2D cifti");
+    int numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    int rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    vector<double> accum(rowSize, 0.0);
+    vector<float> rowScratch(rowSize);
+    for (int i = 0; i < numCifti; ++i)
+    {
+        if (baseXML != ciftiList[i]->getCiftiXML())//equality testing is smart, compares mapping equivalence, despite multiple ways to specify some mappings
         {
-            throw OperationException("error writing output");
+            throw OperationException("error, cifti header of file #" + AString::number(i + 1) + " doesn't match");
         }
-        if (!outfile.write((char*)rowScratch.data(), rowSize * sizeof(float)))
+        for (int j = 0; j < numStrings; ++j)
         {
-            throw OperationException("error writing output");
+            if (indexList[j] >= numRows)
+            {
+                throw OperationException("error, cifti index outside number of rows");
+            }
+            ciftiList[i]->getRow(rowScratch.data(), indexList[j]);
+            for (int k = 0; k < rowSize; ++k)
+            {
+                accum[k] += rowScratch[k];
+            }
         }
-        outfile.close();
+    }
+    output.resize(rowSize);
+    for (int k = 0; k < rowSize; ++k)
+    {
+        output[k] = accum[k] / numCifti / numStrings;
     }
 }
@@ -23,11 +23,21 @@
 
 #include "AbstractOperation.h"
 
+#include <vector>
+
 namespace caret {
     
+    class CiftiFile;
+    
     class OperationBackendAverageDenseROI : public AbstractOperation
     {
     public:
+        ///parse a comma separated list of nonnegative cifti indexes
+        static std::vector<int> parseIndexList(const AString& indexListString);
+        ///write row size as little endian int32, followed by the row as little endian float32
+        static void writeRowFile(const AString& outfileName, const std::vector<float>& row);
+        ///average the selected rows across all files, headers must match
+        static void computeAverageRows(const std::vector<const CiftiFile*>& ciftiList, const std::vector<int>& indexList, std::vector<float>& output);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
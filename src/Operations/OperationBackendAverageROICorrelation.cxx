@@ -19,12 +19,11 @@
 /*LICENSE_END*/
 
 #include "AString.h"
-#include "ByteOrderEnum.h"
-#include "ByteSwapping.h"
 #include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 #include "FileInformation.h"
+#include "OperationBackendAverageDenseROI.h"
 #include "OperationBackendAverageROICorrelation.h"
 #include "OperationException.h"
 
@@ -64,25 +63,9 @@ void OperationBackendAverageROICorrelation::useParameters(OperationParameters* m
     AString indexListString, outfileName;
     indexListString = myParams->getString(1);
     outfileName = myParams->getString(2);
-    CiftiXML baseXML;//TODO: remove when switching to raw reading
-    bool ok = false;
-    vector<int> indexList;
-    QStringList indexStrings = indexListString.split(",");
-    int numStrings = (int)indexStrings.size();
-    indexList.resize(numStrings);
-    for (int i = 0; i < numStrings; ++i)
-    {
-        indexList[i] = indexStrings[i].toInt(&ok);
-        if (!ok)
-        {
-            throw OperationException("failed to parse '" + indexStrings[i] + "' as integer");
-        }
-        if (indexList[i] < 0)
-        {
-            throw OperationException("negative integers are not valid cifti indexes");
-        }
-    }
+    vector<int> indexList = OperationBackendAverageDenseROI::parseIndexList(indexListString);
     vector<CaretPointer<const CiftiFile> > ciftiList;
+    vector<const CiftiFile*> ciftiPointers;
     string myLine;
     while (cin.good())
     {
@@ -101,47 +84,42 @@ void OperationBackendAverageROICorrelation::useParameters(OperationParameters* m
         }
         CaretPointer<CiftiFile> tempCifti(new CiftiFile(myLine.c_str()));//can't skip parsing XML, as different arguments could be different cifti versions, which results in different dimension order
         ciftiList.push_back(tempCifti);
+        ciftiPointers.push_back(tempCifti);
     }
+    if (ciftiList.size() > 0)
+    {
+        vector<float> outRow;
+        computeAverageCorrelation(ciftiPointers, indexList, outRow);
+        OperationBackendAverageDenseROI::writeRowFile(outfileName, outRow);
+    }
+}
+
+void OperationBackendAverageROICorrelation::computeAverageCorrelation(const vector<const CiftiFile*>& ciftiList, const vector<int>& indexList, vector<float>& output)
+{
     int numCifti = (int)ciftiList.size();
-    if (numCifti > 0)
+    int numStrings = (int)indexList.size();
+    if (numCifti == 0) throw OperationException("no cifti files specified");
+    const CiftiXML& baseXML = ciftiList[0]->getCiftiXML();
+    if (baseXML.getNumberOfDimensions() != 2) throw OperationException("operation only supports 2D cifti files");
+    int outSize = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN);//one correlation per row
+    vector<double> accum(outSize, 0.0);
+    vector<float> rowScratch(outSize);
+    for (int i = 0; i < numCifti; ++i)
     {
-        baseXML = ciftiList[0]->getCiftiXML();
-        if (baseXML.getNumberOfDimensions() != 2) throw OperationException("operation only supports 2D cifti files");
-        int rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW);
-        vector<double> accum(rowSize, 0.0);
-        vector<float> rowScratch(rowSize);
-        for (int i = 0; i < numCifti; ++i)
+        if (!baseXML.approximateMatch(ciftiList[i]->getCiftiXML()))//equality testing is smart, compares mapping equivalence, despite multiple ways to specify some mappings
         {
-            if (!baseXML.approximateMatch(ciftiList[i]->getCiftiXML()))//equality testing is smart, compares mapping equivalence, despite multiple ways to specify some mappings
-            {
-                throw OperationException("error, cifti header of file #" + AString::number(i + 1) + " doesn't match");
-            }
-            processCifti(ciftiList[i], indexList, rowScratch);
-            for (int k = 0; k < rowSize; ++k)
-            {
-                accum[k] += rowScratch[k];
-            }
+            throw OperationException("error, cifti header of file #" + AString::number(i + 1) + " doesn't match");
         }
-        for (int k = 0; k < rowSize; ++k)
+        processCifti(ciftiList[i], indexList, rowScratch);
+        for (int k = 0; k < outSize; ++k)
         {
-            rowScratch[k] = accum[k] / numCifti / numStrings;
+            accum[k] += rowScratch[k];
         }
-        int32_t outSize = rowSize;
-        if (ByteOrderEnum::isSystemBigEndian())
-        {
-            ByteSwapping::swapBytes(rowScratch.data(), rowSize);//beware, we are doing the byteswapping in place
-            ByteSwapping::swapBytes(&outSize, 1);
-        }
-        ofstream outfile(outfileName.toLocal8Bit().constData(), ios_base::out | ios_base::binary | ios_base::trunc);
-        if (!outfile.write((char*)&outSize, 4))
-        {
-            throw OperationException("error writing output");
-        }
-        if (!outfile.write((char*)rowScratch.data(), rowSize * sizeof(float)))
-        {
-            throw OperationException("error writing output");
-        }
-        outfile.close();
+    }
+    output.resize(outSize);
+    for (int k = 0; k < outSize; ++k)
+    {
+        output[k] = accum[k] / numCifti / numStrings;
     }
 }
 
@@ -209,7 +187,7 @@ void OperationBackendAverageROICorrelation::processCifti(const CiftiFile* myCift
             corraccum /= rrs * sqrt(tempaccum);
             if (corraccum > 0.999999) corraccum = 0.999999;
             if (corraccum < -0.999999) corraccum = -0.999999;
-            output[i] = 0.5 * log((1 + corraccum) / (1 - corraccum));
+            output[myRow] = 0.5 * log((1 + corraccum) / (1 - corraccum));
         }
     }
 }
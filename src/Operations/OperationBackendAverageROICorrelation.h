@@ -31,6 +31,8 @@ namespace caret {
     {
         static void processCifti(const CiftiFile* myCifti, const std::vector<int>& indexList, std::vector<float>& output);
     public:
+        ///average the selected rows within each file, correlate with every row and fisher z transform, then average across files
+        static void computeAverageCorrelation(const std::vector<const CiftiFile*>& ciftiList, const std::vector<int>& indexList, std::vector<float>& output);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
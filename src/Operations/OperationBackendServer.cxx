@@ -0,0 +1,266 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "OperationBackendServer.h"
+#include "OperationException.h"
+
+#include "AString.h"
+#include "CaretPointer.h"
+#include "CiftiFile.h"
+#include "FileInformation.h"
+#include "OperationBackendAverageDenseROI.h"
+#include "OperationBackendAverageROICorrelation.h"
+
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    struct OpenCifti
+    {
+        CaretPointer<CiftiFile> m_file;
+        int64_t m_size;//to notice files that get replaced while the server is running
+        int64_t m_lastUsed;
+    };
+    
+    class BackendState
+    {
+        map<AString, OpenCifti> m_openFiles;
+        map<AString, vector<float> > m_results;
+        deque<AString> m_resultOrder;//oldest first, for eviction
+        int64_t m_resultBytes, m_maxResultBytes;
+        int m_maxOpenFiles;
+        int64_t m_useCounter;
+        
+        void closeLeastRecentFile()
+        {
+            map<AString, OpenCifti>::iterator oldest = m_openFiles.begin();
+            for (map<AString, OpenCifti>::iterator iter = m_openFiles.begin(); iter != m_openFiles.end(); ++iter)
+            {
+                if (iter->second.m_lastUsed < oldest->second.m_lastUsed) oldest = iter;
+            }
+            m_openFiles.erase(oldest);
+        }
+    public:
+        BackendState(const int& maxOpenFiles, const int64_t& maxResultBytes)
+        {
+            m_maxOpenFiles = maxOpenFiles;
+            m_maxResultBytes = maxResultBytes;
+            m_resultBytes = 0;
+            m_useCounter = 0;
+        }
+        
+        CaretPointer<CiftiFile> getFile(const AString& fileName)
+        {
+            FileInformation ciftiFileInfo(fileName);
+            if (!ciftiFileInfo.exists())
+            {
+                throw OperationException("file does not exist: " + fileName);
+            }
+            int64_t curSize = ciftiFileInfo.size();
+            map<AString, OpenCifti>::iterator iter = m_openFiles.find(fileName);
+            if (iter != m_openFiles.end() && iter->second.m_size != curSize)
+            {
+                closeFile(fileName);
+                iter = m_openFiles.end();
+            }
+            if (iter == m_openFiles.end())
+            {
+                if ((int)m_openFiles.size() >= m_maxOpenFiles) closeLeastRecentFile();
+                OpenCifti toAdd;
+                toAdd.m_file.grabNew(new CiftiFile());
+                toAdd.m_file->openFile(fileName);//on-disk reading, only the XML is parsed here
+                toAdd.m_size = curSize;
+                iter = m_openFiles.insert(make_pair(fileName, toAdd)).first;
+            }
+            iter->second.m_lastUsed = m_useCounter++;
+            return iter->second.m_file;
+        }
+        
+        void closeFile(const AString& fileName)
+        {
+            m_openFiles.erase(fileName);
+            clearResults();//results don't record which files they came from, so drop them all
+        }
+        
+        const vector<float>* getResult(const AString& key) const
+        {
+            map<AString, vector<float> >::const_iterator iter = m_results.find(key);
+            if (iter == m_results.end()) return NULL;
+            return &(iter->second);
+        }
+        
+        void addResult(const AString& key, const vector<float>& result)
+        {
+            int64_t resultBytes = result.size() * sizeof(float);
+            if (resultBytes > m_maxResultBytes) return;
+            while (m_resultBytes + resultBytes > m_maxResultBytes)
+            {
+                m_resultBytes -= m_results[m_resultOrder.front()].size() * sizeof(float);
+                m_results.erase(m_resultOrder.front());
+                m_resultOrder.pop_front();
+            }
+            m_results[key] = result;
+            m_resultOrder.push_back(key);
+            m_resultBytes += resultBytes;
+        }
+        
+        void clearResults()
+        {
+            m_results.clear();
+            m_resultOrder.clear();
+            m_resultBytes = 0;
+        }
+    };
+    
+    void processRequest(BackendState& myState, const QStringList& fields)
+    {
+        const AString& command = fields[0];
+        if (command == "close")
+        {
+            for (int i = 1; i < fields.size(); ++i)
+            {
+                myState.closeFile(fields[i]);
+            }
+            return;
+        }
+        bool correlate = false;
+        if (command == "roi-correlation")
+        {
+            correlate = true;
+        } else if (command != "dense-roi") {
+            throw OperationException("unknown request type '" + command + "'");
+        }
+        if (fields.size() < 4)
+        {
+            throw OperationException("request needs an index list, an output file, and at least one cifti file");
+        }
+        vector<int> indexList = OperationBackendAverageDenseROI::parseIndexList(fields[1]);
+        AString outfileName = fields[2];
+        vector<CaretPointer<CiftiFile> > requestFiles;//hold references, opening a later file can close an earlier one when the request names more than -max-open-files
+        vector<const CiftiFile*> ciftiList;
+        for (int i = 3; i < fields.size(); ++i)
+        {
+            requestFiles.push_back(myState.getFile(fields[i]));//check and open all files first, so stale results get invalidated before the lookup
+            ciftiList.push_back(requestFiles.back());
+        }
+        QStringList keyFields = fields;
+        keyFields.removeAt(2);//output name doesn't change the result
+        AString key = keyFields.join("\t");
+        const vector<float>* cached = myState.getResult(key);
+        if (cached != NULL)
+        {
+            OperationBackendAverageDenseROI::writeRowFile(outfileName, *cached);
+            return;
+        }
+        vector<float> outRow;
+        if (correlate)
+        {
+            OperationBackendAverageROICorrelation::computeAverageCorrelation(ciftiList, indexList, outRow);
+        } else {
+            OperationBackendAverageDenseROI::computeAverageRows(ciftiList, indexList, outRow);
+        }
+        OperationBackendAverageDenseROI::writeRowFile(outfileName, outRow);
+        myState.addResult(key, outRow);
+    }
+}
+
+AString OperationBackendServer::getCommandSwitch()
+{
+    return "-backend-server";
+}
+
+AString OperationBackendServer::getShortDescription()
+{
+    return "CONNECTOME DB BACKEND SERVICE FOR REPEATED CIFTI ROI QUERIES";
+}
+
+OperationParameters* OperationBackendServer::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    OptionalParameter* maxFilesOpt = ret->createOptionalParameter(1, "-max-open-files", "limit the number of cifti files kept open");
+    maxFilesOpt->addIntegerParameter(1, "number", "maximum open files, default 256");
+    OptionalParameter* cacheOpt = ret->createOptionalParameter(2, "-cache-mb", "limit the memory used for remembering previous results");
+    cacheOpt->addDoubleParameter(1, "megabytes", "maximum cache size, default 512");
+    ret->setHelpText(
+        AString("This command is probably not the one you are looking for.  ") +
+        "It serves the requests of -backend-average-dense-roi and -backend-average-roi-correlation without exiting, " +
+        "keeping cifti files open between requests so that their headers are parsed only once, and remembering recent results.  " +
+        "Requests are read from standard input, one per line, with fields separated by tabs:\n\n" +
+        "dense-roi<TAB><index-list><TAB><out-file><TAB><cifti><TAB>...\n" +
+        "roi-correlation<TAB><index-list><TAB><out-file><TAB><cifti><TAB>...\n" +
+        "close<TAB><cifti><TAB>...\n" +
+        "quit\n\n" +
+        "The output file format is the same as the single-use backend commands.  " +
+        "After each request, one line is written to standard output, either 'OK' or 'ERROR' followed by a tab and a message.  " +
+        "A file whose size has changed since it was opened is reopened, use 'close' if a file is replaced by one of the same size.  " +
+        "Requests are answered in order, each one uses multiple threads internally."
+    );
+    return ret;
+}
+
+void OperationBackendServer::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    int maxOpenFiles = 256;
+    OptionalParameter* maxFilesOpt = myParams->getOptionalParameter(1);
+    if (maxFilesOpt->m_present)
+    {
+        maxOpenFiles = (int)maxFilesOpt->getInteger(1);
+        if (maxOpenFiles < 1) throw OperationException("maximum open files must be positive");
+    }
+    double cacheMB = 512.0;
+    OptionalParameter* cacheOpt = myParams->getOptionalParameter(2);
+    if (cacheOpt->m_present)
+    {
+        cacheMB = cacheOpt->getDouble(1);
+        if (cacheMB < 0.0) throw OperationException("cache size must not be negative");
+    }
+    BackendState myState(maxOpenFiles, (int64_t)(cacheMB * 1024 * 1024));
+    string myLine;
+    while (getline(cin, myLine))
+    {
+        if (myLine == "")
+        {
+            continue;//skip blank lines
+        }
+        QStringList fields = AString(myLine.c_str()).split("\t");
+        if (fields[0] == "quit")
+        {
+            break;
+        }
+        try
+        {
+            processRequest(myState, fields);
+            cout << "OK" << endl;//endl flushes, so the client isn't left waiting
+        } catch (CaretException& e) {
+            cout << "ERROR\t" << e.whatString().replace("\n", " ").toLocal8Bit().constData() << endl;
+        } catch (std::exception& e) {//bad_alloc and such, one bad request shouldn't stop the server
+            cout << "ERROR\t" << AString(e.what()).replace("\n", " ").toLocal8Bit().constData() << endl;
+        }
+    }
+}
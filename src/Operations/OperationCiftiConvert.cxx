@@ -21,14 +21,17 @@
 #include "OperationCiftiConvert.h"
 #include "OperationException.h"
 
+#include "ByteSwapping.h"
 #include "CaretAssert.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 #include "CiftiXML.h"
 #include "FloatMatrix.h"
 #include "GiftiFile.h"
-#include "VolumeFile.h"
+#include "NiftiIO.h"
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <limits>
@@ -40,6 +43,16 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t BLOCK_BYTES = ((int64_t)1) << 27;//conversions keep two buffers of this size
+    
+    int64_t getBlockRows(const int64_t& numRows, const int64_t& rowLength)
+    {
+        return max((int64_t)1, min(numRows, BLOCK_BYTES / (int64_t)sizeof(float) / max(rowLength, (int64_t)1)));
+    }
+}
+
 AString OperationCiftiConvert::getCommandSwitch()
 {
     return "-cifti-convert";
@@ -74,10 +87,10 @@ OperationParameters* OperationCiftiConvert::getParameters()
     
     OptionalParameter* toNifti = ret->createOptionalParameter(3, "-to-nifti", "convert to NIFTI1");
     toNifti->addCiftiParameter(1, "cifti-in", "the input cifti file");
-    toNifti->addVolumeOutputParameter(2, "nifti-out", "the output nifti file");
+    toNifti->addStringParameter(2, "nifti-out", "output - the output nifti file");
     
     OptionalParameter* fromNifti = ret->createOptionalParameter(4, "-from-nifti", "convert a NIFTI (1 or 2) file made with this command back into CIFTI");
-    fromNifti->addVolumeParameter(1, "nifti-in", "the input nifti file");
+    fromNifti->addStringParameter(1, "nifti-in", "the input nifti file");
     fromNifti->addCiftiParameter(2, "cifti-template", "a cifti file with the dimension(s) and mapping(s) that should be used");
     fromNifti->addCiftiOutputParameter(3, "cifti-out", "the output cifti file");
     OptionalParameter* fnresetTimeOpt = fromNifti->createOptionalParameter(4, "-reset-timepoints", "reset the mapping along rows to timepoints, taking length from the nifti file");
@@ -112,6 +125,8 @@ OperationParameters* OperationCiftiConvert::getParameters()
         "If you want to create a CIFTI file from metric and/or volume files, see the -cifti-create-* commands.  " +
         "You must specify exactly one of -to-gifti-ext, -from-gifti-ext, -to-nifti, -from-nifti, -to-text, or -from-text.  " +
         "The -transpose option to -from-gifti-ext is needed if the replacement binary file is in column-major order.  " +
+        "The -to-nifti and -from-nifti conversions are done in blocks of rows, so the full matrix is never held in memory, except when reading a compressed nifti file.  " +
+        "The -to-nifti output uses the datatype from the -output-datatype global option, integer types need an extra pass over the input to find the scaling.  " +
         "The -unit options accept these values:\n";
     vector<CiftiSeriesMap::Unit> units = CiftiSeriesMap::getAllUnits();
     for (int i = 0; i < (int)units.size(); ++i)
@@ -153,9 +168,11 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
         if (myXML.getNumberOfDimensions() != 2) throw OperationException("conversion only supported for 2D cifti");
         GiftiDataArray* myArray = new GiftiDataArray(NiftiIntentEnum::NIFTI_INTENT_NORMAL, NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32, myDims, GiftiEncodingEnum::EXTERNAL_FILE_BINARY);
         float* myOutData = myArray->getDataPointerFloat();
-        for (int i = 0; i < myInFile->getNumberOfRows(); ++i)
+        int64_t numRows = myInFile->getNumberOfRows(), numCols = myInFile->getNumberOfColumns();
+        int64_t blockRows = getBlockRows(numRows, numCols);
+        for (int64_t i = 0; i < numRows; i += blockRows)
         {
-            myInFile->getRow(myOutData + i * myInFile->getNumberOfColumns(), i);
+            myInFile->getRows(myOutData + i * numCols, i, min(blockRows, numRows - i));
         }
         AString myCiftiXML = myXML.writeXMLToString();
         myArray->getMetaData()->set("CiftiXML", myCiftiXML);
@@ -234,62 +251,79 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
             {
                 throw OperationException("unable to open replacement file for reading");
             }
-            OptionalParameter* swapBytes = fromGiftiReplace->getOptionalParameter(2);
-            OptionalParameter* transpose = fromGiftiReplace->getOptionalParameter(3);
-            int64_t readSize = numCols, numReads = numRows;
-            if (transpose->m_present)
-            {
-                readSize = numRows;
-                numReads = numCols;
-            }
-            CaretArray<float> myScratch(readSize);
-            for (int i = 0; i < numReads; ++i)
-            {
-                if (replaceFile.read((char*)(myScratch.getArray()), sizeof(float) * readSize) != (int64_t)(sizeof(float) * readSize))
-                {
-                    throw OperationException("short read from replacement file, aborting");
+            bool swapBytes = fromGiftiReplace->getOptionalParameter(2)->m_present;
+            bool transpose = fromGiftiReplace->getOptionalParameter(3)->m_present;
+            int64_t blockRows = getBlockRows(numRows, numCols);
+            vector<float> readScratch(blockRows * numCols), rowScratch;
+            if (transpose) rowScratch.resize(blockRows * numCols);
+            for (int64_t i = 0; i < numRows; i += blockRows)
+            {//the replacement data goes straight to the output, the gifti's own data is never touched
+                int64_t thisRows = min(blockRows, numRows - i);
+                if (transpose)
+                {//column-major, so each column's piece of this block is contiguous
+                    for (int64_t j = 0; j < numCols; ++j)
+                    {
+                        int64_t readBytes = sizeof(float) * thisRows;
+                        if (!replaceFile.seek(sizeof(float) * (j * numRows + i)) || replaceFile.read((char*)(readScratch.data() + j * thisRows), readBytes) != readBytes)
+                        {
+                            throw OperationException("short read from replacement file, aborting");
+                        }
+                    }
+                } else {
+                    int64_t readBytes = sizeof(float) * thisRows * numCols;
+                    if (replaceFile.read((char*)readScratch.data(), readBytes) != readBytes)
+                    {
+                        throw OperationException("short read from replacement file, aborting");
+                    }
                 }
-                float tempVal;
-                char* tempValPointer = (char*)&tempVal;//copy method isn't as fast, but it is clean
-                for (int j = 0; j < readSize; ++j)
+                if (swapBytes) ByteSwapping::swapArray(readScratch.data(), thisRows * numCols);
+                if (transpose)
                 {
-                    if (swapBytes->m_present)
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+                    for (int64_t r = 0; r < thisRows; ++r)
                     {
-                        char* elemPointer = (char*)(myScratch.getArray() + j);
-                        for (int k = 0; k < (int)sizeof(float); ++k)
+                        for (int64_t j = 0; j < numCols; ++j)
                         {
-                            tempValPointer[k] = elemPointer[sizeof(float) - 1 - k];
+                            rowScratch[r * numCols + j] = readScratch[j * thisRows + r];
                         }
-                    } else {
-                        tempVal = myScratch[j];
                     }
-                    if (transpose->m_present)
+                    myOutFile->setRows(rowScratch.data(), i, thisRows);
+                } else {
+                    myOutFile->setRows(readScratch.data(), i, thisRows);
+                }
+            }
+        } else {
+            int64_t blockRows = getBlockRows(numRows, numCols);
+            if (dataArrayRef->getArraySubscriptingOrder() == GiftiArrayIndexingOrderEnum::ROW_MAJOR_ORDER)
+            {//rows are already contiguous in the array
+                const float* inData = dataArrayRef->getDataPointerFloat();
+                for (int64_t i = 0; i < numRows; i += blockRows)
+                {
+                    myOutFile->setRows(inData + i * numCols, i, min(blockRows, numRows - i));
+                }
+            } else {
+                vector<float> rowScratch(blockRows * numCols);
+                for (int64_t i = 0; i < numRows; i += blockRows)
+                {
+                    int64_t thisRows = min(blockRows, numRows - i);
+                    for (int64_t r = 0; r < thisRows; ++r)
                     {
-                        int32_t indices[] = {j, i};
-                        dataArrayRef->setDataFloat32(indices, tempVal);
-                    } else {
-                        int32_t indices[] = {i, j};
-                        dataArrayRef->setDataFloat32(indices, tempVal);
+                        for (int64_t j = 0; j < numCols; ++j)
+                        {
+                            int32_t indices[] = {(int32_t)(i + r), (int32_t)j};
+                            rowScratch[r * numCols + j] = dataArrayRef->getDataFloat32(indices);
+                        }
                     }
+                    myOutFile->setRows(rowScratch.data(), i, thisRows);
                 }
             }
         }
-        vector<float> scratchRow(numCols);
-        for (int i = 0; i < numRows; ++i)
-        {
-            for (int j = 0; j < numCols; ++j)
-            {
-                int32_t indices[] = {i, j};
-                scratchRow[j] = dataArrayRef->getDataFloat32(indices);
-            }
-            myOutFile->setRow(scratchRow.data(), i);
-        }
     }
     if (toNifti->m_present)
     {
         CiftiFile* myCiftiIn = toNifti->getCifti(1);
         if (myCiftiIn->getCiftiXML().getNumberOfDimensions() != 2) throw OperationException("conversion only supported for 2D cifti");
-        VolumeFile* myNiftiOut = toNifti->getOutputVolume(2);
+        AString niftiOutName = toNifti->getString(2);
         vector<int64_t> outDims(4, 1);
         outDims[3] = myCiftiIn->getNumberOfColumns();
         if (outDims[3] > numeric_limits<short>::max()) throw OperationException("cifti rows are too long for nifti1, failing");
@@ -304,39 +338,101 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
             ++index;
         }
         outDims[index] = temp;
-        myNiftiOut->reinitialize(outDims, FloatMatrix::identity(4).getMatrix());
-        myNiftiOut->setValueAllVoxels(0.0f);
-        int64_t ijk[3] = { 0, 0, 0 };
-        vector<float> rowscratch(outDims[3]);
-        for (int64_t i = 0; i < numRows; ++i)
+        int64_t frameSize = outDims[0] * outDims[1] * outDims[2], numCols = outDims[3];
+        NiftiHeader outHeader;
+        int16_t outType = CiftiFile::getDefaultWritingDataType();
+        for (int i = 0; i < 2; ++i)
         {
-            myCiftiIn->getRow(rowscratch.data(), i);
-            for (int64_t j = 0; j < outDims[3]; ++j)
+            if (myCiftiIn->getCiftiXML().getMappingType(i) == CiftiMappingType::LABELS) outType = NIFTI_TYPE_FLOAT32;//label keys must stay exact, like CiftiFile output
+        }
+        outHeader.setDataType(outType);
+        if (outType != NIFTI_TYPE_FLOAT32 && outType != NIFTI_TYPE_FLOAT64)
+        {//integer output, scan the cifti once to see whether the data needs scaling to fit
+            double minVal = numeric_limits<double>::infinity(), maxVal = -numeric_limits<double>::infinity(), mult, offset;
+            bool allIntegers = true;
+            if (frameSize > numRows)
+            {
+                const float zero = 0.0f;//padding voxels must be representable
+                NiftiHeader::accumulateDataRange(&zero, 1, minVal, maxVal, allIntegers);
+            }
+            int64_t blockRows = getBlockRows(numRows, numCols);
+            vector<float> rowScratch(blockRows * numCols);
+            for (int64_t i = 0; i < numRows; i += blockRows)
+            {
+                int64_t thisRows = min(blockRows, numRows - i);
+                myCiftiIn->getRows(rowScratch.data(), i, thisRows);
+                NiftiHeader::accumulateDataRange(rowScratch.data(), thisRows * numCols, minVal, maxVal, allIntegers);
+            }
+            if (NiftiHeader::computeDataScaling(outType, minVal, maxVal, allIntegers, mult, offset))
             {
-                myNiftiOut->setValue(rowscratch[j], ijk, j);
+                outHeader.setDataScaling(mult, offset);
             }
-            ++ijk[0];
-            if (ijk[0] >= outDims[0])
+        }
+        outHeader.setDimensions(outDims);
+        outHeader.setSForm(FloatMatrix::identity(4).getMatrix());
+        NiftiIO myNiftiOut;
+        myNiftiOut.writeNew(niftiOutName, outHeader, 1);
+        if (niftiOutName.endsWith(".gz"))
+        {//compressed output can't seek backwards, so write whole frames in order, scanning the cifti once per group of frames
+            int64_t groupFrames = max((int64_t)1, min(numCols, BLOCK_BYTES / (int64_t)sizeof(float) / frameSize));
+            int64_t blockRows = getBlockRows(numRows, numCols);
+            vector<float> frameScratch(groupFrames * frameSize, 0.0f), rowScratch(blockRows * numCols);//padding voxels stay zero
+            for (int64_t f = 0; f < numCols; f += groupFrames)
             {
-                ijk[0] = 0;
-                ++ijk[1];
-                if (ijk[1] >= outDims[1])
+                int64_t thisFrames = min(groupFrames, numCols - f);
+                for (int64_t i = 0; i < numRows; i += blockRows)
                 {
-                    ijk[1] = 0;
-                    ++ijk[2];
-                    CaretAssert(i == numRows - 1 || ijk[2] < outDims[2]);//in case it divided exactly
+                    int64_t thisRows = min(blockRows, numRows - i);
+                    myCiftiIn->getRows(rowScratch.data(), i, thisRows);
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+                    for (int64_t j = 0; j < thisFrames; ++j)
+                    {
+                        for (int64_t r = 0; r < thisRows; ++r)
+                        {
+                            frameScratch[j * frameSize + i + r] = rowScratch[r * numCols + f + j];
+                        }
+                    }
+                }
+                myNiftiOut.writeElements(frameScratch.data(), f * frameSize, thisFrames * frameSize);
+            }
+        } else {//read each block of rows once, and write its piece of every frame
+            int64_t blockRows = getBlockRows(frameSize, numCols);
+            vector<float> rowScratch(blockRows * numCols), frameScratch(blockRows * numCols);
+            for (int64_t i = 0; i < frameSize; i += blockRows)
+            {
+                int64_t thisRows = min(blockRows, frameSize - i);
+                int64_t haveRows = max((int64_t)0, min(thisRows, numRows - i));//rows past the end of the cifti are padding, and must be written as zeros
+                if (haveRows > 0) myCiftiIn->getRows(rowScratch.data(), i, haveRows);
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+                for (int64_t j = 0; j < numCols; ++j)
+                {
+                    for (int64_t r = 0; r < thisRows; ++r)
+                    {
+                        frameScratch[j * thisRows + r] = (r < haveRows ? rowScratch[r * numCols + j] : 0.0f);
+                    }
+                }
+                for (int64_t j = 0; j < numCols; ++j)
+                {
+                    myNiftiOut.writeElements(frameScratch.data() + j * thisRows, j * frameSize + i, thisRows);
                 }
             }
         }
+        myNiftiOut.close();
     }
     if (fromNifti->m_present)
     {
-        VolumeFile* myNiftiIn = fromNifti->getVolume(1);
+        AString niftiInName = fromNifti->getString(1);
         CiftiFile* myTemplate = fromNifti->getCifti(2);
         CiftiFile* myCiftiOut = fromNifti->getOutputCifti(3);
-        vector<int64_t> myDims;
-        myNiftiIn->getDimensions(myDims);
-        if (myDims[4] != 1) throw OperationException("input nifti has multiple components, aborting");
+        NiftiIO myNiftiIn;
+        myNiftiIn.openRead(niftiInName);
+        if (myNiftiIn.getNumComponents() != 1) throw OperationException("input nifti has multiple components, aborting");
+        vector<int64_t> myDims = myNiftiIn.getDimensions();
+        myDims.resize(max((int)myDims.size(), 4), 1);
+        for (int i = 4; i < (int)myDims.size(); ++i)
+        {
+            myDims[3] *= myDims[i];//treat any extra dimensions as more frames
+        }
         CiftiXML outXML = myTemplate->getCiftiXML();
         if (outXML.getNumberOfDimensions() != 2) throw OperationException("conversion only supported for 2D cifti");
         OptionalParameter* fnresetTimeOpt = fromNifti->getOptionalParameter(4);
@@ -371,14 +467,26 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
                                      ", product of first three nifti dimensions is " + AString::number(myDims[0] * myDims[1] * myDims[2]) + ")");
         }
         myCiftiOut->setCiftiXML(outXML);
-        vector<float> rowscratch(numCols);
-        for (int64_t i = 0; i < numRows; ++i)
+        int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+        int64_t blockRows = getBlockRows(numRows, numCols);
+        if (niftiInName.endsWith(".gz")) blockRows = numRows;//compressed files can't seek backwards cheaply, so read every frame exactly once, in order
+        vector<float> frameScratch(blockRows * numCols), rowScratch(blockRows * numCols);
+        for (int64_t i = 0; i < numRows; i += blockRows)
         {
+            int64_t thisRows = min(blockRows, numRows - i);
             for (int64_t j = 0; j < numCols; ++j)
             {
-                rowscratch[j] = myNiftiIn->getFrame(j)[i];
+                myNiftiIn.readElements(frameScratch.data() + j * thisRows, j * frameSize + i, thisRows);
+            }
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+            for (int64_t r = 0; r < thisRows; ++r)
+            {
+                for (int64_t j = 0; j < numCols; ++j)
+                {
+                    rowScratch[r * numCols + j] = frameScratch[j * thisRows + r];
+                }
             }
-            myCiftiOut->setRow(rowscratch.data(), i);
+            myCiftiOut->setRows(rowScratch.data(), i, thisRows);
         }
     }
     if (toText->m_present)
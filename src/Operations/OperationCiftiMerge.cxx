@@ -22,6 +22,7 @@
 #include "OperationException.h"
 
 #include "CaretAssert.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 
@@ -30,6 +31,17 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    struct MergeInput
+    {
+        int64_t rowLength, outOffset;
+        int buffer;//which block buffer holds this file's rows
+        bool wholeRow;
+        vector<int64_t> sourceColumns;//only used when columns are selected
+    };
+}
+
 AString OperationCiftiMerge::getCommandSwitch()
 {
     return "-cifti-merge";
@@ -140,7 +152,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             CaretAssert(false);
     }
-    int64_t curCol = 0, scratchRowLength = 0;
+    int64_t curCol = 0;
     for (int i = 0; i < numInputs; ++i)
     {
         const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
@@ -150,7 +162,6 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         int numColumnOpts = (int)columnOpts.size();
         if (numColumnOpts > 0)
         {
-            scratchRowLength = max(scratchRowLength, thisXML.getDimensionLength(CiftiXML::ALONG_ROW));//if we use the entire row, we don't need a separate scratch row for it
             if (doLoop)
             {
                 for (int j = 0; j < numColumnOpts; ++j)
@@ -256,52 +267,114 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
     }
     ciftiOut->setCiftiXML(outXML);
     int64_t numRows = baseColMapping.getLength();
-    vector<float> outRow(numOutColumns), scratchRow(scratchRowLength);
-    for (int64_t row = 0; row < numRows; ++row)
+    vector<MergeInput> mergeInputs(numInputs);
+    vector<const CiftiFile*> uniqueFiles;//a file given more than once only needs to be read once per block
+    int64_t inputRowTotal = 0;
+    curCol = 0;
+    for (int i = 0; i < numInputs; ++i)
     {
-        curCol = 0;
-        for (int i = 0; i < numInputs; ++i)
+        const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
+        MergeInput& thisInput = mergeInputs[i];
+        thisInput.rowLength = ciftiIn->getNumberOfColumns();
+        thisInput.outOffset = curCol;
+        thisInput.wholeRow = true;
+        const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
+        int numColumnOpts = (int)columnOpts.size();
+        if (numColumnOpts > 0)
         {
-            const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
-            vector<int64_t> thisDims = ciftiIn->getDimensions();
-            const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
-            int numColumnOpts = (int)columnOpts.size();
-            if (numColumnOpts > 0)
+            thisInput.wholeRow = false;
+            for (int j = 0; j < numColumnOpts; ++j)
             {
-                ciftiIn->getRow(scratchRow.data(), row);
-                for (int j = 0; j < numColumnOpts; ++j)
+                int64_t initialColumn = columnOpts[j]->getInteger(1) - 1;//1-based indexing convention
+                OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);
+                if (upToOpt->m_present)
                 {
-                    int64_t initialColumn = columnOpts[j]->getInteger(1) - 1;//1-based indexing convention
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);
-                    if (upToOpt->m_present)
+                    int finalColumn = upToOpt->getInteger(1) - 1;//ditto
+                    bool reverse = upToOpt->getOptionalParameter(2)->m_present;
+                    if (reverse)
                     {
-                        int finalColumn = upToOpt->getInteger(1) - 1;//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
+                        for (int c = finalColumn; c >= initialColumn; --c)
                         {
-                            for (int c = finalColumn; c >= initialColumn; --c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
+                            thisInput.sourceColumns.push_back(c);
                         }
                     } else {
-                        outRow[curCol] = scratchRow[initialColumn];
-                        ++curCol;
+                        for (int c = initialColumn; c <= finalColumn; ++c)
+                        {
+                            thisInput.sourceColumns.push_back(c);
+                        }
                     }
+                } else {
+                    thisInput.sourceColumns.push_back(initialColumn);
                 }
+            }
+            curCol += (int64_t)thisInput.sourceColumns.size();
+        } else {
+            curCol += thisInput.rowLength;
+        }
+        thisInput.buffer = find(uniqueFiles.begin(), uniqueFiles.end(), ciftiIn) - uniqueFiles.begin();
+        if (thisInput.buffer == (int)uniqueFiles.size())
+        {
+            uniqueFiles.push_back(ciftiIn);
+            inputRowTotal += thisInput.rowLength;
+        }
+    }
+    CaretAssert(curCol == numOutColumns);
+    int numUnique = (int)uniqueFiles.size();
+    //read blocks of contiguous rows from every input, and keep two output blocks so the previous one can be written while the next is being read
+    const int64_t BLOCK_BYTES = ((int64_t)1) << 26;
+    int64_t blockRows = max((int64_t)1, min(numRows, BLOCK_BYTES / (int64_t)sizeof(float) / (inputRowTotal + 2 * numOutColumns)));
+    vector<vector<float> > inBlocks(numUnique);
+    for (int i = 0; i < numUnique; ++i)
+    {
+        inBlocks[i].resize(blockRows * uniqueFiles[i]->getNumberOfColumns());
+    }
+    vector<float> outBlocks[2];
+    outBlocks[0].resize(blockRows * numOutColumns);
+    outBlocks[1].resize(blockRows * numOutColumns);
+    int curBlock = 0;
+    int64_t pendingStart = 0, pendingRows = 0;
+    for (int64_t blockStart = 0; blockStart < numRows; blockStart += blockRows)
+    {
+        int64_t thisRows = min(blockRows, numRows - blockStart);
+        const vector<float>& pendingBlock = outBlocks[1 - curBlock];
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int t = 0; t <= numUnique; ++t)
+        {//each file is only touched by one thread, the extra iteration writes out the previous block
+            if (t < numUnique)
+            {
+                uniqueFiles[t]->getRows(inBlocks[t].data(), blockStart, thisRows);
             } else {
-                ciftiIn->getRow(outRow.data() + curCol, row);
-                curCol += thisDims[0];
+                if (pendingRows > 0) ciftiOut->setRows(pendingBlock.data(), pendingStart, pendingRows);
+            }
+        }
+        float* outBlock = outBlocks[curBlock].data();
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+        for (int64_t r = 0; r < thisRows; ++r)
+        {
+            float* outRow = outBlock + r * numOutColumns;
+            for (int i = 0; i < numInputs; ++i)
+            {
+                const MergeInput& thisInput = mergeInputs[i];
+                const float* inRow = inBlocks[thisInput.buffer].data() + r * thisInput.rowLength;
+                float* outStart = outRow + thisInput.outOffset;
+                if (thisInput.wholeRow)
+                {
+                    for (int64_t c = 0; c < thisInput.rowLength; ++c)
+                    {
+                        outStart[c] = inRow[c];
+                    }
+                } else {
+                    int64_t numSelected = (int64_t)thisInput.sourceColumns.size();
+                    for (int64_t c = 0; c < numSelected; ++c)
+                    {
+                        outStart[c] = inRow[thisInput.sourceColumns[c]];
+                    }
+                }
             }
         }
-        CaretAssert(curCol == numOutColumns);
-        ciftiOut->setRow(outRow.data(), row);
+        pendingStart = blockStart;
+        pendingRows = thisRows;
+        curBlock = 1 - curBlock;
     }
+    if (pendingRows > 0) ciftiOut->setRows(outBlocks[1 - curBlock].data(), pendingStart, pendingRows);
 }
@@ -22,10 +22,9 @@
 #include "OperationException.h"
 
 #include "CiftiFile.h"
+#include "ColumnStatistics.h"
 #include "ReductionOperation.h"
 
-#include <algorithm>
-#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -50,10 +49,10 @@ OperationParameters* OperationCiftiStats::getParameters()
     
     ret->addCiftiParameter(1, "cifti-in", "the input cifti");
     
-    OptionalParameter* reduceOpt = ret->createOptionalParameter(2, "-reduce", "use a reduction operation");
+    ParameterComponent* reduceOpt = ret->createRepeatableParameter(2, "-reduce", "use a reduction operation");
     reduceOpt->addStringParameter(1, "operation", "the reduction operation");
     
-    OptionalParameter* percentileOpt = ret->createOptionalParameter(3, "-percentile", "give the value at a percentile");
+    ParameterComponent* percentileOpt = ret->createRepeatableParameter(3, "-percentile", "give the value at a percentile");
     percentileOpt->addDoubleParameter(1, "percent", "the percentile to find");
     
     OptionalParameter* columnOpt = ret->createOptionalParameter(4, "-column", "only display output for one column");
@@ -66,10 +65,13 @@ OperationParameters* OperationCiftiStats::getParameters()
     ret->createOptionalParameter(6, "-show-map-name", "print column index and name before each output");
     
     ret->setHelpText(
-        AString("For each column of the input, a single number is printed, resulting from the specified reduction or percentile operation.  ") +
+        AString("For each column of the input, a line is printed containing the results of the specified reduction and percentile operations, separated by tabs.  ") +
         "Use -column to only give output for a single column.  " +
         "Use -roi to consider only the data within a region.  " +
-        "Exactly one of -reduce or -percentile must be specified.\n\n" +
+        "At least one -reduce or -percentile must be specified, and both options may be repeated.  " +
+        "The reductions are printed first, followed by the percentiles, each in the order given.  " +
+        "The input is read one row at a time, so large files do not need to fit in memory, " +
+        "unless MEDIAN, MODE, or a percentile is requested, which need the values of every column to be kept.\n\n" +
         "The argument to the -reduce option must be one of the following:\n\n" +
         ReductionOperation::getHelpInfo());
     return ret;
@@ -77,55 +79,16 @@ OperationParameters* OperationCiftiStats::getParameters()
 
 namespace
 {
-    float reduce(const vector<float>& data, const ReductionEnum::Enum& myop, const vector<float>& roiData)
+    void printResults(const vector<float>& results)
     {
-        if (roiData.empty())
-        {
-            return ReductionOperation::reduce(data.data(), data.size(), myop);
-        } else {
-            int64_t numElems = (int64_t)data.size();
-            CaretAssert(numElems == (int64_t)roiData.size());
-            vector<float> toUse;
-            toUse.reserve(numElems);
-            for (int64_t i = 0; i < numElems; ++i)
-            {
-                if (roiData[i] > 0.0f)
-                {
-                    toUse.push_back(data[i]);
-                }
-            }
-            if (toUse.empty()) throw OperationException("roi column is empty");
-            return ReductionOperation::reduce(toUse.data(), toUse.size(), myop);
-        }
-    }
-    
-    float percentile(const vector<float>& data, const float& percent, const vector<float>& roiData)
-    {
-        CaretAssert(percent >= 0.0f && percent <= 100.0f);
-        vector<float> toUse;
-        if (roiData.empty())
+        stringstream resultsstr;
+        resultsstr << setprecision(7);
+        for (int i = 0; i < (int)results.size(); ++i)
         {
-            toUse = data;
-        } else {
-            int64_t numElems = (int64_t)data.size();
-            CaretAssert(numElems == (int64_t)roiData.size());
-            toUse.reserve(numElems);
-            for (int i = 0; i < numElems; ++i)
-            {
-                if (roiData[i] > 0.0f)
-                {
-                    toUse.push_back(data[i]);
-                }
-            }
+            if (i != 0) resultsstr << "\t";
+            resultsstr << results[i];
         }
-        if (toUse.empty()) throw OperationException("roi is empty");
-        sort(toUse.begin(), toUse.end());
-        const float index = percent / 100.0f * (toUse.size() - 1);
-        if (index <= 0) return toUse[0];
-        if (index >= toUse.size() - 1) return toUse.back();
-        float ipart, fpart;
-        fpart = modf(index, &ipart);
-        return (1.0f - fpart) * toUse[(int)ipart] + fpart * toUse[((int)ipart) + 1];
+        cout << resultsstr.str() << endl;
     }
 }
 
@@ -137,24 +100,25 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
     if (myXML.getNumberOfDimensions() != 2) throw OperationException("only 2D cifti are supported in this command");
     int64_t numCols = myXML.getDimensionLength(CiftiXML::ALONG_ROW);
     int64_t colLength = myXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    OptionalParameter* reduceOpt = myParams->getOptionalParameter(2);
-    OptionalParameter* percentileOpt = myParams->getOptionalParameter(3);
-    if (reduceOpt->m_present == percentileOpt->m_present)//use == as logical xor
+    const vector<ParameterComponent*>& reduceInst = *(myParams->getRepeatableParameterInstances(2));
+    const vector<ParameterComponent*>& percentileInst = *(myParams->getRepeatableParameterInstances(3));
+    if (reduceInst.empty() && percentileInst.empty())
     {
-        throw OperationException("you must use exactly one of -reduce or -percentile");
+        throw OperationException("you must use at least one of -reduce or -percentile");
     }
-    ReductionEnum::Enum myop = ReductionEnum::INVALID;
-    if (reduceOpt->m_present)
+    vector<ReductionEnum::Enum> myops;
+    for (int i = 0; i < (int)reduceInst.size(); ++i)
     {
         bool ok = false;
-        myop = ReductionEnum::fromName(reduceOpt->getString(1), &ok);
-        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceOpt->getString(1));
+        myops.push_back(ReductionEnum::fromName(reduceInst[i]->getString(1), &ok));
+        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceInst[i]->getString(1));
     }
-    float percent = 0.0f;
-    if (percentileOpt->m_present)
+    vector<float> percents;
+    for (int i = 0; i < (int)percentileInst.size(); ++i)
     {
-        percent = (float)percentileOpt->getDouble(1);//use not within range to trap NaNs, just in case
+        float percent = (float)percentileInst[i]->getDouble(1);//use not within range to trap NaNs, just in case
         if (!(percent >= 0.0f && percent <= 100.0f)) throw OperationException("percentile must be between 0 and 100");
+        percents.push_back(percent);
     }
     int useColumn = -1;
     OptionalParameter* columnOpt = myParams->getOptionalParameter(4);
@@ -188,57 +152,47 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
     }
     bool showMapName = myParams->getOptionalParameter(6)->m_present;
     const CiftiMappingType* rowMap = myXML.getMap(CiftiXML::ALONG_ROW);
-    vector<float> colScratch(colLength);
     if (useColumn == -1)
-    {
-        myInput->convertToInMemory();//we will be getting all columns, so read it all in first
-        if (matchColumnMode)
-        {
-            roiCifti->convertToInMemory();//ditto
-        }
-        for (int i = 0; i < numCols; ++i)
+    {//stream the rows, rather than reading the whole file to get columns
+        ColumnStatistics myStats(numCols, myops, percents);
+        vector<float> rowScratch(numCols), roiRowScratch;
+        if (matchColumnMode) roiRowScratch.resize(numCols);
+        for (int64_t row = 0; row < colLength; ++row)
         {
-            myInput->getColumn(colScratch.data(), i);
             if (matchColumnMode)
             {
-                roiCifti->getColumn(roiData.data(), i);
-            }
-            float result;
-            if (reduceOpt->m_present)
-            {
-                result = reduce(colScratch, myop, roiData);
+                myInput->getRow(rowScratch.data(), row);
+                roiCifti->getRow(roiRowScratch.data(), row);
+                myStats.addRow(rowScratch.data(), roiRowScratch.data());
             } else {
-                CaretAssert(percentileOpt->m_present);
-                result = percentile(colScratch, percent, roiData);
+                if (!roiData.empty() && !(roiData[row] > 0.0f)) continue;//don't even read rows outside the roi
+                myInput->getRow(rowScratch.data(), row);
+                myStats.addRow(rowScratch.data());
             }
+        }
+        vector<vector<float> > results;
+        myStats.getResults(results);
+        for (int i = 0; i < numCols; ++i)
+        {
             if (showMapName)
             {
                 cout << AString::number(i + 1) << ": " << rowMap->getIndexName(i) << ": ";
             }
-            stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str() << endl;
+            printResults(results[i]);
         }
     } else {
+        vector<float> colScratch(colLength);
         myInput->getColumn(colScratch.data(), useColumn);
         if (matchColumnMode)
         {
             roiCifti->getColumn(roiData.data(), useColumn);
         }
-        float result;
-        if (reduceOpt->m_present)
-        {
-            result = reduce(colScratch, myop, roiData);
-        } else {
-            CaretAssert(percentileOpt->m_present);
-            result = percentile(colScratch, percent, roiData);
-        }
+        vector<float> results;
+        ColumnStatistics::computeColumn(colScratch.data(), colLength, (roiData.empty() ? NULL : roiData.data()), myops, percents, results);
         if (showMapName)
         {
             cout << AString::number(useColumn + 1) << ": " << rowMap->getIndexName(useColumn) << ": ";
         }
-        stringstream resultsstr;
-        resultsstr << setprecision(7) << result;
-        cout << resultsstr.str() << endl;
+        printResults(results);
     }
 }
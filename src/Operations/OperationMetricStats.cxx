@@ -21,11 +21,10 @@
 #include "OperationMetricStats.h"
 #include "OperationException.h"
 
+#include "ColumnStatistics.h"
 #include "MetricFile.h"
 #include "ReductionOperation.h"
 
-#include <algorithm>
-#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -50,10 +49,10 @@ OperationParameters* OperationMetricStats::getParameters()
     
     ret->addMetricParameter(1, "metric-in", "the input metric");
     
-    OptionalParameter* reduceOpt = ret->createOptionalParameter(2, "-reduce", "use a reduction operation");
+    ParameterComponent* reduceOpt = ret->createRepeatableParameter(2, "-reduce", "use a reduction operation");
     reduceOpt->addStringParameter(1, "operation", "the reduction operation");
     
-    OptionalParameter* percentileOpt = ret->createOptionalParameter(3, "-percentile", "give the value at a percentile");
+    ParameterComponent* percentileOpt = ret->createRepeatableParameter(3, "-percentile", "give the value at a percentile");
     percentileOpt->addDoubleParameter(1, "percent", "the percentile to find");
     
     OptionalParameter* columnOpt = ret->createOptionalParameter(4, "-column", "only display output for one column");
@@ -66,10 +65,11 @@ OperationParameters* OperationMetricStats::getParameters()
     ret->createOptionalParameter(6, "-show-map-name", "print map index and name before each output");
     
     ret->setHelpText(
-        AString("For each column of the input, a single number is printed, resulting from the specified reduction or percentile operation.  ") +
+        AString("For each column of the input, a line is printed containing the results of the specified reduction and percentile operations, separated by tabs.  ") +
         "Use -column to only give output for a single column.  " +
         "Use -roi to consider only the data within a region.  " +
-        "Exactly one of -reduce or -percentile must be specified.\n\n" +
+        "At least one -reduce or -percentile must be specified, and both options may be repeated.  " +
+        "The reductions are printed first, followed by the percentiles, each in the order given.\n\n" +
         "The argument to the -reduce option must be one of the following:\n\n" +
         ReductionOperation::getHelpInfo());
     return ret;
@@ -77,51 +77,16 @@ OperationParameters* OperationMetricStats::getParameters()
 
 namespace
 {
-    float reduce(const float* data, const int& numNodes, const ReductionEnum::Enum& myop, const float* roiData)
+    void printResults(const vector<float>& results)
     {
-        if (roiData == NULL)
+        stringstream resultsstr;
+        resultsstr << setprecision(7);
+        for (int i = 0; i < (int)results.size(); ++i)
         {
-            return ReductionOperation::reduce(data, numNodes, myop);
-        } else {
-            vector<float> toUse;
-            toUse.reserve(numNodes);
-            for (int i = 0; i < numNodes; ++i)
-            {
-                if (roiData[i] > 0.0f)
-                {
-                    toUse.push_back(data[i]);
-                }
-            }
-            if (toUse.empty()) throw OperationException("roi contains no vertices");
-            return ReductionOperation::reduce(toUse.data(), toUse.size(), myop);
-        }
-    }
-    
-    float percentile(const float* data, const int& numNodes, const float& percent, const float* roiData)
-    {
-        CaretAssert(percent >= 0.0f && percent <= 100.0f);
-        vector<float> toUse;
-        if (roiData == NULL)
-        {
-            toUse = vector<float>(data, data + numNodes);
-        } else {
-            toUse.reserve(numNodes);
-            for (int i = 0; i < numNodes; ++i)
-            {
-                if (roiData[i] > 0.0f)
-                {
-                    toUse.push_back(data[i]);
-                }
-            }
+            if (i != 0) resultsstr << "\t";
+            resultsstr << results[i];
         }
-        if (toUse.empty()) throw OperationException("roi contains no vertices");
-        sort(toUse.begin(), toUse.end());
-        const float index = percent / 100.0f * (toUse.size() - 1);
-        if (index <= 0) return toUse[0];
-        if (index >= toUse.size() - 1) return toUse.back();
-        float ipart, fpart;
-        fpart = modf(index, &ipart);
-        return (1.0f - fpart) * toUse[(int)ipart] + fpart * toUse[((int)ipart) + 1];
+        cout << resultsstr.str() << endl;
     }
 }
 
@@ -131,24 +96,25 @@ void OperationMetricStats::useParameters(OperationParameters* myParams, Progress
     MetricFile* input = myParams->getMetric(1);
     int numNodes = input->getNumberOfNodes();
     int numCols = input->getNumberOfColumns();
-    OptionalParameter* reduceOpt = myParams->getOptionalParameter(2);
-    OptionalParameter* percentileOpt = myParams->getOptionalParameter(3);
-    if (reduceOpt->m_present == percentileOpt->m_present)//use == as logical xor
+    const vector<ParameterComponent*>& reduceInst = *(myParams->getRepeatableParameterInstances(2));
+    const vector<ParameterComponent*>& percentileInst = *(myParams->getRepeatableParameterInstances(3));
+    if (reduceInst.empty() && percentileInst.empty())
     {
-        throw OperationException("you must use exactly one of -reduce or -percentile");
+        throw OperationException("you must use at least one of -reduce or -percentile");
     }
-    ReductionEnum::Enum myop = ReductionEnum::INVALID;
-    if (reduceOpt->m_present)
+    vector<ReductionEnum::Enum> myops;
+    for (int i = 0; i < (int)reduceInst.size(); ++i)
     {
         bool ok = false;
-        myop = ReductionEnum::fromName(reduceOpt->getString(1), &ok);
-        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceOpt->getString(1));
+        myops.push_back(ReductionEnum::fromName(reduceInst[i]->getString(1), &ok));
+        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceInst[i]->getString(1));
     }
-    float percent = 0.0f;
-    if (percentileOpt->m_present)
+    vector<float> percents;
+    for (int i = 0; i < (int)percentileInst.size(); ++i)
     {
-        percent = (float)percentileOpt->getDouble(1);//use not within range to trap NaNs, just in case
+        float percent = (float)percentileInst[i]->getDouble(1);//use not within range to trap NaNs, just in case
         if (!(percent >= 0.0f && percent <= 100.0f)) throw OperationException("percentile must be between 0 and 100");
+        percents.push_back(percent);
     }
     int column = -1;
     OptionalParameter* columnOpt = myParams->getOptionalParameter(4);
@@ -177,57 +143,35 @@ void OperationMetricStats::useParameters(OperationParameters* myParams, Progress
         }
     }
     bool showMapName = myParams->getOptionalParameter(6)->m_present;
-    if (column == -1)
+    int startCol = 0, endCol = numCols;
+    if (column != -1)
     {
-        if (reduceOpt->m_present)
-        {
-            for (int i = 0; i < numCols; ++i)
-            {//store result before printing anything, in case it throws while computing
-                if (matchColumnMode)
-                {
-                    roiData = myRoi->getValuePointerForColumn(i);
-                }
-                const float result = reduce(input->getValuePointerForColumn(i), numNodes, myop, roiData);
-                if (showMapName) cout << AString::number(i + 1) << ": " << input->getMapName(i) << ": ";
-                stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
-                cout << resultsstr.str() << endl;
-            }
-        } else {
-            CaretAssert(percentileOpt->m_present);
-            for (int i = 0; i < numCols; ++i)
-            {//store result before printing anything, in case it throws while computing
-                if (matchColumnMode)
-                {
-                    roiData = myRoi->getValuePointerForColumn(i);
-                }
-                const float result = percentile(input->getValuePointerForColumn(i), numNodes, percent, roiData);
-                if (showMapName) cout << AString::number(i + 1) << ": " << input->getMapName(i) << ": ";
-                stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
-                cout << resultsstr.str() << endl;
-            }
-        }
-    } else {
         CaretAssert(column >= 0 && column < numCols);
+        startCol = column;
+        endCol = column + 1;
+    }
+    vector<float> results;
+    for (int i = startCol; i < endCol; ++i)
+    {//compute all results for the column before printing anything, in case it throws
         if (matchColumnMode)
         {
-            roiData = myRoi->getValuePointerForColumn(column);
+            roiData = myRoi->getValuePointerForColumn(i);
         }
-        if (reduceOpt->m_present)
+        if (roiData != NULL)
         {
-            const float result = reduce(input->getValuePointerForColumn(column), numNodes, myop, roiData);
-            if (showMapName) cout << AString::number(column + 1) << ": " << input->getMapName(column) << ": ";
-            stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str() << endl;
-        } else {
-            CaretAssert(percentileOpt->m_present);
-            const float result = percentile(input->getValuePointerForColumn(column), numNodes, percent, roiData);
-            if (showMapName) cout << AString::number(column + 1) << ": " << input->getMapName(column) << ": ";
-            stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str() << endl;
+            bool haveVertex = false;
+            for (int j = 0; j < numNodes; ++j)
+            {
+                if (roiData[j] > 0.0f)
+                {
+                    haveVertex = true;
+                    break;
+                }
+            }
+            if (!haveVertex) throw OperationException("roi contains no vertices");
         }
+        ColumnStatistics::computeColumn(input->getValuePointerForColumn(i), numNodes, roiData, myops, percents, results);
+        if (showMapName) cout << AString::number(i + 1) << ": " << input->getMapName(i) << ": ";
+        printResults(results);
     }
 }
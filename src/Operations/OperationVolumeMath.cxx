@@ -24,7 +24,8 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
-#include "VolumeFile.h"
+#include "VolumeFrameReader.h"
+#include "VolumeFrameWriter.h"
 
 #include <iostream>
 
@@ -47,11 +48,11 @@ OperationParameters* OperationVolumeMath::getParameters()
     
     ret->addStringParameter(1, "expression", "the expression to evaluate, in quotes");
     
-    ret->addVolumeOutputParameter(2, "volume-out", "the output volume");
+    ret->addOnDiskVolumeOutputParameter(2, "volume-out", "the output volume");
     
     ParameterComponent* varOpt = ret->createRepeatableParameter(3, "-var", "a volume file to use as a variable");
     varOpt->addStringParameter(1, "name", "the name of the variable, as used in the expression");
-    varOpt->addVolumeParameter(2, "volume", "the volume file to use as this variable");
+    varOpt->addOnDiskVolumeParameter(2, "volume", "the volume file to use as this variable");
     OptionalParameter* subvolSelect = varOpt->createOptionalParameter(3, "-subvolume", "select a single subvolume");
     subvolSelect->addStringParameter(1, "subvol", "the subvolume number or name");
     varOpt->createOptionalParameter(4, "-repeat", "reuse a single subvolume for each subvolume of calculation");
@@ -79,7 +80,7 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
     CaretMathExpression myExpr(expression);
     cout << "parsed '" + expression + "' as '" + myExpr.toString() + "'" << endl;
     vector<AString> myVarNames = myExpr.getVarNames();
-    VolumeFile* myVolOut = myParams->getOutputVolume(2);
+    VolumeFrameWriter* myVolOut = myParams->getOnDiskOutputVolume(2);
     const vector<ParameterComponent*>& myVarOpts = *(myParams->getRepeatableParameterInstances(3));
     OptionalParameter* fixNanOpt = myParams->getOptionalParameter(4);
     bool nanfix = false;
@@ -91,10 +92,10 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
     }
     int numInputs = myVarOpts.size();
     int numVars = myVarNames.size();
-    vector<VolumeFile*> varVolumes(numVars, (VolumeFile*)NULL);
+    vector<VolumeFrameReader*> varVolumes(numVars, (VolumeFrameReader*)NULL);
     vector<int> varSubvolumes(numVars, -1);
     if (numInputs == 0 && numVars == 0) throw OperationException("you must specify at least one input volume (-var), even if the expression doesn't use a variable");
-    VolumeFile* first;
+    VolumeFrameReader* first;
     VolumeSpace mySpace;
     vector<int64_t> outDims;
     int numSubvols = -1;
@@ -102,7 +103,7 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
     {
         if (i == 0)
         {
-            first = myVarOpts[0]->getVolume(2);
+            first = myVarOpts[0]->getOnDiskVolume(2);
             mySpace = first->getVolumeSpace();
         }
         AString varName = myVarOpts[i]->getString(1);
@@ -111,7 +112,7 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
         {
             throw OperationException("'" + varName + "' is a named constant equal to " + AString::number(constVal, 'g', 15) + ", please use a different variable name");
         }
-        VolumeFile* thisVolume = myVarOpts[i]->getVolume(2);
+        VolumeFrameReader* thisVolume = myVarOpts[i]->getOnDiskVolume(2);
         if (thisVolume->getNumberOfComponents() != 1)
         {
             throw OperationException("volume file for variable '" + varName + "' has multiple components, this is not currently supported in -volume-math");
@@ -188,17 +189,17 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
     }
     int64_t frameSize = outDims[0] * outDims[1] * outDims[2];
     vector<float> values(numVars), outFrame(frameSize);
-    vector<const float*> inputFrames(numVars);
-    myVolOut->reinitialize(outDims, first->getSform());//DO NOT take volume type from first volume, because we don't check for or copy label tables, nor do we want to
+    vector<vector<float> > inputFrames(numVars, vector<float>(frameSize));//inputs are read one frame at a time, so memory use doesn't depend on the number of subvolumes
+    myVolOut->writeHeader(outDims, first->getVolumeSpace().getSform());//DO NOT take volume type from first volume, because we don't check for or copy label tables, nor do we want to
     for (int s = 0; s < numSubvols; ++s)
     {
         for (int v = 0; v < numVars; ++v)
         {
             if (varSubvolumes[v] == -1)
             {
-                inputFrames[v] = varVolumes[v]->getFrame(s);
-            } else {
-                inputFrames[v] = varVolumes[v]->getFrame(varSubvolumes[v]);
+                varVolumes[v]->readFrame(inputFrames[v].data(), s);
+            } else if (s == 0) {//fixed subvolume, only needs to be read once
+                varVolumes[v]->readFrame(inputFrames[v].data(), varSubvolumes[v]);
             }
         }
         for (int64_t i = 0; i < frameSize; ++i)
@@ -214,6 +215,6 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
             }
             outFrame[i] = tempf;
         }
-        myVolOut->setFrame(outFrame.data(), s);
+        myVolOut->writeFrame(outFrame.data(), s);
     }
 }
@@ -22,9 +22,14 @@
 #include "OperationException.h"
 
 #include "CaretAssert.h"
+#include "CaretPointer.h"
 #include "GiftiLabelTable.h"
 #include "PaletteColorMapping.h"
 #include "VolumeFile.h"
+#include "VolumeFrameReader.h"
+#include "VolumeFrameWriter.h"
+
+#include <map>
 
 using namespace caret;
 using namespace std;
@@ -43,10 +48,10 @@ OperationParameters* OperationVolumeMerge::getParameters()
 {
     OperationParameters* ret = new OperationParameters();
     
-    ret->addVolumeOutputParameter(1, "volume-out", "the output volume file");
+    ret->addOnDiskVolumeOutputParameter(1, "volume-out", "the output volume file");
     
     ParameterComponent* volumeOpt = ret->createRepeatableParameter(2, "-volume", "specify an input volume file");
-    volumeOpt->addVolumeParameter(1, "volume-in", "a volume file to use subvolumes from");
+    volumeOpt->addOnDiskVolumeParameter(1, "volume-in", "a volume file to use subvolumes from");
     ParameterComponent* subvolOpt = volumeOpt->createRepeatableParameter(2, "-subvolume", "select a single subvolume to use");
     subvolOpt->addStringParameter(1, "subvol", "the subvolume number or name");
     OptionalParameter* upToOpt = subvolOpt->createOptionalParameter(2, "-up-to", "use an inclusive range of subvolumes");
@@ -66,18 +71,17 @@ OperationParameters* OperationVolumeMerge::getParameters()
 void OperationVolumeMerge::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
 {
     LevelProgress myProgress(myProgObj);
-    VolumeFile* volumeOut = myParams->getOutputVolume(1);
+    VolumeFrameWriter* volumeOut = myParams->getOnDiskOutputVolume(1);
     const vector<ParameterComponent*>& myInputs = *(myParams->getRepeatableParameterInstances(2));
     int numInputs = (int)myInputs.size();
     if (numInputs < 1) throw OperationException("no inputs specified");
-    int64_t subvolCount = 0;
-    const VolumeFile* firstVol = myInputs[0]->getVolume(1);
-    vector<int64_t> firstDims = firstVol->getDimensions();
+    VolumeFrameReader* firstVol = myInputs[0]->getOnDiskVolume(1);
     bool isLabel = (firstVol->getType() == SubvolumeAttributes::LABEL);
+    vector<pair<VolumeFrameReader*, int64_t> > frameList;//first pass only figures out which input frames go where, frames are copied one at a time afterwards
     for (int i = 0; i < numInputs; ++i)
     {
-        const VolumeFile* myVol = myInputs[i]->getVolume(1);
-        if (!myVol->matchesVolumeSpace(firstVol))
+        VolumeFrameReader* myVol = myInputs[i]->getOnDiskVolume(1);
+        if (!myVol->matchesVolumeSpace(firstVol->getVolumeSpace()))
         {
             throw OperationException("volume file '" + myVol->getFileName() + "' has a different volume space");
         }
@@ -85,8 +89,7 @@ void OperationVolumeMerge::useParameters(OperationParameters* myParams, Progress
         {
             throw OperationException("only some volumes are label volumes, first mismatch is '" + myVol->getFileName() + "'");
         }
-        vector<int64_t> thisDims = myVol->getDimensions();
-        if (thisDims[4] != firstDims[4]) throw ("volume file '" + myVol->getFileName() + "' has a different number of components");
+        if (myVol->getNumberOfComponents() != firstVol->getNumberOfComponents()) throw OperationException("volume file '" + myVol->getFileName() + "' has a different number of components");
         const vector<ParameterComponent*>& subvolOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
         int numSubvolOpts = (int)subvolOpts.size();
         if (numSubvolOpts > 0)
@@ -102,102 +105,103 @@ void OperationVolumeMerge::useParameters(OperationParameters* myParams, Progress
                     if (finalFrame < 0) throw OperationException("ending subvolume '" + upToOpt->getString(1) + "' not found in file '" + myVol->getFileName() + "'");
                     if (finalFrame < initialFrame) throw OperationException("ending subvolume '" + upToOpt->getString(1) + "' occurs before starting subvolume '"
                                                                             + subvolOpts[j]->getString(1) + "' in file '" + myVol->getFileName() + "'");
-                    subvolCount += finalFrame - initialFrame + 1;//inclusive - we don't need to worry about reversing for counting, though
-                } else {
-                    subvolCount += 1;
-                }
-            }
-        } else {
-            subvolCount += myVol->getNumberOfMaps();
-        }
-    }
-    vector<int64_t> outDims = firstVol->getOriginalDimensions();
-    outDims.resize(4);
-    outDims[3] = subvolCount;
-    volumeOut->reinitialize(outDims, firstVol->getSform(), firstDims[4], firstVol->getType());
-    int64_t curOutVol = 0;
-    for (int i = 0; i < numInputs; ++i)
-    {
-        const VolumeFile* myVol = myInputs[i]->getVolume(1);
-        const vector<ParameterComponent*>& subvolOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
-        int numSubvolOpts = (int)subvolOpts.size();
-        if (numSubvolOpts > 0)
-        {
-            for (int j = 0; j < numSubvolOpts; ++j)
-            {
-                int64_t initialFrame = myVol->getMapIndexFromNameOrNumber(subvolOpts[j]->getString(1));
-                OptionalParameter* upToOpt = subvolOpts[j]->getOptionalParameter(2);
-                if (upToOpt->m_present)
-                {
-                    int64_t finalFrame = myVol->getMapIndexFromNameOrNumber(upToOpt->getString(1));
                     bool reverse = upToOpt->getOptionalParameter(2)->m_present;
                     if (reverse)
                     {
                         for (int64_t b = finalFrame; b >= initialFrame; --b)
                         {
-                            for (int64_t c = 0; c < firstDims[4]; ++c)
-                            {
-                                volumeOut->setFrame(myVol->getFrame(b, c), curOutVol, c);
-                            }
-                            volumeOut->setMapName(curOutVol, myVol->getMapName(b));
-                            if (isLabel)
-                            {
-                                *(volumeOut->getMapLabelTable(curOutVol)) = *(myVol->getMapLabelTable(b));
-                            } else {
-                                *(volumeOut->getMapPaletteColorMapping(curOutVol)) = *(myVol->getMapPaletteColorMapping(b));
-                            }
-                            ++curOutVol;
+                            frameList.push_back(make_pair(myVol, b));
                         }
                     } else {
                         for (int64_t b = initialFrame; b <= finalFrame; ++b)
                         {
-                            for (int64_t c = 0; c < firstDims[4]; ++c)
-                            {
-                                volumeOut->setFrame(myVol->getFrame(b, c), curOutVol, c);
-                            }
-                            volumeOut->setMapName(curOutVol, myVol->getMapName(b));
-                            if (isLabel)
-                            {
-                                *(volumeOut->getMapLabelTable(curOutVol)) = *(myVol->getMapLabelTable(b));
-                            } else {
-                                *(volumeOut->getMapPaletteColorMapping(curOutVol)) = *(myVol->getMapPaletteColorMapping(b));
-                            }
-                            ++curOutVol;
+                            frameList.push_back(make_pair(myVol, b));
                         }
                     }
                 } else {
-                    for (int64_t c = 0; c < firstDims[4]; ++c)
-                    {
-                        volumeOut->setFrame(myVol->getFrame(initialFrame, c), curOutVol, c);
-                    }
-                    volumeOut->setMapName(curOutVol, myVol->getMapName(initialFrame));
-                    if (isLabel)
-                    {
-                        *(volumeOut->getMapLabelTable(curOutVol)) = *(myVol->getMapLabelTable(initialFrame));
-                    } else {
-                        *(volumeOut->getMapPaletteColorMapping(curOutVol)) = *(myVol->getMapPaletteColorMapping(initialFrame));
-                    }
-                    ++curOutVol;
+                    frameList.push_back(make_pair(myVol, initialFrame));
                 }
             }
         } else {
-            vector<int64_t> myDims = myVol->getDimensions();
-            for (int64_t b = 0; b < myDims[3]; ++b)
+            for (int64_t b = 0; b < myVol->getNumberOfMaps(); ++b)
             {
-                for (int64_t c = 0; c < firstDims[4]; ++c)
-                {
-                    volumeOut->setFrame(myVol->getFrame(b, c), curOutVol, c);
-                }
-                volumeOut->setMapName(curOutVol, myVol->getMapName(b));
-                if (isLabel)
-                {
-                    *(volumeOut->getMapLabelTable(curOutVol)) = *(myVol->getMapLabelTable(b));
-                } else {
-                    *(volumeOut->getMapPaletteColorMapping(curOutVol)) = *(myVol->getMapPaletteColorMapping(b));
-                }
-                ++curOutVol;
+                frameList.push_back(make_pair(myVol, b));
+            }
+        }
+    }
+    int64_t subvolCount = (int64_t)frameList.size();
+    if (firstVol->getNumberOfComponents() != 1)
+    {//frames only hold one component, so merge the whole volumes in memory
+        map<VolumeFrameReader*, CaretPointer<VolumeFile> > wholeVolumes;
+        for (int64_t f = 0; f < subvolCount; ++f)
+        {
+            CaretPointer<VolumeFile>& thisVol = wholeVolumes[frameList[f].first];
+            if (thisVol == NULL)
+            {
+                thisVol.grabNew(new VolumeFile());
+                thisVol->readFile(frameList[f].first->getFileName());
+            }
+        }
+        const VolumeFile* firstWhole = wholeVolumes[frameList[0].first];
+        vector<int64_t> outDims = firstWhole->getOriginalDimensions(), firstDims = firstWhole->getDimensions();
+        outDims.resize(4);
+        outDims[3] = subvolCount;
+        VolumeFile mergeOut;
+        mergeOut.reinitialize(outDims, firstWhole->getSform(), firstDims[4], firstWhole->getType());
+        for (int64_t f = 0; f < subvolCount; ++f)
+        {
+            const VolumeFile* thisVol = wholeVolumes[frameList[f].first];
+            const int64_t b = frameList[f].second;
+            for (int64_t c = 0; c < firstDims[4]; ++c)
+            {
+                mergeOut.setFrame(thisVol->getFrame(b, c), f, c);
+            }
+            mergeOut.setMapName(f, thisVol->getMapName(b));
+            if (isLabel)
+            {
+                *(mergeOut.getMapLabelTable(f)) = *(thisVol->getMapLabelTable(b));
+            } else {
+                *(mergeOut.getMapPaletteColorMapping(f)) = *(thisVol->getMapPaletteColorMapping(b));
             }
+            myProgress.reportProgress(((float)f + 1) / subvolCount);
+        }
+        volumeOut->writeVolumeFile(mergeOut);
+        return;
+    }
+    map<VolumeFrameReader*, int64_t> lastFrame;
+    for (int64_t f = 0; f < subvolCount; ++f)
+    {//reading a frame before one already read restarts decompression of a .nii.gz, so decompress those inputs once instead
+        map<VolumeFrameReader*, int64_t>::iterator iter = lastFrame.find(frameList[f].first);
+        if (iter != lastFrame.end() && frameList[f].second <= iter->second)
+        {
+            frameList[f].first->decompressForSliceReads();
+        }
+        lastFrame[frameList[f].first] = frameList[f].second;
+    }
+    CaretVolumeExtension outExt;
+    outExt.m_attributes.resize(subvolCount);
+    for (int64_t f = 0; f < subvolCount; ++f)
+    {
+        const SubvolumeAttributes& inAttrib = *(frameList[f].first->getCaretExtension().m_attributes[frameList[f].second]);
+        outExt.m_attributes[f].grabNew(new SubvolumeAttributes());
+        outExt.m_attributes[f]->m_type = firstVol->getType();
+        outExt.m_attributes[f]->m_guiLabel = inAttrib.m_guiLabel;
+        if (isLabel)
+        {
+            outExt.m_attributes[f]->m_labelTable.grabNew(new GiftiLabelTable(*(inAttrib.m_labelTable)));
+        } else {
+            outExt.m_attributes[f]->m_palette.grabNew(new PaletteColorMapping(*(inAttrib.m_palette)));
         }
     }
-    CaretAssert(curOutVol == subvolCount);
+    vector<int64_t> outDims = firstVol->getOriginalDimensions();
+    outDims.resize(4);
+    outDims[3] = subvolCount;
+    volumeOut->writeHeader(outDims, firstVol->getVolumeSpace().getSform(), outExt);
+    vector<float> scratchFrame(firstVol->getFrameSize());
+    for (int64_t f = 0; f < subvolCount; ++f)
+    {
+        frameList[f].first->readFrame(scratchFrame.data(), frameList[f].second);
+        volumeOut->writeFrame(scratchFrame.data(), f);
+        myProgress.reportProgress(((float)f + 1) / subvolCount);
+    }
 }
@@ -30,6 +30,8 @@
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "VolumeFile.h"
+#include "VolumeFrameReader.h"
+#include "VolumeFrameWriter.h"
 
 using namespace std;
 using namespace caret;
@@ -327,6 +329,12 @@ void ParameterComponent::addVolumeParameter(const int32_t key, const AString& na
     m_paramList.push_back(new VolumeParameter(key, name, description));
 }
 
+void ParameterComponent::addOnDiskVolumeParameter(const int32_t key, const AString& name, const AString& description)
+{
+    CaretAssertMessage(checkUniqueInput(key, OperationParametersEnum::VOLUME), "input volume parameter created with previously used key");
+    m_paramList.push_back(new VolumeParameter(key, name, description, true));
+}
+
 void OperationParameters::setHelpText(const AString& textIn)
 {
     m_helpText = textIn;
@@ -374,6 +382,12 @@ void ParameterComponent::addVolumeOutputParameter(const int32_t key, const AStri
     m_outputList.push_back(new VolumeParameter(key, name, description));
 }
 
+void ParameterComponent::addOnDiskVolumeOutputParameter(const int32_t key, const AString& name, const AString& description)
+{
+    CaretAssertMessage(checkUniqueOutput(key, OperationParametersEnum::VOLUME), "output volume parameter created with previously used key");
+    m_outputList.push_back(new VolumeParameter(key, name, description, true));
+}
+
 AString& OperationParameters::getHelpText()
 {
     return m_helpText;
@@ -383,6 +397,21 @@ AbstractParameter::~AbstractParameter()
 {
 }
 
+VolumeParameter::VolumeParameter(const int32_t key, const AString& shortName, const AString& description, const bool& onDisk) :
+PointerTemplateParameter<VolumeFile, OperationParametersEnum::VOLUME>(key, shortName, description)
+{
+    m_onDisk = onDisk;
+}
+
+VolumeParameter::~VolumeParameter()
+{//defined here so the header doesn't need the reader and writer definitions
+}
+
+AbstractParameter* VolumeParameter::cloneAbstractParameter()
+{
+    return new VolumeParameter(m_key, m_shortName, m_description, m_onDisk);
+}
+
 bool ParameterComponent::getBoolean(const int32_t key)
 {
     return ((BooleanParameter*)getInputParameter(key, OperationParametersEnum::BOOL))->m_parameter;
@@ -435,7 +464,16 @@ SurfaceFile* ParameterComponent::getSurface(const int32_t key)
 
 VolumeFile* ParameterComponent::getVolume(const int32_t key)
 {
-    return ((VolumeParameter*)getInputParameter(key, OperationParametersEnum::VOLUME))->m_parameter.getPointer();
+    VolumeParameter* myParam = (VolumeParameter*)getInputParameter(key, OperationParametersEnum::VOLUME);
+    CaretAssertMessage(!myParam->m_onDisk, "getVolume called on on-disk volume parameter");
+    return myParam->m_parameter.getPointer();
+}
+
+VolumeFrameReader* ParameterComponent::getOnDiskVolume(const int32_t key)
+{
+    VolumeParameter* myParam = (VolumeParameter*)getInputParameter(key, OperationParametersEnum::VOLUME);
+    CaretAssertMessage(myParam->m_onDisk, "getOnDiskVolume called on in-memory volume parameter");
+    return myParam->m_reader.getPointer();
 }
 
 CiftiFile* ParameterComponent::getOutputCifti(const int32_t key)
@@ -465,7 +503,16 @@ SurfaceFile* ParameterComponent::getOutputSurface(const int32_t key)
 
 VolumeFile* ParameterComponent::getOutputVolume(const int32_t key)
 {
-    return ((VolumeParameter*)getOutputParameter(key, OperationParametersEnum::VOLUME))->m_parameter.getPointer();
+    VolumeParameter* myParam = (VolumeParameter*)getOutputParameter(key, OperationParametersEnum::VOLUME);
+    CaretAssertMessage(!myParam->m_onDisk, "getOutputVolume called on on-disk volume parameter");
+    return myParam->m_parameter.getPointer();
+}
+
+VolumeFrameWriter* ParameterComponent::getOnDiskOutputVolume(const int32_t key)
+{
+    VolumeParameter* myParam = (VolumeParameter*)getOutputParameter(key, OperationParametersEnum::VOLUME);
+    CaretAssertMessage(myParam->m_onDisk, "getOnDiskOutputVolume called on in-memory volume parameter");
+    return myParam->m_writer.getPointer();
 }
 
 MetricFile* ParameterComponent::getOutputMetric(const int32_t key)
@@ -36,6 +36,8 @@ namespace caret {
     class MetricFile;
     class SurfaceFile;
     class VolumeFile;
+    class VolumeFrameReader;
+    class VolumeFrameWriter;
     
     struct OptionalParameter;
     struct RepeatableOption;
@@ -110,6 +112,12 @@ namespace caret {
         ///get a volume with a key
         VolumeFile* getVolume(const int32_t key);
         
+        ///add a parameter to get next item as a volume that is read one frame at a time, rather than loaded into memory
+        void addOnDiskVolumeParameter(const int32_t key, const AString& name, const AString& description);
+        
+        ///get an on-disk volume with a key
+        VolumeFrameReader* getOnDiskVolume(const int32_t key);
+        
         ///add a parameter to get next item as a functional file (metric)
         void addMetricParameter(const int32_t key, const AString& name, const AString& description);
         
@@ -152,6 +160,12 @@ namespace caret {
         ///get a volume with a key
         VolumeFile* getOutputVolume(const int32_t key);
         
+        ///add a parameter to get next item as a volume that is written one frame at a time
+        void addOnDiskVolumeOutputParameter(const int32_t key, const AString& name, const AString& description);
+        
+        ///get an on-disk output volume with a key
+        VolumeFrameWriter* getOnDiskOutputVolume(const int32_t key);
+        
         ///add a parameter to get next item as a functional file (metric)
         void addMetricOutputParameter(const int32_t key, const AString& name, const AString& description);
         
@@ -326,7 +340,17 @@ namespace caret {
     
     //some friendlier names
     typedef PointerTemplateParameter<SurfaceFile, OperationParametersEnum::SURFACE> SurfaceParameter;
-    typedef PointerTemplateParameter<VolumeFile, OperationParametersEnum::VOLUME> VolumeParameter;
+    
+    ///volumes can optionally be streamed by frame instead of loaded, the parser fills in m_reader/m_writer instead of m_parameter when m_onDisk is set
+    struct VolumeParameter : public PointerTemplateParameter<VolumeFile, OperationParametersEnum::VOLUME>
+    {
+        bool m_onDisk;
+        CaretPointer<VolumeFrameReader> m_reader;
+        CaretPointer<VolumeFrameWriter> m_writer;
+        virtual AbstractParameter* cloneAbstractParameter();
+        VolumeParameter(const int32_t key, const AString& shortName, const AString& description, const bool& onDisk = false);
+        ~VolumeParameter();
+    };
     typedef PointerTemplateParameter<MetricFile, OperationParametersEnum::METRIC> MetricParameter;
     typedef PointerTemplateParameter<LabelFile, OperationParametersEnum::LABEL> LabelParameter;
     typedef PointerTemplateParameter<CiftiFile, OperationParametersEnum::CIFTI> CiftiParameter;
@@ -491,6 +491,41 @@ Palette::getPaletteColor(
     }
 }
 
+/**
+ * Bake the palette into a table of RGBA colors for evenly spaced
+ * normalized scalars from -1.0 to 1.0, so that coloring many values
+ * does not need to search the palette for each one.  Entries whose
+ * palette color is transparent ("none") are all zeros.
+ *
+ * @param resolution - number of entries per unit, the table has
+ *    (2 * resolution + 1) entries so that -1.0, 0.0 and 1.0 are sampled
+ *    exactly.  Use getPaletteColorLookupIndex() to find the entry.
+ * @param interpolateColorFlag - interpolate the color between scalars.
+ * @param rgbaLookupOut - output, 4 elements per entry.
+ */
+void
+Palette::getPaletteColorLookupTable(const int32_t resolution,
+                                    const bool interpolateColorFlag,
+                                    std::vector<float>& rgbaLookupOut) const
+{
+    CaretAssert(resolution > 0);
+    const int32_t numEntries = 2 * resolution + 1;
+    rgbaLookupOut.resize(numEntries * 4);
+    for (int32_t i = 0; i < numEntries; i++) {
+        float* rgba = &rgbaLookupOut[i * 4];
+        const float scalar = (i == resolution) ? 0.0f : ((float)i / resolution - 1.0f);
+        getPaletteColor(scalar,
+                        interpolateColorFlag,
+                        rgba);
+        if (rgba[3] <= 0.0f) {
+            rgba[0] = 0.0f;
+            rgba[1] = 0.0f;
+            rgba[2] = 0.0f;
+            rgba[3] = 0.0f;
+        }
+    }
+}
+
 /**
  * Set this object has been modified.
  *
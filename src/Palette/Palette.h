@@ -96,6 +96,22 @@ namespace caret {
                              const bool interpolateColorFlag,
                              float rgbaOut[4]) const;
         
+        void getPaletteColorLookupTable(const int32_t resolution,
+                                        const bool interpolateColorFlag,
+                                        std::vector<float>& rgbaLookupOut) const;
+        
+        /**
+         * Index into a table from getPaletteColorLookupTable() of the
+         * entry nearest to a normalized scalar in [-1, 1].
+         */
+        static inline int32_t getPaletteColorLookupIndex(const float normalizedScalar,
+                                                         const int32_t resolution) {
+            float clamped = normalizedScalar;
+            if (clamped > 1.0f) clamped = 1.0f;
+            if (!(clamped >= -1.0f)) clamped = -1.0f; // also catches NaN
+            return (int32_t)((clamped + 1.0f) * resolution + 0.5f);
+        }
+        
         void setModified();
         
         void clearModified();
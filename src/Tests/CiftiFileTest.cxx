@@ -20,6 +20,8 @@
 
 #include "CiftiFileTest.h"
 #include "CiftiFile.h"
+#include <algorithm>
+#include <vector>
 using namespace caret;
 CiftiFileTest::CiftiFileTest(const AString &identifier) : TestInterface(identifier)
 {
@@ -35,6 +37,8 @@ void CiftiFileTest::execute()
     if(this->failed()) return;
     testCiftiReadWriteOnDisk();
     if(this->failed()) return;
+    testCiftiBlockRows();
+    if(this->failed()) return;
 }
 
 void CiftiFileTest::testObjectCreateDestroy()
@@ -199,3 +203,58 @@ void CiftiFileTest::testCiftiReadWriteOnDisk()
     delete [] testRow;
 }
 
+void CiftiFileTest::testCiftiBlockRows()
+{
+    std::cout << "Testing Cifti block row reading/writing." << std::endl;
+    CiftiFile reader(this->m_default_path + "/cifti/DenseTimeSeries.dtseries.nii");
+    AString outFile = this->m_default_path + "/cifti/testBlockOut.dtseries.nii";
+    if(QFile::exists(outFile)) QFile::remove(outFile);
+    CiftiFile writer;
+    writer.setWritingFile(outFile);
+    writer.setCiftiXML(reader.getCiftiXMLOld());
+
+    std::vector <int64_t> dim = reader.getDimensions();
+    if (dim.size() != 2)
+    {
+        setFailed("input file must have 2 dimensions");
+        return;
+    }
+    int64_t rowSize = dim[0];
+    int64_t columnSize = dim[1];
+    const int64_t WRITE_BLOCK = 7, READ_BLOCK = 5;//different sizes that don't divide the row count, so blocks end mid-way through each other
+    std::vector<float> block(std::max(WRITE_BLOCK, READ_BLOCK) * rowSize), row(rowSize);
+    for(int64_t i = 0;i<columnSize;i+=WRITE_BLOCK)
+    {
+        int64_t thisRows = std::min(WRITE_BLOCK, columnSize - i);
+        reader.getRows(block.data(), i, thisRows);
+        for(int64_t r = 0;r<thisRows;r++)
+        {
+            reader.getRow(row.data(), i + r);
+            if(memcmp((void *)row.data(),(void *)(block.data() + r * rowSize),rowSize*sizeof(float)))
+            {
+                this->setFailed("getRows and getRow disagree on row " + AString::number(i + r));
+                return;
+            }
+        }
+        writer.setRows(block.data(), i, thisRows);
+    }
+    writer.writeFile(outFile);
+
+    //reopen output file, and check that blocks of rows agree
+    CiftiFile test(outFile);
+    for(int64_t i = 0;i<columnSize;i+=READ_BLOCK)
+    {
+        int64_t thisRows = std::min(READ_BLOCK, columnSize - i);
+        test.getRows(block.data(), i, thisRows);
+        for(int64_t r = 0;r<thisRows;r++)
+        {
+            reader.getRow(row.data(), i + r);
+            if(memcmp((void *)row.data(),(void *)(block.data() + r * rowSize),rowSize*sizeof(float)))
+            {
+                this->setFailed("Input and output Cifti file rows are not the same after block writing, row " + AString::number(i + r));
+                return;
+            }
+        }
+    }
+    std::cout << "Block reading and writing of Cifti was successful for all rows." << std::endl;
+}
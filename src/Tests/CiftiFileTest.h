@@ -32,6 +32,7 @@ public:
     void testCiftiRead();
     void testCiftiReadWriteInMemory();
     void testCiftiReadWriteOnDisk();
+    void testCiftiBlockRows();
 };
 
 } // namespace caret
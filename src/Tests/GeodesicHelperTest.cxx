@@ -22,6 +22,8 @@
 #include "GeodesicHelper.h"
 #include "SurfaceFile.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 
 using namespace caret;
@@ -96,4 +98,72 @@ void GeodesicHelperTest::execute()
         checkNodeLists(this, "Comparing normal to quarter areas, getPathFollowingData", nodesNorm, nodesQuarter);
         checkNodeLists(this, "Comparing normal to quad areas, getPathFollowingData", nodesNorm, nodesQuad);
     }
+    if (failed()) return;
+    testClosestNodesInRoi();
+}
+
+void GeodesicHelperTest::testClosestNodesInRoi()
+{//the single pass search must give the same distances as searching from each vertex separately
+    const int GRID = 20;
+    SurfaceFile gridSurf;
+    gridSurf.setNumberOfNodesAndTriangles(GRID * GRID, (GRID - 1) * (GRID - 1) * 2);
+    for (int j = 0; j < GRID; ++j)
+    {
+        for (int i = 0; i < GRID; ++i)
+        {
+            gridSurf.setCoordinate(j * GRID + i, i, j, 0.3f * ((float)rand()) / RAND_MAX);//jitter to avoid ties in distance
+        }
+    }
+    int triangle = 0;
+    for (int j = 0; j < GRID - 1; ++j)
+    {
+        for (int i = 0; i < GRID - 1; ++i)
+        {
+            const int32_t corner = j * GRID + i;
+            gridSurf.setTriangle(triangle++, corner, corner + 1, corner + GRID + 1);
+            gridSurf.setTriangle(triangle++, corner, corner + GRID + 1, corner + GRID);
+        }
+    }
+    const int numNodes = GRID * GRID;
+    vector<char> roi(numNodes, 0);
+    for (int i = 0; i < 12; ++i)
+    {
+        roi[rand() % numNodes] = 1;
+    }
+    CaretPointer<GeodesicHelperBase> gridBase(new GeodesicHelperBase(&gridSurf));
+    GeodesicHelper gridHelp(gridBase);
+    const float MAX_DIST = 4.0f;//small enough that some vertices have no roi vertex in range
+    for (int smooth = 0; smooth < 2; ++smooth)
+    {
+        vector<int32_t> closest;
+        vector<float> dists;
+        gridHelp.getClosestNodesInRoi(roi.data(), MAX_DIST, closest, dists, smooth != 0);
+        if ((int)closest.size() != numNodes || (int)dists.size() != numNodes)
+        {
+            setFailed("getClosestNodesInRoi returned the wrong number of vertices");
+            return;
+        }
+        for (int i = 0; i < numNodes; ++i)
+        {
+            float singleDist = -1.0f;
+            int32_t single = gridHelp.getClosestNodeInRoi(i, roi.data(), MAX_DIST, singleDist, smooth != 0);
+            if ((single == -1) != (closest[i] == -1))
+            {
+                setFailed("getClosestNodesInRoi and getClosestNodeInRoi disagree on whether vertex " + AString::number(i) + " has an roi vertex in range");
+                return;
+            }
+            if (single == -1) continue;
+            if (roi[closest[i]] == 0)
+            {
+                setFailed("getClosestNodesInRoi returned vertex " + AString::number(closest[i]) + ", which is outside the roi");
+                return;
+            }
+            if (abs(singleDist - dists[i]) > 0.0001f * max(1.0f, singleDist))
+            {
+                setFailed("getClosestNodesInRoi found distance " + AString::number(dists[i]) + " for vertex " + AString::number(i) +
+                          ", getClosestNodeInRoi found " + AString::number(singleDist));
+                return;
+            }
+        }
+    }
 }
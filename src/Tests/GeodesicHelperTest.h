@@ -29,6 +29,7 @@ namespace caret {
     public:
         GeodesicHelperTest(const AString& identifier);
         virtual void execute();
+        void testClosestNodesInRoi();
     };
 
 }
@@ -0,0 +1,196 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "GradientTest.h"
+
+#include "MetricGradientObject.h"
+#include "SurfaceFile.h"
+#include "VolumeGradientObject.h"
+#include "VolumeSpace.h"
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace caret;
+using namespace std;
+
+GradientTest::GradientTest(const AString& identifier): TestInterface(identifier)
+{
+}
+
+namespace
+{
+    ///scale is the size of the whole vector, so small components of large gradients aren't held to a tighter tolerance
+    bool closeEnough(const float& first, const float& second, const float& scale)
+    {
+        return abs(first - second) <= 0.0001f * (1.0f + scale);
+    }
+}
+
+void GradientTest::execute()
+{
+    testMetricGradient();
+    if (failed()) return;
+    testVolumeGradient();
+}
+
+void GradientTest::testMetricGradient()
+{//the precomputed operator must give the same results as solving each vertex for each column
+    const int GRID = 12, NUM_MAPS = 3;
+    SurfaceFile gridSurf;
+    gridSurf.setNumberOfNodesAndTriangles(GRID * GRID, (GRID - 1) * (GRID - 1) * 2);
+    for (int j = 0; j < GRID; ++j)
+    {
+        for (int i = 0; i < GRID; ++i)
+        {
+            gridSurf.setCoordinate(j * GRID + i, i, j, 0.3f * ((float)rand()) / RAND_MAX);//bumpy, so the normals and unrolling matter
+        }
+    }
+    int triangle = 0;
+    for (int j = 0; j < GRID - 1; ++j)
+    {
+        for (int i = 0; i < GRID - 1; ++i)
+        {
+            const int32_t corner = j * GRID + i;
+            gridSurf.setTriangle(triangle++, corner, corner + 1, corner + GRID + 1);
+            gridSurf.setTriangle(triangle++, corner, corner + GRID + 1, corner + GRID);
+        }
+    }
+    const int numNodes = GRID * GRID;
+    vector<float> columns(numNodes * NUM_MAPS), interleaved(numNodes * NUM_MAPS), roi(numNodes, 1.0f);
+    for (int m = 0; m < NUM_MAPS; ++m)
+    {
+        for (int i = 0; i < numNodes; ++i)
+        {
+            float value = ((float)rand()) / RAND_MAX;
+            columns[m * numNodes + i] = value;
+            interleaved[i * NUM_MAPS + m] = value;
+        }
+    }
+    for (int i = 0; i < numNodes / 4; ++i)
+    {
+        roi[rand() % numNodes] = 0.0f;//leaves some vertices with one or no in-roi neighbors
+    }
+    MetricGradientObject myGradient(&gridSurf);
+    for (int useRoi = 0; useRoi < 2; ++useRoi)
+    {
+        const float* roiData = (useRoi != 0 ? roi.data() : NULL);
+        const AString condition = (useRoi != 0 ? "with" : "without");
+        myGradient.buildOperator(roiData);
+        vector<float> opMag(numNodes * NUM_MAPS), opVec(numNodes * NUM_MAPS * 3), colMag(numNodes), colVec(numNodes * 3);
+        myGradient.applyOperator(interleaved.data(), NUM_MAPS, NUM_MAPS, opMag.data(), opVec.data());
+        for (int m = 0; m < NUM_MAPS; ++m)
+        {
+            myGradient.computeGradient(columns.data() + m * numNodes, colMag.data(), colVec.data(), roiData);
+            for (int i = 0; i < numNodes; ++i)
+            {
+                if (!closeEnough(opMag[i * NUM_MAPS + m], colMag[i], colMag[i]))
+                {
+                    setFailed("gradient operator " + condition + " roi gave magnitude " + AString::number(opMag[i * NUM_MAPS + m]) + " at vertex " + AString::number(i) +
+                              ", per-vertex method gave " + AString::number(colMag[i]));
+                    return;
+                }
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    if (!closeEnough(opVec[(i * NUM_MAPS + m) * 3 + axis], colVec[axis * numNodes + i], colMag[i]))
+                    {
+                        setFailed("gradient operator " + condition + " roi gave a different vector at vertex " + AString::number(i));
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void GradientTest::testVolumeGradient()
+{//the gradient of a linear function is exact for both regression stencils, and is projected onto the available axis by the averaging fallback
+    const int64_t dims[3] = { 6, 7, 5 };
+    vector<vector<float> > sform(3, vector<float>(4, 0.0f));
+    sform[0][0] = 2.0f;
+    sform[1][1] = 1.5f;
+    sform[2][2] = 3.0f;
+    sform[0][3] = -5.0f;
+    sform[1][3] = 4.0f;
+    sform[2][3] = 1.0f;
+    VolumeSpace mySpace(dims, sform);
+    const float slope[3] = { 0.3f, -0.7f, 1.1f };
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    vector<float> frame(frameSize);
+    for (int64_t k = 0; k < dims[2]; ++k)
+    {
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                float coord[3];
+                mySpace.indexToSpace(i, j, k, coord);
+                frame[i + dims[0] * (j + dims[1] * k)] = slope[0] * coord[0] + slope[1] * coord[1] + slope[2] * coord[2];
+            }
+        }
+    }
+    vector<float> holeRoi(frameSize, 1.0f), lineRoi(frameSize, 0.0f);
+    holeRoi[2 + dims[0] * (3 + dims[1] * 1)] = 0.0f;//the voxel between these is missing both k face neighbors, but has k diagonals, so it uses the 26 neighbor regression
+    holeRoi[2 + dims[0] * (3 + dims[1] * 3)] = 0.0f;
+    for (int64_t i = 0; i < dims[0]; ++i)
+    {
+        lineRoi[i + dims[0] * (3 + dims[1] * 2)] = 1.0f;//no neighbors off the i axis, so it uses the forward difference average
+    }
+    for (int test = 0; test < 3; ++test)
+    {
+        const float* roiFrame = (test == 0 ? NULL : (test == 1 ? holeRoi.data() : lineRoi.data()));
+        const AString condition = (test == 0 ? "without roi" : (test == 1 ? "with roi holes" : "with line roi"));
+        float expected[3] = { slope[0], slope[1], slope[2] };
+        if (test == 2)
+        {//only the i direction is known, which is x in this sform
+            expected[1] = 0.0f;
+            expected[2] = 0.0f;
+        }
+        const float expectedMag = sqrt(expected[0] * expected[0] + expected[1] * expected[1] + expected[2] * expected[2]);
+        VolumeGradientObject myGradient(mySpace, roiFrame);
+        vector<float> magOut(frameSize), vecOut(frameSize * 3);
+        myGradient.computeGradient(frame.data(), magOut.data(), vecOut.data());
+        for (int64_t voxel = 0; voxel < frameSize; ++voxel)
+        {
+            if (roiFrame != NULL && !(roiFrame[voxel] > 0.0f))
+            {
+                if (magOut[voxel] != 0.0f || vecOut[voxel] != 0.0f || vecOut[voxel + frameSize] != 0.0f || vecOut[voxel + frameSize * 2] != 0.0f)
+                {
+                    setFailed("volume gradient " + condition + " was nonzero outside the roi at voxel " + AString::number(voxel));
+                    return;
+                }
+                continue;
+            }
+            if (!closeEnough(magOut[voxel], expectedMag, expectedMag))
+            {
+                setFailed("volume gradient " + condition + " gave magnitude " + AString::number(magOut[voxel]) + " at voxel " + AString::number(voxel) +
+                          ", expected " + AString::number(expectedMag));
+                return;
+            }
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (!closeEnough(vecOut[voxel + frameSize * axis], expected[axis], expectedMag))
+                {
+                    setFailed("volume gradient " + condition + " gave a wrong vector at voxel " + AString::number(voxel));
+                    return;
+                }
+            }
+        }
+    }
+}
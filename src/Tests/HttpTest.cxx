@@ -18,16 +18,105 @@
  */
 /*LICENSE_END*/
 #include "HttpTest.h"
+#include "ByteRangeCache.h"
 #include "CaretHttpManager.h"
 
+#include <vector>
+
 using namespace caret;
+using namespace std;
 
 HttpTest::HttpTest(const AString& identifier) : TestInterface(identifier)
 {
 }
 
+namespace
+{
+    //serves ranges from memory, and records them, in place of a server
+    class MemoryRangeCache : public ByteRangeCache
+    {
+    public:
+        vector<char> m_contents;
+        vector<pair<int64_t, int64_t> > m_requests;
+        MemoryRangeCache(const int64_t& blockSize, const int64_t& maxBlocks) : ByteRangeCache(blockSize, maxBlocks) { }
+    protected:
+        void fetchRange(const int64_t& start, const int64_t& end, vector<char>& dataOut)
+        {
+            m_requests.push_back(make_pair(start, end));
+            dataOut.assign(m_contents.begin() + start, m_contents.begin() + end + 1);
+        }
+        AString getRangeSourceName() const { return "memory"; }
+    };
+}
+
+void HttpTest::testRangeReads()
+{
+    const int64_t BLOCK = 16, FILE_SIZE = 100;
+    MemoryRangeCache myCache(BLOCK, 4);
+    myCache.m_contents.resize(FILE_SIZE);
+    for (int64_t i = 0; i < FILE_SIZE; ++i)
+    {
+        myCache.m_contents[i] = (char)(i * 7 + 3);
+    }
+    myCache.setFileSize(FILE_SIZE);
+    struct ReadCheck
+    {
+        int64_t position, count, expectedCount, requestStart, requestEnd;//requestStart of -1 means it should be served from cache
+    };
+    const ReadCheck checks[] = { { 5, 40, 40, 0, 47 },//spans blocks 0 to 2, fetched in one request
+                                 { 20, 10, 10, -1, -1 },//inside block 1, already cached
+                                 { 90, 20, 10, 80, 99 },//short read at the end, the range stops at the last byte, blocks 5 and 6 evict block 0
+                                 { 40, 30, 30, 48, 79 },//block 2 is cached, blocks 3 and 4 are fetched together, evicting blocks 1 and 5
+                                 { 0, 8, 8, 0, 15 },//block 0 is no longer cached
+                                 { 120, 5, 0, -1, -1 } };//past the end
+    vector<char> buffer;
+    for (int c = 0; c < (int)(sizeof(checks) / sizeof(ReadCheck)); ++c)
+    {
+        const ReadCheck& thisCheck = checks[c];
+        const AString readName = "range read of " + AString::number(thisCheck.count) + " bytes at " + AString::number(thisCheck.position);
+        const size_t requestsBefore = myCache.m_requests.size();
+        buffer.assign(thisCheck.count, 0);
+        int64_t numRead = myCache.readRange(buffer.data(), thisCheck.position, thisCheck.count);
+        if (numRead != thisCheck.expectedCount)
+        {
+            setFailed(readName + " returned " + AString::number(numRead) + " bytes, expected " + AString::number(thisCheck.expectedCount));
+            return;
+        }
+        for (int64_t i = 0; i < numRead; ++i)
+        {
+            if (buffer[i] != myCache.m_contents[thisCheck.position + i])
+            {
+                setFailed(readName + " returned wrong data at offset " + AString::number(i));
+                return;
+            }
+        }
+        if (thisCheck.requestStart == -1)
+        {
+            if (myCache.m_requests.size() != requestsBefore)
+            {
+                setFailed(readName + " made a request, expected it to be served from cache");
+                return;
+            }
+        } else {
+            if (myCache.m_requests.size() != requestsBefore + 1 || myCache.m_requests.back().first != thisCheck.requestStart ||
+                myCache.m_requests.back().second != thisCheck.requestEnd)
+            {
+                setFailed(readName + " did not make exactly one request for bytes " + AString::number(thisCheck.requestStart) + "-" + AString::number(thisCheck.requestEnd));
+                return;
+            }
+        }
+        if (myCache.getNumberOfCachedBlocks() > 4)
+        {
+            setFailed("range cache grew past its limit after " + readName);
+            return;
+        }
+    }
+}
+
 void HttpTest::execute()
 {
+    testRangeReads();
+    if (failed()) return;
     CaretHttpManager* myMgr = CaretHttpManager::getHttpManager();
     CaretHttpRequest myReq;
     myReq.m_url = "http://www.google.com/";
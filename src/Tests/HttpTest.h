@@ -28,6 +28,7 @@ namespace caret
 
     class HttpTest : public TestInterface
     {
+        void testRangeReads();
     public:
         HttpTest(const AString& identifier);
         virtual void execute();
@@ -23,6 +23,7 @@
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <cmath>
 #include <vector>
 
 using namespace std;
@@ -38,6 +39,7 @@ void NiftiFileTest::execute()
     if(this->failed()) return;
     testNiftiReadWrite();
     if(this->failed()) return;
+    testIntegerScaling();
 }
 
 void NiftiFileTest::testNiftiReadWrite()
@@ -90,6 +92,61 @@ void NiftiFileTest::testNiftiReadWrite()
     std::cout << "Reading and writing of Nifti was successful for all frames." << std::endl;
 }
 
+void NiftiFileTest::testIntegerScaling()
+{
+    std::cout << "Testing Nifti integer output scaling." << std::endl;
+    const int64_t numElems = 4 * 4 * 4;
+    vector<float> data(numElems);
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        data[i] = (i - 30) * 3.7f;//not integers, so INT16 output needs scaling
+    }
+    data[5] = numeric_limits<float>::quiet_NaN();//non-finite values are left out of the range, and must not break the conversion
+    double minVal = numeric_limits<double>::infinity(), maxVal = -numeric_limits<double>::infinity(), mult = 1.0, offset = 0.0;
+    bool allIntegers = true;
+    NiftiHeader::accumulateDataRange(data.data(), numElems, minVal, maxVal, allIntegers);
+    if (!NiftiHeader::computeDataScaling(NIFTI_TYPE_INT16, minVal, maxVal, allIntegers, mult, offset))
+    {
+        setFailed("non-integer data was not scaled for INT16 output");
+        return;
+    }
+    NiftiHeader header;
+    vector<int64_t> dims(3, 4);
+    header.setDimensions(dims);
+    vector<vector<float> > sform(3, vector<float>(4, 0.0f));
+    for (int i = 0; i < 3; ++i) sform[i][i] = 1.0f;
+    header.setSForm(sform);
+    header.setDataType(NIFTI_TYPE_INT16);
+    header.setDataScaling(mult, offset);
+    AString outFile = this->m_default_path + "/nifti/NiftiScalingTestOut.nii";
+    NiftiIO writer;
+    writer.writeNew(outFile, header);
+    writer.writeData(data.data(), 3, vector<int64_t>());
+    writer.close();
+    NiftiIO test;
+    test.openRead(outFile);
+    vector<float> dataTest(numElems);
+    test.readData(dataTest.data(), 3, vector<int64_t>());
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        if (i == 5)
+        {
+            if (dataTest[i] != dataTest[i] || abs(dataTest[i]) > mult * 0.51)//raw 0 would decode to the intercept, so it must be written as the step nearest 0
+            {
+                setFailed("NaN input read back as " + AString::number(dataTest[i]) + ", expected 0");
+                return;
+            }
+            continue;
+        }
+        if (abs(data[i] - dataTest[i]) > mult * 0.51)//rounding to the nearest step
+        {
+            setFailed("INT16 scaled value " + AString::number(i) + " read back as " + AString::number(dataTest[i]) + ", expected " + AString::number(data[i]));
+            return;
+        }
+    }
+    std::cout << "Integer scaling round trip of Nifti was successful." << std::endl;
+}
+
 //Tests for reading and writing Nifti Headers
 
 NiftiHeaderTest::NiftiHeaderTest(const AString &identifier) : TestInterface(identifier)
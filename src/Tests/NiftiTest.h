@@ -32,6 +32,7 @@ public:
     NiftiFileTest(const AString& identifier);
     virtual void execute();
     void testNiftiReadWrite();
+    void testIntegerScaling();
 };
 
 class NiftiHeaderTest : public TestInterface
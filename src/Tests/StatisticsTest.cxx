@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <cmath>
 
+#include "ColumnStatistics.h"
 #include "FastStatistics.h"
 #include "DescriptiveStatistics.h"
 
@@ -76,4 +77,95 @@ void StatisticsTest::execute()
     {
         setFailed(AString("mismatch in 90% negative percentile, full: ") + AString::number(myFullStats.getNegativePercentile(90.0f)) + ", fast: " + AString::number(myFastStats.getApproxNegativePercentile(90.0f)));
     }
+    const int NUM_COLUMN = 1001;//median and percentiles reorder a working copy, make sure the index reductions don't see that
+    int indexMax = 0, indexMin = 0;
+    for (int i = 1; i < NUM_COLUMN; ++i)
+    {
+        if (myData[i] > myData[indexMax]) indexMax = i;
+        if (myData[i] < myData[indexMin]) indexMin = i;
+    }
+    vector<ReductionEnum::Enum> myReductions;
+    myReductions.push_back(ReductionEnum::MEDIAN);
+    myReductions.push_back(ReductionEnum::INDEXMAX);
+    myReductions.push_back(ReductionEnum::INDEXMIN);
+    vector<float> myPercentiles(1, 90.0f), myColumnResults;
+    ColumnStatistics::computeColumn(myData.data(), NUM_COLUMN, NULL, myReductions, myPercentiles, myColumnResults);
+    DescriptiveStatistics myColumnStats;
+    myColumnStats.update(myData.data(), NUM_COLUMN);
+    if (abs(myColumnResults[0] - myColumnStats.getMedian()) > exacttolerance)
+    {
+        setFailed(AString("mismatch in column median, full: ") + AString::number(myColumnStats.getMedian()) + ", column: " + AString::number(myColumnResults[0]));
+    }
+    if ((int)myColumnResults[1] != indexMax + 1)//1-based, like ReductionOperation
+    {
+        setFailed(AString("mismatch in column index of max, expected: ") + AString::number(indexMax + 1) + ", column: " + AString::number(myColumnResults[1]));
+    }
+    if ((int)myColumnResults[2] != indexMin + 1)
+    {
+        setFailed(AString("mismatch in column index of min, expected: ") + AString::number(indexMin + 1) + ", column: " + AString::number(myColumnResults[2]));
+    }
+    testColumnStreaming();
+}
+
+void StatisticsTest::testColumnStreaming()
+{//adding rows one at a time, as -cifti-stats does, must give the same results as computing each column in memory
+    const int NUM_ROWS = 201, NUM_COLS = 7;//more rows than one buffered block, and not a multiple of it
+    vector<float> matrix(NUM_ROWS * NUM_COLS), roiMatrix(NUM_ROWS * NUM_COLS);
+    for (int i = 0; i < NUM_ROWS * NUM_COLS; ++i)
+    {
+        matrix[i] = (rand() % 5 == 0 ? 0.0f : (rand() * 100.0f / RAND_MAX) - 50.0f);//some zeros for COUNT_NONZERO
+        roiMatrix[i] = (rand() % 3 == 0 ? 0.0f : 1.0f);
+    }
+    vector<ReductionEnum::Enum> myReductions;
+    myReductions.push_back(ReductionEnum::MEAN);
+    myReductions.push_back(ReductionEnum::SUM);
+    myReductions.push_back(ReductionEnum::MEDIAN);
+    myReductions.push_back(ReductionEnum::STDEV);
+    myReductions.push_back(ReductionEnum::SAMPSTDEV);
+    myReductions.push_back(ReductionEnum::MAX);
+    myReductions.push_back(ReductionEnum::MIN);
+    myReductions.push_back(ReductionEnum::INDEXMAX);
+    myReductions.push_back(ReductionEnum::INDEXMIN);
+    myReductions.push_back(ReductionEnum::COUNT_NONZERO);
+    vector<float> myPercentiles;
+    myPercentiles.push_back(25.0f);
+    myPercentiles.push_back(90.0f);
+    for (int useRoi = 0; useRoi < 2; ++useRoi)
+    {
+        const AString condition = (useRoi != 0 ? "with" : "without");
+        ColumnStatistics myStats(NUM_COLS, myReductions, myPercentiles);
+        for (int r = 0; r < NUM_ROWS; ++r)
+        {
+            myStats.addRow(matrix.data() + r * NUM_COLS, (useRoi != 0 ? roiMatrix.data() + r * NUM_COLS : NULL));
+        }
+        vector<vector<float> > streamResults;
+        myStats.getResults(streamResults);
+        vector<float> column(NUM_ROWS), roiColumn(NUM_ROWS), columnResults;
+        for (int c = 0; c < NUM_COLS; ++c)
+        {
+            for (int r = 0; r < NUM_ROWS; ++r)
+            {
+                column[r] = matrix[r * NUM_COLS + c];
+                roiColumn[r] = roiMatrix[r * NUM_COLS + c];
+            }
+            ColumnStatistics::computeColumn(column.data(), NUM_ROWS, (useRoi != 0 ? roiColumn.data() : NULL), myReductions, myPercentiles, columnResults);
+            if (streamResults[c].size() != columnResults.size())
+            {
+                setFailed("streamed column statistics " + condition + " roi returned the wrong number of results");
+                return;
+            }
+            for (int i = 0; i < (int)columnResults.size(); ++i)
+            {
+                AString name = (i < (int)myReductions.size() ? ReductionEnum::toName(myReductions[i]) : "percentile " + AString::number(myPercentiles[i - myReductions.size()]));
+                bool isIndex = (i < (int)myReductions.size() && (myReductions[i] == ReductionEnum::INDEXMAX || myReductions[i] == ReductionEnum::INDEXMIN ||
+                                                                 myReductions[i] == ReductionEnum::COUNT_NONZERO));
+                if (isIndex ? streamResults[c][i] != columnResults[i] : abs(streamResults[c][i] - columnResults[i]) > 0.0001f * (1.0f + abs(columnResults[i])))
+                {
+                    setFailed("streamed column statistics " + condition + " roi gave " + name + " of " + AString::number(streamResults[c][i]) + " in column " + AString::number(c) +
+                              ", in-memory gave " + AString::number(columnResults[i]));
+                    return;
+                }
+            }
+        }
+    }
 }
@@ -26,6 +26,7 @@ namespace caret {
 
    class StatisticsTest : public TestInterface
    {
+      void testColumnStreaming();
    public:
       StatisticsTest(const AString& identifier);
       virtual void execute();
@@ -18,10 +18,14 @@
  */
 /*LICENSE_END*/
 #include "TopologyHelperTest.h"
+#include "DataFileException.h"
 #include "SurfaceFile.h"
+#include "SurfaceHelperCache.h"
 #include "TopologyHelper.h"
 #include "TopologyHelperOld.h"
 
+#include <QFile>
+
 #include <cstdlib>
 
 using namespace caret;
@@ -97,4 +101,80 @@ void TopologyHelperTest::execute()
             }
         }
     }
+    testCacheFile(mySurf);
+}
+
+void TopologyHelperTest::testCacheFile(const SurfaceFile& mySurf)
+{
+    AString cacheName = m_default_path + "/gifti/testOut.topo";
+    if (QFile::exists(cacheName)) QFile::remove(cacheName);
+    uint64_t hash = SurfaceHelperCache::computeTopologyHash(&mySurf);
+    CaretPointer<TopologyHelperBase> builtBase(new TopologyHelperBase(&mySurf, true));
+    builtBase->writeCacheFile(cacheName, hash);
+    CaretPointer<TopologyHelperBase> readBase;
+    try
+    {
+        readBase.grabNew(TopologyHelperBase::readCacheFile(cacheName, &mySurf, hash));
+    } catch (DataFileException& e) {
+        setFailed("failed to read topology helper cache file: " + e.whatString());
+        QFile::remove(cacheName);
+        return;
+    }
+    if (readBase == NULL)
+    {
+        setFailed("topology helper cache file was rejected for the surface it was written from");
+        QFile::remove(cacheName);
+        return;
+    }
+    TopologyHelper builtHelp(builtBase), readHelp(readBase);
+    if (builtHelp.isNodeInfoSorted() != readHelp.isNodeInfoSorted() || builtHelp.getMaximumNumberOfNeighbors() != readHelp.getMaximumNumberOfNeighbors())
+    {
+        setFailed("topology helper cache file changed sorted flag or maximum neighbors");
+    }
+    for (int32_t i = 0; i < mySurf.getNumberOfNodes(); ++i)
+    {
+        if (builtHelp.getNodeNeighbors(i) != readHelp.getNodeNeighbors(i) || builtHelp.getNodeEdges(i) != readHelp.getNodeEdges(i) ||
+            builtHelp.getNodeTiles(i) != readHelp.getNodeTiles(i))
+        {
+            setFailed("topology helper cache file changed neighbor, edge, or tile lists of node " + AString::number(i));
+            break;
+        }
+    }
+    if (builtHelp.getNumberOfBoundaryEdgesForAllNodes() != readHelp.getNumberOfBoundaryEdgesForAllNodes())
+    {
+        setFailed("topology helper cache file changed boundary counts");
+    }
+    const vector<TopologyEdgeInfo>& builtEdges = builtHelp.getEdgeInfo(), readEdges = readHelp.getEdgeInfo();
+    if (builtEdges.size() != readEdges.size())
+    {
+        setFailed("topology helper cache file changed the number of edges");
+    } else {
+        for (size_t i = 0; i < builtEdges.size(); ++i)
+        {
+            if (builtEdges[i].node1 != readEdges[i].node1 || builtEdges[i].node2 != readEdges[i].node2 || builtEdges[i].numTiles != readEdges[i].numTiles ||
+                builtEdges[i].tiles[0].tile != readEdges[i].tiles[0].tile)
+            {
+                setFailed("topology helper cache file changed edge " + AString::number(i));
+                break;
+            }
+        }
+    }
+    //corrupt the edge index of the last tile's last edge, which is the last thing in the file, and make sure it is rejected rather than used
+    QFile corruptFile(cacheName);
+    if (!corruptFile.open(QIODevice::ReadWrite) || !corruptFile.seek(corruptFile.size() - (qint64)sizeof(TopologyTileInfo::Edge)))
+    {
+        setFailed("unable to open topology helper cache file for corruption");
+        QFile::remove(cacheName);
+        return;
+    }
+    int32_t badEdge = (int32_t)builtEdges.size() + 1000;
+    corruptFile.write((const char*)&badEdge, sizeof(int32_t));
+    corruptFile.close();
+    try
+    {
+        CaretPointer<TopologyHelperBase> corruptBase(TopologyHelperBase::readCacheFile(cacheName, &mySurf, hash));
+        setFailed("corrupted topology helper cache file was not rejected");
+    } catch (DataFileException&) {//expected
+    }
+    QFile::remove(cacheName);
 }
@@ -24,8 +24,11 @@
 
 namespace caret {
 
+    class SurfaceFile;
+    
     class TopologyHelperTest : public TestInterface
     {
+        void testCacheFile(const SurfaceFile& mySurf);
     public:
         TopologyHelperTest(const AString& identifier);
         virtual void execute();
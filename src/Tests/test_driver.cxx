@@ -35,6 +35,7 @@
 //tests
 #include "CiftiFileTest.h"
 #include "GeodesicHelperTest.h"
+#include "GradientTest.h"
 #include "HttpTest.h"
 #include "HeapTest.h"
 #include "LookupTest.h"
@@ -70,6 +71,7 @@ int main(int argc, char** argv)
         vector<TestInterface*> mytests;
         mytests.push_back(new CiftiFileTest("ciftifile"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
+        mytests.push_back(new GradientTest("gradient"));
         mytests.push_back(new HeapTest("heap"));
         mytests.push_back(new HttpTest("http"));
         mytests.push_back(new LookupTest("lookup"));